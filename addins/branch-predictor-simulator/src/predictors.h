@@ -0,0 +1,147 @@
+///////////////////////////////////////////
+// predictors.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Trace-driven models of the Wally branch predictors in src/ifu/bpred.
+//          Each model has the same tables as the RTL (2-bit counters reset to 0,
+//          the same PC hash, history shifted in at the MSB) and is stepped once per
+//          committed conditional branch, in program order.  They model the
+//          predictors, not the pipeline, so their rates approximate the RTL's rather
+//          than matching it bit for bit; see GShare for how the history differs.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PREDICTORS_H
+#define PREDICTORS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// {PC[k+1] ^ PC[1], PC[k:2]}: the index hash shared by the PHTs and the BTB
+static inline uint32_t pcIndex(uint64_t pc, int k) {
+  return ((pc >> 2) & ((1u << (k - 1)) - 1)) | ((((pc >> (k + 1)) ^ (pc >> 1)) & 1) << (k - 1));
+}
+
+// satCounter2
+static inline uint8_t satCounter2(uint8_t old, bool taken) {
+  if (taken) return old == 3 ? 3 : old + 1;
+  return old == 0 ? 0 : old - 1;
+}
+
+// Direction predictor interface: predict() is called before update() for each branch.
+class DirPredictor {
+ public:
+  virtual ~DirPredictor() {}
+  virtual bool predict(uint64_t pc) = 0;
+  virtual void update(uint64_t pc, bool taken) = 0;
+  virtual void reset() = 0;
+};
+
+// twoBitPredictor.sv: 2^k counters indexed by the PC hash
+class TwoBit : public DirPredictor {
+ public:
+  explicit TwoBit(int k) : k(k), pht(1u << k) {}
+  bool predict(uint64_t pc) override { idx = pcIndex(pc, k); return pht[idx] >> 1; }
+  void update(uint64_t, bool taken) override { pht[idx] = satCounter2(pht[idx], taken); }
+  void reset() override { std::fill(pht.begin(), pht.end(), 0); }
+ private:
+  int k;
+  uint32_t idx = 0;
+  std::vector<uint8_t> pht;
+};
+
+// gshare.sv / gsharebasic.sv: TYPE 1 XORs an n-bit global history into the top of the
+// PC hash (n = k in Wally), TYPE 0 (BP_GLOBAL) indexes by history alone.  New outcomes
+// enter at the MSB: GHR <= {PCSrc, GHR[n-1:1]}.
+// Here the history is the resolved outcome of every earlier branch.  The RTL reads the
+// table at fetch with a speculative history, built from the committed GHR and the
+// branches still in the pipeline (predicted in Decode, resolved after), and repaired
+// by the flush when one of them was mispredicted.  The two agree for most branches but
+// not all, e.g. the fetch after a branch the BTB did not mark as one misses its bit.
+class GShare : public DirPredictor {
+ public:
+  GShare(int k, int n, bool usePC) : k(k), n(n), usePC(usePC), pht(1u << k) {}
+  bool predict(uint64_t pc) override {
+    idx = (ghr << (k - n)) ^ (usePC ? pcIndex(pc, k) : 0);
+    return pht[idx] >> 1;
+  }
+  void update(uint64_t, bool taken) override {
+    pht[idx] = satCounter2(pht[idx], taken);
+    if (n) ghr = (ghr >> 1) | ((uint32_t)taken << (n - 1));
+  }
+  void reset() override { std::fill(pht.begin(), pht.end(), 0); ghr = 0; }
+ private:
+  int k, n;
+  bool usePC;
+  uint32_t ghr = 0, idx = 0;
+  std::vector<uint8_t> pht;
+};
+
+// localHistoryPredictor.sv (PAg): 2^m local history registers of k bits selected by
+// the PC hash, indexing one shared table of 2^k counters
+class LocalHistory : public DirPredictor {
+ public:
+  LocalHistory(int m, int k) : m(m), k(k), lhr(1u << m), pht(1u << k) {}
+  bool predict(uint64_t pc) override {
+    slot = pcIndex(pc, m);
+    return pht[lhr[slot]] >> 1;
+  }
+  void update(uint64_t, bool taken) override {
+    uint32_t &h = lhr[slot];
+    pht[h] = satCounter2(pht[h], taken);
+    h = (h >> 1) | ((uint32_t)taken << (k - 1));
+  }
+  void reset() override {
+    std::fill(lhr.begin(), lhr.end(), 0);
+    std::fill(pht.begin(), pht.end(), 0);
+  }
+ private:
+  int m, k;
+  uint32_t slot = 0;
+  std::vector<uint32_t> lhr;
+  std::vector<uint8_t> pht;
+};
+
+// btb.sv: direct mapped and untagged, holding {InstrClass, target} per entry.  With
+// INSTR_CLASS_PRED the BTB also supplies the instruction class, so a branch the BTB
+// does not hold is fetched as a non-branch (falls through).  The entry is rewritten
+// whenever the class or target was wrong.  Direct branch targets are fixed per PC, so
+// the owning branch's PC stands in for the stored target.
+class BTB {
+ public:
+  explicit BTB(int depth) : depth(depth), owner(depth ? 1u << depth : 0) {}
+  bool enabled() const { return depth > 0; }
+  // isBranch: the fetch stage sees a branch; hit: its target is this branch's
+  void lookup(uint64_t pc, bool &isBranch, bool &hit) {
+    idx = pcIndex(pc, depth);
+    isBranch = owner[idx] != 0;
+    hit = owner[idx] == pc + 1;
+  }
+  void update(uint64_t pc) { owner[idx] = pc + 1; }   // 0 marks an empty (reset) entry
+  void reset() { std::fill(owner.begin(), owner.end(), 0); }
+ private:
+  int depth;
+  uint32_t idx = 0;
+  std::vector<uint64_t> owner;
+};
+
+#endif
@@ -0,0 +1,246 @@
+///////////////////////////////////////////
+// sim_bp.cpp
+//
+// Written: Wally team 2023
+//
+// Purpose: Trace-driven branch predictor simulator.  Replays the branch_<type><size>
+//          logs (or binary .wtr traces) written by the BranchLogger in testbench.sv
+//          through the models in predictors.h.  Every requested predictor type and
+//          size is evaluated from a single read of each trace, spread over threads.
+//
+//   sim_bp [-t twobit,gshare,global,local] [-s 6,8,10,12,14,16] [-b btbbits]
+//          [-m localm] [-j threads] [-o out.csv] trace...
+//   sim_bp bimodal <M2> [<btbbits> <assoc>] trace        (bin/CModelBranchAccuracy.sh)
+//   sim_bp gshare <M1> <N> [<btbbits> <assoc>] trace
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "predictors.h"
+#include "wallytrace.h"
+
+// trace records: PC << 1 | taken, or RESET for a TRAIN marker (the predictor is reset)
+static const uint64_t RESET = ~0ull;
+
+struct Trace {
+  std::string name;
+  std::vector<uint64_t> rec;
+};
+
+struct Config {
+  std::string type;
+  int size, btbBits, localM, histBits;
+};
+
+struct Result {
+  uint64_t branches = 0, dirWrong = 0, wrong = 0;
+  double rate() const { return branches ? 100.0 * wrong / branches : 0; }
+};
+
+static void usage(const char *prog) {
+  fprintf(stderr, "usage: %s [options] trace...\n"
+          "  -t, --types LIST   twobit, gshare, global, gshare_basic, global_basic, local\n"
+          "                     (default twobit,gshare,global,local)\n"
+          "  -s, --sizes LIST   BPRED_SIZE values (default 6,8,10,12,14,16)\n"
+          "  -b, --btb N        BTB_SIZE index bits, 0 for a perfect BTB (default 10)\n"
+          "  -m, --localm N     local history registers = 2^N for 'local' (default 6)\n"
+          "  -j, --threads N    worker threads (default: hardware threads)\n"
+          "  -o, --output FILE  CSV output (default stdout)\n"
+          "       %s bimodal <M2> [<btbbits> <assoc>] trace\n"
+          "       %s gshare <M1> <N> [<btbbits> <assoc>] trace\n", prog, prog, prog);
+  exit(2);
+}
+
+static std::vector<std::string> split(const char *s) {
+  std::vector<std::string> v;
+  std::string cur;
+  for (; ; s++) {
+    if (*s == ',' || !*s) { if (!cur.empty()) v.push_back(cur); cur.clear(); if (!*s) break; }
+    else cur += *s;
+  }
+  return v;
+}
+
+static bool loadTrace(const char *path, Trace &t) {
+  wt_reader *r = wt_open(path);
+  wt_event e;
+  int st;
+  if (!r) return false;
+  if (wt_kind(r) && wt_kind(r) != WT_KIND_BRANCH) {
+    fprintf(stderr, "sim_bp: %s is not a branch trace\n", path);
+    wt_close(r);
+    return false;
+  }
+  t.name = path;
+  while ((st = wt_next(r, &e)) > 0) {
+    if (e.type == WT_TRAIN) t.rec.push_back(RESET);
+    else if (e.type == WT_BRANCH) t.rec.push_back(e.addr << 1 | e.taken);
+  }
+  wt_close(r);
+  if (st < 0) fprintf(stderr, "sim_bp: malformed record in %s\n", path);
+  return st == 0;
+}
+
+static std::unique_ptr<DirPredictor> makePredictor(const Config &c) {
+  if (c.type == "twobit") return std::unique_ptr<DirPredictor>(new TwoBit(c.size));
+  // the _basic variants differ from gshare/global only in pipeline forwarding,
+  // which has no effect once branches are replayed one at a time in order
+  if (c.type == "gshare" || c.type == "gshare_basic")
+    return std::unique_ptr<DirPredictor>(new GShare(c.size, c.histBits, true));
+  if (c.type == "global" || c.type == "global_basic")
+    return std::unique_ptr<DirPredictor>(new GShare(c.size, c.histBits, false));
+  if (c.type == "local") return std::unique_ptr<DirPredictor>(new LocalHistory(c.localM, c.size));
+  return nullptr;
+}
+
+static Result simulate(const Config &c, const Trace &t) {
+  std::unique_ptr<DirPredictor> p = makePredictor(c);
+  BTB btb(c.btbBits);
+  Result res;
+  for (uint64_t rec : t.rec) {
+    if (rec == RESET) { p->reset(); btb.reset(); continue; }
+    uint64_t pc = rec >> 1;
+    bool taken = rec & 1, isBranch = true, hit = true;
+    bool dir = p->predict(pc);
+    if (btb.enabled()) btb.lookup(pc, isBranch, hit);
+    // fetch only redirects if the BTB classifies the PC as a branch, and then to the
+    // BTB's target; a branch unknown to the BTB behaves as predicted not taken
+    bool fetchTaken = isBranch && dir;
+    res.branches++;
+    res.dirWrong += dir != taken;
+    res.wrong += taken ? !(fetchTaken && hit) : fetchTaken;
+    p->update(pc, taken);
+    if (btb.enabled() && !hit) btb.update(pc);
+  }
+  return res;
+}
+
+// bimodal/gshare invocation kept for bin/CModelBranchAccuracy.sh; the last
+// line's fourth field is the misprediction rate
+static int legacy(int argc, char **argv) {
+  Config c;
+  std::vector<int> n;
+  for (int i = 2; i < argc - 1; i++) n.push_back(atoi(argv[i]));
+  bool gshare = !strcmp(argv[1], "gshare");
+  size_t need = gshare ? 2 : 1;
+  if (n.size() != need && n.size() != need + 2) usage(argv[0]);
+  c.type = gshare ? "gshare" : "twobit";
+  c.size = n[0];
+  c.histBits = gshare ? n[1] : 0;
+  c.btbBits = n.size() > need ? n[need] : 0;
+  c.localM = 0;
+  if (c.size < 1 || c.size > 24 || c.histBits < 0 || c.histBits > c.size || c.btbBits < 0 || c.btbBits > 24) {
+    fprintf(stderr, "sim_bp: table sizes must be 1-24 bits with N <= M1\n");
+    return 2;
+  }
+  Trace t;
+  if (!loadTrace(argv[argc - 1], t)) return 1;
+  Result r = simulate(c, t);
+  printf("number of predictions:    %llu\n", (unsigned long long)r.branches);
+  printf("number of direction mispredictions: %llu\n", (unsigned long long)r.dirWrong);
+  printf("number of mispredictions: %llu\n", (unsigned long long)r.wrong);
+  printf("branch misprediction rate: %.4f\n", r.rate());
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && (!strcmp(argv[1], "bimodal") || !strcmp(argv[1], "gshare"))) return legacy(argc, argv);
+
+  std::vector<std::string> types = {"twobit", "gshare", "global", "local"};
+  std::vector<std::string> sizes = {"6", "8", "10", "12", "14", "16"};
+  std::vector<const char *> files;
+  int btbBits = 10, localM = 6, threads = std::thread::hardware_concurrency();
+  const char *output = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a[0] != '-') { files.push_back(argv[i]); continue; }
+    if (i + 1 == argc) usage(argv[0]);
+    const char *v = argv[++i];
+    if (a == "-t" || a == "--types") types = split(v);
+    else if (a == "-s" || a == "--sizes") sizes = split(v);
+    else if (a == "-b" || a == "--btb") btbBits = atoi(v);
+    else if (a == "-m" || a == "--localm") localM = atoi(v);
+    else if (a == "-j" || a == "--threads") threads = atoi(v);
+    else if (a == "-o" || a == "--output") output = v;
+    else usage(argv[0]);
+  }
+  if (files.empty() || btbBits < 0 || btbBits > 24 || localM < 1 || localM > 24) usage(argv[0]);
+  if (threads < 1) threads = 1;
+
+  std::vector<Config> configs;
+  for (const std::string &t : types)
+    for (const std::string &s : sizes) {
+      Config c{t, atoi(s.c_str()), btbBits, localM, atoi(s.c_str())};
+      if (c.size < 1 || c.size > 24 || !makePredictor(c)) {
+        fprintf(stderr, "sim_bp: unknown predictor %s%s\n", t.c_str(), s.c_str());
+        return 2;
+      }
+      configs.push_back(c);
+    }
+
+  std::vector<Trace> traces(files.size());
+  for (size_t i = 0; i < files.size(); i++)
+    if (!loadTrace(files[i], traces[i])) return 1;
+
+  // one task per (configuration, trace) pair
+  std::vector<Result> results(configs.size() * traces.size());
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; t++)
+    pool.emplace_back([&] {
+      for (size_t i; (i = next++) < results.size(); )
+        results[i] = simulate(configs[i / traces.size()], traces[i % traces.size()]);
+    });
+  for (auto &th : pool) th.join();
+
+  FILE *out = output ? fopen(output, "w") : stdout;
+  if (!out) { fprintf(stderr, "sim_bp: cannot write %s\n", output); return 1; }
+  fprintf(out, "type,size,trace,branches,dirmispredicts,mispredicts,mispredictrate\n");
+  for (size_t c = 0; c < configs.size(); c++) {
+    double logsum = 0;
+    size_t counted = 0;
+    for (size_t t = 0; t < traces.size(); t++) {
+      const Result &r = results[c * traces.size() + t];
+      fprintf(out, "%s,%d,%s,%llu,%llu,%llu,%.4f\n", configs[c].type.c_str(), configs[c].size,
+              traces[t].name.c_str(), (unsigned long long)r.branches, (unsigned long long)r.dirWrong,
+              (unsigned long long)r.wrong, r.rate());
+      // a trace without branches has no rate, and one predicted perfectly counts as the
+      // smallest rate printed rather than taking the mean to 0
+      if (r.branches) {
+        logsum += log(std::max(r.rate(), 0.0001));
+        counted++;
+      }
+    }
+    // geometric mean across benchmarks, as in bin/CModelBranchAccuracy.sh
+    if (traces.size() > 1 && counted)
+      fprintf(out, "%s,%d,geomean,,,,%.4f\n", configs[c].type.c_str(), configs[c].size,
+              exp(logsum / counted));
+  }
+  if (output) fclose(out);
+  return 0;
+}
@@ -387,6 +387,57 @@ ee_u8 core_stop_parallel(core_results *res) {
 	}
 	return 1;
 }
+#elif USE_WALLY_HARTS
+/* Wally's caches are not coherent, so each hart runs on a private copy of its
+   core_results and passes its CRCs back through a cache line of its own. */
+typedef struct {
+	ee_u16 crc, crclist, crcmatrix, crcstate;
+} __attribute__((aligned(64))) context_crcs;
+
+static context_crcs crcs[MULTITHREAD];
+static ee_u32 harts_started, harts_stopped;
+
+static void run_context(int hart, void *arg) {
+	core_results res = *(core_results *)arg;
+	harts_begin(hart);
+	iterate(&res);
+	harts_end(hart);
+	crcs[hart].crc = res.crc;
+	crcs[hart].crclist = res.crclist;
+	crcs[hart].crcmatrix = res.crcmatrix;
+	crcs[hart].crcstate = res.crcstate;
+}
+
+/* Function: thread_entry
+	Called on every hart by _init in syscalls.c.  Hart 0 returns to run main; the
+	others wait to be started by core_start_parallel.
+*/
+void thread_entry(int cid, int nc) {
+	if (cid != 0)
+		harts_park(cid);
+}
+
+ee_u8 core_start_parallel(core_results *res) {
+	res->port.hart = harts_started++;
+	/* hart 0 runs its own context in core_stop_parallel, once the others are running */
+	if (res->port.hart != 0)
+		harts_start(res->port.hart, run_context, res);
+	return 1;
+}
+ee_u8 core_stop_parallel(core_results *res) {
+	ee_u32 hart = res->port.hart;
+	if (hart == 0)
+		run_context(0, res);
+	else
+		harts_wait(hart);
+	res->crc = crcs[hart].crc;
+	res->crclist = crcs[hart].crclist;
+	res->crcmatrix = crcs[hart].crcmatrix;
+	res->crcstate = crcs[hart].crcstate;
+	if (++harts_stopped == default_num_contexts)
+		harts_report(ee_printf, "CoreMark", default_num_contexts, res->iterations);
+	return 1;
+}
 #else /* no standard multicore implementation */
 #error "Please implement multicore functionality in core_portme.c to use multiple contexts."
 #endif /* multithread implementations */
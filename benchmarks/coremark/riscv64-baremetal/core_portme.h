@@ -208,6 +208,22 @@ typedef size_t ee_size_t;
 #define USE_SOCKET 0
 #endif
 
+/* Configuration: USE_WALLY_HARTS
+	Implementation for launching parallel contexts on the harts of a multi-core Wally.
+	Context i runs on hart i; the other harts are started with a CLINT software interrupt.
+	See benchmarks/smp/harts.h.
+
+	Valid values:
+	0 - Do not run contexts on Wally harts.
+	1 - Run contexts on Wally harts.
+
+	Note:
+	This flag only matters if MULTITHREAD has been defined to a value greater then 1.
+*/
+#ifndef USE_WALLY_HARTS
+#define USE_WALLY_HARTS 1
+#endif
+
 /* Configuration: MAIN_HAS_NOARGC
 	Needed if platform does not support getting arguments to main.
 
@@ -264,6 +280,9 @@ extern ee_u32 default_num_contexts;
 	#include <unistd.h>
 	#include <errno.h>
 	#define PARALLEL_METHOD "Sockets"
+#elif USE_WALLY_HARTS
+	#include "harts.h"
+	#define PARALLEL_METHOD "Wally harts"
 #else
 	#define PARALLEL_METHOD "Proprietary"
 	#error "Please implement multicore functionality in core_portme.c to use multiple contexts."
@@ -282,6 +301,8 @@ typedef struct CORE_PORTABLE_S {
 	pid_t pid;
 	int sock;
 	struct sockaddr_in sa;
+	#elif USE_WALLY_HARTS
+	ee_u32 hart;
 	#endif /* Method for multithreading */
 #endif /* MULTITHREAD>1 */
 	ee_u8	portable_id;
@@ -450,48 +450,127 @@ int sprintf(char* str, const char* fmt, ...)
   return str - str0;
 }
 
-void* memcpy(void* dest, const void* src, size_t len)
+// The word loops below read and write aligned words only, so they also suit
+// -mstrict-align builds.  Reading a whole aligned word beyond the end of a string
+// is safe: the word cannot cross into another page or PMP region.
+#define WORD sizeof(uintptr_t)
+#define ONES ((uintptr_t)-1 / 0xFF)
+
+// Keep gcc from turning the byte loops back into calls to memcpy and memset
+#define NO_LIBCALL __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+#ifdef __riscv_zbb
+// orc.b sets each nonzero byte to 0xff and leaves zero bytes zero
+static inline uintptr_t orcb(uintptr_t x)
 {
-  if ((((uintptr_t)dest | (uintptr_t)src | len) & (sizeof(uintptr_t)-1)) == 0) {
-    const uintptr_t* s = src;
-    uintptr_t *d = dest;
-    while (d < (uintptr_t*)(dest + len))
-      *d++ = *s++;
-  } else {
-    const char* s = src;
-    char *d = dest;
-    while (d < (char*)(dest + len))
+  uintptr_t r;
+  asm ("orc.b %0, %1" : "=r"(r) : "r"(x));
+  return r;
+}
+#define HASZERO(x) (orcb(x) != (uintptr_t)-1)
+#else
+#define HASZERO(x) (((x) - ONES) & ~(x) & (ONES << 7))
+#endif
+
+void* NO_LIBCALL memcpy(void* dest, const void* src, size_t len)
+{
+  char *d = dest;
+  const char *s = src;
+  uintptr_t *dw;
+
+  if (len >= 2*WORD) {
+    while ((uintptr_t)d & (WORD-1)) {
       *d++ = *s++;
+      len--;
+    }
+    dw = (uintptr_t *)d;
+    if (((uintptr_t)s & (WORD-1)) == 0) {
+      const uintptr_t *sw = (const uintptr_t *)s;
+      // eight words per iteration, which is a cache line on RV64; the loads are
+      // issued ahead of the stores so none waits on the one before it
+      while (len >= 8*WORD) {
+        uintptr_t w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+        uintptr_t w4 = sw[4], w5 = sw[5], w6 = sw[6], w7 = sw[7];
+        dw[0] = w0; dw[1] = w1; dw[2] = w2; dw[3] = w3;
+        dw[4] = w4; dw[5] = w5; dw[6] = w6; dw[7] = w7;
+        dw += 8;
+        sw += 8;
+        len -= 8*WORD;
+      }
+      while (len >= WORD) {
+        *dw++ = *sw++;
+        len -= WORD;
+      }
+      s = (const char *)sw;
+    } else {
+      // src is not aligned like dest: build each dest word from two aligned src words
+      unsigned shift = 8 * ((uintptr_t)s & (WORD-1));
+      const uintptr_t *sw = (const uintptr_t *)((uintptr_t)s & -WORD);
+      uintptr_t lo = *sw++, hi;
+      while (len >= WORD) {
+        hi = *sw++;
+        *dw++ = lo >> shift | hi << (8*WORD - shift);
+        lo = hi;
+        len -= WORD;
+      }
+      s = (const char *)(sw - 1) + shift/8;
+    }
+    d = (char *)dw;
   }
+  while (len--)
+    *d++ = *s++;
   return dest;
 }
-void* memset(void* dest, int byte, size_t len)
+
+void* NO_LIBCALL memset(void* dest, int byte, size_t len)
 {
-  if ((((uintptr_t)dest | len) & (sizeof(uintptr_t)-1)) == 0) {
-    uintptr_t word = byte & 0xFF;
-    word |= word << 8;
-    word |= word << 16;
-    word |= word << 16 << 16;
-
-    uintptr_t *d = dest;
-    while (d < (uintptr_t*)(dest + len)){
-      *d = word;
-      d++;}
-  } else {
-    char *d = dest;
-    while (d < (char*)(dest + len)){
-      *d = byte;
-      d++;}
+  char *d = dest;
+  uintptr_t *dw;
+  uintptr_t word = (byte & 0xFF) * ONES;
+
+  if (len >= 2*WORD) {
+    while ((uintptr_t)d & (WORD-1)) {
+      *d++ = byte;
+      len--;
+    }
+    dw = (uintptr_t *)d;
+    while (len >= 8*WORD) {
+      dw[0] = word; dw[1] = word; dw[2] = word; dw[3] = word;
+      dw[4] = word; dw[5] = word; dw[6] = word; dw[7] = word;
+      dw += 8;
+      len -= 8*WORD;
+    }
+    while (len >= WORD) {
+      *dw++ = word;
+      len -= WORD;
+    }
+    d = (char *)dw;
   }
+  while (len--)
+    *d++ = byte;
   return dest;
 }
 
 size_t strlen(const char *s)
 {
   const char *p = s;
+  const uintptr_t *w;
+
+  while ((uintptr_t)p & (WORD-1)) {
+    if (!*p)
+      return p - s;
+    p++;
+  }
+  for (w = (const uintptr_t *)p; !HASZERO(*w); w++)
+    ;
+  p = (const char *)w;
+#ifdef __riscv_zbb
+  return p - s + __builtin_ctzl(~orcb(*w)) / 8;
+#else
   while (*p)
     p++;
   return p - s;
+#endif
 }
 
 size_t strnlen(const char *s, size_t n)
@@ -506,6 +585,22 @@ int strcmp(const char* s1, const char* s2)
 {
   unsigned char c1, c2;
 
+  // a word at a time while both strings are aligned alike, up to the word that
+  // differs or holds the terminator, which is then compared byte by byte
+  if ((((uintptr_t)s1 ^ (uintptr_t)s2) & (WORD-1)) == 0) {
+    const uintptr_t *w1, *w2;
+    while ((uintptr_t)s1 & (WORD-1)) {
+      c1 = *s1++;
+      c2 = *s2++;
+      if (c1 == 0 || c1 != c2)
+        return c1 - c2;
+    }
+    for (w1 = (const uintptr_t *)s1, w2 = (const uintptr_t *)s2; *w1 == *w2 && !HASZERO(*w1); w1++, w2++)
+      ;
+    s1 = (const char *)w1;
+    s2 = (const char *)w2;
+  }
+
   do {
     c1 = *s1++;
     c2 = *s2++;
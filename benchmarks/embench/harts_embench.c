@@ -0,0 +1,115 @@
+///////////////////////////////////////////
+// harts_embench.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Run an embench benchmark on HARTS harts at once.  Linked with
+//          -Wl,--wrap=main,--wrap=benchmark,--wrap=initialise_benchmark (see the
+//          build_harts target in the Makefile): every hart leaves the board's crt0
+//          through harts_entry.S, which sends hart 0 on to embench's main and parks
+//          the others.  The timed call of benchmark() from main then runs on every
+//          hart, each result is checked with verify_benchmark(), and each hart's
+//          counters are printed.  The warmup calls stay on hart 0.
+//
+//          Every hart runs the board's crt0 before main, so it must not write
+//          memory other than through the stack pointer it sets up.
+//
+//          Harts can only share read-only globals: the caches are not coherent,
+//          so harts writing the same working data would each see a mix of their
+//          own and the others' writes.  The writable data (.data through .bss) is
+//          checksummed after initialise_benchmark() and again after the warmup.
+//          A benchmark whose warmup changed it keeps working data in globals, so
+//          it runs on hart 0 alone and is left out of the multi-hart report.  The
+//          check relies on the board running a warmup (WARMUP_HEAT > 0).
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "harts.h"
+
+#ifndef HARTS
+#define HARTS 2
+#endif
+
+#if HARTS > HARTS_MAX
+#error "HARTS is larger than HARTS_MAX"
+#endif
+
+int __real_benchmark(void);
+void __real_initialise_benchmark(void);
+int verify_benchmark(int result);
+
+// bounds of the writable data in the default RISC-V linker script
+extern unsigned int __DATA_BEGIN__[], _end[];
+
+// per-hart results, each in a cache line of its own; see harts.h
+typedef struct {
+  int result, correct;
+} __attribute__((aligned(64))) hartResult;
+
+static hartResult results[HARTS];
+
+// checksum of the writable data after initialise_benchmark(); leaves itself out
+static unsigned int initialSum;
+
+static unsigned int globalsSum(void) {
+  unsigned int *p, sum = 0;
+  for (p = __DATA_BEGIN__; p < _end; p++)
+    if (p != &initialSum) sum = sum * 31 + *p;
+  return sum;
+}
+
+// whether the writable data holds this hart's stack, which always changes
+static int stackInGlobals(void) {
+  unsigned int *sp;
+  asm volatile ("mv %0, sp" : "=r"(sp));
+  return sp >= __DATA_BEGIN__ && sp < _end;
+}
+
+void __wrap_initialise_benchmark(void) {
+  __real_initialise_benchmark();
+  initialSum = globalsSum();
+}
+
+static void job(int hart, void *arg) {
+  int r;
+  harts_begin(hart);
+  r = __real_benchmark();
+  harts_end(hart);
+  results[hart].result = r;
+  results[hart].correct = verify_benchmark(r);
+}
+
+int __wrap_benchmark(void) {
+  int h;
+  if (stackInGlobals() || globalsSum() != initialSum) {
+    printf("embench: the benchmark writes global data, so it runs on hart 0 only\n");
+    job(0, 0);
+    harts_report(printf, "embench", 1, 0);
+    if (!results[0].correct) printf("embench hart 0: verify_benchmark failed\n");
+    return results[0].result;
+  }
+  for (h = 1; h < HARTS; h++) harts_start(h, job, 0);
+  job(0, 0);
+  for (h = 1; h < HARTS; h++) harts_wait(h);
+  harts_report(printf, "embench", HARTS, 0);
+  for (h = 0; h < HARTS; h++)
+    if (!results[h].correct) printf("embench hart %d: verify_benchmark failed\n", h);
+  return results[0].result;
+}
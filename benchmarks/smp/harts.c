@@ -0,0 +1,134 @@
+///////////////////////////////////////////
+// harts.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Multi-hart benchmark start/stop and per-hart counters; see harts.h
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "harts.h"
+
+#define HARTS_READ(reg) ({ unsigned long __tmp; asm volatile ("csrr %0, " #reg : "=r"(__tmp)); __tmp; })
+#define MIP_MSIP 0x8
+
+// What hart 0 hands a worker hart, read by the worker once when it starts
+typedef struct {
+  harts_job job;
+  void *arg;
+} __attribute__((aligned(64))) hartJob;
+
+// Counters of one hart, written only by that hart.  Hart 0 reads a worker's count
+// after it is done, from lines hart 0 has never cached.
+typedef struct {
+  unsigned long v[HARTS_COUNTERS];
+} __attribute__((aligned(64))) hartCounters;
+
+// a whole number of cache lines each, so that no line holds data of two harts
+static hartJob jobs[HARTS_MAX];
+static hartCounters starts[HARTS_MAX], counts[HARTS_MAX];
+
+static inline volatile unsigned int *msip(int hart) {
+  return (volatile unsigned int *)HARTS_CLINT_MSIP + hart;
+}
+
+// write back this hart's dirty D$ lines with fence.i, encoded as a word so that
+// -march strings without Zifencei (such as CoreMark's rv64im) assemble it, and
+// order that before the next store
+static inline void publish(void) {
+  asm volatile (".word 0x0000100f\n\tfence" ::: "memory");
+}
+
+static void snapshot(unsigned long *v) {
+  v[HARTS_CYCLES]        = HARTS_READ(mcycle);
+  v[HARTS_INSTRET]       = HARTS_READ(minstret);
+  v[HARTS_BRANCH]        = HARTS_READ(mhpmcounter3);
+  v[HARTS_BP_WRONG]      = HARTS_READ(mhpmcounter6);
+  v[HARTS_LOAD_STALL]    = HARTS_READ(mhpmcounter11);
+  v[HARTS_DCACHE_ACCESS] = HARTS_READ(mhpmcounter13);
+  v[HARTS_DCACHE_MISS]   = HARTS_READ(mhpmcounter14);
+  v[HARTS_ICACHE_ACCESS] = HARTS_READ(mhpmcounter16);
+  v[HARTS_ICACHE_MISS]   = HARTS_READ(mhpmcounter17);
+}
+
+void harts_begin(int hart) {
+  snapshot(starts[hart].v);
+}
+
+void harts_end(int hart) {
+  unsigned long now[HARTS_COUNTERS];
+  int i;
+  snapshot(now);
+  for (i = 0; i < HARTS_COUNTERS; i++) counts[hart].v[i] = now[i] - starts[hart].v[i];
+}
+
+void harts_park(int hart) {
+  hartJob *j = &jobs[hart];
+  asm volatile ("csrs mie, %0" :: "r"(MIP_MSIP));  // wakes wfi; mstatus.MIE stays clear
+  while (!(HARTS_READ(mip) & MIP_MSIP)) asm volatile ("wfi");
+  j->job(hart, j->arg);
+  publish();
+  *msip(hart) = 0;
+  // harts_start does not start a hart twice, so msip stays clear
+  while (1) asm volatile ("wfi");
+}
+
+// jobs[hart] is only written here, so hart 0's cached copy tells it whether the
+// hart has been started
+int harts_start(int hart, harts_job job, void *arg) {
+  if (jobs[hart].job) return -1;
+  jobs[hart].job = job;
+  jobs[hart].arg = arg;
+  publish();
+  *msip(hart) = 1;
+  return 0;
+}
+
+void harts_wait(int hart) {
+  while (*msip(hart)) ;
+}
+
+// x/y with two decimals
+static void fixed2(unsigned long long x, unsigned long long y, unsigned long *whole, unsigned long *hundredths) {
+  unsigned long v = y ? (unsigned long)(x * 100 / y) : 0;
+  *whole = v / 100;
+  *hundredths = v % 100;
+}
+
+void harts_report(int (*print)(const char *fmt, ...), const char *name, int nharts, unsigned long iterations) {
+  unsigned long w, f, *c;
+  int h;
+  for (h = 0; h < nharts && h < HARTS_MAX; h++) {
+    c = counts[h].v;
+    print("%s hart %d: %lu cycles %lu instr", name, h, c[HARTS_CYCLES], c[HARTS_INSTRET]);
+    fixed2(c[HARTS_CYCLES], c[HARTS_INSTRET], &w, &f);
+    print(" CPI %lu.%02lu", w, f);
+    if (iterations) {
+      fixed2(iterations * 1000000ULL, c[HARTS_CYCLES], &w, &f);
+      print(" score/MHz %lu.%02lu", w, f);
+    }
+    fixed2(100ULL * c[HARTS_BP_WRONG], c[HARTS_BRANCH], &w, &f);
+    print(" BP wrong %lu.%02lu%%", w, f);
+    fixed2(100ULL * c[HARTS_DCACHE_MISS], c[HARTS_DCACHE_ACCESS], &w, &f);
+    print(" D$ miss %lu.%02lu%%", w, f);
+    fixed2(100ULL * c[HARTS_ICACHE_MISS], c[HARTS_ICACHE_ACCESS], &w, &f);
+    print(" I$ miss %lu.%02lu%%", w, f);
+    print(" load stalls %lu\n", c[HARTS_LOAD_STALL]);
+  }
+}
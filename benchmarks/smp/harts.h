@@ -0,0 +1,74 @@
+///////////////////////////////////////////
+// harts.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Run a bare-metal benchmark on several harts at once and report each
+//          hart's performance counters.  Hart 0 starts the others with a CLINT
+//          software interrupt (as tests/custom/zsbl/smp.h does) and each of them
+//          signals that it is done by clearing its own msip, which hart 0 polls.
+//          The CLINT is not cached, so the handshake does not depend on the
+//          harts' caches.  Wally's caches are not coherent, so data is passed
+//          through memory: a hart executes fence.i, which writes back its dirty
+//          D$ lines, before it signals, and a hart reads results only from lines it
+//          has not cached before.
+//
+//          So each worker hart can be started only once per program load.  It
+//          caches the line holding its job when it starts, and the D$ has no
+//          invalidate that software can reach, so it would not see a second job.
+//          harts_start returns -1, and starts nothing, for a hart already started.
+//          CoreMark and embench start each hart once.
+//
+//          Worker harts call harts_park(hart) from their startup code with a stack
+//          of their own; it does not return.  Hart 0 then, for its one run,
+//
+//            harts_start(hart, job, arg);  // for each worker hart
+//            job(0, arg);                  // its own share
+//            harts_wait(hart);             // for each worker hart
+//            harts_report(printf, "name", nharts, iterations);
+//
+//          Each job brackets its timed work with harts_begin() and harts_end().
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __HARTS_H
+#define __HARTS_H
+
+#ifndef HARTS_MAX
+#define HARTS_MAX 8
+#endif
+
+#define HARTS_CLINT_MSIP 0x2000000UL     // msip of hart i is at +4*i
+
+// Counters kept per hart; counter i counts event i after reset, see src/privileged/csrc.sv
+enum { HARTS_CYCLES, HARTS_INSTRET, HARTS_BRANCH, HARTS_BP_WRONG, HARTS_LOAD_STALL,
+       HARTS_DCACHE_ACCESS, HARTS_DCACHE_MISS, HARTS_ICACHE_ACCESS, HARTS_ICACHE_MISS, HARTS_COUNTERS };
+
+typedef void (*harts_job)(int hart, void *arg);
+
+void harts_park(int hart) __attribute__((noreturn));
+int harts_start(int hart, harts_job job, void *arg);
+void harts_wait(int hart);
+void harts_begin(int hart);
+void harts_end(int hart);
+// One line per hart.  With iterations non-zero the benchmark's score per MHz,
+// iterations * 10^6 / cycles, is printed as well.
+void harts_report(int (*print)(const char *fmt, ...), const char *name, int nharts, unsigned long iterations);
+
+#endif
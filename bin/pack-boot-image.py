@@ -0,0 +1,195 @@
+#!/usr/bin/python3
+###########################################
+## pack-boot-image.py
+##
+## Written: Wally team 2023
+##
+## Purpose: Pack a boot image (OpenSBI with the kernel and device tree, as built by
+##          linux/buildroot) for the boot partition of the SD card that the zsbl in
+##          tests/custom/zsbl loads.  The image is LZ4 compressed, unless -raw, and
+##          followed by a footer in the last block of the partition giving its size,
+##          CRC-32, format and size once decompressed; see boot_footer_t in
+##          tests/custom/zsbl/gpt.h.  zsbl reads only the blocks of the compressed
+##          image and decompresses them as they arrive, so the boot is faster by about
+##          the compression ratio when the SD card is the bottleneck.
+##
+##          The LZ4 frame is written by the lz4 command when it is on the path, and
+##          otherwise by a slower compressor here.
+##
+##          zsbl looks for the footer in the last block of the partition, so -size must
+##          be the exact size of the partition the output is written to, as given by
+##          blockdev --getsize64 /dev/sdX1 or by the -b option of testbench/dpi/mksdimg.
+##
+##            pack-boot-image.py -size 64M fw_payload.bin boot.img   for a 64 MiB partition
+##            dd if=boot.img of=/dev/sdX1 bs=64k                     write it to that partition
+##
+## A component of the CORE-V-WALLY configurable RISC-V project.
+##
+## Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+##
+## SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+##
+## Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+## except in compliance with the License, or, at your option, the Apache License version 2.0. You
+## may obtain a copy of the License at
+##
+## https:##solderpad.org/licenses/SHL-2.1/
+##
+## Unless required by applicable law or agreed to in writing, any work distributed under the
+## License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+## either express or implied. See the License for the specific language governing permissions
+## and limitations under the License.
+################################################################################################
+
+import sys, os, struct, zlib, shutil, argparse, subprocess, tempfile
+
+BLOCK = 512
+FOOTER_MAGIC = 0x474D49594C4C4157 # "WALLYIMG"
+FORMAT_RAW = 0
+FORMAT_LZ4 = 1
+
+LZ4_MAGIC = 0x184D2204
+LZ4_BLOCK = 4 << 20                   # block maximum size 4 MiB (BD = 0x70)
+LZ4_MIN_MATCH = 4
+LZ4_LAST_LITERALS = 5                 # a block ends with at least 5 literals
+LZ4_MATCH_LIMIT = 12                  # and its last match starts 12 bytes before the end
+
+def xxh32(data, seed=0):
+    "xxHash32, for the header checksum of an LZ4 frame"
+    P1, P2, P3, P4, P5 = 2654435761, 2246822519, 3266489917, 668265263, 374761393
+    M = 0xFFFFFFFF
+    rotl = lambda x, r: ((x << r) | (x >> (32 - r))) & M
+    n, i = len(data), 0
+    if n >= 16:
+        v = [(seed + P1 + P2) & M, (seed + P2) & M, seed, (seed - P1) & M]
+        while i + 16 <= n:
+            for k in range(4):
+                v[k] = (rotl((v[k] + struct.unpack_from('<I', data, i + 4*k)[0] * P2) & M, 13) * P1) & M
+            i += 16
+        h = (rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18)) & M
+    else:
+        h = (seed + P5) & M
+    h = (h + n) & M
+    while i + 4 <= n:
+        h = (rotl((h + struct.unpack_from('<I', data, i)[0] * P3) & M, 17) * P4) & M
+        i += 4
+    while i < n:
+        h = (rotl((h + data[i] * P5) & M, 11) * P1) & M
+        i += 1
+    h = ((h ^ (h >> 15)) * P2) & M
+    h = ((h ^ (h >> 13)) * P3) & M
+    return h ^ (h >> 16)
+
+def lz4Length(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+def lz4Sequence(out, literals, offset, matchLen):
+    lit = len(literals)
+    ml = matchLen - LZ4_MIN_MATCH if offset else 0
+    out.append((min(lit, 15) << 4) | min(ml, 15))
+    if lit >= 15: lz4Length(out, lit - 15)
+    out += literals
+    if offset:
+        out += struct.pack('<H', offset)
+        if ml >= 15: lz4Length(out, ml - 15)
+
+def lz4Block(src):
+    "Greedy LZ4 block compressor with a hash of the last position of each 4 bytes"
+    n = len(src)
+    out = bytearray()
+    table = {}
+    anchor = i = 0
+    limit = n - LZ4_MATCH_LIMIT
+    misses = 0
+    while i < limit:
+        key = src[i:i+4]
+        cand = table.get(key)
+        table[key] = i
+        if cand is None or i - cand > 65535:
+            misses += 1
+            i += 1 + (misses >> 6)  # skip faster through data that does not compress
+            continue
+        misses = 0
+        # extend forwards, a slice at a time, then backwards over pending literals
+        length, maxLen = LZ4_MIN_MATCH, n - LZ4_LAST_LITERALS - i
+        while length + 32 <= maxLen and src[cand+length:cand+length+32] == src[i+length:i+length+32]:
+            length += 32
+        while length < maxLen and src[cand+length] == src[i+length]:
+            length += 1
+        while i > anchor and cand > 0 and src[i-1] == src[cand-1]:
+            i, cand, length = i - 1, cand - 1, length + 1
+        lz4Sequence(out, src[anchor:i], i - cand, length)
+        i += length
+        anchor = i
+    lz4Sequence(out, src[anchor:], 0, 0)
+    return bytes(out)
+
+def lz4Frame(data):
+    "LZ4 frame of independent blocks with the content size and no checksums"
+    flg, bd = 0x40 | 0x20 | 0x08, 0x70
+    descriptor = struct.pack('<BBQ', flg, bd, len(data))
+    out = bytearray(struct.pack('<I', LZ4_MAGIC) + descriptor)
+    out.append((xxh32(descriptor) >> 8) & 0xFF)
+    for start in range(0, len(data), LZ4_BLOCK):
+        raw = data[start:start+LZ4_BLOCK]
+        block = lz4Block(raw)
+        if len(block) >= len(raw):
+            out += struct.pack('<I', len(raw) | 0x80000000) + raw
+        else:
+            out += struct.pack('<I', len(block)) + block
+    out += struct.pack('<I', 0)
+    return bytes(out)
+
+def compress(data):
+    lz4 = shutil.which('lz4')
+    if lz4 is None:
+        return lz4Frame(data)
+    with tempfile.TemporaryDirectory() as tmp:
+        src, dst = os.path.join(tmp, 'image'), os.path.join(tmp, 'image.lz4')
+        with open(src, 'wb') as f: f.write(data)
+        subprocess.run([lz4, '-q', '-9', '-f', src, dst], check=True)
+        with open(dst, 'rb') as f: return f.read()
+
+def footer(stored, fmt, loadSize):
+    fields = struct.pack('<QQIIQI', FOOTER_MAGIC, len(stored), zlib.crc32(stored), fmt, loadSize, 0)
+    return (fields + struct.pack('<I', zlib.crc32(fields))).ljust(BLOCK, b'\0')
+
+def packImage(data, size, raw=False):
+    "The contents of a boot partition of size bytes holding data, with the footer in its last block"
+    stored = data if raw else compress(data)
+    if not raw and len(stored) >= len(data):
+        stored, raw = data, True    # does not compress
+    body = stored.ljust(-(-len(stored) // BLOCK) * BLOCK, b'\0')
+    if size % BLOCK or len(body) + BLOCK > size:
+        raise ValueError("%d bytes packed do not fit a partition of %d bytes" % (len(body) + BLOCK, size))
+    body = body.ljust(size - BLOCK, b'\0')
+    return body + footer(stored, FORMAT_RAW if raw else FORMAT_LZ4, len(data)), len(stored)
+
+def parseSize(s):
+    units = {'K': 1 << 10, 'M': 1 << 20, 'G': 1 << 30}
+    return int(s[:-1]) * units[s[-1].upper()] if s[-1].upper() in units else int(s, 0)
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack a boot image for the zsbl boot partition")
+    parser.add_argument("input", help="boot image, such as fw_payload.bin")
+    parser.add_argument("output", help="partition contents to write")
+    parser.add_argument("-raw", action="store_true", help="store the image uncompressed")
+    parser.add_argument("-size", type=parseSize, required=True,
+                        help="size of the boot partition, in bytes or with K, M or G")
+    args = parser.parse_args()
+
+    with open(args.input, 'rb') as f: data = f.read()
+    try:
+        packed, stored = packImage(data, args.size, args.raw)
+    except ValueError as e:
+        sys.exit("pack-boot-image: %s" % e)
+    with open(args.output, 'wb') as f: f.write(packed)
+    blocksRaw, blocksStored = -(-len(data) // BLOCK), -(-stored // BLOCK)
+    print("%s: %d bytes stored as %d (%.1f%%), %d blocks read at boot instead of %d" %
+          (args.output, len(data), stored, 100.0 * stored / max(len(data), 1), blocksStored, blocksRaw))
+
+if __name__ == '__main__':
+    main()
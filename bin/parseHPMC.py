@@ -42,41 +42,46 @@ RefData = [('twobitCModel6', 11.0501534891674), ('twobitCModel8', 8.518290522663
            ('gshareCModel12', 8.25796055444401), ('gshareCModel14', 6.23093702707613), ('gshareCModel16', 3.34001125650374)]
 
 
+def Ratio(num, den):
+    'num / den, or 0 if den is 0, as it can be for a short region measured by perf.c.'
+    if(int(den) == 0): return 0
+    return 1.0 * int(num) / int(den)
+
 def ComputeCPI(benchmark):
     'Computes and inserts CPI into benchmark stats.'
     (nameString, opt, dataDict) = benchmark
-    CPI = 1.0 * int(dataDict['Mcycle']) / int(dataDict['InstRet'])
+    CPI = Ratio(dataDict['Mcycle'], dataDict['InstRet'])
     dataDict['CPI'] = CPI
 
 def ComputeBranchDirMissRate(benchmark):
     'Computes and inserts branch direction miss prediction rate.'
     (nameString, opt, dataDict) = benchmark
-    branchDirMissRate = 100.0 * int(dataDict['BP Dir Wrong']) / int(dataDict['Br Count'])
+    branchDirMissRate = 100.0 * Ratio(dataDict['BP Dir Wrong'], dataDict['Br Count'])
     dataDict['BDMR'] = branchDirMissRate
 
 def ComputeBranchTargetMissRate(benchmark):
     'Computes and inserts branch target miss prediction rate.'
     # *** this is wrong in the verilog test bench
     (nameString, opt, dataDict) = benchmark
-    branchTargetMissRate = 100.0 * int(dataDict['BP Target Wrong']) / (int(dataDict['Br Count']) + int(dataDict['Jump Not Return']))
+    branchTargetMissRate = 100.0 * Ratio(dataDict['BP Target Wrong'], int(dataDict['Br Count']) + int(dataDict['Jump Not Return']))
     dataDict['BTMR'] = branchTargetMissRate
 
 def ComputeRASMissRate(benchmark):
     'Computes and inserts return address stack miss prediction rate.'
     (nameString, opt, dataDict) = benchmark
-    RASMPR = 100.0 * int(dataDict['RAS Wrong']) / int(dataDict['Return'])
+    RASMPR = 100.0 * Ratio(dataDict['RAS Wrong'], dataDict['Return'])
     dataDict['RASMPR'] = RASMPR
 
 def ComputeInstrClassMissRate(benchmark):
     'Computes and inserts instruction class miss prediction rate.'
     (nameString, opt, dataDict) = benchmark
-    ClassMPR = 100.0 * int(dataDict['Instr Class Wrong']) / int(dataDict['InstRet'])
+    ClassMPR = 100.0 * Ratio(dataDict['Instr Class Wrong'], dataDict['InstRet'])
     dataDict['ClassMPR'] = ClassMPR
     
 def ComputeICacheMissRate(benchmark):
     'Computes and inserts instruction class miss prediction rate.'
     (nameString, opt, dataDict) = benchmark
-    ICacheMR = 100.0 * int(dataDict['I Cache Miss']) / int(dataDict['I Cache Access'])
+    ICacheMR = 100.0 * Ratio(dataDict['I Cache Miss'], dataDict['I Cache Access'])
     dataDict['ICacheMR'] = ICacheMR
 
 def ComputeICacheMissTime(benchmark):
@@ -90,7 +95,7 @@ def ComputeICacheMissTime(benchmark):
 def ComputeDCacheMissRate(benchmark):
     'Computes and inserts instruction class miss prediction rate.'
     (nameString, opt, dataDict) = benchmark
-    DCacheMR = 100.0 * int(dataDict['D Cache Miss']) / int(dataDict['D Cache Access'])
+    DCacheMR = 100.0 * Ratio(dataDict['D Cache Miss'], dataDict['D Cache Access'])
     dataDict['DCacheMR'] = DCacheMR
 
 def ComputeDCacheMissTime(benchmark):
@@ -128,6 +133,22 @@ def printStats(benchmark):
     print('D Cache Miss Ave Cycles  %1.4f' % dataDict['DCacheMT'])
     print()
 
+def ProcessPerfFile(fileName):
+    '''Extract the regions reported by perf_report() in examples/C/common/perf.c from a log.
+    Each region becomes a benchmark tuple as in ProcessFile, with the region name as the test name.'''
+    benchmarks = []
+    names = []
+    for line in open(fileName, 'r').readlines():
+        start = line.find('perf,')
+        if(start < 0): continue
+        fields = line[start:].rstrip().split(',')[1:]
+        if(fields[0] == 'Region'):
+            names = fields[3:]
+        else:
+            HPMClist = dict(zip(names, [int(value) for value in fields[3:]]))
+            benchmarks.append((fields[0], 'depth' + fields[1], HPMClist))
+    return benchmarks
+
 def ProcessFile(fileName):
     '''Extract preformance counters from a modelsim log.  Outputs a list of tuples for each test/benchmark.
     The tuple contains the test name, optimization characteristics, and dictionary of performance counters.'''
@@ -302,7 +323,10 @@ if(sys.argv[1] == '-b'):
             
 else:
     # steps 1 and 2
-    benchmarks = ProcessFile(sys.argv[1])
+    if(sys.argv[1] == '-p'):
+        benchmarks = ProcessPerfFile(sys.argv[2])
+    else:
+        benchmarks = ProcessFile(sys.argv[1])
     print(benchmarks[0])
     ComputeAll(benchmarks)
     ComputeGeometricAverage(benchmarks)
@@ -43,6 +43,7 @@
 `define COUNTERS 32
 `define ZFH_SUPPORTED 0
 `define SSTC_SUPPORTED 0
+`define SSCOFPMF_SUPPORTED 0
 
 // LSU microarchitectural Features
 `define BUS_SUPPORTED 1
@@ -44,6 +44,7 @@
 `define ZFH_SUPPORTED 0
 `define COUNTERS 32
 `define SSTC_SUPPORTED 0
+`define SSCOFPMF_SUPPORTED 1
 
 // LSU microarchitectural Features
 `define BUS_SUPPORTED 1
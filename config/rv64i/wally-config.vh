@@ -45,6 +45,7 @@
 `define ZICOUNTERS_SUPPORTED 0
 `define ZFH_SUPPORTED 0
 `define SSTC_SUPPORTED 0
+`define SSCOFPMF_SUPPORTED 0
 
 // LSU microarchitectural Features
 `define BUS_SUPPORTED 0
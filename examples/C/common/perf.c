@@ -0,0 +1,145 @@
+///////////////////////////////////////////
+// perf.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Region-of-interest performance counters; see perf.h
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "encoding.h"
+#include "perf.h"
+
+#if PERF_COUNTERS > 32
+#error "PERF_COUNTERS is at most 32"
+#endif
+
+// Names match HPMCnames in testbench/testbench.sv, which bin/parseHPMC.py looks up
+static const char *perfNames[] = {
+  "Mcycle", "------", "InstRet", "Br Count", "Jump Not Return", "Return", "BP Wrong",
+  "BP Dir Wrong", "BP Target Wrong", "RAS Wrong", "Instr Class Wrong", "Load Stall",
+  "Store Stall", "D Cache Access", "D Cache Miss", "D Cache Cycles", "I Cache Access",
+  "I Cache Miss", "I Cache Cycles", "CSR Write", "FenceI", "SFenceVMA", "Interrupt",
+  "Exception", "Divide Cycles", "FP Reg Write", "ITLB Miss", "DTLB Miss", "HPTW Cycles",
+  "Bus Wait Cycles", "HPM Event 30", "HPM Event 31"
+};
+
+typedef struct {
+  const char *name;
+  int depth;                      // nesting depth when first entered
+  uint64_t calls;
+  uint64_t count[PERF_COUNTERS];
+} perfRegion;
+
+typedef struct {
+  int region;                     // -1 if the region table was full
+  uint64_t start[PERF_COUNTERS];
+} perfFrame;
+
+static perfRegion regions[PERF_MAX_REGIONS];
+static perfFrame stack[PERF_MAX_DEPTH];
+static int numRegions, depth;
+static uint64_t lost;             // calls not recorded for lack of space
+
+// The CSR name is stringified by read_csr, so each counter is named explicitly.
+// On RV32 the high half is read twice in case the low half carried into it.
+#if __riscv_xlen == 64
+#define PERF_READ(n, reg) if (n < PERF_COUNTERS) v[n] = read_csr(reg)
+#else
+#define PERF_READ(n, reg) if (n < PERF_COUNTERS) do { \
+    uint32_t hi, lo; \
+    do { hi = read_csr(reg##h); lo = read_csr(reg); } while (hi != read_csr(reg##h)); \
+    v[n] = ((uint64_t)hi << 32) | lo; \
+  } while (0)
+#endif
+
+static inline void snapshot(uint64_t *v) {
+  PERF_READ(0, mcycle);
+  PERF_READ(2, minstret);
+  PERF_READ(3, mhpmcounter3);   PERF_READ(4, mhpmcounter4);   PERF_READ(5, mhpmcounter5);
+  PERF_READ(6, mhpmcounter6);   PERF_READ(7, mhpmcounter7);   PERF_READ(8, mhpmcounter8);
+  PERF_READ(9, mhpmcounter9);   PERF_READ(10, mhpmcounter10); PERF_READ(11, mhpmcounter11);
+  PERF_READ(12, mhpmcounter12); PERF_READ(13, mhpmcounter13); PERF_READ(14, mhpmcounter14);
+  PERF_READ(15, mhpmcounter15); PERF_READ(16, mhpmcounter16); PERF_READ(17, mhpmcounter17);
+  PERF_READ(18, mhpmcounter18); PERF_READ(19, mhpmcounter19); PERF_READ(20, mhpmcounter20);
+  PERF_READ(21, mhpmcounter21); PERF_READ(22, mhpmcounter22); PERF_READ(23, mhpmcounter23);
+  PERF_READ(24, mhpmcounter24); PERF_READ(25, mhpmcounter25); PERF_READ(26, mhpmcounter26);
+  PERF_READ(27, mhpmcounter27); PERF_READ(28, mhpmcounter28); PERF_READ(29, mhpmcounter29);
+  PERF_READ(30, mhpmcounter30); PERF_READ(31, mhpmcounter31);
+  if (PERF_COUNTERS > 1) v[1] = 0;
+}
+
+static int findRegion(const char *name) {
+  int i;
+  for (i = 0; i < numRegions; i++)
+    if (regions[i].name == name || strcmp(regions[i].name, name) == 0) return i;
+  if (numRegions == PERF_MAX_REGIONS) return -1;
+  regions[numRegions].name = name;
+  regions[numRegions].depth = depth;
+  return numRegions++;
+}
+
+void perf_begin(const char *name) {
+  perfFrame *f;
+  if (depth >= PERF_MAX_DEPTH) {
+    depth++;
+    lost++;
+    return;
+  }
+  f = &stack[depth];
+  f->region = findRegion(name);
+  depth++;
+  if (f->region < 0) lost++;
+  // read the counters last so the bookkeeping above is not counted
+  snapshot(f->start);
+}
+
+void perf_end(void) {
+  uint64_t now[PERF_COUNTERS];
+  perfRegion *r;
+  int i;
+
+  snapshot(now);
+  if (depth == 0) return;       // unmatched perf_end
+  if (--depth >= PERF_MAX_DEPTH || stack[depth].region < 0) return;
+  r = &regions[stack[depth].region];
+  r->calls++;
+  for (i = 0; i < PERF_COUNTERS; i++) r->count[i] += now[i] - stack[depth].start[i];
+}
+
+void perf_report(void) {
+  int i, j;
+
+  printf("perf,Region,Depth,Calls");
+  for (j = 0; j < PERF_COUNTERS; j++)
+    if (j != 1) printf(",%s", perfNames[j]);
+  printf("\n");
+  for (i = 0; i < numRegions; i++) {
+    printf("perf,%s,%d,%lld", regions[i].name, regions[i].depth, (long long)regions[i].calls);
+    for (j = 0; j < PERF_COUNTERS; j++)
+      if (j != 1) printf(",%lld", (long long)regions[i].count[j]);
+    printf("\n");
+  }
+  if (lost) printf("perf: %lld calls not recorded; raise PERF_MAX_REGIONS or PERF_MAX_DEPTH\n", (long long)lost);
+  memset(regions, 0, sizeof(regions));
+  numRegions = 0;
+  lost = 0;
+}
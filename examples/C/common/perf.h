@@ -0,0 +1,73 @@
+///////////////////////////////////////////
+// perf.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Bare-metal region-of-interest performance counters.  perf_begin(name)
+//          and perf_end() bracket a region of code; each region accumulates the
+//          change in mcycle, minstret and every hpmcounter over all of its calls.
+//          Regions may nest, and a region entered again by name adds to the same
+//          entry.  Everything lives in fixed tables, so no heap is needed.
+//
+//          perf_report() prints one CSV line per region through printf, which
+//          reaches the testbench over tohost:
+//
+//            perf,Region,Depth,Calls,Mcycle,InstRet,Br Count,...
+//            perf,matmul,0,1,104332,80211,4113,...
+//
+//          The columns are named as in the testbench's HPMCnames, so
+//          bin/parseHPMC.py -p log computes the same statistics per region as it
+//          does per benchmark from the Cnt[] lines.  Counts are inclusive: an outer
+//          region also counts the regions nested in it.
+//
+//            perf_begin("matmul");
+//            ... code to measure ...
+//            perf_end();
+//            perf_report();
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PERF_H
+#define __PERF_H
+
+#include <stdint.h>
+
+// Counters read: mcycle, (time, not read), minstret, then mhpmcounter3 up to
+// PERF_COUNTERS-1.  Counter i counts event i after reset; see profile.h.
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS 30
+#endif
+
+// Distinct region names
+#ifndef PERF_MAX_REGIONS
+#define PERF_MAX_REGIONS 16
+#endif
+
+// Deepest nesting of regions
+#ifndef PERF_MAX_DEPTH
+#define PERF_MAX_DEPTH 8
+#endif
+
+// name must stay valid until perf_report; a string literal is best
+void perf_begin(const char *name);
+void perf_end(void);
+// Print every region as CSV, then forget them
+void perf_report(void);
+
+#endif
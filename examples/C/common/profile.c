@@ -0,0 +1,129 @@
+///////////////////////////////////////////
+// profile.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Sampling profiler; see profile.h
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "encoding.h"
+#include "profile.h"
+
+// the CSRs of PROFILE_COUNTER; the extra level expands the counter number before write_csr stringifies
+#define PROFILE_CAT2(a, b) a##b
+#define PROFILE_CAT(a, b)  PROFILE_CAT2(a, b)
+#define profile_write(reg, val) write_csr(reg, val)
+#define EVENT_CSR    PROFILE_CAT(mhpmevent, PROFILE_COUNTER)
+#define COUNTER_CSR  PROFILE_CAT(mhpmcounter, PROFILE_COUNTER)
+#define EVENTH_CSR   PROFILE_CAT(EVENT_CSR, h)
+#define COUNTERH_CSR PROFILE_CAT(COUNTER_CSR, h)
+
+#define MCAUSE_INT ((uintptr_t)1 << (__riscv_xlen - 1))
+
+extern void __attribute__((noreturn)) tohost_exit(uintptr_t code);
+
+static uintptr_t samples[PROFILE_SAMPLES];
+static volatile uint64_t numSamples;
+static uint64_t reload;        // counter value that overflows after period events
+static int event;
+
+// Preload the counter and clear OF, which rearms the overflow interrupt
+static void arm(void) {
+#if __riscv_xlen == 64
+  profile_write(COUNTER_CSR, reload);
+  profile_write(EVENT_CSR, event); // count in every mode, OF clear
+#else
+  profile_write(COUNTER_CSR, (uint32_t)reload);
+  profile_write(COUNTERH_CSR, (uint32_t)(reload >> 32));
+  profile_write(EVENTH_CSR, 0);
+#endif
+}
+
+void profile_start(int ev, uint64_t period) {
+  event = ev;
+  reload = -period;
+  numSamples = 0;
+#if __riscv_xlen == 32
+  profile_write(EVENT_CSR, event);
+#endif
+  arm();
+  clear_csr(mip, MIP_LCOFIP);
+  set_csr(mie, MIP_LCOFIP);
+  set_csr(mstatus, MSTATUS_MIE);
+}
+
+void profile_stop(void) {
+  clear_csr(mie, MIP_LCOFIP);
+  profile_write(EVENT_CSR, HPM_EVENT_NONE);
+#if __riscv_xlen == 32
+  profile_write(EVENTH_CSR, 0);
+#endif
+  clear_csr(mip, MIP_LCOFIP);
+}
+
+uintptr_t handle_trap(uintptr_t cause, uintptr_t epc, uintptr_t regs[32]) {
+  if (cause == (MCAUSE_INT | IRQ_LCOF)) {
+    if (numSamples < PROFILE_SAMPLES) samples[numSamples] = epc;
+    numSamples++;
+    arm();
+    clear_csr(mip, MIP_LCOFIP);
+    return epc;
+  }
+  tohost_exit(1337);
+}
+
+static void sortSamples(uintptr_t *a, int n) {
+  int gap, i, j;
+  uintptr_t v;
+  for (gap = n / 2; gap > 0; gap /= 2)
+    for (i = gap; i < n; i++) {
+      v = a[i];
+      for (j = i; j >= gap && a[j - gap] > v; j -= gap) a[j] = a[j - gap];
+      a[j] = v;
+    }
+}
+
+void profile_report(int top) {
+  int n = numSamples < PROFILE_SAMPLES ? numSamples : PROFILE_SAMPLES;
+  int i, j, k, count, pick;
+  uintptr_t pc;
+
+  printf("profile: %ld samples of event %d every %ld events\n", (long)numSamples, event, (long)-reload);
+  if (n == 0) return;
+  sortSamples(samples, n);
+  // Move the most frequent PCs to the front, one per pass; top is small
+  for (k = 0, i = 0; k < top && i < n; k++) {
+    pick = -1;
+    count = 0;
+    for (j = i; j < n; ) {
+      int run = 1;
+      while (j + run < n && samples[j + run] == samples[j]) run++;
+      if (run > count) { count = run; pick = j; }
+      j += run;
+    }
+    pc = samples[pick];
+    printf("  %016lx %6d %3d%%\n", (unsigned long)pc, count, (int)(100 * (uint64_t)count / n));
+    // swap the run with the unreported ones at i and keep the rest sorted
+    for (j = pick + count - 1; j >= i + count; j--) samples[j] = samples[j - count];
+    for (j = 0; j < count; j++) samples[i + j] = pc;
+    i += count;
+  }
+}
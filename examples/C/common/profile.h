@@ -0,0 +1,102 @@
+///////////////////////////////////////////
+// profile.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Bare-metal sampling profiler built on the Sscofpmf counter overflow
+//          interrupt.  One hardware performance counter counts a chosen event and
+//          is preloaded so that it overflows every period events; each overflow
+//          interrupt records the PC that was interrupted.  profile_report() then
+//          prints the PCs that were sampled most often, which can be looked up in
+//          the objdump of the program.
+//
+//          Link profile.c with the program.  It replaces the default handle_trap
+//          in syscalls.c, so the program must not install its own.
+//
+//            profile_start(HPM_EVENT_CYCLES, 1000);
+//            ... code to profile ...
+//            profile_stop();
+//            profile_report(10);
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include <stdint.h>
+
+// Events selected by mhpmevent; see src/privileged/csrc.sv.  After reset counter i
+// counts event i.
+#define HPM_EVENT_NONE            0
+#define HPM_EVENT_CYCLES          1
+#define HPM_EVENT_INSTRET         2
+#define HPM_EVENT_BRANCH          3
+#define HPM_EVENT_JUMP            4
+#define HPM_EVENT_RETURN          5
+#define HPM_EVENT_BP_WRONG        6
+#define HPM_EVENT_BP_DIR_WRONG    7
+#define HPM_EVENT_BTA_WRONG       8
+#define HPM_EVENT_RAS_WRONG       9
+#define HPM_EVENT_ICLASS_WRONG    10
+#define HPM_EVENT_LOAD_STALL      11
+#define HPM_EVENT_STORE_STALL     12
+#define HPM_EVENT_DCACHE_ACCESS   13
+#define HPM_EVENT_DCACHE_MISS     14
+#define HPM_EVENT_DCACHE_CYCLES   15
+#define HPM_EVENT_ICACHE_ACCESS   16
+#define HPM_EVENT_ICACHE_MISS     17
+#define HPM_EVENT_ICACHE_CYCLES   18
+#define HPM_EVENT_CSR_WRITE       19
+#define HPM_EVENT_FENCEI          20
+#define HPM_EVENT_SFENCEVMA       21
+#define HPM_EVENT_INTERRUPT       22
+#define HPM_EVENT_EXCEPTION       23
+#define HPM_EVENT_DIV_CYCLES      24
+#define HPM_EVENT_FP_WRITE        25
+#define HPM_EVENT_ITLB_MISS       26
+#define HPM_EVENT_DTLB_MISS       27
+#define HPM_EVENT_HPTW_CYCLES     28
+#define HPM_EVENT_BUS_WAIT        29
+
+// Sscofpmf mhpmevent fields, in mhpmeventh on RV32
+#define HPM_EVENT_OF              (1ULL << 63)
+#define HPM_EVENT_MINH            (1ULL << 62)
+#define HPM_EVENT_SINH            (1ULL << 61)
+#define HPM_EVENT_UINH            (1ULL << 60)
+
+#define IRQ_LCOF                  13
+#define MIP_LCOFIP                (1 << IRQ_LCOF)
+
+// Counter used for sampling; the others keep counting their own events
+#ifndef PROFILE_COUNTER
+#define PROFILE_COUNTER 31
+#endif
+
+// Samples kept; later samples are counted but not recorded
+#ifndef PROFILE_SAMPLES
+#define PROFILE_SAMPLES 4096
+#endif
+
+// Sample the PC every period occurrences of event
+void profile_start(int event, uint64_t period);
+void profile_stop(void);
+// Print the top most frequently sampled PCs
+void profile_report(int top);
+
+#endif
@@ -0,0 +1,83 @@
+// memperf.c
+// Wally team 2023
+// Cycles per byte of memcpy, memset and strlen from syscalls.c over a range of
+// sizes and alignments, measured with mcycle.  Run it in simulation or on the
+// FPGA; build with make MARCH=rv64gc_zbb to use the Zbb string routines.
+
+#include <stdio.h>
+#include <string.h>
+#include "util.h"
+
+#define MAXLEN 4096
+#define REPS   4
+
+static char src[MAXLEN + 64] __attribute__((aligned(64)));
+static char dst[MAXLEN + 64] __attribute__((aligned(64)));
+
+static const int sizes[] = {8, 32, 64, 256, 1024, 4096};
+// dst and src offsets from a cache line boundary
+static const int align[][2] = {{0, 0}, {0, 3}, {5, 0}, {3, 3}, {5, 2}};
+
+#define NUM(a) (sizeof(a) / sizeof(a[0]))
+// keeps gcc from merging the repeated calls
+#define BARRIER() asm volatile ("" ::: "memory")
+
+// prints cycles per byte with two decimals
+static void report(const char *name, int d, int s, int len, unsigned long cycles) {
+  unsigned long cpb = 100 * cycles / ((unsigned long)len * REPS);
+  printf("%s dst+%d src+%d %4d bytes: %ld.%ld%ld cycles/byte\n", name, d, s, len,
+         cpb / 100, cpb / 10 % 10, cpb % 10);
+}
+
+int main(void) {
+  unsigned long start, cycles;
+  int i, j, r, len, d, s;
+
+  for (i = 0; i < MAXLEN + 64; i++) src[i] = 'a' + i % 26;
+  for (i = 0; i < NUM(sizes); i++) {
+    len = sizes[i];
+    for (j = 0; j < NUM(align); j++) {
+      d = align[j][0];
+      s = align[j][1];
+      memcpy(dst + d, src + s, len); // warm the caches
+      start = read_csr(mcycle);
+      for (r = 0; r < REPS; r++) {
+        memcpy(dst + d, src + s, len);
+        BARRIER();
+      }
+      cycles = read_csr(mcycle) - start;
+      report("memcpy", d, s, len, cycles);
+      for (r = 0; r < len; r++)
+        if (dst[d + r] != src[s + r]) {
+          printf("memcpy dst+%d src+%d %d bytes: wrong result\n", d, s, len);
+          return 1;
+        }
+    }
+    for (j = 0; j < NUM(align); j++) {
+      d = align[j][0];
+      start = read_csr(mcycle);
+      for (r = 0; r < REPS; r++) {
+        memset(dst + d, r, len);
+        BARRIER();
+      }
+      cycles = read_csr(mcycle) - start;
+      report("memset", d, 0, len, cycles);
+    }
+    for (j = 0; j < NUM(align); j++) {
+      s = align[j][1];
+      src[s + len] = 0;
+      start = read_csr(mcycle);
+      for (r = 0; r < REPS; r++) {
+        if (strlen(src + s) != len) {
+          printf("strlen src+%d %d bytes: wrong result\n", s, len);
+          return 1;
+        }
+        BARRIER();
+      }
+      cycles = read_csr(mcycle) - start;
+      src[s + len] = 'a' + (s + len) % 26;
+      report("strlen", 0, s, len, cycles);
+    }
+  }
+  return 0;
+}
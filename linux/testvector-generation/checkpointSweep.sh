@@ -1,6 +1,29 @@
 #!/bin/bash
-for index in {450..500};
-do 
-    instrs=$(($index*1000000))
-    echo "y" | nice -n 5 ./genCheckpoint.sh $instrs
+# Take <count> evenly spaced checkpoints across the Linux trace in one QEMU replay,
+# splitting it into <count>+1 slices that sim/linux-checkpoint-sweep verifies in
+# parallel.  Without an end the whole trace is used.
+tvDir=$RISCV/linux-testvectors
+traceFile="$tvDir/all.txt"
+indexedTraceFile="$tvDir/all.ltr"
+
+if [ "$#" -lt 1 ] || [ "$#" -gt 3 ]; then
+    echo "checkpointSweep requires 1 to 3 arguments: <count> [first instr] [last instr]" >&2
+    exit 1
+fi
+count=$1
+first=${2:-0}
+if [ "$#" -ge 3 ]; then
+    last=$3
+elif [ -f "$indexedTraceFile" ]; then
+    make -C ../../testbench/dpi ltr2txt > /dev/null
+    last=$(../../testbench/dpi/ltr2txt -c "$indexedTraceFile")
+else
+    last=$(wc -l < "$traceFile")
+fi
+
+instrs=()
+for ((index = 1; index <= count; index++)); do
+    instrs+=($((first + (last - first) * index / (count + 1))))
 done
+echo "Checkpoints at ${instrs[*]}"
+nice -n 5 ./genCheckpoint.sh -y "${instrs[@]}"
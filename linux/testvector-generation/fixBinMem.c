@@ -1,33 +1,194 @@
+// fixBinMem.c
+// Converts a raw GDB memory dump (little-endian 64-bit words) into the image that
+// testbench-linux.sv and genInitMem.sh load: ram.bin/bootmem.bin for $fread, whose
+// words are big-endian, or with -x a $readmemh file of 64-bit words.
+//
+// Both files are mapped and converted a page at a time across threads.  All-zero
+// pages are skipped, leaving holes in the binary image and @address gaps in the
+// $readmemh file.  A trailing partial word is zero padded.
+//
+// usage: fixBinMem [-j threads] [-x] <raw GDB dump> <output>
+
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SWAP_SHUFFLE 1
+#endif
+
+#define PAGE 4096
+#define WORDS_PER_PAGE (PAGE / 8)
+
+typedef struct {
+    const uint8_t *in;
+    uint8_t *out;         // binary output
+    size_t inSize;
+    size_t firstPage, lastPage;
+    char *text;           // $readmemh output for this range
+    size_t textLen;
+    int prevSkipped;      // whether the page before firstPage is all zero
+} job_t;
+
+static int hexOutput;
+
+static void swapPortable(uint64_t *dst, const uint64_t *src, size_t n) {
+    for (; n; n--) *dst++ = __builtin_bswap64(*src++);
+}
+
+// The shuffles are built for their own target and chosen at run time in selectSwap,
+// so the binary runs on any x86 host whatever the machine it was built on
+#ifdef SWAP_SHUFFLE
+__attribute__((target("avx2")))
+static void swapAvx2(uint64_t *dst, const uint64_t *src, size_t n) {
+    const __m256i mask = _mm256_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+                                         8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+        _mm256_storeu_si256((__m256i *)dst, _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)src), mask));
+    swapPortable(dst, src, n);
+}
+
+__attribute__((target("ssse3")))
+static void swapSsse3(uint64_t *dst, const uint64_t *src, size_t n) {
+    const __m128i mask = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+    for (; n >= 2; n -= 2, src += 2, dst += 2)
+        _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), mask));
+    swapPortable(dst, src, n);
+}
+#endif
+
+static void (*swapWords)(uint64_t *dst, const uint64_t *src, size_t n) = swapPortable;
+
+static void selectSwap(void) {
+#ifdef SWAP_SHUFFLE
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) swapWords = swapAvx2;
+    else if (__builtin_cpu_supports("ssse3")) swapWords = swapSsse3;
+#endif
+}
+
+// the page's words, with a trailing partial word zero padded
+static size_t loadPage(const job_t *j, size_t page, uint64_t *words) {
+    size_t off = page * PAGE, len = j->inSize - off < PAGE ? j->inSize - off : PAGE;
+    size_t n = (len + 7) / 8;
+    words[n - 1] = 0;
+    memcpy(words, j->in + off, len);
+    return n;
+}
+
+static int isZero(const uint64_t *w, size_t n) {
+    uint64_t acc = 0;
+    size_t i;
+    for (i = 0; i < n; i++) acc |= w[i];
+    return acc == 0;
+}
+
+static void *convert(void *arg) {
+    static const char hex[] = "0123456789abcdef";
+    job_t *j = arg;
+    uint64_t words[WORDS_PER_PAGE];
+    size_t page, i, n, cap = 0;
+    int skipped = j->prevSkipped;
+    for (page = j->firstPage; page < j->lastPage; page++) {
+        n = loadPage(j, page, words);
+        if (isZero(words, n)) { skipped = 1; continue; }
+        if (!hexOutput) {
+            // the output is truncated to size first, so only whole words land in it
+            if (n * 8 <= j->inSize - page * PAGE) swapWords((uint64_t *)(j->out + page * PAGE), words, n);
+            else {
+                uint64_t last[WORDS_PER_PAGE];
+                swapWords(last, words, n);
+                memcpy(j->out + page * PAGE, last, n * 8);
+            }
+            continue;
+        }
+        if (j->textLen + 32 + n * 17 > cap) j->text = realloc(j->text, cap = 2 * cap + 32 + n * 17);
+        if (skipped) j->textLen += sprintf(j->text + j->textLen, "@%zx\n", page * WORDS_PER_PAGE);
+        skipped = 0;
+        for (i = 0; i < n; i++) {
+            char *p = j->text + j->textLen;
+            uint64_t v = words[i];
+            int d;
+            for (d = 15; d >= 0; d--, v >>= 4) p[d] = hex[v & 0xf];
+            p[16] = '\n';
+            j->textLen += 17;
+        }
+    }
+    return NULL;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc < 3){
+    int threads = sysconf(_SC_NPROCESSORS_ONLN), opt, fd, t;
+    struct stat st;
+    const uint8_t *in = NULL;
+    uint8_t *out = NULL;
+    size_t size, outSize, pages;
+    job_t *jobs;
+    pthread_t *tid;
+    while ((opt = getopt(argc, argv, "j:x")) != -1) {
+        if (opt == 'j') threads = atoi(optarg);
+        else if (opt == 'x') hexOutput = 1;
+        else exit(1);
+    }
+    selectSwap();
+    if (argc - optind < 2) {
         fprintf(stderr, "Expected 2 arguments: <raw GDB dump> <output binary>\n");
         exit(1);
     }
-    char* rawGDBfilePath = argv[1];
-    FILE* rawGDBfile;
-    if ((rawGDBfile = fopen(rawGDBfilePath,"rb"))==NULL) {
-        fprintf(stderr, "File not found: %s\n",rawGDBfilePath);
+    if ((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st)) {
+        fprintf(stderr, "File not found: %s\n", argv[optind]);
         exit(1);
     }
-    char* outFilePath = argv[2];
-    FILE* outFile = fopen(outFilePath,"w");
-    uint64_t qemuWord;
-    uint64_t verilogWord;
-    int bytesReturned=0;
-    do {
-        bytesReturned=fread(&qemuWord, 8, 1, rawGDBfile);
-        verilogWord = (((qemuWord>>0 )&0xff)<<56 | 
-                       ((qemuWord>>8 )&0xff)<<48 | 
-                       ((qemuWord>>16)&0xff)<<40 | 
-                       ((qemuWord>>24)&0xff)<<32 | 
-                       ((qemuWord>>32)&0xff)<<24 | 
-                       ((qemuWord>>40)&0xff)<<16 | 
-                       ((qemuWord>>48)&0xff)<<8  | 
-                       ((qemuWord>>56)&0xff)<<0);
-        fwrite(&verilogWord, 8, 1, outFile);
-    } while(bytesReturned!=0);
+    size = st.st_size;
+    if (size && (in = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s\n", argv[optind]);
+        exit(1);
+    }
+    close(fd);
+    outSize = (size + 7) & ~(size_t)7;
+    // O_TRUNC then ftruncate leaves every page a hole until it is written
+    if ((fd = open(argv[optind + 1], O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0 ||
+        (!hexOutput && ftruncate(fd, outSize))) {
+        fprintf(stderr, "Cannot write %s\n", argv[optind + 1]);
+        exit(1);
+    }
+    if (!hexOutput && outSize && (out = mmap(NULL, outSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s\n", argv[optind + 1]);
+        exit(1);
+    }
+
+    pages = (size + PAGE - 1) / PAGE;
+    if (threads < 1) threads = 1;
+    if ((size_t)threads > pages) threads = pages ? pages : 1;
+    jobs = calloc(threads, sizeof(job_t));
+    tid = malloc(threads * sizeof(pthread_t));
+    for (t = 0; t < threads; t++) {
+        jobs[t].in = in;
+        jobs[t].out = out;
+        jobs[t].inSize = size;
+        jobs[t].firstPage = pages * t / threads;
+        jobs[t].lastPage = pages * (t + 1) / threads;
+        jobs[t].prevSkipped = 1;
+        if (jobs[t].firstPage) {
+            uint64_t words[WORDS_PER_PAGE];
+            jobs[t].prevSkipped = isZero(words, loadPage(&jobs[t], jobs[t].firstPage - 1, words));
+        }
+        pthread_create(&tid[t], NULL, convert, &jobs[t]);
+    }
+    for (t = 0; t < threads; t++) {
+        pthread_join(tid[t], NULL);
+        if (hexOutput && jobs[t].textLen && write(fd, jobs[t].text, jobs[t].textLen) != (ssize_t)jobs[t].textLen) {
+            fprintf(stderr, "Cannot write %s\n", argv[optind + 1]);
+            exit(1);
+        }
+    }
+    if (out && munmap(out, outSize)) exit(1);
+    if (close(fd)) exit(1);
     return 0;
 }
@@ -1,38 +1,44 @@
 #!/bin/bash
-tcpPort=1238
+tcpPort=${GDB_PORT:-1238}
 imageDir=$RISCV/buildroot/output/images
 tvDir=$RISCV/linux-testvectors
 recordFile="$tvDir/all.qemu"
 traceFile="$tvDir/all.txt"
+indexedTraceFile="$tvDir/all.ltr"
+baseRamFile="$tvDir/ram.bin"
 
-# Parse Commandline Arg
-if [ "$#" -ne 1 ]; then
-    echo "genCheckpoint requires 1 argument: <num instrs>" >&2
-    exit 1
+# Parse Commandline Args
+# Several checkpoints are taken in a single QEMU replay; -y skips the confirmation
+# so that checkpointSweep.sh can run unattended.  Set GDB_PORT to run more than
+# one replay at a time.
+confirm=1
+if [ "$1" == "-y" ]; then
+    confirm=0
+    shift
 fi
-instrs=$1
-if ! [ "$instrs" -eq "$instrs" ] 2> /dev/null
-then
-    echo "Error expected integer number of instructions, got $instrs" >&2
+if [ "$#" -lt 1 ]; then
+    echo "genCheckpoint requires at least 1 argument: [-y] <num instrs> [<num instrs> ...]" >&2
     exit 1
 fi
+for instrs in "$@"; do
+    if ! [ "$instrs" -eq "$instrs" ] 2> /dev/null || [ "$instrs" -le 0 ]
+    then
+        echo "Error expected integer number of instructions, got $instrs" >&2
+        exit 1
+    fi
+done
+checkpoints=$(printf "%s\n" "$@" | sort -n -u)
 
-checkPtDir="$tvDir/checkpoint$instrs"
-outTraceFile="$checkPtDir/all.txt"
-rawStateFile="$checkPtDir/stateGDB.txt"
-rawUartStateFile="$checkPtDir/uartStateGDB.txt"
-uartStateFile="$checkPtDir/checkpoint-UART"
-rawPlicStateFile="$checkPtDir/plicStateGDB.txt"
-plicStateFile="$checkPtDir/checkpoint-PLIC"
-rawRamFile="$checkPtDir/ramGDB.bin"
-ramFile="$checkPtDir/ram.bin"
-
-read -p "This scripts is going to create a checkpoint at $instrs instrs.
+if [ $confirm -eq 1 ]; then
+    read -p "This scripts is going to create checkpoints at $(echo $checkpoints) instrs.
 Is that what you wanted? (y/n) " -n 1 -r
-echo
+    echo
+else
+    REPLY=y
+fi
 if [[ $REPLY =~ ^[Yy]$ ]]
 then
-    echo "Creating checkpoint at $instrs instructions!"
+    echo "Creating checkpoints at $(echo $checkpoints) instructions!"
     if [ ! -d "$tvDir" ]; then
         echo "Error: linux testvector directory $tvDir not found!">&2
         echo "Please create it. For example:">&2
@@ -46,19 +52,12 @@ then
         echo "    sudo chmod -R a+rw $tvDir">&2
         exit 1
     fi
-
-    mkdir -p $checkPtDir
-
-    # Identify instruction in trace
-    instr=$(sed "${instrs}q;d" "$traceFile")
-    echo "Found ${instrs}th instr: ${instr}"
-    pc=$(echo $instr | cut -d " " -f1)
-    asm=$(echo $instr | cut -d " " -f2)
-    occurences=$(($(head -$instrs "$traceFile" | grep -c "${pc} ${asm}")-1))
-    echo "It occurs ${occurences} times before the ${instrs}th instr." 
+    if [ -f "$indexedTraceFile" ]; then
+        make -C ../../testbench/dpi ltr2txt
+    fi
 
     # Create GDB script because GDB is terrible at handling arguments / variables
-    cat > genCheckpoint.gdb <<- end_of_script 
+    cat > genCheckpoint.gdb <<- end_of_script
     set pagination off
     set logging overwrite on
     set logging redirect on
@@ -68,10 +67,41 @@ then
     file $imageDir/vmlinux
     # Step over reset vector into actual code
     stepi 100
+end_of_script
+
+    prev=0
+    for instrs in $checkpoints; do
+        checkPtDir="$tvDir/checkpoint$instrs"
+        rawStateFile="$checkPtDir/stateGDB.txt"
+        rawUartStateFile="$checkPtDir/uartStateGDB.txt"
+        rawPlicStateFile="$checkPtDir/plicStateGDB.txt"
+        rawRamFile="$checkPtDir/ramGDB.bin"
+        mkdir -p $checkPtDir
+
+        # Identify instruction in trace
+        if [ -f "$indexedTraceFile" ]; then
+            instr=$(../../testbench/dpi/ltr2txt -s $instrs -n 1 "$indexedTraceFile")
+        else
+            instr=$(sed "${instrs}q;d" "$traceFile")
+        fi
+        echo "Found ${instrs}th instr: ${instr}"
+        pc=$(echo $instr | cut -d " " -f1)
+        asm=$(echo $instr | cut -d " " -f2)
+        # GDB resumes from the previous checkpoint, so only count the hits since then
+        if [ -f "$indexedTraceFile" ]; then
+            occurences=$(../../testbench/dpi/ltr2txt -s $instrs -p -a $prev "$indexedTraceFile")
+        else
+            occurences=$(($(sed -n "$((prev+1)),${instrs}p" "$traceFile" | grep -c "${pc} ${asm}")-1))
+        fi
+        echo "It occurs ${occurences} times between the ${prev}th and ${instrs}th instrs."
+        prev=$instrs
+
+        cat >> genCheckpoint.gdb <<- end_of_script
     shell echo \"GDB proceeding to checkpoint at $instrs instrs, pc $pc\"
     b *0x$pc
-    ignore 1 $occurences
+    ignore \$bpnum $occurences
     c
+    delete
     shell echo \"Reached checkpoint at $instrs instrs\"
     shell echo \"GDB storing CPU state to $rawStateFile\"
     set logging file $rawStateFile
@@ -95,6 +125,8 @@ then
     x/1xb 0x10000006
     x/1xb 0x10000007
     set logging off
+    # Restore LCR so that the replay continues unchanged
+    set {char}0x10000003 = \$LCR
     shell echo \"GDB storing PLIC state to $rawPlicStateFile\"
     shell echo \"Note: this dumping assumes a maximum of 63 PLIC sources\"
     set logging file $rawPlicStateFile
@@ -110,6 +142,9 @@ then
     set logging off
     shell echo \"GDB storing RAM to $rawRamFile\"
     dump binary memory $rawRamFile 0x80000000 0x87ffffff
+end_of_script
+    done
+    cat >> genCheckpoint.gdb <<- end_of_script
     kill
     q
 end_of_script
@@ -128,19 +163,35 @@ end_of_script
     echo "Completed GDB script at $(date +%H:%M:%S)"
 
     # Post-Process GDB outputs
-    ./parseState.py "$checkPtDir"
-    ./parseUartState.py "$checkPtDir"
-    ./parsePlicState.py "$checkPtDir"
-    echo "Changing Endianness at $(date +%H:%M:%S)"
     make fixBinMem
-    ./fixBinMem "$rawRamFile" "$ramFile"
-    echo "Copying over a truncated trace"
-    tail -n+$instrs $traceFile > $outTraceFile
+    make -C ../../testbench/dpi bin2rpg
+    for instrs in $checkpoints; do
+        checkPtDir="$tvDir/checkpoint$instrs"
+        rawRamFile="$checkPtDir/ramGDB.bin"
+        ramFile="$checkPtDir/ram.bin"
+        sparseRamFile="$checkPtDir/ram.rpg"
+        ./parseState.py "$checkPtDir"
+        ./parseUartState.py "$checkPtDir"
+        ./parsePlicState.py "$checkPtDir"
+        echo "Changing Endianness at $(date +%H:%M:%S)"
+        ./fixBinMem "$rawRamFile" "$ramFile"
+        # Keep only the pages that are not zero or already in the genInitMem.sh image
+        echo "Packing sparse RAM checkpoint at $(date +%H:%M:%S)"
+        if ../../testbench/dpi/bin2rpg -b "$baseRamFile" "$ramFile" "$sparseRamFile"; then
+            rm -f "$rawRamFile" "$ramFile"
+            echo "Removed $ramFile; recreate it if needed with"
+            echo "    ../../testbench/dpi/rpg2bin -b $baseRamFile $sparseRamFile $ramFile"
+        fi
+        # testbench-linux.sv starts the indexed trace at the checkpoint itself
+        if [ ! -f "$indexedTraceFile" ]; then
+            echo "Copying over a truncated trace"
+            tail -n+$instrs $traceFile > "$checkPtDir/all.txt"
+        fi
+        echo "Checkpoint $instrs completed at $(date +%H:%M:%S)"
+    done
 
-    echo "Checkpoint completed at $(date +%H:%M:%S)"
     echo "You may want to restrict write access to $tvDir now and give cad ownership of it."
     echo "Run the following:"
     echo "    sudo chown -R cad:cad $tvDir"
     echo "    sudo chmod -R go-w $tvDir"
 fi
-
@@ -4,11 +4,13 @@ imageDir=$RISCV/buildroot/output/images
 tvDir=$RISCV/linux-testvectors
 recordFile="$tvDir/all.qemu"
 traceFile="$tvDir/all.txt"
+indexedTraceFile="$tvDir/all.ltr"
 trapsFile="$tvDir/traps.txt"
 interruptsFile="$tvDir/interrupts.txt"
 
 read -p "Warning: running this script will overwrite the contents of:
   * $traceFile
+  * $indexedTraceFile
   * $trapsFile
   * $interruptsFile
 Would you like to proceed? (y/n) " -n 1 -r
@@ -33,6 +35,9 @@ then
     touch $trapsFile 
     touch $interruptsFile 
 
+    make qemu2trace
+    make -C ../../testbench/dpi txt2ltr
+
     # QEMU Simulation
     echo "Launching QEMU in replay mode!"
     (qemu-system-riscv64 \
@@ -41,9 +46,10 @@ then
     -bios $imageDir/fw_jump.elf -kernel $imageDir/Image -append "root=/dev/vda ro" -initrd $imageDir/rootfs.cpio \
     -singlestep -rtc clock=vm -icount shift=0,align=off,sleep=on,rr=replay,rrfile=$recordFile \
     -d nochain,cpu,in_asm,int \
-    2>&1 >./qemu-serial | ./parseQEMUtoGDB.py | ./parseGDBtoTrace.py $trapsFile > $traceFile)
+    2>&1 >./qemu-serial | ./qemu2trace $trapsFile $interruptsFile > $traceFile)
 
-    ./filterTrapsToInterrupts.py $tvDir
+    echo "Indexing trace into $indexedTraceFile"
+    ../../testbench/dpi/txt2ltr $traceFile $indexedTraceFile
 
     echo "genTrace.sh completed!"
     echo "You may want to restrict write access to $tvDir now and give cad ownership of it."
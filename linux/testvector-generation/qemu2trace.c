@@ -0,0 +1,839 @@
+// qemu2trace.c
+// Converts the QEMU log written by genTrace.sh (-d nochain,cpu,in_asm,int) into the
+// Linux test vectors in one streaming pass.  It is a native replacement for
+//     parseQEMUtoGDB.py | parseGDBtoTrace.py traps.txt > all.txt
+//     filterTrapsToInterrupts.py
+// and reproduces their output, including the page fault CSR/register handling, the
+// whichClass() memory access decoding and the duplicate-PC filtering.
+//
+// The log is read in large blocks by one thread, split into lines and tokens (with
+// register values already converted from hex) by a pool of worker threads, and run
+// through the two original state machines in order on the main thread.  Output is
+// handed to a writer thread.
+//
+// usage: qemu2trace [-j <threads>] <traps file> <interrupts file> < qemu log > all.txt
+
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define CHUNK    (4 << 20)   // bytes of log per work item
+#define NSLOTS   16          // work items in flight
+#define OUTBUF   (1 << 20)   // bytes of output per write
+
+/////////////////////////////////////////////
+// Tokenized input
+/////////////////////////////////////////////
+
+enum {
+  F_INTR  = 1 << 0,   // riscv_cpu_do_interrupt
+  F_TERM  = 1 << 1,   // QEMU terminated via GDBstub
+  F_IN    = 1 << 2,   // IN:
+  F_0X    = 1 << 3,   // 0x... (disassembled instruction)
+  F_OOB   = 1 << 4,   // contains "out of bounds"
+  F_DASH  = 1 << 5,   // --------
+  F_X0    = 1 << 6,   // " x0/zero"
+  F_PC    = 1 << 7,   // contains "pc"
+  F_SKIP  = 1 << 8    // blank, Disassembler... or Please...
+};
+
+typedef struct {
+  const char *p, *name;     // token; name is the part after '/' if there is one
+  uint32_t    len, nameLen;
+  uint8_t     hexok, slash;
+  uint64_t    val, hash;    // hex value; hash of name
+} tok_t;
+
+typedef struct {
+  const char *s;
+  uint32_t    len, flags;
+  size_t      tok, ntok;
+} line_t;
+
+enum { SLOT_FREE, SLOT_FILLED, SLOT_BUSY, SLOT_READY };
+
+typedef struct {
+  char   *data;
+  size_t  len, cap;
+  line_t *lines;
+  size_t  nlines, capLines;
+  tok_t  *toks;
+  size_t  ntoks, capToks;
+  int     state;
+  long    seq;
+} chunk_t;
+
+static chunk_t         slots[NSLOTS];
+static long            nextTokenize, numChunks = -1;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  changed = PTHREAD_COND_INITIALIZER;
+
+static int isspc(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+static int startsWith(const char *s, size_t len, const char *prefix) {
+  size_t n = strlen(prefix);
+  return len >= n && memcmp(s, prefix, n) == 0;
+}
+
+static uint64_t fnv(const char *s, size_t n) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  while (n--) h = (h ^ (uint8_t)*s++) * 0x100000001b3ull;
+  return h;
+}
+
+static int parseHex(const char *s, size_t n, uint64_t *v) {
+  int d;
+  if (n > 2 && s[0] == '0' && (s[1] | 0x20) == 'x') { s += 2; n -= 2; }
+  if (n == 0) return 0;
+  for (*v = 0; n; n--, s++) {
+    char c = *s | 0x20;
+    if (*s >= '0' && *s <= '9') d = *s - '0';
+    else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+    else return 0;
+    *v = *v << 4 | d;
+  }
+  return 1;
+}
+
+static void tokenize(chunk_t *c) {
+  const char *p = c->data, *end = c->data + c->len;
+  c->nlines = c->ntoks = 0;
+  while (p < end) {
+    const char *nl = memchr(p, '\n', end - p), *q;
+    line_t *l;
+    if (!nl) nl = end;
+    if (c->nlines == c->capLines) {
+      c->capLines = c->capLines ? 2 * c->capLines : 65536;
+      c->lines = realloc(c->lines, c->capLines * sizeof(line_t));
+    }
+    l = &c->lines[c->nlines++];
+    l->s = p;
+    l->len = nl - p;
+    l->flags = 0;
+    l->tok = c->ntoks;
+    if (startsWith(p, l->len, "riscv_cpu_do_interrupt")) l->flags |= F_INTR;
+    if (startsWith(p, l->len, "qemu-system-riscv64: QEMU: Terminated via GDBstub")) l->flags |= F_TERM;
+    if (startsWith(p, l->len, "IN:")) l->flags |= F_IN;
+    if (startsWith(p, l->len, "0x")) l->flags |= F_0X;
+    if ((l->flags & F_0X) && memmem(p, l->len, "out of bounds", 13)) l->flags |= F_OOB;
+    if (startsWith(p, l->len, "--------")) l->flags |= F_DASH;
+    if (startsWith(p, l->len, " x0/zero")) l->flags |= F_X0;
+    if (memmem(p, l->len, "pc", 2)) l->flags |= F_PC;
+    if (startsWith(p, l->len, "Disassembler") || startsWith(p, l->len, "Please")) l->flags |= F_SKIP;
+    for (q = p; q < nl; ) {
+      tok_t *t;
+      const char *s, *slash;
+      while (q < nl && isspc(*q)) q++;
+      if (q == nl) break;
+      for (s = q; q < nl && !isspc(*q); q++);
+      if (c->ntoks == c->capToks) {
+        c->capToks = c->capToks ? 2 * c->capToks : 262144;
+        c->toks = realloc(c->toks, c->capToks * sizeof(tok_t));
+      }
+      t = &c->toks[c->ntoks++];
+      t->p = s;
+      t->len = q - s;
+      t->hexok = parseHex(s, t->len, &t->val);
+      slash = memchr(s, '/', t->len);
+      t->slash = slash != NULL;
+      if (slash) {
+        const char *e = memchr(slash + 1, '/', q - slash - 1);
+        t->name = slash + 1;
+        t->nameLen = (e ? e : q) - t->name;
+      } else {
+        t->name = s;
+        t->nameLen = t->len;
+      }
+      t->hash = fnv(t->name, t->nameLen);
+    }
+    l->ntok = c->ntoks - l->tok;
+    if (l->ntok == 0) l->flags |= F_SKIP;
+    p = nl + 1;
+  }
+}
+
+static void *reader(void *arg) {
+  FILE *in = arg;
+  char *carry = NULL;
+  size_t ncarry = 0;
+  long seq;
+  for (seq = 0; ; seq++) {
+    chunk_t *c = &slots[seq % NSLOTS];
+    size_t got, last;
+    pthread_mutex_lock(&lock);
+    while (c->state != SLOT_FREE) pthread_cond_wait(&changed, &lock);
+    pthread_mutex_unlock(&lock);
+    if (c->cap < ncarry + CHUNK) {
+      c->cap = ncarry + CHUNK;
+      c->data = realloc(c->data, c->cap);
+    }
+    memcpy(c->data, carry, ncarry);
+    c->len = ncarry;
+    do {
+      if (c->len == c->cap) c->data = realloc(c->data, c->cap *= 2);
+      got = fread(c->data + c->len, 1, c->cap - c->len, in);
+      c->len += got;
+      for (last = c->len; last > ncarry && c->data[last - 1] != '\n'; last--);
+    } while (got && last == ncarry && c->len > 0);   // a line longer than the buffer
+    if (!got) last = c->len;                          // end of input: keep the unterminated line
+    ncarry = c->len - last;
+    carry = realloc(carry, ncarry ? ncarry : 1);
+    memcpy(carry, c->data + last, ncarry);
+    c->len = last;
+    pthread_mutex_lock(&lock);
+    if (c->len == 0 && !got) {
+      numChunks = seq;
+      pthread_cond_broadcast(&changed);
+      pthread_mutex_unlock(&lock);
+      free(carry);
+      return NULL;
+    }
+    c->seq = seq;
+    c->state = SLOT_FILLED;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+  }
+}
+
+static void *worker(void *arg) {
+  (void)arg;
+  for (;;) {
+    chunk_t *c;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+      c = &slots[nextTokenize % NSLOTS];
+      if (numChunks >= 0 && nextTokenize >= numChunks) { pthread_mutex_unlock(&lock); return NULL; }
+      if (c->state == SLOT_FILLED && c->seq == nextTokenize) break;
+      pthread_cond_wait(&changed, &lock);
+    }
+    nextTokenize++;
+    c->state = SLOT_BUSY;
+    pthread_mutex_unlock(&lock);
+    tokenize(c);
+    pthread_mutex_lock(&lock);
+    c->state = SLOT_READY;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+  }
+}
+
+/////////////////////////////////////////////
+// Output
+/////////////////////////////////////////////
+
+static char           *outbuf[2], *pending;
+static size_t          outlen, pendingLen;
+static int             outIdx, writerDone;
+static pthread_mutex_t outLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  outCond = PTHREAD_COND_INITIALIZER;
+
+static void *writer(void *arg) {
+  FILE *out = arg;
+  pthread_mutex_lock(&outLock);
+  for (;;) {
+    while (!pending && !writerDone) pthread_cond_wait(&outCond, &outLock);
+    if (!pending) break;
+    pthread_mutex_unlock(&outLock);
+    fwrite(pending, 1, pendingLen, out);
+    pthread_mutex_lock(&outLock);
+    pending = NULL;
+    pthread_cond_broadcast(&outCond);
+  }
+  pthread_mutex_unlock(&outLock);
+  fflush(out);
+  return NULL;
+}
+
+static void submitOutput(void) {
+  pthread_mutex_lock(&outLock);
+  while (pending) pthread_cond_wait(&outCond, &outLock);
+  pending = outbuf[outIdx];
+  pendingLen = outlen;
+  pthread_cond_broadcast(&outCond);
+  pthread_mutex_unlock(&outLock);
+  outIdx ^= 1;
+  outlen = 0;
+}
+
+static void emit(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void emit(const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  outlen += vsnprintf(outbuf[outIdx] + outlen, OUTBUF + 4096 - outlen, fmt, ap);
+  va_end(ap);
+}
+
+// Python '{:x}' of an integer that may be negative or wider than 64 bits
+static void emitHex128(__int128 v) {
+  unsigned __int128 u = v < 0 ? -(unsigned __int128)v : (unsigned __int128)v;
+  uint64_t hi = u >> 64, lo = (uint64_t)u;
+  if (hi) emit("%s%llx%016llx", v < 0 ? "-" : "", (unsigned long long)hi, (unsigned long long)lo);
+  else    emit("%s%llx", v < 0 ? "-" : "", (unsigned long long)lo);
+}
+
+/////////////////////////////////////////////
+// Register/CSR names
+/////////////////////////////////////////////
+
+static const char *regNames[] = {
+  "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+  "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+  "mhartid", "mstatus", "mip", "mie", "mideleg", "medeleg", "mtvec", "stvec", "mepc", "sepc",
+  "mcause", "scause", "mtval", "stval", "mscratch", "sscratch", "satp"
+};
+#define NREGNAMES (int)(sizeof(regNames) / sizeof(regNames[0]))
+
+typedef struct {
+  char     *s;
+  uint32_t  len;
+  uint64_t  hash;
+  int       regNum;                       // parseGDBtoTrace RegNumber, -1 if not checked
+  // parseQEMUtoGDB state
+  uint64_t  csr, pfCsr, reg, pfReg;
+  uint8_t   hasCsr, hasPfCsr, hasReg, hasPfReg;
+  // parseGDBtoTrace register snapshots (two blocks)
+  uint64_t  bval[2];
+  uint64_t  bstamp[2];
+} name_t;
+
+static name_t *names;
+static int     nnames, capNames;
+static int    *nameTable;                  // open addressing, -1 empty
+static size_t  tableSize;
+
+static int lookupName(const char *s, size_t len, uint64_t hash, int insert) {
+  size_t i;
+  if (insert && 2 * (size_t)(nnames + 1) > tableSize) {
+    size_t n = tableSize ? 2 * tableSize : 1024, j;
+    int *t = malloc(n * sizeof(int));
+    memset(t, -1, n * sizeof(int));
+    for (j = 0; j < (size_t)nnames; j++) {
+      for (i = names[j].hash & (n - 1); t[i] >= 0; i = (i + 1) & (n - 1));
+      t[i] = j;
+    }
+    free(nameTable);
+    nameTable = t;
+    tableSize = n;
+  }
+  if (!tableSize) return -1;
+  for (i = hash & (tableSize - 1); nameTable[i] >= 0; i = (i + 1) & (tableSize - 1)) {
+    name_t *nm = &names[nameTable[i]];
+    if (nm->hash == hash && nm->len == len && !memcmp(nm->s, s, len)) return nameTable[i];
+  }
+  if (!insert) return -1;
+  if (nnames == capNames) {
+    capNames = capNames ? 2 * capNames : 256;
+    names = realloc(names, capNames * sizeof(name_t));
+  }
+  memset(&names[nnames], 0, sizeof(name_t));
+  names[nnames].s = malloc(len + 1);
+  memcpy(names[nnames].s, s, len);
+  names[nnames].s[len] = 0;
+  names[nnames].len = len;
+  names[nnames].hash = hash;
+  names[nnames].regNum = -1;
+  nameTable[i] = nnames;
+  return nnames++;
+}
+
+static int intern(const char *s, size_t len, uint64_t hash) { return lookupName(s, len, hash, 1); }
+static int internStr(const char *s) { return intern(s, strlen(s), fnv(s, strlen(s))); }
+
+/////////////////////////////////////////////
+// parseGDBtoTrace.py
+/////////////////////////////////////////////
+
+enum { CLASS_OTHER, CLASS_LOAD, CLASS_STORE, CLASS_AMO, CLASS_LR, CLASS_SC };
+
+typedef struct {
+  int       valid;         // text != None
+  uint64_t  pc, bits;
+  char     *text;
+  int       cls;
+  int       hasAddr;
+  __int128  addr;
+  int       writeReg, readReg;   // name ids, -1 for None
+  int       slot;
+  uint64_t  stamp;
+  int      *order;
+  int       n, cap;
+} gdbinstr_t;
+
+static gdbinstr_t  gPrev, gCur;
+static int         gOpen;
+static uint64_t    gStamp;
+static long long   numInstrs;
+static int         pcId;
+static FILE       *trapsFile, *interruptsFile;
+
+static void blockAdd(gdbinstr_t *b, int id, uint64_t val) {
+  name_t *nm = &names[id];
+  if (nm->bstamp[b->slot] != b->stamp) {
+    if (b->n == b->cap) b->order = realloc(b->order, (b->cap = b->cap ? 2 * b->cap : 128) * sizeof(int));
+    b->order[b->n++] = id;
+    nm->bstamp[b->slot] = b->stamp;
+  }
+  nm->bval[b->slot] = val;
+}
+
+static int blockGet(const gdbinstr_t *b, int id, uint64_t *val) {
+  if (id < 0 || names[id].bstamp[b->slot] != b->stamp) return 0;
+  *val = names[id].bval[b->slot];
+  return 1;
+}
+
+// value of the register named by s[0:len] in block b
+static int regByName(const gdbinstr_t *b, const char *s, size_t len, uint64_t *val) {
+  return blockGet(b, lookupName(s, len, fnv(s, len), 0), val);
+}
+
+static const char *trimSpaces(const char *s, const char *e, const char **end) {
+  while (s < e && (*s == ' ' || *s == '\t' || *s == '\n')) s++;
+  while (e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\n')) e--;
+  *end = e;
+  return s;
+}
+
+// WhatMemDestSource: text.split()[1].split(',')[0]
+static int memDestSource(const char *text) {
+  const char *s = strchr(text, ' '), *e;
+  if (!s) return -1;
+  s++;
+  for (e = s; *e && *e != ',' && *e != ' '; e++);
+  return lookupName(s, e - s, fnv(s, e - s), 0);
+}
+
+// register inside the parentheses: text.split('(')[1].strip(')').strip()
+static int addrReg(const gdbinstr_t *b, const char *text, uint64_t *val) {
+  const char *s = strchr(text, '('), *e, *t;
+  if (!s) return 0;
+  s++;
+  for (e = s; *e && *e != '('; e++);
+  while (e > s && e[-1] == ')') e--;
+  s = trimSpaces(s, e, &t);
+  return regByName(b, s, t - s, val);
+}
+
+// WhatAddr: Imm + Regs[Src] from "rd,imm(src)"
+static int whatAddr(const gdbinstr_t *b, const char *text, __int128 *addr) {
+  const char *s = strchr(text, ','), *e, *paren, *t;
+  char immstr[64], *endp;
+  long long imm;
+  uint64_t rv;
+  if (!s) return 0;
+  s++;
+  for (e = s; *e && *e != ','; e++);
+  paren = memchr(s, '(', e - s);
+  if (!paren || memchr(paren + 1, '(', e - paren - 1)) return 0;
+  s = trimSpaces(s, paren, &t);
+  if (t - s == 0 || t - s >= (long)sizeof(immstr)) return 0;
+  memcpy(immstr, s, t - s);
+  immstr[t - s] = 0;
+  imm = strtoll(immstr, &endp, 10);
+  if (*endp) return 0;
+  s = paren + 1;
+  while (e > s && e[-1] == ')') e--;
+  s = trimSpaces(s, e, &t);
+  if (!regByName(b, s, t - s, &rv)) return 0;
+  *addr = (__int128)imm + rv;
+  return 1;
+}
+
+static void whichClass(gdbinstr_t *b) {
+  const char *t = b->text;
+  uint64_t v;
+  b->cls = CLASS_OTHER;
+  b->hasAddr = 0;
+  b->writeReg = b->readReg = -1;
+  if (!strncmp(t, "ld", 2) || !strncmp(t, "lw", 2) || !strncmp(t, "lh", 2) || !strncmp(t, "lb", 2)) {
+    if (!whatAddr(b, t, &b->addr)) return;
+    b->cls = CLASS_LOAD;
+    b->readReg = memDestSource(t);
+  } else if (!strncmp(t, "sd", 2) || !strncmp(t, "sw", 2) || !strncmp(t, "sh", 2) || !strncmp(t, "sb", 2)) {
+    if (!whatAddr(b, t, &b->addr)) return;
+    b->cls = CLASS_STORE;
+    b->writeReg = memDestSource(t);
+  } else if (!strncmp(t, "amo", 3) || !strncmp(t, "lr", 2) || !strncmp(t, "sc", 2)) {
+    if (!addrReg(b, t, &v)) return;
+    b->addr = v;
+    b->cls = t[0] == 'a' ? CLASS_AMO : t[0] == 'l' ? CLASS_LR : CLASS_SC;
+    if (b->cls != CLASS_LR) b->writeReg = memDestSource(t);
+    if (b->cls != CLASS_SC) b->readReg = memDestSource(t);
+  } else return;
+  b->hasAddr = 1;
+}
+
+// PrintInstr for the previous instruction, with the registers it changed as seen
+// in the current dump
+static void printInstr(void) {
+  int i, gpr = -1;
+  uint64_t gprVal = 0, v, wd = 0, rd = 0;
+  char *c;
+  emit("%llx %llx ", (unsigned long long)gPrev.pc, (unsigned long long)gPrev.bits);
+  for (c = gPrev.text; *c; c++) outbuf[outIdx][outlen++] = *c == ' ' ? '_' : *c;
+  for (i = 0; i < gPrev.n; i++) {
+    int id = gPrev.order[i];
+    if (names[id].regNum >= 0 && names[id].regNum < 32 && blockGet(&gCur, id, &v) &&
+        v != names[id].bval[gPrev.slot]) { gpr = names[id].regNum; gprVal = v; }
+  }
+  if (gpr >= 0) emit(" GPR %d %llx", gpr, (unsigned long long)gprVal);
+  if (gPrev.readReg >= 0) blockGet(&gCur, gPrev.readReg, &rd);
+  if (gPrev.writeReg >= 0) blockGet(&gCur, gPrev.writeReg, &wd);
+  if (gPrev.cls == CLASS_LOAD || gPrev.cls == CLASS_LR) {
+    emit(" MemR ");
+    emitHex128(gPrev.addr);
+    emit(" 0 %llx", (unsigned long long)rd);
+  }
+  if (gPrev.cls == CLASS_STORE) {
+    emit(" MemW ");
+    emitHex128(gPrev.addr);
+    emit(" %llx 0", (unsigned long long)wd);
+  }
+  for (i = 0, c = " CSR"; i < gPrev.n; i++) {
+    int id = gPrev.order[i];
+    if (names[id].regNum >= 32 && blockGet(&gCur, id, &v) && v != names[id].bval[gPrev.slot]) {
+      emit("%s %s %llx", c, names[id].s, (unsigned long long)v);
+      c = "";
+    }
+  }
+  emit("\n");
+  if (outlen > OUTBUF) submitOutput();
+}
+
+static void gdbStart(uint64_t pc, uint64_t bits, const char *text) {
+  gCur.pc = pc;
+  gCur.bits = bits;
+  free(gCur.text);
+  gCur.text = strdup(text);
+  gCur.valid = 1;
+  gCur.slot = gPrev.slot ^ 1;
+  gCur.stamp = ++gStamp;
+  gCur.n = 0;
+  gOpen = 1;
+}
+
+static void gdbReg(int id, uint64_t val) {
+  if (gOpen && id != pcId) blockAdd(&gCur, id, val);
+}
+
+static void gdbEnd(void) {
+  gdbinstr_t t;
+  if (!gOpen) return;
+  gOpen = 0;
+  whichClass(&gCur);
+  if (gPrev.valid && gPrev.pc != gCur.pc) {
+    printInstr();
+    if (++numInstrs % 1000000 == 0) fprintf(stderr, "qemu2trace reached %lld million instrs\n", numInstrs / 1000000);
+  }
+  t = gPrev;
+  gPrev = gCur;
+  gCur = t;
+}
+
+// traps.txt entry (parseGDBtoTrace.py) and interrupts.txt (filterTrapsToInterrupts.py)
+static void gdbInterrupt(const char *line) {
+  static const char *prefix = "riscv_cpu_do_interrupt: ";
+  char buf[4096], *vals[16], *p, *q, *last;
+  int nvals = 0, i, keep;
+  size_t n = strlen(line);
+  if (n >= sizeof(buf) - 1) n = sizeof(buf) - 2;
+  memcpy(buf, line, n);
+  buf[n] = 0;
+  // line.strip('riscv_cpu_do_interrupt: ').strip('\n').split(',')
+  for (p = buf; *p && strchr(prefix, *p); p++);
+  for (; p && nvals < 16; p = q) {
+    char *s, *e;
+    q = strchr(p, ',');
+    if (q) *q++ = 0;
+    s = strrchr(p, ':') ? strrchr(p, ':') + 1 : p;
+    if (strchr(s, '=')) s = strrchr(s, '=') + 1;
+    while (*s == ' ') s++;
+    for (e = s + strlen(s); e > s && e[-1] == ' '; e--);
+    *e = 0;
+    vals[nvals++] = s;
+  }
+  last = strrchr(line, ' ') ? strrchr(line, ' ') + 1 : (char *)line;
+  keep = strstr(line, "interrupt") && (strstr(last, "external") || strstr(last, "m_timer"));
+  for (i = 0; i < 1 + keep; i++) {
+    FILE *f = i ? interruptsFile : trapsFile;
+    int j;
+    fprintf(f, "%s\n%lld\n", line, numInstrs);
+    for (j = 0; j < nvals; j++) fprintf(f, "%s\n", vals[j]);
+  }
+}
+
+/////////////////////////////////////////////
+// parseQEMUtoGDB.py
+/////////////////////////////////////////////
+
+enum { ST_IDLE, ST_INSTR, ST_CSRS, ST_REGFILE };
+
+typedef struct { uint64_t adr, bits; char *text; int used; } instrent_t;
+
+static int         state = ST_IDLE;
+static int         inPageFault, endPageFault;
+static uint64_t    returnAdr;
+static int        *csrOrder, ncsrs, capCsrs;
+static int         pfCsrCount, pfRegCount;
+static char       *interruptLine;
+static instrent_t *instrs;
+static size_t      ninstrs, capInstrs;
+static int         sepcId, stvalId;
+
+static instrent_t *findInstr(uint64_t adr, int insert) {
+  size_t i;
+  if (insert && 2 * (ninstrs + 1) > capInstrs) {
+    size_t n = capInstrs ? 2 * capInstrs : 65536, j;
+    instrent_t *t = calloc(n, sizeof(instrent_t));
+    for (j = 0; j < capInstrs; j++)
+      if (instrs[j].used) {
+        for (i = (instrs[j].adr * 0x9e3779b97f4a7c15ull >> 20) & (n - 1); t[i].used; i = (i + 1) & (n - 1));
+        t[i] = instrs[j];
+      }
+    free(instrs);
+    instrs = t;
+    capInstrs = n;
+  }
+  if (!capInstrs) return NULL;
+  for (i = (adr * 0x9e3779b97f4a7c15ull >> 20) & (capInstrs - 1); instrs[i].used; i = (i + 1) & (capInstrs - 1))
+    if (instrs[i].adr == adr) return &instrs[i];
+  if (!insert) return NULL;
+  instrs[i].used = 1;
+  instrs[i].adr = adr;
+  instrs[i].text = NULL;
+  ninstrs++;
+  return &instrs[i];
+}
+
+static const tok_t *T(const chunk_t *c, const line_t *l, int i) { return &c->toks[l->tok + i]; }
+
+static void printCSRs(void) {
+  int i;
+  if (inPageFault) return;
+  for (i = 0; i < ncsrs; i++) gdbReg(csrOrder[i], names[csrOrder[i]].csr);
+  gdbEnd();
+  if (interruptLine) {
+    gdbInterrupt(interruptLine);
+    free(interruptLine);
+    interruptLine = NULL;
+  }
+}
+
+static void warnLine(const char *msg, const line_t *l) {
+  fprintf(stderr, "%s%.*s\n", msg, (int)l->len, l->s);
+}
+
+static void parseRegs(const chunk_t *c, const line_t *l);
+
+static void setCsr(name_t *nm, uint64_t val) {
+  if (!nm->hasCsr) {
+    if (ncsrs == capCsrs) csrOrder = realloc(csrOrder, (capCsrs *= 2) * sizeof(int));
+    csrOrder[ncsrs++] = nm - names;
+    nm->hasCsr = 1;
+  }
+  nm->csr = val;
+}
+
+static void parseCSRs(const chunk_t *c, const line_t *l) {
+  const tok_t *t0, *t1;
+  name_t *nm;
+  int id;
+  if (l->flags & F_SKIP) return;
+  if (l->flags & F_X0) {
+    state = ST_REGFILE;
+    if (!inPageFault) {
+      instrent_t *e = names[pcId].hasCsr ? findInstr(names[pcId].csr, 0) : NULL;
+      if (!e) fprintf(stderr, "qemu2trace: no disassembly for pc 0x%llx\n", (unsigned long long)names[pcId].csr);
+      else gdbStart(e->adr, e->bits, e->text);
+    }
+    parseRegs(c, l);
+    return;
+  }
+  t0 = T(c, l, 0);
+  if (l->ntok < 2 || !(t1 = T(c, l, 1))->hexok) { warnLine("qemu2trace: unexpected CSR line: ", l); return; }
+  id = intern(t0->p, t0->len, fnv(t0->p, t0->len));
+  nm = &names[id];
+  // sepc and stval are corrupted on leaving a QEMU page fault; keep the faulting PC
+  // until QEMU reports a new value
+  if (endPageFault && (id == sepcId || id == stvalId)) {
+    setCsr(nm, returnAdr);
+    if (!nm->hasPfCsr) pfCsrCount++;
+    nm->hasPfCsr = 1;
+    nm->pfCsr = t1->val;
+  } else if (pfCsrCount && nm->hasPfCsr) {
+    if (t1->val != nm->pfCsr) {
+      nm->hasPfCsr = 0;
+      pfCsrCount--;
+      setCsr(nm, t1->val);
+    }
+  } else setCsr(nm, t1->val);
+}
+
+static void parseRegs(const chunk_t *c, const line_t *l) {
+  size_t i;
+  if (l->flags & F_PC) {
+    printCSRs();
+    state = ST_CSRS;
+    parseCSRs(c, l);
+    return;
+  }
+  if (l->flags & F_DASH) {
+    printCSRs();
+    state = ST_IDLE;
+    return;
+  }
+  for (i = 0; i < l->ntok; i += 2) {
+    const tok_t *t = T(c, l, i);
+    name_t *nm;
+    int id;
+    if (!t->slash) { warnLine("Whoops. Expected a list of reg file regs; got:\n", l); continue; }
+    if (i + 1 >= l->ntok || !T(c, l, i + 1)->hexok) { warnLine("qemu2trace: bad register value: ", l); break; }
+    id = intern(t->name, t->nameLen, t->hash);
+    nm = &names[id];
+    if (inPageFault) {
+      if (!nm->hasPfReg) pfRegCount++;
+      nm->hasPfReg = 1;
+      nm->pfReg = T(c, l, i + 1)->val;
+    } else {
+      uint64_t val = T(c, l, i + 1)->val;
+      if (pfRegCount && nm->hasPfReg) {
+        if (val != nm->pfReg) {
+          nm->hasPfReg = 0;
+          pfRegCount--;
+          nm->reg = val;
+          nm->hasReg = 1;
+        }
+      } else {
+        nm->reg = val;
+        nm->hasReg = 1;
+      }
+      if (nm->hasReg) gdbReg(id, nm->reg);
+    }
+  }
+}
+
+static void instrLine(const chunk_t *c, const line_t *l) {
+  const tok_t *t0 = T(c, l, 0);
+  uint64_t adr;
+  int ok = t0->len > 3 && parseHex(t0->p + 2, t0->len - 3, &adr);
+  if (l->flags & F_OOB) {
+    fprintf(stderr, "Detected QEMU page fault error\n");
+    if (!inPageFault) {
+      returnAdr = ok ? adr : 0;
+      fprintf(stderr, "Saving SEPC of 0x%llx\n", (unsigned long long)returnAdr);
+    }
+    inPageFault = 1;
+  } else {
+    endPageFault = inPageFault;
+    inPageFault = 0;
+    if (!ok || l->ntok < 3) warnLine("qemu2trace: unexpected instruction line: ", l);
+    else {
+      instrent_t *e = findInstr(adr, 1);
+      const tok_t *t2 = T(c, l, 2);
+      size_t n = t2->len + (l->ntok > 3 ? 1 + T(c, l, 3)->len : 0);
+      free(e->text);
+      e->text = malloc(n + 1);
+      memcpy(e->text, t2->p, t2->len);
+      if (l->ntok > 3) {
+        e->text[t2->len] = ' ';
+        memcpy(e->text + t2->len + 1, T(c, l, 3)->p, T(c, l, 3)->len);
+      }
+      e->text[n] = 0;
+      if (!T(c, l, 1)->hexok) warnLine("qemu2trace: bad instruction bits: ", l);
+      e->bits = T(c, l, 1)->val;
+    }
+  }
+  state = ST_CSRS;
+}
+
+// returns 0 once QEMU reports termination
+static int processChunk(const chunk_t *c) {
+  size_t i;
+  for (i = 0; i < c->nlines; i++) {
+    const line_t *l = &c->lines[i];
+    if (l->flags & F_INTR) {
+      fprintf(stderr, "%.*s\n", (int)l->len, l->s);
+      free(interruptLine);
+      interruptLine = strndup(l->s, l->len);
+    } else if (l->flags & F_TERM) return 0;
+    else if (l->flags & F_IN) state = ST_INSTR;
+    else if (state == ST_INSTR && (l->flags & F_0X)) instrLine(c, l);
+    else if (state == ST_CSRS) parseCSRs(c, l);
+    else if (state == ST_REGFILE) parseRegs(c, l);
+  }
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  pthread_t rd, wr, *workers;
+  int nworkers = sysconf(_SC_NPROCESSORS_ONLN) - 2, i, opt;
+  long seq;
+
+  while ((opt = getopt(argc, argv, "j:")) != -1) {
+    if (opt == 'j') nworkers = atoi(optarg);
+    else { fprintf(stderr, "usage: %s [-j threads] <traps file> <interrupts file> < qemu log > trace\n", argv[0]); exit(1); }
+  }
+  if (argc - optind != 2) {
+    fprintf(stderr, "Expected 2 arguments: <traps file> <interrupts file>\n");
+    exit(1);
+  }
+  if (nworkers < 1) nworkers = 1;
+  if (!(trapsFile = fopen(argv[optind], "w")) || !(interruptsFile = fopen(argv[optind + 1], "w"))) {
+    fprintf(stderr, "Cannot write %s or %s\n", argv[optind], argv[optind + 1]);
+    exit(1);
+  }
+
+  // parseGDBtoTrace's initial register state: the checked registers, all zero
+  for (i = 0; i < NREGNAMES; i++) {
+    int id = internStr(regNames[i]);
+    names[id].regNum = i;
+  }
+  pcId = internStr("pc");
+  sepcId = internStr("sepc");
+  stvalId = internStr("stval");
+  gPrev.slot = 0;
+  gPrev.stamp = ++gStamp;
+  for (i = 0; i < NREGNAMES; i++) blockAdd(&gPrev, i, 0);
+  csrOrder = malloc((capCsrs = 64) * sizeof(int));
+  outbuf[0] = malloc(OUTBUF + 4096);
+  outbuf[1] = malloc(OUTBUF + 4096);
+
+  pthread_create(&rd, NULL, reader, stdin);
+  pthread_create(&wr, NULL, writer, stdout);
+  workers = malloc(nworkers * sizeof(pthread_t));
+  for (i = 0; i < nworkers; i++) pthread_create(&workers[i], NULL, worker, NULL);
+
+  for (seq = 0; ; seq++) {
+    chunk_t *c = &slots[seq % NSLOTS];
+    int more;
+    pthread_mutex_lock(&lock);
+    while (!(c->state == SLOT_READY && c->seq == seq) && !(numChunks >= 0 && seq >= numChunks))
+      pthread_cond_wait(&changed, &lock);
+    pthread_mutex_unlock(&lock);
+    if (numChunks >= 0 && seq >= numChunks) break;
+    more = processChunk(c);
+    pthread_mutex_lock(&lock);
+    c->state = SLOT_FREE;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+    if (!more) break;
+  }
+
+  submitOutput();
+  pthread_mutex_lock(&outLock);
+  while (pending) pthread_cond_wait(&outCond, &outLock);
+  writerDone = 1;
+  pthread_cond_broadcast(&outCond);
+  pthread_mutex_unlock(&outLock);
+  pthread_join(wr, NULL);
+  fclose(trapsFile);
+  fclose(interruptsFile);
+  fprintf(stderr, "qemu2trace wrote %lld instrs\n", numInstrs);
+  // the reader may still be blocked on QEMU's output after termination; don't wait for it
+  exit(0);
+}
@@ -0,0 +1,295 @@
+#!/usr/bin/python3
+###########################################
+## benchmark-sweep.py
+##
+## Written: Wally team 2023
+##
+## Purpose: Run CoreMark and embench across a list of configurations in parallel,
+##          record the performance counters of every benchmark in a history file
+##          keyed by git commit, and flag CPI or miss rate regressions against a
+##          baseline commit.
+##
+##          Each variant is a base configuration with some `defines replaced; its
+##          wally-config.vh is written to config/sweep-<variant> for the run and
+##          removed afterwards.  RV64 variants run CoreMark and RV32 variants run
+##          embench, which is built for riscv32 only.  Build them first with
+##          make in benchmarks/coremark and make build modelsim_build_memfile in
+##          benchmarks/embench, or pass -build.
+##
+##          The history is JSON lines, one record per benchmark per variant per run:
+##            {"commit": ..., "dirty": ..., "date": ..., "variant": ..., "benchmark": ...,
+##             "counters": {"Mcycle": ..., ...}, "metrics": {"CPI": ..., ...}}
+##
+##            ./benchmark-sweep.py                      run every variant, compare to the last commit
+##            ./benchmark-sweep.py -variants rv64gc     run one variant
+##            ./benchmark-sweep.py -baseline 1a2b3c4    compare to a given commit
+##            ./benchmark-sweep.py -norun               parse the logs of the last run again
+##
+##          Exits with the number of regressions found, so it can gate a CI job.
+##
+## A component of the CORE-V-WALLY configurable RISC-V project.
+##
+## Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+##
+## SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+##
+## Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+## except in compliance with the License, or, at your option, the Apache License version 2.0. You
+## may obtain a copy of the License at
+##
+## https:##solderpad.org/licenses/SHL-2.1/
+##
+## Unless required by applicable law or agreed to in writing, any work distributed under the
+## License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+## either express or implied. See the License for the specific language governing permissions
+## and limitations under the License.
+################################################################################################
+
+import sys, os, re, json, shutil, argparse, signal, subprocess, datetime
+from collections import namedtuple
+from multiprocessing import Pool
+
+class bcolors:
+    OKGREEN = '\033[92m'
+    WARNING = '\033[93m'
+    FAIL = '\033[91m'
+    ENDC = '\033[0m'
+
+sweepDir = os.path.dirname(os.path.abspath(__file__))
+configDir = os.path.join(sweepDir, '..', 'config')
+
+Variant = namedtuple("Variant", ['name', 'base', 'defines'])
+# name:     names the generated config directory and the log file
+# base:     the configuration in config/ that the variant starts from
+# defines:  `define names and the values that replace those in the base wally-config.vh
+
+# edit this list to sweep other parameters
+variants = [
+    Variant("rv32gc", "rv32gc", {}),
+    Variant("rv64gc", "rv64gc", {}),
+]
+for bpType in ["BP_TWOBIT", "BP_GSHARE", "BP_GLOBAL"]:
+    for bpSize in [6, 10, 16]:
+        variants.append(Variant("rv32gc_%s_%d" % (bpType.lower(), bpSize), "rv32gc",
+                                {"BPRED_TYPE": '"%s"' % bpType, "BPRED_SIZE": str(bpSize)}))
+for (ways, waySize) in [(1, 4096), (2, 2048), (8, 4096)]:
+    variants.append(Variant("rv64gc_dcache%dx%d" % (ways, waySize), "rv64gc",
+                            {"DCACHE_NUMWAYS": str(ways), "DCACHE_WAYSIZEINBYTES": str(waySize)}))
+    variants.append(Variant("rv64gc_icache%dx%d" % (ways, waySize), "rv64gc",
+                            {"ICACHE_NUMWAYS": str(ways), "ICACHE_WAYSIZEINBYTES": str(waySize)}))
+
+# higher is worse for each metric; CPI is compared relative to the baseline and the
+# rates, which are in percent, by the difference in percentage points
+metricNames = ['CPI', 'BDMR', 'BTMR', 'RASMPR', 'ClassMPR', 'ICacheMR', 'DCacheMR']
+
+TIMEOUT = 6*3600    # seconds each variant may simulate before vsim is killed
+
+def configName(variant):
+    return "sweep-" + variant.name
+
+def suite(variant):
+    'CoreMark for RV64 variants and embench for RV32, as they are built.'
+    return "coremark" if variant.base.startswith("rv64") else "embench"
+
+def logName(variant):
+    return os.path.join(sweepDir, "logs", "sweep_%s_%s.log" % (variant.name, suite(variant)))
+
+def writeConfig(variant):
+    'Writes config/sweep-<name>/wally-config.vh with the defines of the variant, and with counters printed.'
+    with open(os.path.join(configDir, variant.base, "wally-config.vh")) as f:
+        text = f.read()
+    defines = dict(variant.defines, PrintHPMCounters="1")
+    for (name, value) in defines.items():
+        (text, found) = re.subn(r"^(\s*`define\s+%s\s+)(\S+)" % name, lambda m: m.group(1) + value, text, flags=re.M)
+        if not found and name != "PrintHPMCounters":
+            raise ValueError("%s does not define %s" % (variant.base, name))
+    if "PrintHPMCounters" not in text:
+        text += "\n`define PrintHPMCounters 1\n"
+    os.makedirs(os.path.join(configDir, configName(variant)), exist_ok=True)
+    with open(os.path.join(configDir, configName(variant), "wally-config.vh"), "w") as f:
+        f.write(text)
+
+def runVsim(do, fileName, timeout):
+    '''Runs the do command in batch vsim with its output in fileName.  Returns False if it
+    ran longer than timeout seconds, after killing vsim and the simulator it started.'''
+    with open(fileName, 'w') as log:
+        proc = subprocess.Popen(["vsim", "-c"], stdin=subprocess.PIPE, stdout=log,
+                                text=True, start_new_session=True)
+        try:
+            proc.communicate(do + "\n", timeout=timeout)
+            return True
+        except subprocess.TimeoutExpired:
+            os.killpg(proc.pid, signal.SIGKILL)
+            proc.wait()
+            return False
+
+def runVariant(variant):
+    'Simulates the benchmarks of one variant; returns 0 if the log shows they finished.'
+    log = logName(variant)
+    os.chdir(sweepDir)
+    if not runVsim("do wally-batch.do %s %s" % (configName(variant), suite(variant)), log, TIMEOUT):
+        print(f"{bcolors.FAIL}%s: timeout{bcolors.ENDC}" % variant.name)
+        return 1
+    if len(parseLog(log)) == 0:
+        print(f"{bcolors.FAIL}%s: no benchmark results in %s{bcolors.ENDC}" % (variant.name, log))
+        return 1
+    print(f"{bcolors.OKGREEN}%s: done{bcolors.ENDC}" % variant.name)
+    return 0
+
+def parseLog(fileName):
+    '''Returns {benchmark: {counter name: value}} from the Cnt[] lines the testbench prints
+    when a benchmark ends, as bin/parseHPMC.py reads them.'''
+    benchmarks = {}
+    counters = {}
+    name = ''
+    if not os.path.exists(fileName):
+        return benchmarks
+    for line in open(fileName, 'r', errors='replace'):
+        tokens = line.split()
+        if len(tokens) > 3 and tokens[1] == 'Read' and tokens[2] == 'memfile':
+            # embench kernels are built more than once, so their build directory is part of the name
+            parts = tokens[3].split('/')
+            name = '/'.join([p for p in parts if p.startswith('bd_')] + [parts[-1].split('.')[0]])
+            counters = {}
+        elif len(tokens) > 4 and tokens[1][0:3] == 'Cnt':
+            countTokens = line.split('=')[1].split()
+            counters[' '.join(countTokens[1:])] = int(countTokens[0])
+        elif 'is done' in line and counters:
+            benchmarks[name] = counters
+            counters = {}
+    return benchmarks
+
+def ratio(num, den, scale=1.0):
+    return scale * num / den if den else 0.0
+
+def computeMetrics(c):
+    'The statistics bin/parseHPMC.py computes, from one benchmark\'s counters.'
+    g = lambda name: c.get(name, 0)
+    return {
+        'CPI':      ratio(g('Mcycle'), g('InstRet')),
+        'BDMR':     ratio(g('BP Dir Wrong'), g('Br Count'), 100),
+        'BTMR':     ratio(g('BP Target Wrong'), g('Br Count') + g('Jump Not Return'), 100),
+        'RASMPR':   ratio(g('RAS Wrong'), g('Return'), 100),
+        'ClassMPR': ratio(g('Instr Class Wrong'), g('InstRet'), 100),
+        'ICacheMR': ratio(g('I Cache Miss'), g('I Cache Access'), 100),
+        'DCacheMR': ratio(g('D Cache Miss'), g('D Cache Access'), 100),
+    }
+
+def gitCommit():
+    commit = subprocess.run(["git", "rev-parse", "HEAD"], cwd=sweepDir, capture_output=True, text=True).stdout.strip()
+    dirty = subprocess.run(["git", "status", "--porcelain", "--untracked-files=no"], cwd=sweepDir,
+                           capture_output=True, text=True).stdout.strip() != ""
+    return (commit, dirty)
+
+def readHistory(fileName):
+    if not os.path.exists(fileName):
+        return []
+    with open(fileName) as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+def baselineRecords(history, commit, baseline):
+    '''Records of the baseline commit, by (variant, benchmark).  Without a baseline the
+    last commit other than the current one is used.'''
+    if baseline is None:
+        for record in reversed(history):
+            if record['commit'] != commit:
+                baseline = record['commit']
+                break
+        if baseline is None:
+            return (None, {})
+    records = {}
+    for record in history:
+        if record['commit'].startswith(baseline):
+            records[(record['variant'], record['benchmark'])] = record  # the latest run wins
+    return (baseline, records)
+
+def compare(records, base, cpiThreshold, rateThreshold):
+    'Prints and counts the metrics that got worse than the thresholds allow.'
+    regressions = 0
+    for record in records:
+        old = base.get((record['variant'], record['benchmark']))
+        if old is None:
+            continue
+        for metric in metricNames:
+            new, was = record['metrics'][metric], old['metrics'][metric]
+            if metric == 'CPI':
+                worse = was > 0 and 100.0 * (new - was) / was > cpiThreshold
+            else:
+                worse = new - was > rateThreshold
+            if worse:
+                regressions += 1
+                print(f"{bcolors.FAIL}%s %s: %s %.4f, was %.4f{bcolors.ENDC}" %
+                      (record['variant'], record['benchmark'], metric, new, was))
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description="Sweep CoreMark and embench over configurations and track regressions")
+    parser.add_argument("-variants", help="comma separated variants to run (default all)")
+    parser.add_argument("-list", action="store_true", help="list the variants and exit")
+    parser.add_argument("-build", action="store_true", help="build CoreMark and embench first")
+    parser.add_argument("-norun", action="store_true", help="only parse the logs of the last run")
+    parser.add_argument("-history", default=os.path.join(sweepDir, "benchmark-history.jsonl"), help="results database")
+    parser.add_argument("-baseline", help="commit to compare to (default the last other commit in the history)")
+    parser.add_argument("-cpi", type=float, default=1.0, help="CPI regression threshold in percent (default 1)")
+    parser.add_argument("-rate", type=float, default=0.5, help="miss rate regression threshold in percentage points (default 0.5)")
+    parser.add_argument("-j", type=int, default=min(len(variants), 40), help="concurrent simulations")
+    args = parser.parse_args()
+
+    selected = variants
+    if args.variants:
+        names = args.variants.split(',')
+        selected = [v for v in variants if v.name in names]
+        unknown = set(names) - set(v.name for v in selected)
+        if unknown:
+            sys.exit("unknown variants: " + ', '.join(sorted(unknown)))
+    if args.list:
+        for v in variants:
+            print("%-28s %-8s %-8s %s" % (v.name, v.base, suite(v), ' '.join("%s=%s" % d for d in v.defines.items())))
+        return 0
+
+    os.chdir(sweepDir)
+    os.makedirs("logs", exist_ok=True)
+    if args.build:
+        os.system("make -C ../benchmarks/coremark")
+        os.system("make -C ../benchmarks/embench build modelsim_build_memfile")
+
+    failures = 0
+    if not args.norun:
+        for v in selected:
+            writeConfig(v)
+        try:
+            with Pool(processes=max(1, min(len(selected), args.j))) as pool:
+                results = [(v, pool.apply_async(runVariant, (v,))) for v in selected]
+                for (v, result) in results:
+                    failures += result.get()
+        finally:
+            for v in selected:
+                shutil.rmtree(os.path.join(configDir, configName(v)), ignore_errors=True)
+
+    (commit, dirty) = gitCommit()
+    date = datetime.datetime.now().isoformat(timespec='seconds')
+    records = []
+    for v in selected:
+        for (benchmark, counters) in parseLog(logName(v)).items():
+            records.append({"commit": commit, "dirty": dirty, "date": date, "variant": v.name,
+                            "benchmark": benchmark, "counters": counters, "metrics": computeMetrics(counters)})
+    history = readHistory(args.history)
+    (baseline, base) = baselineRecords(history, commit, args.baseline)
+    with open(args.history, "a") as f:
+        for record in records:
+            f.write(json.dumps(record) + "\n")
+    print("%d results for commit %s%s added to %s" % (len(records), commit[:10], " (dirty)" if dirty else "", args.history))
+
+    if baseline is None:
+        print("no baseline to compare to")
+        regressions = 0
+    else:
+        regressions = compare(records, base, args.cpi, args.rate)
+        if regressions:
+            print(f"{bcolors.FAIL}%d regressions against %s{bcolors.ENDC}" % (regressions, baseline[:10]))
+        else:
+            print(f"{bcolors.OKGREEN}no regressions against %s{bcolors.ENDC}" % baseline[:10])
+    return regressions + failures
+
+if __name__ == '__main__':
+    exit(min(main(), 255))
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# Boot Linux with every instruction checked against testbench/dpi/rvmodel.c
+# usage: run-cosim-linux.sh [instr limit] [checkpoint]
+export OTHERFLAGS=""
+
+vsim -c -do "do wally-linux-imperas.do buildroot buildroot-cosim $RISCV ${1:-0} 0 ${2:-0}"
@@ -29,6 +29,7 @@
 import sys
 import os
 import argparse
+import shutil
 
 # NOTE: make sure testbench.sv has the ICache and DCache loggers enabled!
 # This does not check the test output for correctness, run regression for that.
@@ -64,7 +65,10 @@ if __name__ == '__main__':
     args = parser.parse_args()
 
     testcmd = "vsim -do \"do wally-batch.do rv64gc {}\" -c > /dev/null"
-    cachecmd = "CacheSim.py 64 4 56 44 -f {}"
+    # prefer the native simulator (make -C studies/cachesim); it also reads the
+    # binary .wtr traces written when WALLY_TRACE_LOGGER is set
+    native = shutil.which("cachesim") is not None
+    cachecmd = ("cachesim" if native else "CacheSim.py") + " 64 4 56 44 -f {}"
     
     if args.perf:
         cachecmd += " -p"
@@ -76,5 +80,6 @@ if __name__ == '__main__':
         os.system(testcmd.format(test))
         for cache in cachetypes:
             print(f"{bcolors.OKCYAN}Running the", cache, f"simulator.{bcolors.ENDC}")
-            os.system(cachecmd.format(cache+".log"))
+            log = cache+".wtr" if native and os.path.exists(cache+".wtr") else cache+".log"
+            os.system(cachecmd.format(log))
         print()
@@ -86,6 +86,7 @@ module lsu (
   output logic [`XLEN-1:0]    PTE,                                  // Page table entry write to ITLB
   output logic [1:0]          PageType,                             // Type of page table entry to write to ITLB
   output logic                ITLBWriteF,                           // Write PTE to ITLB
+  output logic                DTLBWriteM,                           // Write PTE to DTLB, for performance counters
   output logic                SelHPTW,                              // During a HPTW walk the effective privilege mode becomes S_MODE
   input var logic [7:0]       PMPCFG_ARRAY_REGW[`PMP_ENTRIES-1:0],  // PMP configuration from privileged unit
   input var logic [`PA_BITS-3:0] PMPADDR_ARRAY_REGW[`PMP_ENTRIES-1:0]  // PMP address from privileged unit
@@ -126,7 +127,6 @@ module lsu (
   logic [(`LLEN-1)/8:0] ByteMaskM;                              // Selects which bytes within a word to write
 
   logic                 DTLBMissM;                              // DTLB miss causes HPTW walk
-  logic                 DTLBWriteM;                             // Writes PTE and PageType to DTLB
   logic                 DataUpdateDAM;                          // DTLB hit needs to update dirty or access bits
   logic                 LSULoadAccessFaultM;                    // Load acces fault
   logic                 LSUStoreAmoAccessFaultM;                // Store access fault
@@ -76,12 +76,14 @@ module csr #(parameter
   input  logic             InvalidateICacheM,
   input  logic             DivBusyE,                                  // integer divide busy
   input  logic             FDivBusyE,                                 // floating point divide busy
+  input  logic             ITLBWriteF, DTLBWriteM,                    // TLB filled after a miss
+  input  logic             HREADY,                                    // AHB bus is not inserting a wait state
   // outputs from CSRs
   output logic [1:0]       STATUS_MPP,
   output logic             STATUS_SPP, STATUS_TSR, STATUS_TVM,
   output logic [15:0] MEDELEG_REGW, 
   output logic [`XLEN-1:0] SATP_REGW,
-  output logic [11:0]      MIP_REGW, MIE_REGW, MIDELEG_REGW,
+  output logic [13:0]      MIP_REGW, MIE_REGW, MIDELEG_REGW,
   output logic             STATUS_MIE, STATUS_SIE,
   output logic             STATUS_MXR, STATUS_SUM, STATUS_MPRV, STATUS_TW,
   output logic [1:0]       STATUS_FS,
@@ -115,7 +117,7 @@ module csr #(parameter
   logic                    InsufficientCSRPrivilegeM;
   logic                    IllegalCSRMWriteReadonlyM;
   logic [`XLEN-1:0]        CSRReadVal2M;
-  logic [11:0]             MIP_REGW_writeable;
+  logic [13:0]             MIP_REGW_writeable;
   logic [`XLEN-1:0]        TVecM, TrapVectorM, NextFaultMtvalM;
   logic                    MTrapM, STrapM;
   logic [`XLEN-1:0]        EPC;
@@ -124,6 +126,7 @@ module csr #(parameter
   logic [`XLEN-1:0]        TVecAlignedM;
   logic                    InstrValidNotFlushedM;
   logic                    STimerInt;
+  logic                    HPMOverflowM;
 
   // only valid unflushed instructions can access CSRs
   assign InstrValidNotFlushedM = InstrValidM & ~StallW & ~FlushW;
@@ -176,7 +179,7 @@ module csr #(parameter
     CSRSrcM = InstrM[14] ? {{(`XLEN-5){1'b0}}, InstrM[19:15]} : SrcAM;
 
     // CSR set and clear for MIP/SIP should only touch internal state, not interrupt inputs
-    if (CSRAdrM == MIP | CSRAdrM == SIP) CSRReadVal2M = {{(`XLEN-12){1'b0}}, MIP_REGW_writeable};
+    if (CSRAdrM == MIP | CSRAdrM == SIP) CSRReadVal2M = {{(`XLEN-14){1'b0}}, MIP_REGW_writeable};
     else                                 CSRReadVal2M = CSRReadValM;
 
     // Compute AND/OR modification
@@ -213,7 +216,7 @@ module csr #(parameter
 
   csri   csri(.clk, .reset,  
     .CSRMWriteM, .CSRSWriteM, .CSRWriteValM, .CSRAdrM, 
-    .MExtInt, .SExtInt, .MTimerInt, .STimerInt, .MSwInt,
+    .MExtInt, .SExtInt, .MTimerInt, .STimerInt, .MSwInt, .HPMOverflowM,
     .MIDELEG_REGW, .MIP_REGW, .MIE_REGW, .MIP_REGW_writeable);
 
   csrsr csrsr(.clk, .reset, .StallW, 
@@ -273,11 +276,13 @@ module csr #(parameter
       .BPDirPredWrongM, .BTAWrongM, .RASPredPCWrongM, .IClassWrongM, .BPWrongM,
       .InstrClassM, .DCacheMiss, .DCacheAccess, .ICacheMiss, .ICacheAccess, .sfencevmaM,
       .InterruptM, .ExceptionM, .InvalidateICacheM, .ICacheStallF, .DCacheStallM, .DivBusyE, .FDivBusyE,
+      .FRegWriteM, .ITLBWriteF, .DTLBWriteM, .SelHPTW, .HREADY,
       .CSRAdrM, .PrivilegeModeW, .CSRWriteValM,
       .MCOUNTINHIBIT_REGW, .MCOUNTEREN_REGW, .SCOUNTEREN_REGW,
-      .MTIME_CLINT,  .CSRCReadValM, .IllegalCSRCAccessM);
+      .MTIME_CLINT,  .CSRCReadValM, .HPMOverflowM, .IllegalCSRCAccessM);
   end else begin
     assign CSRCReadValM = 0;
+    assign HPMOverflowM = 0;
     assign IllegalCSRCAccessM = 1; // counters aren't enabled
   end
 
@@ -10,7 +10,8 @@
 //          See RISC-V Privileged Mode Specification 20190608 3.1.10-11
 // 
 // Documentation: RISC-V System on Chip Design Chapter 5
-//    MHPMEVENT is not supported
+//    MHPMEVENT selects the event of each counter when Sscofpmf is supported;
+//    otherwise counter i counts event i
 //
 // A component of the CORE-V-WALLY configurable RISC-V project.
 // 
@@ -37,6 +38,8 @@ module csrc #(parameter
   MHPMCOUNTERHBASE = 12'hB80,
   MTIMEH = 12'hB81,               // this is a memory-mapped register; no such CSR exists, and access should fault
   MHPMEVENTBASE = 12'h320,
+  MHPMEVENTHBASE = 12'h720,      // Sscofpmf: OF and mode inhibit bits in RV32
+  SCOUNTOVF = 12'hDA0,           // Sscofpmf: OF bits visible to S-mode
   HPMCOUNTERBASE = 12'hC00,
   HPMCOUNTERHBASE = 12'hC80,
   TIME  = 12'hC01,
@@ -65,12 +68,17 @@ module csrc #(parameter
   input  logic             InvalidateICacheM,
   input  logic             DivBusyE,                                  // integer divide busy
   input  logic             FDivBusyE,                                 // floating point divide busy
+  input  logic             FRegWriteM,                                // instruction writes a floating point register
+  input  logic             ITLBWriteF, DTLBWriteM,                    // TLB filled after a miss
+  input  logic             SelHPTW,                                   // hardware page table walker active
+  input  logic             HREADY,                                    // AHB bus is not inserting a wait state
   input  logic [11:0]      CSRAdrM,
   input  logic [1:0]       PrivilegeModeW,
   input  logic [`XLEN-1:0] CSRWriteValM,
   input  logic [31:0]      MCOUNTINHIBIT_REGW, MCOUNTEREN_REGW, SCOUNTEREN_REGW,
   input  logic [63:0]      MTIME_CLINT, 
   output logic [`XLEN-1:0] CSRCReadValM,
+  output logic             HPMOverflowM,                              // counter overflowed with OF clear; sets LCOFIP
   output logic             IllegalCSRCAccessM
 );
 
@@ -81,6 +89,13 @@ module csrc #(parameter
   logic                    StoreStallE, StoreStallM;
   logic [`COUNTERS-1:0]    WriteHPMCOUNTERM;
   logic [`COUNTERS-1:0]    CounterEvent;
+  logic [31:0]             HPMEvent;                                  // events a counter can select
+  logic [`COUNTERS-1:0]    CounterOverflowM;
+  logic [4:0]              HPMEventSel[`COUNTERS-1:0];
+  logic [3:0]              HPMEventFlags[`COUNTERS-1:0];              // {OF, MINH, SINH, UINH}
+  logic [`XLEN-1:0]        MHPMEVENT_REGW[`COUNTERS-1:0];
+  logic [`XLEN-1:0]        MHPMEVENTH_REGW[`COUNTERS-1:0];
+  logic [31:0]             HPMOF;
   logic [63:0]             HPMCOUNTERPlusM[`COUNTERS-1:0];
   logic [`XLEN-1:0]        NextHPMCOUNTERM[`COUNTERS-1:0];
   genvar                   i;
@@ -94,36 +109,80 @@ module csrc #(parameter
   assign CounterEvent[1] = 1'b0;                                                        // Counter 1 doesn't exist
   assign CounterEvent[2] = InstrValidNotFlushedM;                                       // MINSTRET instructions retired
   if(`QEMU) begin: cevent // No other performance counters in QEMU
-    assign CounterEvent[`COUNTERS-1:3] = 0;
-  end else begin: cevent                                                                // User-defined counters
-    assign CounterEvent[3] = InstrClassM[0] & InstrValidNotFlushedM;                    // branch instruction
-    assign CounterEvent[4] = InstrClassM[1] & ~InstrClassM[2] & InstrValidNotFlushedM;  // jump and not return instructions
-    assign CounterEvent[5] = InstrClassM[2] & InstrValidNotFlushedM;                    // return instructions
-  assign CounterEvent[6] = BPWrongM & InstrValidNotFlushedM;                            // branch predictor wrong
-    assign CounterEvent[7] = BPDirPredWrongM & InstrValidNotFlushedM;                   // Branch predictor wrong direction
-    assign CounterEvent[8] = BTAWrongM & InstrValidNotFlushedM;                         // branch predictor wrong target
-    assign CounterEvent[9] = RASPredPCWrongM & InstrValidNotFlushedM;                   // return address stack wrong address
-    assign CounterEvent[10] = IClassWrongM & InstrValidNotFlushedM;                     // instruction class predictor wrong
-    assign CounterEvent[11] = LoadStallM & InstrValidNotFlushedM;                       // Load Stalls. don't want to suppress on flush as this only happens if flushed.
-    assign CounterEvent[12] = StoreStallM & InstrValidNotFlushedM;                      //  Store Stall
-    assign CounterEvent[13] = DCacheAccess & InstrValidNotFlushedM;                     // data cache access
-    assign CounterEvent[14] = DCacheMiss;                                               // data cache miss. Miss asserted 1 cycle at start of cache miss
-    assign CounterEvent[15] = DCacheStallM;                                             // d cache miss cycles
-    assign CounterEvent[16] = ICacheAccess & InstrValidNotFlushedM;                     // instruction cache access
-    assign CounterEvent[17] = ICacheMiss;                                               // instruction cache miss. Miss asserted 1 cycle at start of cache miss
-    assign CounterEvent[18] = ICacheStallF;                                             // i cache miss cycles
-    assign CounterEvent[19] = CSRWriteM & InstrValidNotFlushedM;                        // CSR writes
-    assign CounterEvent[20] = InvalidateICacheM & InstrValidNotFlushedM;                // fence.i
-    assign CounterEvent[21] = sfencevmaM & InstrValidNotFlushedM;                       // sfence.vma
-    assign CounterEvent[22] = InterruptM;                                               // interrupt, InstrValidNotFlushedM will be low
-    assign CounterEvent[23] = ExceptionM;                                               // exceptions, InstrValidNotFlushedM will be low
+    assign HPMEvent = 0;
+  end else begin: cevent                                                                // Events the other counters can count
+    assign HPMEvent[0] = 1'b0;                                                          // no event
+    assign HPMEvent[1] = 1'b1;                                                          // cycles
+    assign HPMEvent[2] = InstrValidNotFlushedM;                                         // instructions retired
+    assign HPMEvent[3] = InstrClassM[0] & InstrValidNotFlushedM;                        // branch instruction
+    assign HPMEvent[4] = InstrClassM[1] & ~InstrClassM[2] & InstrValidNotFlushedM;      // jump and not return instructions
+    assign HPMEvent[5] = InstrClassM[2] & InstrValidNotFlushedM;                        // return instructions
+    assign HPMEvent[6] = BPWrongM & InstrValidNotFlushedM;                              // branch predictor wrong
+    assign HPMEvent[7] = BPDirPredWrongM & InstrValidNotFlushedM;                       // Branch predictor wrong direction
+    assign HPMEvent[8] = BTAWrongM & InstrValidNotFlushedM;                             // branch predictor wrong target
+    assign HPMEvent[9] = RASPredPCWrongM & InstrValidNotFlushedM;                       // return address stack wrong address
+    assign HPMEvent[10] = IClassWrongM & InstrValidNotFlushedM;                         // instruction class predictor wrong
+    assign HPMEvent[11] = LoadStallM & InstrValidNotFlushedM;                           // Load Stalls. don't want to suppress on flush as this only happens if flushed.
+    assign HPMEvent[12] = StoreStallM & InstrValidNotFlushedM;                          //  Store Stall
+    assign HPMEvent[13] = DCacheAccess & InstrValidNotFlushedM;                         // data cache access
+    assign HPMEvent[14] = DCacheMiss;                                                   // data cache miss. Miss asserted 1 cycle at start of cache miss
+    assign HPMEvent[15] = DCacheStallM;                                                 // d cache miss cycles
+    assign HPMEvent[16] = ICacheAccess & InstrValidNotFlushedM;                         // instruction cache access
+    assign HPMEvent[17] = ICacheMiss;                                                   // instruction cache miss. Miss asserted 1 cycle at start of cache miss
+    assign HPMEvent[18] = ICacheStallF;                                                 // i cache miss cycles
+    assign HPMEvent[19] = CSRWriteM & InstrValidNotFlushedM;                            // CSR writes
+    assign HPMEvent[20] = InvalidateICacheM & InstrValidNotFlushedM;                    // fence.i
+    assign HPMEvent[21] = sfencevmaM & InstrValidNotFlushedM;                           // sfence.vma
+    assign HPMEvent[22] = InterruptM;                                                   // interrupt, InstrValidNotFlushedM will be low
+    assign HPMEvent[23] = ExceptionM;                                                   // exceptions, InstrValidNotFlushedM will be low
     // coverage off
     // DivBusyE will never be assert high since this configuration uses the FPU to do integer division
-    assign CounterEvent[24] = DivBusyE | FDivBusyE;                                     // division cycles *** RT: might need to be delay until the next cycle
+    assign HPMEvent[24] = DivBusyE | FDivBusyE;                                         // division cycles *** RT: might need to be delay until the next cycle
     // coverage on
-    assign CounterEvent[`COUNTERS-1:25] = 0; // eventually give these sources, including FP instructions, I$/D$ misses, branches and mispredictions
+    assign HPMEvent[25] = FRegWriteM & InstrValidNotFlushedM;                           // floating point register writes (FP operations and loads)
+    assign HPMEvent[26] = ITLBWriteF;                                                   // ITLB misses, counted when the walk fills the TLB
+    assign HPMEvent[27] = DTLBWriteM;                                                   // DTLB misses, counted when the walk fills the TLB
+    assign HPMEvent[28] = SelHPTW;                                                      // hardware page table walker cycles
+    assign HPMEvent[29] = ~HREADY;                                                      // AHB wait states
+    assign HPMEvent[31:30] = 0;
   end
-  
+
+  // Select each counter's event
+  for (i = 3; i < `COUNTERS; i = i+1) begin:sel
+    if (`SSCOFPMF_SUPPORTED) begin:hpmevent // MHPMEVENT chooses the event and the privilege modes it is counted in
+      localparam [4:0] RESETEVENT = i;
+      logic WriteEventM, WriteEventHM, Inhibited;
+      assign WriteEventM = CSRMWriteM & (CSRAdrM == MHPMEVENTBASE + i);
+      assign WriteEventHM = CSRMWriteM & (CSRAdrM == ((`XLEN==64) ? MHPMEVENTBASE : MHPMEVENTHBASE) + i);
+      // event i after reset, so software written for the fixed events still works
+      flopenl #(5) EventSelReg(clk, reset, WriteEventM, CSRWriteValM[4:0], RESETEVENT, HPMEventSel[i]);
+      always_ff @(posedge clk)
+        if (reset)             HPMEventFlags[i] <= #1 0;
+        else if (WriteEventHM) HPMEventFlags[i] <= #1 CSRWriteValM[`XLEN-1:`XLEN-4];
+        else                   HPMEventFlags[i][3] <= #1 HPMEventFlags[i][3] | CounterOverflowM[i];
+      assign Inhibited = PrivilegeModeW == `M_MODE ? HPMEventFlags[i][2] :
+                         PrivilegeModeW == `S_MODE ? HPMEventFlags[i][1] : HPMEventFlags[i][0];
+      assign CounterEvent[i] = HPMEvent[HPMEventSel[i]] & ~Inhibited;
+      assign HPMOF[i] = HPMEventFlags[i][3];
+    end else begin:hpmevent
+      assign HPMEventSel[i] = i;
+      assign HPMEventFlags[i] = 0;
+      assign CounterEvent[i] = HPMEvent[i];
+      assign HPMOF[i] = 1'b0;
+    end
+    if (`XLEN==64) begin
+      assign MHPMEVENT_REGW[i] = {HPMEventFlags[i], {(`XLEN-9){1'b0}}, HPMEventSel[i]};
+      assign MHPMEVENTH_REGW[i] = 0;
+    end else begin
+      assign MHPMEVENT_REGW[i] = {{(`XLEN-5){1'b0}}, HPMEventSel[i]};
+      assign MHPMEVENTH_REGW[i] = {HPMEventFlags[i], {(`XLEN-4){1'b0}}};
+    end
+  end
+  assign HPMOF[2:0] = 0;
+  if (`COUNTERS < 32) assign HPMOF[31:`COUNTERS] = 0;
+  // local counter overflow interrupt when a counter overflows and its OF bit is not already set
+  assign HPMOverflowM = `SSCOFPMF_SUPPORTED & |(CounterOverflowM & ~HPMOF[`COUNTERS-1:0]);
+
   // Counter update and write logic
   for (i = 0; i < `COUNTERS; i = i+1) begin:cntr
       assign WriteHPMCOUNTERM[i] = CSRMWriteM & (CSRAdrM == MHPMCOUNTERBASE + i);
@@ -137,19 +196,31 @@ module csrc #(parameter
         logic [`XLEN-1:0] NextHPMCOUNTERHM[`COUNTERS-1:0];
         assign HPMCOUNTERPlusM[i] = {HPMCOUNTERH_REGW[i], HPMCOUNTER_REGW[i]} + {63'b0, CounterEvent[i] & ~MCOUNTINHIBIT_REGW[i]};
         assign WriteHPMCOUNTERHM[i] = CSRMWriteM & (CSRAdrM == MHPMCOUNTERHBASE + i);
+        assign CounterOverflowM[i] = CounterEvent[i] & ~MCOUNTINHIBIT_REGW[i] & (&{HPMCOUNTERH_REGW[i], HPMCOUNTER_REGW[i]}) & 
+                                     (i >= 3) & ~WriteHPMCOUNTERM[i] & ~WriteHPMCOUNTERHM[i];
         assign NextHPMCOUNTERHM[i] = WriteHPMCOUNTERHM[i] ? CSRWriteValM : HPMCOUNTERPlusM[i][63:32];
         always_ff @(posedge clk) //, posedge reset) // ModelSim doesn't like syntax of passing array element to flop
             if (reset) HPMCOUNTERH_REGW[i][`XLEN-1:0] <= #1 0;
             else       HPMCOUNTERH_REGW[i][`XLEN-1:0] <= #1 NextHPMCOUNTERHM[i];
       end else begin // XLEN=64; write entire register
           assign HPMCOUNTERPlusM[i] = HPMCOUNTER_REGW[i] + {63'b0, CounterEvent[i] & ~MCOUNTINHIBIT_REGW[i]};
+          assign CounterOverflowM[i] = CounterEvent[i] & ~MCOUNTINHIBIT_REGW[i] & (&HPMCOUNTER_REGW[i]) & (i >= 3) & ~WriteHPMCOUNTERM[i];
       end
   end
 
   // Read Counters, or cause excepiton if insufficient privilege in light of COUNTEREN flags
   assign CounterNumM = CSRAdrM[4:0]; // which counter to read?
   always_comb 
-    if (PrivilegeModeW == `M_MODE | 
+    if (`SSCOFPMF_SUPPORTED & CSRAdrM == SCOUNTOVF) begin // S-mode sees the OF bits of the counters it may read
+      IllegalCSRCAccessM = 0;
+      CSRCReadValM = {{(`XLEN-32){1'b0}}, HPMOF & (PrivilegeModeW == `M_MODE ? 32'hFFFFFFFF : MCOUNTEREN_REGW)};
+    end else if (`SSCOFPMF_SUPPORTED & PrivilegeModeW == `M_MODE & CSRAdrM >= MHPMEVENTBASE+3 & CSRAdrM < MHPMEVENTBASE+`COUNTERS) begin
+      IllegalCSRCAccessM = 0;
+      CSRCReadValM = MHPMEVENT_REGW[CounterNumM];
+    end else if (`SSCOFPMF_SUPPORTED & `XLEN==32 & PrivilegeModeW == `M_MODE & CSRAdrM >= MHPMEVENTHBASE+3 & CSRAdrM < MHPMEVENTHBASE+`COUNTERS) begin
+      IllegalCSRCAccessM = 0;
+      CSRCReadValM = MHPMEVENTH_REGW[CounterNumM];
+    end else if (PrivilegeModeW == `M_MODE | 
         MCOUNTEREN_REGW[CounterNumM] & (!`S_SUPPORTED | PrivilegeModeW == `S_MODE | SCOUNTEREN_REGW[CounterNumM])) begin
       IllegalCSRCAccessM = 0;
       if (`XLEN==64) begin // 64-bit counter reads
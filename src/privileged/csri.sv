@@ -39,12 +39,14 @@ module csri #(parameter
   input  logic [`XLEN-1:0]  CSRWriteValM,
   input  logic [11:0]       CSRAdrM,
   input  logic              MExtInt, SExtInt, MTimerInt, STimerInt, MSwInt,
-  input  logic [11:0]       MIDELEG_REGW,
-  output logic [11:0]       MIP_REGW, MIE_REGW,
-  output logic [11:0]       MIP_REGW_writeable // only SEIP, STIP, SSIP are actually writeable; the rest are hardwired to 0
+  input  logic              HPMOverflowM,      // local counter overflow sets LCOFIP
+  input  logic [13:0]       MIDELEG_REGW,
+  output logic [13:0]       MIP_REGW, MIE_REGW,
+  output logic [13:0]       MIP_REGW_writeable // only LCOFIP, SEIP, STIP, SSIP are actually writeable; the rest are hardwired to 0
 );
 
-  logic [11:0]              MIP_WRITE_MASK, SIP_WRITE_MASK, MIE_WRITE_MASK;
+  logic [13:0]              MIP_WRITE_MASK, SIP_WRITE_MASK, MIE_WRITE_MASK;
+  logic [13:0]              LCOF_MASK;
   logic                     WriteMIPM, WriteMIEM, WriteSIPM, WriteSIEM;
   logic                     STIP;
 
@@ -58,32 +60,36 @@ module csri #(parameter
   // MEIP, MTIP, MSIP are read-only
   // SEIP, STIP, SSIP is writable in MIP if S mode exists
   // SSIP is writable in SIP if S mode exists
+  // LCOFIP is set by counter overflow and writeable in MIP, and in SIP when delegated (Sscofpmf)
+  assign LCOF_MASK = `SSCOFPMF_SUPPORTED ? 14'h2000 : 14'h0000;
   if (`S_SUPPORTED) begin:mask
     if (`SSTC_SUPPORTED) begin
-      assign MIP_WRITE_MASK = 12'h202; // SEIP and SSIP are writable, but STIP is not writable when STIMECMP is implemented (see SSTC spec)
+      assign MIP_WRITE_MASK = 14'h0202 | LCOF_MASK; // SEIP and SSIP are writable, but STIP is not writable when STIMECMP is implemented (see SSTC spec)
       assign STIP = STimerInt;
     end else begin
-      assign MIP_WRITE_MASK = 12'h222; // SEIP, STIP, SSIP are writeable in MIP (20210108-draft 3.1.9)
+      assign MIP_WRITE_MASK = 14'h0222 | LCOF_MASK; // SEIP, STIP, SSIP are writeable in MIP (20210108-draft 3.1.9)
       assign STIP = MIP_REGW_writeable[5];
     end
-    assign SIP_WRITE_MASK = 12'h002 & MIDELEG_REGW; // SSIP is writeable in SIP (privileged 20210108-draft 4.1.3) 
-    assign MIE_WRITE_MASK = 12'hAAA;
+    assign SIP_WRITE_MASK = (14'h0002 | LCOF_MASK) & MIDELEG_REGW; // SSIP is writeable in SIP (privileged 20210108-draft 4.1.3) 
+    assign MIE_WRITE_MASK = 14'h0AAA | LCOF_MASK;
   end else begin:mask
-    assign MIP_WRITE_MASK = 12'h000;
-    assign SIP_WRITE_MASK = 12'h000;
-    assign MIE_WRITE_MASK = 12'h888;
+    assign MIP_WRITE_MASK = LCOF_MASK;
+    assign SIP_WRITE_MASK = 14'h0000;
+    assign MIE_WRITE_MASK = 14'h0888 | LCOF_MASK;
   end
   always @(posedge clk)
-    if (reset)          MIP_REGW_writeable <= 12'b0;
-    else if (WriteMIPM) MIP_REGW_writeable <= (CSRWriteValM[11:0] & MIP_WRITE_MASK);
-    else if (WriteSIPM) MIP_REGW_writeable <= (CSRWriteValM[11:0] & SIP_WRITE_MASK) | (MIP_REGW_writeable & ~SIP_WRITE_MASK);
+    if (reset)          MIP_REGW_writeable <= 14'b0;
+    else if (WriteMIPM) MIP_REGW_writeable <= (CSRWriteValM[13:0] & MIP_WRITE_MASK) | {HPMOverflowM, 13'b0};
+    else if (WriteSIPM) MIP_REGW_writeable <= (CSRWriteValM[13:0] & SIP_WRITE_MASK) | (MIP_REGW_writeable & ~SIP_WRITE_MASK) | {HPMOverflowM, 13'b0};
+    else                MIP_REGW_writeable <= MIP_REGW_writeable | {HPMOverflowM, 13'b0};
   always @(posedge clk)
-    if (reset)          MIE_REGW <= 12'b0;
-    else if (WriteMIEM) MIE_REGW <= (CSRWriteValM[11:0] & MIE_WRITE_MASK); // MIE controls M and S fields
-    else if (WriteSIEM) MIE_REGW <= (CSRWriteValM[11:0] & 12'h222 & MIDELEG_REGW) | (MIE_REGW & 12'h888); // only S fields
+    if (reset)          MIE_REGW <= 14'b0;
+    else if (WriteMIEM) MIE_REGW <= (CSRWriteValM[13:0] & MIE_WRITE_MASK); // MIE controls M and S fields
+    else if (WriteSIEM) MIE_REGW <= (CSRWriteValM[13:0] & (14'h0222 | LCOF_MASK) & MIDELEG_REGW) | (MIE_REGW & (14'h0888 | LCOF_MASK & ~MIDELEG_REGW)); // only S fields
 
 
-  assign MIP_REGW = {MExtInt,   1'b0, SExtInt|MIP_REGW_writeable[9],  1'b0,
+  assign MIP_REGW = {MIP_REGW_writeable[13],          1'b0,
+                     MExtInt,   1'b0, SExtInt|MIP_REGW_writeable[9],  1'b0,
                      MTimerInt, 1'b0, STIP,                           1'b0,
                      MSwInt,    1'b0, MIP_REGW_writeable[1],          1'b0};
 endmodule
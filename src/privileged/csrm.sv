@@ -70,7 +70,7 @@ module csrm #(parameter
   // Constants
   ZERO = {(`XLEN){1'b0}},
   MEDELEG_MASK = 16'hB3FF,
-  MIDELEG_MASK = 12'h222 // we choose to not make machine interrupts delegable
+  MIDELEG_MASK = `SSCOFPMF_SUPPORTED ? 14'h2222 : 14'h0222 // we choose to not make machine interrupts delegable
 ) (
   input  logic                    clk, reset, 
   input  logic                    UngatedCSRMWriteM, CSRMWriteM, MTrapM,
@@ -78,12 +78,12 @@ module csrm #(parameter
   input  logic [`XLEN-1:0]        NextEPCM, NextMtvalM, MSTATUS_REGW, MSTATUSH_REGW,
   input  logic [4:0]              NextCauseM,
   input  logic [`XLEN-1:0]        CSRWriteValM,
-  input  logic [11:0]             MIP_REGW, MIE_REGW,
+  input  logic [13:0]             MIP_REGW, MIE_REGW,
   output logic [`XLEN-1:0]        CSRMReadValM, MTVEC_REGW,
   output logic [`XLEN-1:0]        MEPC_REGW,    
   output logic [31:0]             MCOUNTEREN_REGW, MCOUNTINHIBIT_REGW, 
   output logic [15:0]             MEDELEG_REGW,
-  output logic [11:0]             MIDELEG_REGW,
+  output logic [13:0]             MIDELEG_REGW,
   output var logic [7:0]          PMPCFG_ARRAY_REGW[`PMP_ENTRIES-1:0],
   output var logic [`PA_BITS-3:0] PMPADDR_ARRAY_REGW [`PMP_ENTRIES-1:0],
   output logic                    WriteMSTATUSM, WriteMSTATUSHM,
@@ -150,7 +150,7 @@ module csrm #(parameter
   flopenr #(`XLEN) MTVECreg(clk, reset, WriteMTVECM, {CSRWriteValM[`XLEN-1:2], 1'b0, CSRWriteValM[0]}, MTVEC_REGW); 
   if (`S_SUPPORTED) begin:deleg // DELEG registers should exist
     flopenr #(16) MEDELEGreg(clk, reset, WriteMEDELEGM, CSRWriteValM[15:0] & MEDELEG_MASK, MEDELEG_REGW);
-    flopenr #(12) MIDELEGreg(clk, reset, WriteMIDELEGM, CSRWriteValM[11:0] & MIDELEG_MASK, MIDELEG_REGW);
+    flopenr #(14) MIDELEGreg(clk, reset, WriteMIDELEGM, CSRWriteValM[13:0] & MIDELEG_MASK, MIDELEG_REGW);
   end else assign {MEDELEG_REGW, MIDELEG_REGW} = 0;
 
   flopenr #(`XLEN) MSCRATCHreg(clk, reset, WriteMSCRATCHM, CSRWriteValM, MSCRATCH_REGW);
@@ -193,9 +193,9 @@ module csrm #(parameter
       MSTATUSH:  CSRMReadValM = MSTATUSH_REGW; 
       MTVEC:     CSRMReadValM = MTVEC_REGW;
       MEDELEG:   CSRMReadValM = {{(`XLEN-16){1'b0}}, MEDELEG_REGW};
-      MIDELEG:   CSRMReadValM = {{(`XLEN-12){1'b0}}, MIDELEG_REGW};
-      MIP:       CSRMReadValM = {{(`XLEN-12){1'b0}}, MIP_REGW};
-      MIE:       CSRMReadValM = {{(`XLEN-12){1'b0}}, MIE_REGW};
+      MIDELEG:   CSRMReadValM = {{(`XLEN-14){1'b0}}, MIDELEG_REGW};
+      MIP:       CSRMReadValM = {{(`XLEN-14){1'b0}}, MIP_REGW};
+      MIE:       CSRMReadValM = {{(`XLEN-14){1'b0}}, MIE_REGW};
       MSCRATCH:  CSRMReadValM = MSCRATCH_REGW;
       MEPC:      CSRMReadValM = MEPC_REGW;
       MCAUSE:    CSRMReadValM = MCAUSE_REGW;
@@ -57,7 +57,7 @@ module csrs #(parameter
   output logic [`XLEN-1:0] SEPC_REGW,      
   output logic [31:0]      SCOUNTEREN_REGW, 
   output logic [`XLEN-1:0] SATP_REGW,
-  input  logic [11:0]      MIP_REGW, MIE_REGW, MIDELEG_REGW,
+  input  logic [13:0]      MIP_REGW, MIE_REGW, MIDELEG_REGW,
   input  logic [63:0]      MTIME_CLINT,
   output logic             WriteSSTATUSM,
   output logic             IllegalCSRSAccessM,
@@ -120,8 +120,8 @@ module csrs #(parameter
     case (CSRAdrM) 
       SSTATUS:   CSRSReadValM = SSTATUS_REGW;
       STVEC:     CSRSReadValM = STVEC_REGW;
-      SIP:       CSRSReadValM = {{(`XLEN-12){1'b0}}, MIP_REGW & 12'h222 & MIDELEG_REGW}; // only read supervisor fields  
-      SIE:       CSRSReadValM = {{(`XLEN-12){1'b0}}, MIE_REGW & 12'h222 & MIDELEG_REGW}; // only read supervisor fields
+      SIP:       CSRSReadValM = {{(`XLEN-14){1'b0}}, MIP_REGW & 14'h2222 & MIDELEG_REGW}; // only read supervisor fields  
+      SIE:       CSRSReadValM = {{(`XLEN-14){1'b0}}, MIE_REGW & 14'h2222 & MIDELEG_REGW}; // only read supervisor fields
       SSCRATCH:  CSRSReadValM = SSCRATCH_REGW;
       SEPC:      CSRSReadValM = SEPC_REGW;
       SCAUSE:    CSRSReadValM = SCAUSE_REGW;
@@ -62,6 +62,8 @@ module privileged (
   input  logic             ICacheAccess,                                   // instruction cache access
   input  logic             DivBusyE,                                       // integer divide busy
   input  logic             FDivBusyE,                                      // floating point divide busy
+  input  logic             ITLBWriteF, DTLBWriteM,                         // TLB filled after a miss
+  input  logic             HREADY,                                         // AHB bus is not inserting a wait state
   // fault sources                                                         
   input  logic             InstrAccessFaultF,                              // instruction access fault
   input  logic             LoadAccessFaultM, StoreAmoAccessFaultM,         // load or store access fault
@@ -98,7 +100,7 @@ module privileged (
                                                                            
   logic [3:0]              CauseM;                                         // trap cause
   logic [15:0]             MEDELEG_REGW;                                   // exception delegation CSR
-  logic [11:0]             MIDELEG_REGW;                                   // interrupt delegation CSR
+  logic [13:0]             MIDELEG_REGW;                                   // interrupt delegation CSR
   logic                    sretM, mretM;                                   // supervisor / machine return instruction
   logic                    IllegalCSRAccessM;                              // Illegal access to CSR
   logic                    IllegalIEUFPUInstrM;                            // Illegal IEU or FPU instruction, delayed to Mem stage
@@ -107,7 +109,7 @@ module privileged (
   logic                    IllegalInstrFaultM;                             // Illegal instruction fault
   logic                    STATUS_SPP, STATUS_TSR, STATUS_TW, STATUS_TVM;  // Status bits needed within privileged unit
   logic                    STATUS_MIE, STATUS_SIE;                         // status bits: interrupt enables
-  logic [11:0]             MIP_REGW, MIE_REGW;                             // interrupt pending and enable bits
+  logic [13:0]             MIP_REGW, MIE_REGW;                             // interrupt pending and enable bits
   logic [1:0]              NextPrivilegeModeM;                             // next privilege mode based on trap or return
   logic                    DelegateM;                                      // trap should be delegated
   logic                    InterruptM;                                     // interrupt occuring
@@ -134,6 +136,7 @@ module privileged (
     .BPDirPredWrongM, .BTAWrongM, .RASPredPCWrongM, .BPWrongM,
     .sfencevmaM, .ExceptionM, .InvalidateICacheM, .ICacheStallF, .DCacheStallM, .DivBusyE, .FDivBusyE,
     .IClassWrongM, .InstrClassM, .DCacheMiss, .DCacheAccess, .ICacheMiss, .ICacheAccess,
+    .ITLBWriteF, .DTLBWriteM, .HREADY,
     .NextPrivilegeModeM, .PrivilegeModeW, .CauseM, .SelHPTW,
     .STATUS_MPP, .STATUS_SPP, .STATUS_TSR, .STATUS_TVM,
     .STATUS_MIE, .STATUS_SIE, .STATUS_MXR, .STATUS_SUM, .STATUS_MPRV, .STATUS_TW, .STATUS_FS,
@@ -37,7 +37,7 @@ module trap (
   input  logic                 mretM, sretM,                                    // return instructions
   input  logic                 wfiM,                                            // wait for interrupt instruction
   input  logic [1:0]           PrivilegeModeW,                                  // current privilege mode
-  input  logic [11:0]          MIP_REGW, MIE_REGW, MIDELEG_REGW,                // interrupt pending, enabled, and delegate CSRs
+  input  logic [13:0]          MIP_REGW, MIE_REGW, MIDELEG_REGW,                // interrupt pending, enabled, and delegate CSRs
   input  logic [15:0]          MEDELEG_REGW,                                    // exception delegation SR
   input  logic                 STATUS_MIE, STATUS_SIE,                          // machine/supervisor interrupt enables
   input  logic                 InstrValidM,                                     // current instruction is valid, not flushed
@@ -54,7 +54,7 @@ module trap (
   logic                        MIntGlobalEnM, SIntGlobalEnM;                    // Global interupt enables
   logic                        Committed;                                       // LSU or IFU has committed to a bus operation that can't be interrupted
   logic                        BothInstrAccessFaultM;                           // instruction or HPTW ITLB fill caused an Instruction Access Fault
-  logic [11:0]                 PendingIntsM, ValidIntsM, EnabledIntsM;          // interrupts are pending, valid, or enabled
+  logic [13:0]                 PendingIntsM, ValidIntsM, EnabledIntsM;          // interrupts are pending, valid, or enabled
 
   ///////////////////////////////////////////
   // Determine pending enabled interrupts
@@ -68,8 +68,8 @@ module trap (
   assign PendingIntsM = MIP_REGW & MIE_REGW;
   assign IntPendingM = |PendingIntsM;
   assign Committed = CommittedM | CommittedF;
-  assign EnabledIntsM = ({12{MIntGlobalEnM}} & PendingIntsM & ~MIDELEG_REGW | {12{SIntGlobalEnM}} & PendingIntsM & MIDELEG_REGW);
-  assign ValidIntsM = {12{~Committed}} & EnabledIntsM;
+  assign EnabledIntsM = ({14{MIntGlobalEnM}} & PendingIntsM & ~MIDELEG_REGW | {14{SIntGlobalEnM}} & PendingIntsM & MIDELEG_REGW);
+  assign ValidIntsM = {14{~Committed}} & EnabledIntsM;
   assign InterruptM = (|ValidIntsM) & InstrValidM; // suppress interrupt if the memory system has partially processed a request.
   assign DelegateM = `S_SUPPORTED & (InterruptM ? MIDELEG_REGW[CauseM] : MEDELEG_REGW[CauseM]) & 
                      (PrivilegeModeW == `U_MODE | PrivilegeModeW == `S_MODE);
@@ -105,6 +105,7 @@ module trap (
     else if (ValidIntsM[9])            CauseM = 9;  // Supervisor External Int 
     else if (ValidIntsM[1])            CauseM = 1;  // Supervisor Sw Int       
     else if (ValidIntsM[5])            CauseM = 5;  // Supervisor Timer Int    
+    else if (ValidIntsM[13])           CauseM = 13; // Local Counter Overflow Int (Sscofpmf)
     else if (InstrPageFaultM)          CauseM = 12;
     else if (BothInstrAccessFaultM)    CauseM = 1;
     else if (IllegalInstrFaultM)       CauseM = 2;
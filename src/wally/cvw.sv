@@ -102,6 +102,7 @@ package cvw;
   parameter BPRED_TYPE = `BPRED_TYPE;
   parameter BPRED_SIZE = `BPRED_SIZE;
   parameter SVADU_SUPPORTED = `SVADU_SUPPORTED;
+  parameter SSCOFPMF_SUPPORTED = `SSCOFPMF_SUPPORTED;
 //  parameter  = `;
 
 
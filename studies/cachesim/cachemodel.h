@@ -0,0 +1,164 @@
+///////////////////////////////////////////
+// cachemodel.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Behavioral model of the Wally L1 cache tag array for trace-driven
+//          simulation.  Replacement follows src/cache/cacheLRU.sv bit for bit: the
+//          tree pseudo-LRU uses the same node numbering (root at NUMWAYS-2), victims
+//          are the lowest-numbered invalid way until the set is full, and the tree
+//          is only consulted once all ways are valid.  Tags, valid and dirty bits
+//          are kept as separate arrays so a set lookup touches one short, contiguous
+//          run of tags.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CACHEMODEL_H
+#define CACHEMODEL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// number of bits needed to index n things (n a power of 2)
+static inline int log2i(uint64_t n) {
+  int l = 0;
+  while ((1ull << l) < n) l++;
+  return l;
+}
+
+// Tree pseudo-LRU for one set size, mirroring cacheLRU.sv.  The per-set state is the
+// NUMWAYS-1 bit CurrLRU vector.  Because an update only depends on the way accessed,
+// the RTL LRUUpdate/WayExpanded logic is precomputed into a mask and value per way.
+class TreePLRU {
+ public:
+  explicit TreePLRU(int ways) : n(ways), updMask(ways), updVal(ways) {
+    int logn = log2i(ways);
+    if (n < 2) return;
+    // WayExpanded: node -> bit of the encoded way that drives it
+    std::vector<int> expBit(n - 1);
+    for (int row = 0; row < logn; row++) {
+      int dup = 1 << (logn - row - 1);
+      for (int node = n - 2 * dup; node <= n - 1 - dup; node++) expBit[node] = row;
+    }
+    for (int way = 0; way < n; way++) {
+      std::vector<int> upd(n - 1, 0);
+      upd[n - 2] = 1;
+      for (int node = n - 2; node >= n / 2; node--) {
+        int ctr = n - node - 1, depth = 0;
+        for (int v = ctr; v > 0; v >>= 1) depth++;   // cacheLRU's log2 counts bits
+        int lchild = node - ctr, rchild = lchild - 1, r = logn - depth;
+        int bit = (way >> r) & 1;
+        upd[lchild] = upd[node] & !bit;
+        upd[rchild] = upd[node] & bit;
+      }
+      for (int node = 0; node < n - 1; node++) {
+        if (!upd[node]) continue;
+        updMask[way] |= 1ull << node;
+        if (!((way >> expBit[node]) & 1)) updVal[way] |= 1ull << node;
+      }
+    }
+  }
+
+  // NextLRU after an access to way
+  uint64_t update(uint64_t lru, int way) const {
+    return (lru & ~updMask[way]) | updVal[way];
+  }
+
+  // VictimWay once the set is full: walk the Intermediate tree from the root
+  int victim(uint64_t lru) const {
+    if (n < 2) return 0;
+    int node = n - 2;
+    while (node >= n / 2) node = ((lru >> node) & 1) ? 2 * node - n : 2 * node - n + 1;
+    int leaf = (n / 2 - 1 - node) * 2;
+    return ((lru >> node) & 1) ? leaf + 1 : leaf;
+  }
+
+ private:
+  int n;
+  std::vector<uint64_t> updMask, updVal;
+};
+
+// Outcome characters match the H/M/E/D codes in the ICache/DCache logs.
+class CacheModel {
+ public:
+  CacheModel(uint64_t sets, int ways, int addrlen, int taglen)
+      : numSets(sets), numWays(ways), plru(ways),
+        tags(sets * ways), valid(sets), dirty(sets), lru(sets) {
+    if (ways < 1 || ways > 64 || (ways & (ways - 1)) || !sets || (sets & (sets - 1)))
+      throw std::invalid_argument("lines and ways must be powers of 2, with at most 64 ways");
+    setLen = log2i(sets);
+    offsetLen = addrlen - taglen - setLen;
+    if (offsetLen < 0 || taglen < 1 || taglen > 64)
+      throw std::invalid_argument("tag and set bits exceed the address length");
+    tagMask = taglen == 64 ? ~0ull : (1ull << taglen) - 1;
+    fullMask = ways == 64 ? ~0ull : (1ull << ways) - 1;
+  }
+
+  uint64_t tagOf(uint64_t addr) const { return (addr >> (setLen + offsetLen)) & tagMask; }
+  uint64_t setOf(uint64_t addr) const { return (addr >> offsetLen) & (numSets - 1); }
+  uint64_t offsetOf(uint64_t addr) const { return addr & ((1ull << offsetLen) - 1); }
+
+  // flush writes back every line: dirty bits clear, lines stay valid.
+  // Returns the number of lines written back.
+  uint64_t flush() {
+    uint64_t n = 0;
+    for (uint64_t &d : dirty) { n += __builtin_popcountll(d); d = 0; }
+    return n;
+  }
+  void invalidate() { std::fill(valid.begin(), valid.end(), 0); }
+  void clearLRU() { std::fill(lru.begin(), lru.end(), 0); }
+
+  char access(uint64_t addr, bool write) {
+    uint64_t tag = tagOf(addr), set = setOf(addr);
+    uint64_t *t = &tags[set * numWays];
+    uint64_t v = valid[set];
+    int way;
+    for (way = 0; way < numWays; way++)
+      if (t[way] == tag && ((v >> way) & 1)) {
+        if (write) dirty[set] |= 1ull << way;
+        lru[set] = plru.update(lru[set], way);
+        return 'H';
+      }
+    char outcome;
+    if (v != fullMask) {
+      way = __builtin_ctzll(~v);           // priorityonehot of the invalid ways
+      outcome = 'M';
+    } else {
+      way = plru.victim(lru[set]);
+      outcome = ((dirty[set] >> way) & 1) ? 'D' : 'E';
+    }
+    t[way] = tag;
+    valid[set] |= 1ull << way;
+    dirty[set] = (dirty[set] & ~(1ull << way)) | ((uint64_t)write << way);
+    lru[set] = plru.update(lru[set], way);
+    return outcome;
+  }
+
+ private:
+  uint64_t numSets;
+  int numWays, setLen, offsetLen;
+  uint64_t tagMask, fullMask;
+  TreePLRU plru;
+  std::vector<uint64_t> tags;                 // [set][way]
+  std::vector<uint64_t> valid, dirty, lru;    // one bit per way / CurrLRU per set
+};
+
+#endif
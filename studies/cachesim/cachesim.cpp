@@ -0,0 +1,155 @@
+///////////////////////////////////////////
+// cachesim.cpp
+//
+// Written: Wally team 2023
+//
+// Purpose: Native replacement for bin/CacheSim.py.  Replays an ICache/DCache log
+//          (legacy text or the binary trace from testbench/dpi) through the model in
+//          cachemodel.h and cross-checks every H/M/E/D outcome against Wally.
+//          Arguments and messages are the same as CacheSim.py, so existing scripts
+//          and expected outputs carry over unchanged.
+//
+//   cachesim <lines> <ways> <addrlen> <taglen> -f <log file> [-v] [-p] [-d]
+//   the default invocation for rv64gc is 'cachesim 64 4 56 44 -f <log file>'
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "cachemodel.h"
+#include "wallytrace.h"
+
+static void usage(const char *prog) {
+  fprintf(stderr, "usage: %s L W A T -f FILE [-v] [-p] [-d]\n"
+          "  L  number of lines per way (a power of 2)\n"
+          "  W  number of ways (a power of 2)\n"
+          "  A  length of the physical address in bits\n"
+          "  T  length of the tag in bits\n"
+          "  -f, --file     log file (text or binary trace) to simulate from\n"
+          "  -v, --verbose  verbose/full-trace mode\n"
+          "  -p, --perf     report hit/miss ratio\n"
+          "  -d, --dist     report distribution of operations\n", prog);
+  exit(2);
+}
+
+// str(round(x, 3)) as printed by Python
+static std::string pyround3(double x) {
+  char s[64];
+  if (std::isinf(x)) return "inf";
+  snprintf(s, sizeof(s), "%.3f", x);
+  std::string r(s);
+  while (r.back() == '0' && r[r.size() - 2] != '.') r.pop_back();
+  return r;
+}
+
+int main(int argc, char **argv) {
+  const char *file = nullptr;
+  bool verbose = false, perf = false, dist = false;
+  long pos[4];
+  int npos = 0;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-f" || a == "--file") { if (++i == argc) usage(argv[0]); file = argv[i]; }
+    else if (a == "-v" || a == "--verbose") verbose = true;
+    else if (a == "-p" || a == "--perf") perf = true;
+    else if (a == "-d" || a == "--dist") dist = true;
+    else if (a[0] != '-' && npos < 4) pos[npos++] = strtol(a.c_str(), nullptr, 0);
+    else usage(argv[0]);
+  }
+  if (npos != 4 || !file) usage(argv[0]);
+
+  int addrlen = pos[2], digits = (addrlen + 3) / 4;
+  CacheModel *cache;
+  try {
+    cache = new CacheModel(pos[0], pos[1], addrlen, pos[3]);
+  } catch (const std::invalid_argument &e) {
+    fprintf(stderr, "cachesim: %s\n", e.what());
+    return 2;
+  }
+
+  std::string path = file;
+  if (path.compare(0, 2, "~/") == 0 && getenv("HOME")) path = getenv("HOME") + path.substr(1);
+  wt_reader *r = wt_open(path.c_str());
+  if (!r) return 1;
+  if (wt_kind(r) == WT_KIND_BRANCH) {
+    fprintf(stderr, "cachesim: %s is a branch trace\n", file);
+    return 1;
+  }
+
+  uint64_t hits = 0, misses = 0, loads = 0, stores = 0, atoms = 0, totalops = 0, lineno = 0;
+  bool nofails = true;
+  wt_event e;
+  int st;
+  while ((st = wt_next(r, &e)) > 0) {
+    lineno++;
+    if (e.type == WT_BEGIN || e.type == WT_TRAIN) {
+      // a new test is starting, so 'empty' the cache
+      cache->invalidate();
+      cache->clearLRU();
+      if (verbose) puts("New Test");
+      continue;
+    }
+    if (e.type != WT_ACCESS) continue;
+    totalops++;
+    if (e.access == 'F') {
+      cache->flush();
+      if (verbose) puts("F");
+    } else if (e.access == 'I') {
+      cache->invalidate();
+      if (verbose) puts("I");
+    } else {
+      char result = cache->access(e.addr, e.access == 'W' || e.access == 'A');
+      if (verbose)
+        printf("0x%llx 0x%llx 0x%llx 0x%llx %c %c\n", (unsigned long long)e.addr,
+               (unsigned long long)cache->tagOf(e.addr), (unsigned long long)cache->setOf(e.addr),
+               (unsigned long long)cache->offsetOf(e.addr), e.outcome, result);
+      if (result == 'H') hits++; else misses++;
+      if (e.access == 'R') loads++;
+      else if (e.access == 'W') stores++;
+      else if (e.access == 'A') atoms++;
+      if (result != e.outcome) {
+        printf("Result mismatch at address %0*llx. Wally: %c, Sim: %c\n", digits,
+               (unsigned long long)e.addr, e.outcome, result);
+        nofails = false;
+      }
+    }
+  }
+  wt_close(r);
+  if (st < 0) {
+    fprintf(stderr, "cachesim: malformed record after event %llu in %s\n", (unsigned long long)lineno, file);
+    return 1;
+  }
+
+  if (dist && totalops) {
+    auto pct = [&](uint64_t n) { return (long long)std::nearbyint(100.0 * n / totalops); };
+    printf("This log had %lld%% loads, %lld%% stores, and %lld%% atomic operations.\n",
+           pct(loads), pct(stores), pct(atoms));
+  }
+  if (perf)
+    printf("There were %llu hits and %llu misses. The hit/miss ratio was %s.\n",
+           (unsigned long long)hits, (unsigned long long)misses,
+           pyround3(misses ? (double)hits / misses : INFINITY).c_str());
+  if (nofails) puts("SUCCESS! There were no mismatches between Wally and the sim.");
+  delete cache;
+  return 0;
+}
@@ -0,0 +1,195 @@
+///////////////////////////////////////////
+// cachesweep.cpp
+//
+// Written: Wally team 2023
+//
+// Purpose: Cache design-space sweep over one ICache/DCache trace.  The trace is read
+//          once, in chunks, and every chunk is replayed through all requested
+//          geometries (NUMWAYS x WAYSIZEINBYTES x LINELENINBITS, as in
+//          wally-config.vh) on a pool of threads while the next chunk is read.
+//          Each configuration uses the cacheLRU.sv replacement model from
+//          cachemodel.h; reports hit rate, writebacks and estimated AMAT as CSV.
+//
+//   cachesweep -f DCache.log [-w 1,2,4,8] [-s 1024,...] [-l 256,512] [-a 56] [-j threads]
+//              [--hit 1] [--latency 10] [--buswidth 64] [-o sweep.csv]
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cachemodel.h"
+#include "wallytrace.h"
+
+// Events are packed into one word: the kind in the top 3 bits, the address below.
+enum : uint64_t { EV_READ, EV_WRITE, EV_FLUSH, EV_INVAL, EV_RESET };
+static const int      EV_SHIFT = 61;
+static const uint64_t EV_ADDR  = (1ull << EV_SHIFT) - 1;
+static const size_t   CHUNK    = 1 << 22;   // events per chunk
+
+struct Config {
+  int ways, waySize, lineBits;
+  std::unique_ptr<CacheModel> cache;
+  uint64_t accesses = 0, hits = 0, writebacks = 0;
+};
+
+static void usage(const char *prog) {
+  fprintf(stderr, "usage: %s -f FILE [options]\n"
+          "  -f, --file FILE    ICache/DCache log or binary trace\n"
+          "  -w, --ways LIST    NUMWAYS values (default 1,2,4,8)\n"
+          "  -s, --waysize LIST WAYSIZEINBYTES values (default 1024,2048,4096,8192,16384)\n"
+          "  -l, --linelen LIST LINELENINBITS values (default 256,512)\n"
+          "  -a, --addrlen N    physical address bits (default 56)\n"
+          "  -j, --threads N    worker threads (default: hardware threads)\n"
+          "      --hit N        hit time in cycles (default 1)\n"
+          "      --latency N    memory latency before the first beat (default 10)\n"
+          "      --buswidth N   bus width in bits, one beat per cycle (default 64)\n"
+          "  -o, --output FILE  CSV output (default stdout)\n", prog);
+  exit(2);
+}
+
+static std::vector<int> parseList(const char *s) {
+  std::vector<int> v;
+  for (char *end; *s; s = *end ? end + 1 : end) v.push_back(strtol(s, &end, 0));
+  return v;
+}
+
+// read up to CHUNK events; returns false once the trace is exhausted
+static bool readChunk(wt_reader *r, std::vector<uint64_t> &ev, int &status) {
+  wt_event e;
+  ev.clear();
+  while (ev.size() < CHUNK && (status = wt_next(r, &e)) > 0) {
+    uint64_t kind;
+    if (e.type == WT_BEGIN || e.type == WT_TRAIN) kind = EV_RESET;
+    else if (e.type != WT_ACCESS) continue;
+    else if (e.access == 'F') kind = EV_FLUSH;
+    else if (e.access == 'I') kind = EV_INVAL;
+    else kind = (e.access == 'W' || e.access == 'A') ? EV_WRITE : EV_READ;
+    ev.push_back(kind << EV_SHIFT | (e.addr & EV_ADDR));
+  }
+  return status > 0;
+}
+
+static void replay(Config &c, const std::vector<uint64_t> &ev) {
+  CacheModel &cache = *c.cache;
+  uint64_t hits = 0, wb = 0;
+  for (uint64_t w : ev) {
+    switch (w >> EV_SHIFT) {
+      case EV_READ:
+      case EV_WRITE: {
+        char r = cache.access(w & EV_ADDR, (w >> EV_SHIFT) == EV_WRITE);
+        hits += r == 'H';
+        wb += r == 'D';
+        c.accesses++;
+        break;
+      }
+      case EV_FLUSH: wb += cache.flush(); break;
+      case EV_INVAL: cache.invalidate(); break;
+      default:       cache.invalidate(); cache.clearLRU(); break;
+    }
+  }
+  c.hits += hits;
+  c.writebacks += wb;
+}
+
+int main(int argc, char **argv) {
+  const char *file = nullptr, *output = nullptr;
+  std::vector<int> ways = {1, 2, 4, 8}, waySizes = {1024, 2048, 4096, 8192, 16384}, lineLens = {256, 512};
+  int addrlen = 56, hitTime = 1, latency = 10, busWidth = 64;
+  int threads = std::thread::hardware_concurrency();
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (i + 1 == argc) usage(argv[0]);
+    const char *v = argv[++i];
+    if (a == "-f" || a == "--file") file = v;
+    else if (a == "-w" || a == "--ways") ways = parseList(v);
+    else if (a == "-s" || a == "--waysize") waySizes = parseList(v);
+    else if (a == "-l" || a == "--linelen") lineLens = parseList(v);
+    else if (a == "-a" || a == "--addrlen") addrlen = atoi(v);
+    else if (a == "-j" || a == "--threads") threads = atoi(v);
+    else if (a == "--hit") hitTime = atoi(v);
+    else if (a == "--latency") latency = atoi(v);
+    else if (a == "--buswidth") busWidth = atoi(v);
+    else if (a == "-o" || a == "--output") output = v;
+    else usage(argv[0]);
+  }
+  if (!file || busWidth <= 0) usage(argv[0]);
+  if (threads < 1) threads = 1;
+
+  std::vector<Config> configs;
+  for (int w : ways)
+    for (int s : waySizes)
+      for (int l : lineLens) {
+        Config c{w, s, l};
+        int lineBytes = l / 8, sets = lineBytes ? s / lineBytes : 0;
+        try {
+          if (!sets || s % lineBytes) throw std::invalid_argument("way size is not a multiple of the line");
+          c.cache.reset(new CacheModel(sets, w, addrlen, addrlen - log2i(s)));
+        } catch (const std::invalid_argument &e) {
+          fprintf(stderr, "cachesweep: skipping %d ways x %d bytes x %d bit lines: %s\n", w, s, l, e.what());
+          continue;
+        }
+        configs.push_back(std::move(c));
+      }
+  if (configs.empty()) { fprintf(stderr, "cachesweep: no valid configurations\n"); return 2; }
+
+  wt_reader *r = wt_open(file);
+  if (!r) return 1;
+  if (wt_kind(r) == WT_KIND_BRANCH) { fprintf(stderr, "cachesweep: %s is a branch trace\n", file); return 1; }
+
+  // replay chunk k on the workers while chunk k+1 is read
+  std::vector<uint64_t> cur, next;
+  int status = 1;
+  bool more = readChunk(r, cur, status);
+  for (;;) {
+    std::vector<std::future<void>> work;
+    for (int t = 0; t < threads && t < (int)configs.size(); t++)
+      work.push_back(std::async(std::launch::async, [&, t] {
+        for (size_t i = t; i < configs.size(); i += threads) replay(configs[i], cur);
+      }));
+    if (more) more = readChunk(r, next, status); else next.clear();
+    for (auto &w : work) w.get();
+    if (next.empty()) break;
+    cur.swap(next);
+  }
+  wt_close(r);
+  if (status < 0) { fprintf(stderr, "cachesweep: malformed record in %s\n", file); return 1; }
+
+  FILE *out = output ? fopen(output, "w") : stdout;
+  if (!out) { fprintf(stderr, "cachesweep: cannot write %s\n", output); return 1; }
+  fprintf(out, "ways,waysizebytes,linelenbits,sets,capacitybytes,accesses,hits,misses,hitrate,writebacks,amat\n");
+  for (const Config &c : configs) {
+    // a line fill or writeback is the memory latency plus one beat per bus word
+    double lineCycles = latency + (c.lineBits + busWidth - 1) / busWidth;
+    uint64_t misses = c.accesses - c.hits;
+    double amat = c.accesses ? hitTime + (misses + c.writebacks) * lineCycles / c.accesses : 0;
+    fprintf(out, "%d,%d,%d,%d,%d,%llu,%llu,%llu,%.6f,%llu,%.4f\n", c.ways, c.waySize, c.lineBits,
+            c.waySize / (c.lineBits / 8), c.ways * c.waySize, (unsigned long long)c.accesses,
+            (unsigned long long)c.hits, (unsigned long long)misses,
+            c.accesses ? (double)c.hits / c.accesses : 0, (unsigned long long)c.writebacks, amat);
+  }
+  if (output) fclose(out);
+  return 0;
+}
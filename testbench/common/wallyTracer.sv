@@ -28,6 +28,9 @@
 `define PRINT_MOST 0
 `define PRINT_ALL 0
 `define PRINT_CSRS 0
+// write every retired instruction to rvvi.wtr through the DPI-C event logger
+// (testbench/dpi/wallytrace.so) instead of printing it; wtrace2txt renders it as text
+`define RVVI_TRACE 0
 
 module wallyTracer(rvviTrace rvvi);
 
@@ -153,7 +156,7 @@ module wallyTracer(rvviTrace rvvi);
 	  CSRArray[12'hB02] = testbench.dut.core.priv.priv.csr.counters.counters.HPMCOUNTER_REGW[2];
 	  // supervisor CSRs
 	  CSRArray[12'h100] = testbench.dut.core.priv.priv.csr.csrs.csrs.SSTATUS_REGW;
-	  CSRArray[12'h104] = testbench.dut.core.priv.priv.csr.csrm.MIE_REGW & 12'h222;
+	  CSRArray[12'h104] = testbench.dut.core.priv.priv.csr.csrm.MIE_REGW & 14'h2222;
 	  CSRArray[12'h105] = testbench.dut.core.priv.priv.csr.csrs.csrs.STVEC_REGW;
 	  CSRArray[12'h141] = testbench.dut.core.priv.priv.csr.csrs.csrs.SEPC_REGW;
 	  CSRArray[12'h106] = testbench.dut.core.priv.priv.csr.csrs.csrs.SCOUNTEREN_REGW;
@@ -161,7 +164,7 @@ module wallyTracer(rvviTrace rvvi);
 	  CSRArray[12'h140] = testbench.dut.core.priv.priv.csr.csrs.csrs.SSCRATCH_REGW;
 	  CSRArray[12'h143] = testbench.dut.core.priv.priv.csr.csrs.csrs.STVAL_REGW;
 	  CSRArray[12'h142] = testbench.dut.core.priv.priv.csr.csrs.csrs.SCAUSE_REGW;
-	  CSRArray[12'h144] = testbench.dut.core.priv.priv.csr.csrm.MIP_REGW & & 12'h222 & testbench.dut.core.priv.priv.csr.csrm.MIDELEG_REGW;
+	  CSRArray[12'h144] = testbench.dut.core.priv.priv.csr.csrm.MIP_REGW & & 14'h2222 & testbench.dut.core.priv.priv.csr.csrm.MIDELEG_REGW;
 	  CSRArray[12'h14D] = testbench.dut.core.priv.priv.csr.csrs.csrs.STIMECMP_REGW;
 	  // user CSRs
 	  CSRArray[12'h001] = testbench.dut.core.priv.priv.csr.csru.csru.FFLAGS_REGW;
@@ -505,6 +508,35 @@ module wallyTracer(rvviTrace rvvi);
     if(HaltW) $finish;
   end
 
+  if (`RVVI_TRACE) begin : RVVITrace
+    // as declared in testbench/wallytrace.vh, which is not on the include path of testbench/common
+    import "DPI-C" function chandle wtrace_open(input string filename, input int kind, input int zlevel);
+    import "DPI-C" function void    wtrace_rvvi_csr(input chandle h, input int csr, input longint unsigned value);
+    import "DPI-C" function void    wtrace_rvvi(input chandle h, input longint unsigned order, input longint unsigned pc,
+                                                input longint unsigned pcNext, input longint unsigned insn,
+                                                input int trap, input int halt, input int intr, input int mode, input int ixl,
+                                                input int xReg, input longint unsigned xVal,
+                                                input int fReg, input longint unsigned fVal);
+    import "DPI-C" function void    wtrace_close(input chandle h);
+    chandle trace;
+    int     zlevel;
+    initial begin
+      if (!$value$plusargs("TRACEZSTD=%d", zlevel)) zlevel = 0;
+      trace = wtrace_open("rvvi.wtr", 4, zlevel);
+    end
+    always_ff @(posedge clk) begin
+	  if(rvvi.valid[0][0]) begin
+		// only the CSRs Wally models are in CSRArray; the logger drops unchanged values
+		foreach (CSRArray[csr])
+		  if(CSR_W[csr]) wtrace_rvvi_csr(trace, csr, CSRArray[csr]);
+		wtrace_rvvi(trace, rvvi.order[0][0], rvvi.pc_rdata[0][0], rvvi.pc_wdata[0][0], rvvi.insn[0][0],
+					rvvi.trap[0][0], rvvi.halt[0][0], rvvi.intr[0][0], rvvi.mode[0][0], rvvi.ixl[0][0],
+					rf_we3 ? rf_a3 : -1, rvvi.x_wdata[0][0][rf_a3], frf_we4 ? frf_a4 : -1, rvvi.f_wdata[0][0][frf_a4]);
+	  end
+    end
+    final wtrace_close(trace);
+  end
+
 
 
 endmodule
@@ -0,0 +1,52 @@
+///////////////////////////////////////////
+// cosim.vh
+//
+// Written: Wally team 2023
+//
+// Purpose: DPI-C imports for the lockstep comparator (testbench/dpi/cosim.c, built
+//          into cosim.so) used by testbench-linux-imperas.sv with USE_WALLY_COSIM
+//          to check every retired instruction against the RV64GC model in rvmodel.c.
+// 
+// A component of the Wally configurable RISC-V project.
+// 
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file 
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You 
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the 
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, 
+// either express or implied. See the License for the specific language governing permissions 
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ranges are as in the config (size - 1); misa includes MXL; returns null on failure
+import "DPI-C" function chandle cosim_open(input longint unsigned romBase, input longint unsigned romRange,
+                                           input longint unsigned ramBase, input longint unsigned ramRange,
+                                           input longint unsigned misa, input longint unsigned resetVector,
+                                           input int svadu, input int numPMP);
+import "DPI-C" function void     cosim_device(input chandle h, input longint unsigned base, input longint unsigned range);
+// bootmem.bin / ram.bin images; returns bytes loaded or -1
+import "DPI-C" function longint  cosim_load(input chandle h, input string path, input longint unsigned base);
+// checkpointN/ram.rpg against the base image ram.bin; returns non-zero pages or -1
+import "DPI-C" function longint  cosim_load_checkpoint(input chandle h, input string path, input string basePath,
+                                                       input longint unsigned base);
+import "DPI-C" function void     cosim_set_xreg(input chandle h, input int reg, input longint unsigned value);
+import "DPI-C" function void     cosim_set_pc(input chandle h, input longint unsigned pc);
+import "DPI-C" function void     cosim_set_priv(input chandle h, input int priv);
+import "DPI-C" function void     cosim_set_csr(input chandle h, input int csr, input longint unsigned value);
+// interrupt lines in their mip bit positions
+import "DPI-C" function void     cosim_irq(input chandle h, input longint unsigned lines);
+// report each CSR the retiring instruction changed, then the instruction itself;
+// xReg and fReg are -1 for no write.  Returns the number of mismatches.
+import "DPI-C" function void     cosim_csr(input chandle h, input int csr, input longint unsigned value);
+import "DPI-C" function int      cosim_retire(input chandle h, input longint unsigned order, input longint unsigned pc,
+                                              input int unsigned insn, input int intr, input int mode,
+                                              input int xReg, input longint unsigned xVal,
+                                              input int fReg, input longint unsigned fVal);
+import "DPI-C" function void     cosim_close(input chandle h);
@@ -0,0 +1,89 @@
+///////////////////////////////////////////
+// bin2rpg.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Pack a RAM image in the ram.bin layout (fixBinMem output) into the sparse
+//          checkpoint described in rampages.h, storing each page only if it is
+//          non-zero and not already in the base image.  The result is checked to
+//          expand back to exactly the input.
+//          usage: bin2rpg [-b base ram.bin] <ram.bin> <ram.rpg>
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "rampages.h"
+
+static const uint8_t *mapFile(const char *path, size_t *size) {
+  struct stat st;
+  const uint8_t *map;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st)) { fprintf(stderr, "bin2rpg: cannot open %s\n", path); exit(1); }
+  *size = st.st_size;
+  map = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+  close(fd);
+  if (map == MAP_FAILED) { fprintf(stderr, "bin2rpg: cannot map %s\n", path); exit(1); }
+  return map;
+}
+
+int main(int argc, char *argv[]) {
+  const char *basePath = NULL;
+  const uint8_t *mem, *base = NULL;
+  size_t bytes, baseBytes = 0;
+  uint8_t page[RP_PAGE_BYTES];
+  uint64_t n, stored = 0, shared = 0;
+  rp_image *img;
+  int opt;
+  while ((opt = getopt(argc, argv, "b:")) != -1) {
+    if (opt == 'b') basePath = optarg;
+    else return 1;
+  }
+  if (argc - optind != 2) {
+    fprintf(stderr, "Expected 2 arguments: <ram.bin> <ram.rpg>\n");
+    return 1;
+  }
+  mem = mapFile(argv[optind], &bytes);
+  if (basePath) base = mapFile(basePath, &baseBytes);
+  if (rp_write(argv[optind + 1], mem, bytes, base, baseBytes)) {
+    fprintf(stderr, "bin2rpg: error writing %s\n", argv[optind + 1]);
+    return 1;
+  }
+  if (!(img = rp_open(argv[optind + 1], basePath))) return 1;
+  for (n = 0; n < rp_num_pages(img); n++) {
+    size_t off = n * RP_PAGE_BYTES, len = bytes - off < RP_PAGE_BYTES ? bytes - off : RP_PAGE_BYTES;
+    uint32_t e = rp_page(img, n, page);
+    if (memcmp(page, mem + off, len)) {
+      fprintf(stderr, "bin2rpg: page %llu of %s does not read back\n", (unsigned long long)n, argv[optind + 1]);
+      return 1;
+    }
+    if (e & RP_BASE) shared++;
+    else if (e != RP_ZERO) stored++;
+  }
+  printf("%llu pages: %llu stored, %llu shared with the base image, %llu zero\n",
+         (unsigned long long)rp_num_pages(img), (unsigned long long)stored, (unsigned long long)shared,
+         (unsigned long long)(rp_num_pages(img) - stored - shared));
+  rp_close(img);
+  return 0;
+}
@@ -0,0 +1,266 @@
+///////////////////////////////////////////
+// cosim.c
+//
+// Written: Wally team 2023
+//
+// Purpose: DPI-C lockstep comparator for testbench-linux-imperas.sv built with
+//          USE_WALLY_COSIM.  Each instruction Wally retires (as seen through the
+//          RVVI wallyTracer) steps the RV64GC model in rvmodel.c, and the PC,
+//          instruction, privilege mode, destination register and changed CSRs are
+//          compared.  This replaces the QEMU trace for Linux boots: there is no
+//          trace to record or read and no interrupt file, because the DUT tells the
+//          model when it took an interrupt and what each device load returned.
+//          On a mismatch the model is resynchronized to the DUT so that one bug
+//          is reported once rather than on every following instruction.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "svdpi.h"
+#include "rvmodel.h"
+#include "rampages.h"
+
+#define MAX_STAGED 64
+
+typedef struct {
+  rvm_hart  hart;
+  // last value the DUT reported for each CSR, for CSRs the model changed but the DUT did not
+  uint64_t  dutCSR[4096];
+  uint8_t   dutKnown[4096];
+  // CSRs the DUT reported for the instruction about to retire
+  int       numStaged;
+  uint16_t  stagedCSR[MAX_STAGED];
+  uint64_t  stagedVal[MAX_STAGED];
+  uint64_t  instrs, interrupts, dutReads, mismatches;
+} cosim;
+
+// wallyTracer reports sie as mie & 0x222 without the mideleg mask, so it is not compared
+static int compared(int csr) { return !rvm_csr_volatile(csr) && csr != RVM_SIE; }
+
+static const char *privName(int p) { return p == 3 ? "M" : p == 1 ? "S" : p == 0 ? "U" : "?"; }
+
+// the 64-bit words of bootmem.bin and ram.bin are stored most significant byte first
+static void swapWords(uint8_t *p, uint64_t bytes) {
+  uint64_t i, v;
+  for (i = 0; i + 8 <= bytes; i += 8) {
+    memcpy(&v, p + i, 8);
+    v = __builtin_bswap64(v);
+    memcpy(p + i, &v, 8);
+  }
+}
+
+void *cosim_open(unsigned long long romBase, unsigned long long romRange,
+                 unsigned long long ramBase, unsigned long long ramRange,
+                 unsigned long long misa, unsigned long long resetVector, int svadu, int numPMP) {
+  cosim *c = calloc(1, sizeof(cosim));
+  if (!c) return NULL;
+  rvm_init(&c->hart, misa, resetVector);
+  c->hart.svadu = svadu;
+  c->hart.numPMP = numPMP;
+  if (rvm_add_region(&c->hart, romBase, romRange + 1, 0) || rvm_add_region(&c->hart, ramBase, ramRange + 1, 0)) {
+    fprintf(stderr, "cosim: cannot allocate model memory\n");
+    free(c);
+    return NULL;
+  }
+  return c;
+}
+
+// a device region: loads take the DUT's value and stores are dropped
+void cosim_device(void *h, unsigned long long base, unsigned long long range) {
+  cosim *c = h;
+  if (rvm_add_region(&c->hart, base, range + 1, 1)) fprintf(stderr, "cosim: too many regions\n");
+}
+
+// copy a bootmem.bin or ram.bin image to base; returns bytes loaded or -1
+long long cosim_load(void *h, const char *path, unsigned long long base) {
+  cosim *c = h;
+  FILE *f = fopen(path, "rb");
+  long size;
+  uint8_t *p;
+  if (!f) return -1;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  rewind(f);
+  if (!(p = rvm_mem(&c->hart, base, size))) {
+    fprintf(stderr, "cosim: %s does not fit at 0x%llx\n", path, base);
+    fclose(f);
+    return -1;
+  }
+  size = fread(p, 1, size, f);
+  fclose(f);
+  swapWords(p, size);
+  return size;
+}
+
+// load a sparse checkpoint ram.rpg made against ram.bin to base; returns non-zero pages or -1
+long long cosim_load_checkpoint(void *h, const char *path, const char *basePath, unsigned long long base) {
+  cosim *c = h;
+  rp_image *img = rp_open(path, basePath);
+  uint64_t n, bytes, loaded = 0;
+  uint8_t *p;
+  if (!img) return -1;
+  bytes = rp_mem_bytes(img);
+  if (!(p = rvm_mem(&c->hart, base, bytes))) {
+    fprintf(stderr, "cosim: %s does not fit at 0x%llx\n", path, base);
+    rp_close(img);
+    return -1;
+  }
+  for (n = 0; n < rp_num_pages(img); n++) {
+    // the model memory starts zeroed, so zero pages need not be written
+    if (rp_page(img, n, p + n * RP_PAGE_BYTES) == RP_ZERO) memset(p + n * RP_PAGE_BYTES, 0, RP_PAGE_BYTES);
+    else loaded++;
+  }
+  swapWords(p, bytes);
+  rp_close(img);
+  return loaded;
+}
+
+// checkpoint state; CSRs are written as if by the DUT so they are compared from here on
+void cosim_set_xreg(void *h, int reg, unsigned long long value) { if (reg) ((cosim *)h)->hart.x[reg & 31] = value; }
+void cosim_set_pc(void *h, unsigned long long pc) { ((cosim *)h)->hart.pc = pc; }
+void cosim_set_priv(void *h, int priv) { ((cosim *)h)->hart.priv = priv; }
+
+void cosim_set_csr(void *h, int csr, unsigned long long value) {
+  cosim *c = h;
+  rvm_csr_poke(&c->hart, csr, value);
+  c->dutCSR[csr] = value;
+  c->dutKnown[csr] = 1;
+}
+
+// level of MEIP, MSIP, MTIP, SEIP and STIP in their mip bit positions
+void cosim_irq(void *h, unsigned long long lines) { ((cosim *)h)->hart.irqLines = lines; }
+
+// a CSR the DUT changed with the instruction it is retiring; call before cosim_retire
+void cosim_csr(void *h, int csr, unsigned long long value) {
+  cosim *c = h;
+  if (c->numStaged == MAX_STAGED) return;
+  c->stagedCSR[c->numStaged] = csr;
+  c->stagedVal[c->numStaged++] = value;
+}
+
+static int mismatch(cosim *c, unsigned long long order, uint64_t pc, const char *what, uint64_t dut, uint64_t model) {
+  printf("cosim: instr %llu pc %016llx: %s is %016llx, model expects %016llx\n",
+         order, (unsigned long long)pc, what, (unsigned long long)dut, (unsigned long long)model);
+  c->mismatches++;
+  return 1;
+}
+
+// Compare one instruction the DUT retired.  intr is set for the first instruction of a
+// trap handler; xReg and fReg are -1 if no register was written.  Returns the number of
+// mismatches found, after which the model holds the DUT's state.
+int cosim_retire(void *h, unsigned long long order, unsigned long long pc, unsigned int insn, int intr, int mode,
+                 int xReg, unsigned long long xVal, int fReg, unsigned long long fVal) {
+  cosim *c = h;
+  rvm_hart *m = &c->hart;
+  int errors = 0, i, csr, exists, dutWrote;
+  uint64_t pcBefore;
+  char what[32];
+
+  m->numWrites = 0;
+  if (intr && m->pc != pc) {
+    // the trap the DUT took is either an interrupt or an exception the model has to find
+    if (rvm_interrupt(m) >= 0) c->interrupts++;
+    else {
+      m->dutX = m->dutF = 0;
+      rvm_step(m);
+      if (!m->trapped) errors += mismatch(c, order, pc, "trap target", pc, m->pc);
+    }
+  }
+  if (m->pc != pc) {
+    errors += mismatch(c, order, pc, "pc", pc, m->pc);
+    m->pc = pc;
+  }
+  if (m->priv != mode) {
+    printf("cosim: instr %llu pc %016llx: mode is %s, model expects %s\n", order, pc, privName(mode), privName(m->priv));
+    c->mismatches++;
+    errors++;
+    m->priv = mode;
+  }
+
+  m->dutX = xVal;
+  m->dutF = fVal;
+  pcBefore = m->pc;
+  rvm_step(m);
+  if (m->usedDut) c->dutReads++;
+  c->instrs++;
+  if (m->trapped) {
+    printf("cosim: instr %llu pc %016llx: retired, but the model takes exception %llu (tval %016llx)\n",
+           order, (unsigned long long)pcBefore, (unsigned long long)m->cause, (unsigned long long)m->tval);
+    c->mismatches++;
+    errors++;
+  } else {
+    if ((m->insn & 3) == 3 ? m->insn != insn : m->insn != (insn & 0xffff))
+      errors += mismatch(c, order, pcBefore, "instruction", insn, m->insn);
+    if (xReg == 0) xReg = -1;
+    if (xReg != m->xRd) {
+      printf("cosim: instr %llu pc %016llx: writes x%d, model expects x%d\n", order, (unsigned long long)pcBefore, xReg, m->xRd);
+      c->mismatches++;
+      errors++;
+    } else if (xReg > 0 && m->x[xReg] != xVal) {
+      snprintf(what, sizeof(what), "x%d", xReg);
+      errors += mismatch(c, order, pcBefore, what, xVal, m->x[xReg]);
+    }
+    if (fReg != m->fRd) {
+      printf("cosim: instr %llu pc %016llx: writes f%d, model expects f%d\n", order, (unsigned long long)pcBefore, fReg, m->fRd);
+      c->mismatches++;
+      errors++;
+    } else if (fReg >= 0 && m->f[fReg] != fVal) {
+      snprintf(what, sizeof(what), "f%d", fReg);
+      errors += mismatch(c, order, pcBefore, what, fVal, m->f[fReg]);
+    }
+  }
+  if (xReg > 0) m->x[xReg] = xVal;
+  if (fReg >= 0) m->f[fReg] = fVal;
+
+  // CSRs the DUT changed
+  for (i = 0; i < c->numStaged; i++) {
+    csr = c->stagedCSR[i];
+    c->dutCSR[csr] = c->stagedVal[i];
+    c->dutKnown[csr] = 1;
+    if (!compared(csr) || rvm_csr_peek(m, csr, &exists) == c->stagedVal[i] || !exists) continue;
+    snprintf(what, sizeof(what), "CSR 0x%03x", csr);
+    errors += mismatch(c, order, pcBefore, what, c->stagedVal[i], rvm_csr_peek(m, csr, NULL));
+    rvm_csr_poke(m, csr, c->stagedVal[i]);
+  }
+  // and those the model changed but the DUT did not
+  for (i = 0; i < m->numWrites; i++) {
+    csr = m->writes[i];
+    if (!c->dutKnown[csr] || !compared(csr) || rvm_csr_peek(m, csr, NULL) == c->dutCSR[csr]) continue;
+    for (dutWrote = 0; dutWrote < c->numStaged && c->stagedCSR[dutWrote] != csr; dutWrote++);
+    if (dutWrote < c->numStaged) continue;
+    snprintf(what, sizeof(what), "CSR 0x%03x", csr);
+    errors += mismatch(c, order, pcBefore, what, c->dutCSR[csr], rvm_csr_peek(m, csr, NULL));
+    rvm_csr_poke(m, csr, c->dutCSR[csr]);
+  }
+  c->numStaged = 0;
+  return errors;
+}
+
+void cosim_close(void *h) {
+  cosim *c = h;
+  int i;
+  if (!c) return;
+  printf("cosim: %llu instructions compared, %llu interrupts, %llu device or counter reads taken from the DUT, %llu mismatches\n",
+         (unsigned long long)c->instrs, (unsigned long long)c->interrupts,
+         (unsigned long long)c->dutReads, (unsigned long long)c->mismatches);
+  for (i = 0; i < c->hart.numRegions; i++) free(c->hart.region[i].mem);
+  free(c);
+}
@@ -0,0 +1,302 @@
+///////////////////////////////////////////
+// eventlogger.c
+//
+// Written: Wally team 2023
+//
+// Purpose: DPI-C writer for the cache, branch predictor and RVVI event traces
+//          (format in wallytrace.h).  The simulator thread only packs a few bytes
+//          per event into a memory buffer; full buffers are handed to a background
+//          thread that optionally zstd-compresses them and writes them to disk.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "wallytrace.h"
+#ifdef WALLY_TRACE_ZSTD
+#include <zstd.h>
+#endif
+
+#define WRBUF    (1 << 20)     // bytes per buffer handed to the writer thread
+#define WRSLACK  4200          // room for the largest single record
+#define MAXQUEUE 8             // buffers in flight before the simulator waits
+
+typedef struct wtbuf {
+  uint8_t      *data;
+  size_t        len;
+  struct wtbuf *next;
+} wtbuf;
+
+typedef struct wtrace {
+  struct wtrace  *nextOpen;          // traces still open at exit
+  FILE           *fp;
+  wtbuf          *cur;               // buffer being filled by the simulator
+  wtbuf          *head, *tail;       // full buffers waiting for the writer
+  int             queued, done;
+  uint64_t        lastAddr, lastPC, lastOrder;
+  uint64_t       *csrs;              // RVVI: CSR values last written to the trace
+  int             numCSRs;           // RVVI: CSR writes staged for the next retire
+  uint64_t        droppedCSRs;       // RVVI: CSR writes beyond WT_MAX_CSRS in one retire
+  uint16_t        csr[WT_MAX_CSRS];
+  uint64_t        csrVal[WT_MAX_CSRS];
+  pthread_t       thread;
+  pthread_mutex_t lock;
+  pthread_cond_t  ready, drained;
+#ifdef WALLY_TRACE_ZSTD
+  ZSTD_CCtx      *zc;
+  uint8_t        *zbuf;
+  size_t          zcap;
+#endif
+} wtrace;
+
+static wtrace *openTraces;
+
+static wtbuf *newbuf(void) {
+  wtbuf *b = malloc(sizeof(*b));
+  b->data = malloc(WRBUF + WRSLACK);
+  b->len = 0;
+  b->next = NULL;
+  return b;
+}
+
+static void writeout(wtrace *t, wtbuf *b, int last) {
+#ifdef WALLY_TRACE_ZSTD
+  if (t->zc) {
+    ZSTD_inBuffer in = {b->data, b->len, 0};
+    size_t rem;
+    do {
+      ZSTD_outBuffer out = {t->zbuf, t->zcap, 0};
+      rem = ZSTD_compressStream2(t->zc, &out, &in, last ? ZSTD_e_end : ZSTD_e_continue);
+      fwrite(t->zbuf, 1, out.pos, t->fp);
+    } while (!ZSTD_isError(rem) && (last ? rem != 0 : in.pos < in.size));
+    return;
+  }
+#endif
+  (void)last;
+  fwrite(b->data, 1, b->len, t->fp);
+}
+
+static void *writer(void *arg) {
+  wtrace *t = arg;
+  wtbuf *b;
+  pthread_mutex_lock(&t->lock);
+  for (;;) {
+    while (!t->head && !t->done) pthread_cond_wait(&t->ready, &t->lock);
+    if (!t->head) break;
+    b = t->head;
+    t->head = b->next;
+    if (!t->head) t->tail = NULL;
+    pthread_mutex_unlock(&t->lock);
+    writeout(t, b, 0);
+    free(b->data);
+    free(b);
+    pthread_mutex_lock(&t->lock);
+    t->queued--;
+    pthread_cond_signal(&t->drained);
+  }
+  pthread_mutex_unlock(&t->lock);
+  return NULL;
+}
+
+static void submit(wtrace *t) {
+  pthread_mutex_lock(&t->lock);
+  while (t->queued >= MAXQUEUE) pthread_cond_wait(&t->drained, &t->lock);
+  if (t->tail) t->tail->next = t->cur; else t->head = t->cur;
+  t->tail = t->cur;
+  t->queued++;
+  pthread_cond_signal(&t->ready);
+  pthread_mutex_unlock(&t->lock);
+  t->cur = newbuf();
+}
+
+static void put8(wtrace *t, uint8_t v) { t->cur->data[t->cur->len++] = v; }
+
+static void putvar(wtrace *t, uint64_t v) {
+  while (v >= 0x80) { put8(t, (v & 0x7f) | 0x80); v >>= 7; }
+  put8(t, v);
+}
+
+static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+
+static void endrecord(wtrace *t) { if (t->cur->len >= WRBUF) submit(t); }
+
+static int indexof(const char *s, char c) {
+  const char *p = strchr(s, c);
+  return (p && c) ? (int)(p - s) : -1;
+}
+
+void wtrace_close(void *h);
+
+// traces not closed from a final block (e.g. the run ended with $stop and quit)
+// are flushed when the simulator exits
+static void closeAll(void) {
+  while (openTraces) wtrace_close(openTraces);
+}
+
+/////////////////////////////////////////////
+// DPI-C entry points
+/////////////////////////////////////////////
+
+// Open a trace of the given kind (WT_KIND_*).  zlevel > 0 zstd-compresses the
+// stream at that level when the library was built with ZSTD=1.
+void *wtrace_open(const char *filename, int kind, int zlevel) {
+  wtrace *t;
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) { fprintf(stderr, "eventlogger: cannot open %s\n", filename); return NULL; }
+  t = calloc(1, sizeof(*t));
+  t->fp = fp;
+  t->cur = newbuf();
+  pthread_mutex_init(&t->lock, NULL);
+  pthread_cond_init(&t->ready, NULL);
+  pthread_cond_init(&t->drained, NULL);
+#ifdef WALLY_TRACE_ZSTD
+  if (zlevel > 0) {
+    t->zc = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(t->zc, ZSTD_c_compressionLevel, zlevel);
+    t->zcap = ZSTD_CStreamOutSize();
+    t->zbuf = malloc(t->zcap);
+  }
+#else
+  if (zlevel > 0) fprintf(stderr, "eventlogger: built without zstd, writing %s uncompressed\n", filename);
+#endif
+  memcpy(t->cur->data, WT_MAGIC, 4);
+  t->cur->data[4] = WT_VERSION;
+  t->cur->data[5] = kind;
+  t->cur->data[6] = t->cur->data[7] = 0;
+  t->cur->len = 8;
+  pthread_create(&t->thread, NULL, writer, t);
+  if (!openTraces) atexit(closeAll);
+  t->nextOpen = openTraces;
+  openTraces = t;
+  return t;
+}
+
+// access: R W A F I, outcome: H M E D X, as in the text logs
+void wtrace_cache(void *h, unsigned long long addr, char access, char outcome) {
+  wtrace *t = h;
+  int a = indexof(wt_access_chars, access), o = indexof(wt_outcome_chars, outcome);
+  if (!t || a < 0 || o < 0) return;
+  put8(t, a | o << 3);
+  if (a < 3) {
+    putvar(t, zigzag((int64_t)(addr - t->lastAddr)));
+    t->lastAddr = addr;
+  }
+  endrecord(t);
+}
+
+void wtrace_branch(void *h, unsigned long long pc, int taken) {
+  wtrace *t = h;
+  if (!t) return;
+  put8(t, WT_OP_BRANCH | (taken != 0));
+  putvar(t, zigzag((int64_t)(pc - t->lastPC)));
+  t->lastPC = pc;
+  endrecord(t);
+}
+
+// marker: 'B' BEGIN, 'E' END, 'T' TRAIN; name is the test (memfile) name
+void wtrace_marker(void *h, char marker, const char *name) {
+  wtrace *t = h;
+  size_t n = name ? strlen(name) : 0;
+  if (!t) return;
+  if (marker == 'T') { put8(t, WT_OP_TRAIN); endrecord(t); return; }
+  if (n > 4095) n = 4095;   // reader name limit
+  put8(t, marker == 'B' ? WT_OP_BEGIN : WT_OP_END);
+  putvar(t, n);
+  memcpy(t->cur->data + t->cur->len, name, n);
+  t->cur->len += n;
+  endrecord(t);
+}
+
+// Stage a CSR the next retired instruction wrote; logged only if its value changed.
+// A retire record holds at most WT_MAX_CSRS of them; the rest are dropped, with a
+// warning the first time and a count when the trace is closed.
+void wtrace_rvvi_csr(void *h, int csr, unsigned long long value) {
+  wtrace *t = h;
+  if (!t || csr < 0 || csr >= WT_NUM_CSRS) return;
+  if (!t->csrs) t->csrs = calloc(WT_NUM_CSRS, sizeof(uint64_t));
+  if (t->csrs[csr] == value) return;
+  if (t->numCSRs == WT_MAX_CSRS) {
+    if (t->droppedCSRs++ == 0)
+      fprintf(stderr, "eventlogger: more than %d CSR writes in one retired instruction; "
+              "dropping the rest, so the trace's CSR values are wrong from here on\n", WT_MAX_CSRS);
+    return;
+  }
+  t->csr[t->numCSRs] = csr;
+  t->csrVal[t->numCSRs++] = value;
+}
+
+// One retired instruction from the RVVI interface; xReg/fReg are -1 when no
+// integer/floating-point register is written
+void wtrace_rvvi(void *h, unsigned long long order, unsigned long long pc, unsigned long long pcNext,
+                 unsigned long long insn, int trap, int halt, int intr, int mode, int ixl,
+                 int xReg, unsigned long long xVal, int fReg, unsigned long long fVal) {
+  wtrace *t = h;
+  int i;
+  if (!t) return;
+  put8(t, WT_OP_RETIRE | (trap ? WT_RETIRE_TRAP : 0) | (halt ? WT_RETIRE_HALT : 0) | (intr ? WT_RETIRE_INTR : 0) |
+          (xReg >= 0 ? WT_RETIRE_X : 0) | (fReg >= 0 ? WT_RETIRE_F : 0) | (t->numCSRs ? WT_RETIRE_CSR : 0));
+  put8(t, (mode & 3) | (ixl & 3) << 2);
+  putvar(t, zigzag((int64_t)(pc - t->lastPC)));
+  putvar(t, zigzag((int64_t)(pcNext - pc)));
+  putvar(t, insn);
+  putvar(t, zigzag((int64_t)(order - t->lastOrder - 1)));
+  t->lastPC = pcNext;
+  t->lastOrder = order;
+  if (xReg >= 0) { put8(t, xReg & 31); putvar(t, xVal); }
+  if (fReg >= 0) { put8(t, fReg & 31); putvar(t, fVal); }
+  if (t->numCSRs) {
+    putvar(t, t->numCSRs);
+    for (i = 0; i < t->numCSRs; i++) {
+      putvar(t, t->csr[i]);
+      putvar(t, t->csrVal[i] ^ t->csrs[t->csr[i]]);
+      t->csrs[t->csr[i]] = t->csrVal[i];
+    }
+    t->numCSRs = 0;
+  }
+  endrecord(t);
+}
+
+void wtrace_close(void *h) {
+  wtrace *t = h, **p;
+  if (!t) return;
+  for (p = &openTraces; *p && *p != t; p = &(*p)->nextOpen);
+  if (!*p) return;   // already closed
+  *p = t->nextOpen;
+  submit(t);
+  pthread_mutex_lock(&t->lock);
+  t->done = 1;
+  pthread_cond_signal(&t->ready);
+  pthread_mutex_unlock(&t->lock);
+  pthread_join(t->thread, NULL);
+  t->cur->len = 0;
+  writeout(t, t->cur, 1);  // end the zstd frame
+  free(t->cur->data);
+  free(t->cur);
+#ifdef WALLY_TRACE_ZSTD
+  if (t->zc) { ZSTD_freeCCtx(t->zc); free(t->zbuf); }
+#endif
+  fclose(t->fp);
+  if (t->droppedCSRs)
+    fprintf(stderr, "eventlogger: %llu CSR writes were dropped from the trace\n",
+            (unsigned long long)t->droppedCSRs);
+  free(t->csrs);
+  free(t);
+}
@@ -0,0 +1,483 @@
+///////////////////////////////////////////
+// linuxtrace.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Reader and writer for the indexed Linux instruction trace described in
+//          linuxtrace.h.  The reader maps the file and decodes one chunk at a time,
+//          so opening and seeking cost the same anywhere in a multi-billion
+//          instruction trace.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "linuxtrace.h"
+#ifdef WALLY_TRACE_ZSTD
+#include <zstd.h>
+#endif
+
+#define CODEC_NONE 0
+#define CODEC_ZSTD 1
+
+static uint64_t get64(const uint8_t *p) {
+  uint64_t v = 0;
+  int i;
+  for (i = 7; i >= 0; i--) v = v << 8 | p[i];
+  return v;
+}
+
+static uint32_t get32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+static void put64(uint8_t *p, uint64_t v) { int i; for (i = 0; i < 8; i++, v >>= 8) p[i] = v; }
+static void put32(uint8_t *p, uint32_t v) { int i; for (i = 0; i < 4; i++, v >>= 8) p[i] = v; }
+
+static uint64_t zigzag(uint64_t v)   { return (v << 1) ^ -(v >> 63); }
+static uint64_t unzigzag(uint64_t v) { return (v >> 1) ^ -(v & 1); }
+
+/////////////////////////////////////////////
+// Text form
+/////////////////////////////////////////////
+
+static int isblank_(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// next blank-separated token; returns its length, 0 at end of line
+static size_t token(const char **p, const char **tok) {
+  const char *s = *p;
+  while (*s && isblank_(*s)) s++;
+  *tok = s;
+  while (*s && !isblank_(*s)) s++;
+  *p = s;
+  return s - *tok;
+}
+
+static int hexval(const char *s, size_t n, uint64_t *v) {
+  if (n == 0 || n > 16) return -1;
+  for (*v = 0; n; n--, s++) {
+    char c = *s;
+    if (c >= '0' && c <= '9') *v = *v << 4 | (c - '0');
+    else if (c >= 'a' && c <= 'f') *v = *v << 4 | (c - 'a' + 10);
+    else return -1;
+  }
+  return 0;
+}
+
+static int hexfield(const char **p, uint64_t *v) {
+  const char *t;
+  size_t n = token(p, &t);
+  return hexval(t, n, v);
+}
+
+int lt_parse(const char *line, lt_record *rec) {
+  const char *p = line, *t;
+  size_t n;
+  uint64_t v;
+  memset(rec, 0, offsetof(lt_record, csr));
+  if (hexfield(&p, &rec->pc) || hexfield(&p, &v) || v >> 32) return -1;
+  rec->instr = v;
+  if ((n = token(&p, &t)) == 0 || n >= LT_TEXT_LEN) return -1;
+  memcpy(rec->text, t, n);
+  rec->text[n] = 0;
+  while ((n = token(&p, &t)) != 0) {
+    if (n == 3 && !memcmp(t, "GPR", 3)) {
+      char *end;
+      n = token(&p, &t);
+      v = strtoul(t, &end, 10);
+      if (n == 0 || end != t + n || v > 31 || hexfield(&p, &rec->gprVal)) return -1;
+      rec->flags |= LT_GPR;
+      rec->gprAdr = v;
+    } else if (n == 4 && (!memcmp(t, "MemR", 4) || !memcmp(t, "MemW", 4))) {
+      rec->flags |= t[3] == 'R' ? LT_MEMR : LT_MEMW;
+      n = token(&p, &t);
+      if (n && *t == '-') { rec->flags |= LT_NEGADR; t++; n--; }
+      if (n == 17 && *t == '1') { rec->flags |= LT_ADRCARRY; t++; n--; }
+      if (hexval(t, n, &rec->memAdr) || hexfield(&p, &rec->memWriteData) || hexfield(&p, &rec->memReadData))
+        return -1;
+    } else if (n == 3 && !memcmp(t, "CSR", 3)) {
+      while ((n = token(&p, &t)) != 0) {
+        int i;
+        for (i = 0; i < LT_NUM_CSRS && (strlen(lt_csr_names[i]) != n || memcmp(lt_csr_names[i], t, n)); i++);
+        if (i == LT_NUM_CSRS || rec->numCSRs == LT_NUM_CSRS) return -1;
+        rec->csr[rec->numCSRs] = i;
+        if (hexfield(&p, &rec->csrVal[rec->numCSRs++])) return -1;
+      }
+    } else return -1;
+  }
+  return 0;
+}
+
+int lt_format(const lt_record *rec, char *buf, size_t size) {
+  int n, i;
+  n = snprintf(buf, size, "%llx %x %s", (unsigned long long)rec->pc, rec->instr, rec->text);
+  if (rec->flags & LT_GPR)
+    n += snprintf(buf + n, size > (size_t)n ? size - n : 0, " GPR %d %llx", rec->gprAdr, (unsigned long long)rec->gprVal);
+  if (rec->flags & (LT_MEMR | LT_MEMW))
+    n += snprintf(buf + n, size > (size_t)n ? size - n : 0, " Mem%c %s%s%0*llx %llx %llx",
+                  rec->flags & LT_MEMR ? 'R' : 'W', rec->flags & LT_NEGADR ? "-" : "",
+                  rec->flags & LT_ADRCARRY ? "1" : "", rec->flags & LT_ADRCARRY ? 16 : 1,
+                  (unsigned long long)rec->memAdr, (unsigned long long)rec->memWriteData,
+                  (unsigned long long)rec->memReadData);
+  for (i = 0; i < rec->numCSRs; i++)
+    n += snprintf(buf + n, size > (size_t)n ? size - n : 0, "%s %s %llx", i ? "" : " CSR",
+                  lt_csr_names[rec->csr[i]], (unsigned long long)rec->csrVal[i]);
+  return n;
+}
+
+/////////////////////////////////////////////
+// Reader
+/////////////////////////////////////////////
+
+struct lt_reader {
+  const uint8_t  *map, *index;
+  size_t          size;
+  int             codec;
+  uint32_t        chunkInstrs;
+  uint64_t        count, numChunks;
+  uint64_t        chunk;          // loaded chunk, or numChunks if none
+  uint64_t        next;           // instruction returned by the next lt_next
+  const uint8_t  *p, *end;        // decode position in the loaded chunk
+  uint8_t        *buf;            // decompressed chunk
+  size_t          bufCap;
+  uint64_t        lastPC;
+  const uint8_t **texts;          // texts introduced so far in the chunk
+  uint8_t        *textLen;
+  uint32_t        ntexts;
+#ifdef WALLY_TRACE_ZSTD
+  ZSTD_DCtx      *dctx;
+#endif
+};
+
+lt_reader *lt_open(const char *path) {
+  lt_reader *r;
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  const uint8_t *map;
+  if (fd < 0 || fstat(fd, &st)) { fprintf(stderr, "linuxtrace: cannot open %s\n", path); if (fd >= 0) close(fd); return NULL; }
+  map = st.st_size >= LT_HEADER_BYTES ? mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (map == MAP_FAILED || memcmp(map, LT_MAGIC, 4)) {
+    fprintf(stderr, "linuxtrace: %s is not a Linux trace\n", path);
+    if (map != MAP_FAILED) munmap((void *)map, st.st_size);
+    return NULL;
+  }
+  r = calloc(1, sizeof(*r));
+  r->map = map;
+  r->size = st.st_size;
+  r->codec = map[5];
+  r->chunkInstrs = get32(map + 8);
+  r->count = get64(map + 16);
+  r->numChunks = r->chunkInstrs ? (r->count + r->chunkInstrs - 1) / r->chunkInstrs : 0;
+  if (map[4] != LT_VERSION || !r->chunkInstrs || get64(map + 24) == 0 ||
+      get64(map + 24) + 16 * r->numChunks > r->size) {
+    fprintf(stderr, "linuxtrace: %s has an unsupported version or is incomplete\n", path);
+    lt_close(r);
+    return NULL;
+  }
+#ifdef WALLY_TRACE_ZSTD
+  if (r->codec == CODEC_ZSTD) r->dctx = ZSTD_createDCtx();
+#endif
+  if (r->codec != CODEC_NONE && r->codec != CODEC_ZSTD) {
+    fprintf(stderr, "linuxtrace: %s uses unknown codec %d\n", path, r->codec);
+    lt_close(r);
+    return NULL;
+  }
+#ifndef WALLY_TRACE_ZSTD
+  if (r->codec == CODEC_ZSTD) {
+    fprintf(stderr, "linuxtrace: %s is zstd compressed; rebuild with ZSTD=1\n", path);
+    lt_close(r);
+    return NULL;
+  }
+#endif
+  r->index = map + get64(map + 24);
+  r->texts = malloc(r->chunkInstrs * sizeof(*r->texts));
+  r->textLen = malloc(r->chunkInstrs);
+  r->chunk = r->numChunks;
+  lt_seek(r, 0);
+  return r;
+}
+
+uint64_t lt_count(const lt_reader *r) { return r->count; }
+
+static int loadChunk(lt_reader *r, uint64_t c) {
+  const uint8_t *e = r->index + 16 * c;
+  uint64_t off = get64(e);
+  uint32_t stored = get32(e + 8), raw = get32(e + 12);
+  if (off + stored > r->size) return -1;
+  if (r->codec == CODEC_NONE) {
+    if (stored != raw) return -1;
+    r->p = r->map + off;
+  } else {
+#ifdef WALLY_TRACE_ZSTD
+    if (r->bufCap < raw) r->buf = realloc(r->buf, r->bufCap = raw);
+    if (ZSTD_decompressDCtx(r->dctx, r->buf, raw, r->map + off, stored) != raw) return -1;
+    r->p = r->buf;
+#else
+    return -1;
+#endif
+  }
+  r->end = r->p + raw;
+  r->chunk = c;
+  r->lastPC = 0;
+  r->ntexts = 0;
+  return 0;
+}
+
+static int varint(lt_reader *r, uint64_t *v) {
+  int shift = 0;
+  uint8_t b;
+  *v = 0;
+  do {
+    if (r->p == r->end || shift > 63) return -1;
+    b = *r->p++;
+    *v |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  return 0;
+}
+
+static int decode(lt_reader *r, lt_record *rec) {
+  uint64_t v;
+  const uint8_t *text;
+  size_t len;
+  int i, flags;
+  if (r->p == r->end) return -1;
+  flags = *r->p++;
+  rec->flags = flags & (LT_GPR | LT_MEMR | LT_MEMW | LT_NEGADR | LT_ADRCARRY);
+  if (varint(r, &v)) return -1;
+  rec->pc = r->lastPC += unzigzag(v);
+  if (varint(r, &v)) return -1;
+  rec->instr = v;
+  if (flags & LT_NEWTEXT) {
+    if (varint(r, &v) || v >= LT_TEXT_LEN || (size_t)(r->end - r->p) < v) return -1;
+    r->texts[r->ntexts] = r->p;
+    r->textLen[r->ntexts++] = v;
+    text = r->p;
+    len = v;
+    r->p += v;
+  } else {
+    if (varint(r, &v) || v >= r->ntexts) return -1;
+    text = r->texts[v];
+    len = r->textLen[v];
+  }
+  memcpy(rec->text, text, len);
+  rec->text[len] = 0;
+  rec->gprAdr = 0;
+  rec->gprVal = rec->memAdr = rec->memWriteData = rec->memReadData = 0;
+  if (flags & LT_GPR) {
+    if (r->p == r->end) return -1;
+    rec->gprAdr = *r->p++;
+    if (varint(r, &rec->gprVal)) return -1;
+  }
+  if (flags & (LT_MEMR | LT_MEMW))
+    if (varint(r, &rec->memAdr) || varint(r, &rec->memWriteData) || varint(r, &rec->memReadData)) return -1;
+  rec->numCSRs = 0;
+  if (flags & LT_CSR) {
+    if (r->p == r->end || *r->p > LT_NUM_CSRS) return -1;
+    rec->numCSRs = *r->p++;
+    for (i = 0; i < rec->numCSRs; i++) {
+      if (r->p == r->end || *r->p >= LT_NUM_CSRS) return -1;
+      rec->csr[i] = *r->p++;
+      if (varint(r, &rec->csrVal[i])) return -1;
+    }
+  }
+  return 0;
+}
+
+int lt_seek(lt_reader *r, uint64_t n) {
+  lt_record skip;
+  uint64_t i;
+  if (n > r->count) return -1;
+  r->next = n;
+  if (n == r->count) { r->p = r->end; return 0; }
+  if (loadChunk(r, n / r->chunkInstrs)) return -1;
+  for (i = 0; i < n % r->chunkInstrs; i++)
+    if (decode(r, &skip)) return -1;
+  return 0;
+}
+
+int lt_next(lt_reader *r, lt_record *rec) {
+  if (r->next == r->count) return 0;
+  if (r->next % r->chunkInstrs == 0 && r->next / r->chunkInstrs != r->chunk)
+    if (loadChunk(r, r->next / r->chunkInstrs)) return -1;
+  if (decode(r, rec)) return -1;
+  if (++r->next % r->chunkInstrs == 0) r->chunk = r->numChunks;   // load the next chunk on demand
+  return 1;
+}
+
+void lt_close(lt_reader *r) {
+  if (!r) return;
+#ifdef WALLY_TRACE_ZSTD
+  if (r->dctx) ZSTD_freeDCtx(r->dctx);
+#endif
+  munmap((void *)r->map, r->size);
+  free(r->buf);
+  free(r->texts);
+  free(r->textLen);
+  free(r);
+}
+
+/////////////////////////////////////////////
+// Writer
+/////////////////////////////////////////////
+
+#define TEXT_SLOTS (2 * LT_CHUNK_INSTRS)
+
+typedef struct { uint32_t hash, id; char text[LT_TEXT_LEN]; } textslot;
+
+struct lt_writer {
+  FILE     *fp;
+  int       level, err;
+  uint64_t  count, offset, lastPC;
+  uint8_t  *raw, *out;
+  size_t    rawLen, rawCap, outCap;
+  uint32_t  inChunk, ntexts;
+  textslot *texts;
+  uint8_t  *index;
+  size_t    indexLen, indexCap;
+};
+
+lt_writer *lt_create(const char *path, int level) {
+  lt_writer *w;
+  uint8_t header[LT_HEADER_BYTES] = {0};
+  FILE *fp = fopen(path, "wb");
+  if (!fp) { fprintf(stderr, "linuxtrace: cannot write %s\n", path); return NULL; }
+#ifndef WALLY_TRACE_ZSTD
+  if (level > 0) fprintf(stderr, "linuxtrace: built without ZSTD=1; writing uncompressed chunks\n");
+  level = 0;
+#endif
+  w = calloc(1, sizeof(*w));
+  w->fp = fp;
+  w->level = level;
+  w->texts = calloc(TEXT_SLOTS, sizeof(textslot));
+  // the header is rewritten with the instruction count and index offset by lt_finish
+  w->err = fwrite(header, 1, LT_HEADER_BYTES, fp) != LT_HEADER_BYTES;
+  w->offset = LT_HEADER_BYTES;
+  return w;
+}
+
+static void emitByte(lt_writer *w, uint8_t b) {
+  if (w->rawLen == w->rawCap) w->raw = realloc(w->raw, w->rawCap = w->rawCap ? 2 * w->rawCap : 1 << 20);
+  w->raw[w->rawLen++] = b;
+}
+
+static void emitVarint(lt_writer *w, uint64_t v) {
+  for (; v >= 0x80; v >>= 7) emitByte(w, v | 0x80);
+  emitByte(w, v);
+}
+
+static void flushChunk(lt_writer *w) {
+  const uint8_t *data = w->raw;
+  size_t len = w->rawLen;
+  uint8_t *e;
+  if (!w->inChunk) return;
+#ifdef WALLY_TRACE_ZSTD
+  if (w->level > 0) {
+    size_t bound = ZSTD_compressBound(w->rawLen);
+    if (w->outCap < bound) w->out = realloc(w->out, w->outCap = bound);
+    len = ZSTD_compress(w->out, bound, w->raw, w->rawLen, w->level);
+    if (ZSTD_isError(len)) { w->err = 1; len = 0; }
+    data = w->out;
+  }
+#endif
+  if (fwrite(data, 1, len, w->fp) != len) w->err = 1;
+  if (w->indexLen + 16 > w->indexCap) w->index = realloc(w->index, w->indexCap = w->indexCap ? 2 * w->indexCap : 4096);
+  e = w->index + w->indexLen;
+  put64(e, w->offset);
+  put32(e + 8, len);
+  put32(e + 12, w->rawLen);
+  w->indexLen += 16;
+  w->offset += len;
+  w->rawLen = 0;
+  w->inChunk = 0;
+  w->ntexts = 0;
+  w->lastPC = 0;
+  memset(w->texts, 0, TEXT_SLOTS * sizeof(textslot));
+}
+
+int lt_write(lt_writer *w, const lt_record *rec) {
+  size_t len = strlen(rec->text);
+  uint32_t hash = 2166136261u, i;
+  textslot *s;
+  int flags = rec->flags & (LT_GPR | LT_MEMR | LT_MEMW | LT_NEGADR | LT_ADRCARRY);
+  if (len >= LT_TEXT_LEN || rec->numCSRs > LT_NUM_CSRS) return -1;
+  for (i = 0; i < len; i++) hash = (hash ^ (uint8_t)rec->text[i]) * 16777619u;
+  hash |= 1;   // 0 marks an empty slot
+  for (i = hash & (TEXT_SLOTS - 1); w->texts[i].hash; i = (i + 1) & (TEXT_SLOTS - 1))
+    if (w->texts[i].hash == hash && !strcmp(w->texts[i].text, rec->text)) break;
+  s = &w->texts[i];
+  if (!s->hash) flags |= LT_NEWTEXT;
+  if (rec->numCSRs) flags |= LT_CSR;
+  emitByte(w, flags);
+  emitVarint(w, zigzag(rec->pc - w->lastPC));
+  w->lastPC = rec->pc;
+  emitVarint(w, rec->instr);
+  if (flags & LT_NEWTEXT) {
+    s->hash = hash;
+    s->id = w->ntexts++;
+    memcpy(s->text, rec->text, len + 1);
+    emitVarint(w, len);
+    for (i = 0; i < len; i++) emitByte(w, rec->text[i]);
+  } else emitVarint(w, s->id);
+  if (flags & LT_GPR) {
+    emitByte(w, rec->gprAdr);
+    emitVarint(w, rec->gprVal);
+  }
+  if (flags & (LT_MEMR | LT_MEMW)) {
+    emitVarint(w, rec->memAdr);
+    emitVarint(w, rec->memWriteData);
+    emitVarint(w, rec->memReadData);
+  }
+  if (flags & LT_CSR) {
+    emitByte(w, rec->numCSRs);
+    for (i = 0; i < rec->numCSRs; i++) {
+      emitByte(w, rec->csr[i]);
+      emitVarint(w, rec->csrVal[i]);
+    }
+  }
+  w->count++;
+  if (++w->inChunk == LT_CHUNK_INSTRS) flushChunk(w);
+  return w->err ? -1 : 0;
+}
+
+int lt_finish(lt_writer *w) {
+  uint8_t header[LT_HEADER_BYTES] = {0};
+  int err;
+  flushChunk(w);
+  if (w->indexLen && fwrite(w->index, 1, w->indexLen, w->fp) != w->indexLen) w->err = 1;
+  memcpy(header, LT_MAGIC, 4);
+  header[4] = LT_VERSION;
+  header[5] = w->level > 0 ? CODEC_ZSTD : CODEC_NONE;
+  put32(header + 8, LT_CHUNK_INSTRS);
+  put64(header + 16, w->count);
+  put64(header + 24, w->offset);
+  if (fseek(w->fp, 0, SEEK_SET) || fwrite(header, 1, LT_HEADER_BYTES, w->fp) != LT_HEADER_BYTES) w->err = 1;
+  if (fclose(w->fp)) w->err = 1;
+  err = w->err;
+  free(w->raw);
+  free(w->out);
+  free(w->texts);
+  free(w->index);
+  free(w);
+  return err ? -1 : 0;
+}
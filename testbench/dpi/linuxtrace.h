@@ -0,0 +1,121 @@
+///////////////////////////////////////////
+// linuxtrace.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Indexed, chunk-compressed binary form of the Linux instruction trace
+//          (linux-testvectors/all.txt) with random access by instruction count.
+//          The testbench and the checkpoint scripts open one shared all.ltr and
+//          seek to any instruction without reading or copying what precedes it.
+//
+// File layout (little endian):
+//   header   "WLTR" u8 version u8 codec u16 reserved u32 chunkInstrs u32 reserved
+//            u64 numInstrs u64 indexOffset
+//   chunks   chunkInstrs records each (the last may be short), encoded as below and
+//            then compressed on their own (codec 0 none, 1 zstd)
+//   index    per chunk: u64 file offset, u32 stored size, u32 decoded size
+// Instruction n is record n % chunkInstrs of chunk n / chunkInstrs.
+//
+// Record encoding within a chunk:
+//   u8 flags (LT_GPR, LT_MEMR, LT_MEMW, LT_NEGADR, LT_ADRCARRY, LT_NEWTEXT, LT_CSR)
+//   varint(zigzag(pc - previous pc)) varint(instr)
+//   LT_NEWTEXT ? varint(length) text : varint(index of an earlier text in this chunk)
+//   LT_GPR     u8 register, varint(value)
+//   LT_MEMR/W  varint(address) varint(write data) varint(read data)
+//   LT_CSR     u8 count, then u8 CSR number and varint(value) per CSR
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LINUXTRACE_H
+#define LINUXTRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LT_MAGIC        "WLTR"
+#define LT_VERSION      1
+#define LT_HEADER_BYTES 32
+#define LT_CHUNK_INSTRS 65536
+
+// record flags
+#define LT_GPR      0x01
+#define LT_MEMR     0x02
+#define LT_MEMW     0x04
+#define LT_NEGADR   0x08   // the trace printed -memAdr (immediate below a zero base)
+#define LT_ADRCARRY 0x10   // the trace printed memAdr + 2^64 (base + immediate overflowed)
+#define LT_NEWTEXT  0x20   // encoding only
+#define LT_CSR      0x40   // encoding only
+
+#define LT_NUM_CSRS 17
+#define LT_TEXT_LEN 64
+
+// CSRs in the trace, numbered as in parseGDBtoTrace.py less 32
+static const char *const lt_csr_names[LT_NUM_CSRS] = {
+  "mhartid", "mstatus", "mip", "mie", "mideleg", "medeleg", "mtvec", "stvec", "mepc",
+  "sepc", "mcause", "scause", "mtval", "stval", "mscratch", "sscratch", "satp"
+};
+
+// one line of all.txt:
+//   pc instr text [GPR adr val] [MemR|MemW adr writedata readdata] [CSR name val ...]
+typedef struct {
+  uint64_t pc;
+  uint32_t instr;
+  uint8_t  flags;
+  uint8_t  gprAdr;
+  uint8_t  numCSRs;
+  uint64_t gprVal;
+  uint64_t memAdr, memWriteData, memReadData;
+  uint8_t  csr[LT_NUM_CSRS];      // index into lt_csr_names, in trace order
+  uint64_t csrVal[LT_NUM_CSRS];
+  char     text[LT_TEXT_LEN];     // disassembly with '_' for spaces
+} lt_record;
+
+typedef struct lt_reader lt_reader;
+typedef struct lt_writer lt_writer;
+
+// Parse one all.txt line (with or without the newline).  Returns 0, or -1 if the
+// line is malformed or cannot be represented.
+int        lt_parse(const char *line, lt_record *rec);
+// Render a record as its all.txt line, without the newline; returns the length
+int        lt_format(const lt_record *rec, char *buf, size_t size);
+
+// Map a trace and read its index.  Returns NULL and prints a message on failure.
+lt_reader *lt_open(const char *path);
+uint64_t   lt_count(const lt_reader *r);
+// Position the reader at instruction n (0 based).  Returns 0, or -1 past the end.
+int        lt_seek(lt_reader *r, uint64_t n);
+// Fetch the next record.  Returns 1 on success, 0 at end of trace, -1 if corrupt.
+int        lt_next(lt_reader *r, lt_record *rec);
+void       lt_close(lt_reader *r);
+
+// Create a trace; level > 0 compresses chunks with zstd at that level (ZSTD=1 builds)
+lt_writer *lt_create(const char *path, int level);
+int        lt_write(lt_writer *w, const lt_record *rec);
+// Write the index and header.  Returns 0, or -1 on an I/O error.
+int        lt_finish(lt_writer *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
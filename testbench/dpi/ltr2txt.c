@@ -0,0 +1,81 @@
+///////////////////////////////////////////
+// ltr2txt.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Print part of an indexed Linux trace (linuxtrace.h) as all.txt lines.
+//          Line numbers are 1 based as for sed and tail, and the start is found
+//          through the chunk index rather than by reading what precedes it.
+//          usage: ltr2txt [-s first line] [-n lines] [-p [-a after line]] [-c] <all.ltr>
+//            -p  instead print how many earlier lines have the same PC and
+//                instruction as the first line (the GDB breakpoint ignore count)
+//            -a  with -p, count only lines after this one (GDB stopped there)
+//            -c  instead print the number of lines in the trace
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "linuxtrace.h"
+
+int main(int argc, char *argv[]) {
+  lt_reader *r;
+  lt_record rec, target;
+  char line[4096];
+  unsigned long long first = 1, lines = ~0ull, after = 0, i, repeats = 0;
+  int prior = 0, count = 0, opt, status = 1;
+  while ((opt = getopt(argc, argv, "s:n:pa:c")) != -1) {
+    if (opt == 's') first = strtoull(optarg, NULL, 10);
+    else if (opt == 'n') lines = strtoull(optarg, NULL, 10);
+    else if (opt == 'p') prior = 1;
+    else if (opt == 'a') after = strtoull(optarg, NULL, 10);
+    else if (opt == 'c') count = 1;
+    else return 1;
+  }
+  if (argc - optind != 1 || first == 0 || after >= first) {
+    fprintf(stderr, "usage: ltr2txt [-s first line] [-n lines] [-p [-a after line]] [-c] <all.ltr>\n");
+    return 1;
+  }
+  if (!(r = lt_open(argv[optind]))) return 1;
+  if (count) {
+    printf("%llu\n", (unsigned long long)lt_count(r));
+    lt_close(r);
+    return 0;
+  }
+  if (lt_seek(r, first - 1)) {
+    fprintf(stderr, "ltr2txt: %s has only %llu lines\n", argv[optind], (unsigned long long)lt_count(r));
+    return 1;
+  }
+  if (prior) {
+    if (lt_next(r, &target) != 1 || lt_seek(r, after)) return 1;
+    for (i = after + 1; i < first && (status = lt_next(r, &rec)) > 0; i++)
+      repeats += rec.pc == target.pc && rec.instr == target.instr;
+    printf("%llu\n", repeats);
+  } else {
+    for (i = 0; i < lines && (status = lt_next(r, &rec)) > 0; i++) {
+      lt_format(&rec, line, sizeof(line));
+      puts(line);
+    }
+  }
+  lt_close(r);
+  if (status < 0) fprintf(stderr, "ltr2txt: corrupt chunk in %s\n", argv[optind]);
+  return status < 0;
+}
@@ -0,0 +1,299 @@
+///////////////////////////////////////////
+// mksdimg.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Build a GPT-partitioned SD card image for the SD card model, directly as
+//          a sparse binary file rather than as hex text for $readmemh.  Partition 1
+//          holds the boot image that zsbl (tests/custom/zsbl) loads and the optional
+//          partition 2 holds a root filesystem.  A boot image already packed by
+//          bin/pack-boot-image.py, with its footer in the last block, is used as it
+//          is; any other file gets a footer for an uncompressed image, so that zsbl
+//          copies only the image and checks its CRC.  Simulate with the result as
+//          +SDIMAGE=card.img (see sdimage.c).
+//          usage: mksdimg [-b bootsize] [-r rootsize] [-s cardsize] <boot.img> [rootfs.img] <card.img>
+//          Sizes are in bytes or with K, M or G; partitions default to the size of
+//          their file and the card to just hold them.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLOCK         512ULL
+#define ALIGN         2048ULL                // partitions start on 1 MiB boundaries
+#define ENTRIES       128
+#define ENTRY_BYTES   128
+#define ENTRY_BLOCKS  (ENTRIES * ENTRY_BYTES / BLOCK)
+#define HEADER_BYTES  92
+#define GPT_SIGNATURE 0x5452415020494645ULL  // "EFI PART", as in tests/custom/zsbl/gpt.h
+
+// boot_footer_t in tests/custom/zsbl/gpt.h
+#define FOOTER_MAGIC      0x474D49594C4C4157ULL // "WALLYIMG"
+#define FOOTER_CRC_OFFSET 36
+#define FORMAT_RAW        0
+
+// Partition types as sgdisk names them: HiFive BBL (which OpenSBI payloads reuse)
+// and Linux filesystem
+static const char *bootType = "2E54B353-1271-4842-806F-E436D6AF6985";
+static const char *rootType = "0FC63DAF-8483-4772-8E79-3D69D8477DE4";
+
+typedef struct {
+  const char *path, *name, *type;
+  const uint8_t *data;
+  uint64_t bytes;                 // of data
+  uint64_t first, blocks;         // partition
+  uint8_t footer[BLOCK];          // appended to the boot image when it has none
+  int addFooter;
+} partition;
+
+static uint32_t crcTable[256];
+
+static uint32_t crc32(const void *buf, uint64_t len) {
+  const uint8_t *p = buf;
+  uint32_t crc = 0xFFFFFFFF;
+  while (len--) crc = crcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFF;
+}
+
+static void crcInit(void) {
+  uint32_t i, j, c;
+  for (i = 0; i < 256; i++) {
+    for (c = i, j = 0; j < 8; j++) c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    crcTable[i] = c;
+  }
+}
+
+static void put16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void put32(uint8_t *p, uint32_t v) { put16(p, v); put16(p + 2, v >> 16); }
+static void put64(uint8_t *p, uint64_t v) { put32(p, v); put32(p + 4, v >> 32); }
+static uint64_t get64(const uint8_t *p) {
+  uint64_t v = 0;
+  int i;
+  for (i = 7; i >= 0; i--) v = v << 8 | p[i];
+  return v;
+}
+
+// GUIDs are stored with their first three fields little-endian
+static void putGuid(uint8_t *p, const char *s) {
+  static const int pos[16] = {3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15};
+  int i;
+  for (i = 0; i < 16; i++, s += 2) {
+    if (*s == '-') s++;
+    p[pos[i]] = strtoul((char[3]){s[0], s[1], 0}, NULL, 16);
+  }
+}
+
+// Unique GUIDs are derived from the name and size so that an image is reproducible
+static void uniqueGuid(uint8_t *p, const char *name, uint64_t blocks) {
+  uint32_t seed[2] = {crc32(name, strlen(name)), (uint32_t)blocks};
+  int i;
+  for (i = 0; i < 4; i++) {
+    seed[1] = crc32(seed, sizeof(seed));
+    put32(p + 4 * i, seed[1]);
+  }
+  p[7] = (p[7] & 0x0F) | 0x40;    // version 4
+  p[8] = (p[8] & 0x3F) | 0x80;    // variant 1
+}
+
+static uint64_t parseSize(const char *s) {
+  char *end;
+  uint64_t v = strtoull(s, &end, 0);
+  switch (*end) {
+    case 'k': case 'K': return v << 10;
+    case 'm': case 'M': return v << 20;
+    case 'g': case 'G': return v << 30;
+    case 0: return v;
+  }
+  fprintf(stderr, "mksdimg: bad size %s\n", s);
+  exit(1);
+}
+
+static const uint8_t *mapFile(const char *path, uint64_t *size) {
+  struct stat st;
+  const uint8_t *map;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st)) { fprintf(stderr, "mksdimg: cannot open %s\n", path); exit(1); }
+  *size = st.st_size;
+  map = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+  close(fd);
+  if (map == MAP_FAILED) { fprintf(stderr, "mksdimg: cannot map %s\n", path); exit(1); }
+  return map;
+}
+
+static uint64_t roundUp(uint64_t v, uint64_t to) { return (v + to - 1) / to * to; }
+
+// A footer for the uncompressed image, unless the last block already holds one.
+// Returns the blocks the partition needs.
+static uint64_t bootFooter(partition *p) {
+  uint8_t *f = p->footer;
+  if (p->bytes >= BLOCK && p->bytes % BLOCK == 0 && get64(p->data + p->bytes - BLOCK) == FOOTER_MAGIC)
+    return p->bytes / BLOCK;
+  put64(f, FOOTER_MAGIC);
+  put64(f + 8, p->bytes);
+  put32(f + 16, crc32(p->data, p->bytes));
+  put32(f + 20, FORMAT_RAW);
+  put64(f + 24, p->bytes);
+  put32(f + FOOTER_CRC_OFFSET, crc32(f, FOOTER_CRC_OFFSET));
+  p->addFooter = 1;
+  return roundUp(p->bytes, BLOCK) / BLOCK + 1;
+}
+
+static void writeAt(int fd, const void *buf, uint64_t len, uint64_t offset, const char *path) {
+  if (pwrite(fd, buf, len, offset) != (ssize_t)len) {
+    fprintf(stderr, "mksdimg: error writing %s\n", path);
+    exit(1);
+  }
+}
+
+// Copy data, skipping runs of zero so that the image stays sparse
+static void writeSparse(int fd, const uint8_t *data, uint64_t len, uint64_t offset, const char *path) {
+  static const uint8_t zero[1 << 16];
+  uint64_t pos, n;
+  for (pos = 0; pos < len; pos += n) {
+    n = len - pos < sizeof(zero) ? len - pos : sizeof(zero);
+    if (memcmp(data + pos, zero, n)) writeAt(fd, data + pos, n, offset + pos, path);
+  }
+}
+
+static void writeHeader(int fd, uint64_t lba, uint64_t backup, uint64_t entriesLba, uint64_t lastUsable,
+                        const uint8_t *diskGuid, uint32_t entriesCrc, const char *path) {
+  uint8_t h[BLOCK] = {0};
+  put64(h, GPT_SIGNATURE);
+  put32(h + 8, 0x00010000);       // revision 1.0
+  put32(h + 12, HEADER_BYTES);
+  put64(h + 24, lba);
+  put64(h + 32, backup);
+  put64(h + 40, 2 + ENTRY_BLOCKS);
+  put64(h + 48, lastUsable);
+  memcpy(h + 56, diskGuid, 16);
+  put64(h + 72, entriesLba);
+  put32(h + 80, ENTRIES);
+  put32(h + 84, ENTRY_BYTES);
+  put32(h + 88, entriesCrc);
+  put32(h + 16, crc32(h, HEADER_BYTES));
+  writeAt(fd, h, BLOCK, lba * BLOCK, path);
+}
+
+int main(int argc, char *argv[]) {
+  partition part[2] = {{.name = "boot", .type = bootType}, {.name = "rootfs", .type = rootType}};
+  uint64_t bootSize = 0, rootSize = 0, cardSize = 0, cardBlocks, lastUsable, next;
+  uint8_t mbr[BLOCK] = {0}, entries[ENTRIES * ENTRY_BYTES] = {0}, diskGuid[16];
+  uint32_t entriesCrc;
+  const char *out;
+  int opt, parts, fd, i, j;
+
+  while ((opt = getopt(argc, argv, "b:r:s:")) != -1) {
+    if (opt == 'b') bootSize = parseSize(optarg);
+    else if (opt == 'r') rootSize = parseSize(optarg);
+    else if (opt == 's') cardSize = parseSize(optarg);
+    else return 1;
+  }
+  parts = argc - optind - 1;
+  if (parts != 1 && parts != 2) {
+    fprintf(stderr, "Expected 2 or 3 arguments: <boot.img> [rootfs.img] <card.img>\n");
+    return 1;
+  }
+  crcInit();
+  out = argv[argc - 1];
+
+  // lay the partitions out one after another
+  next = ALIGN;
+  for (i = 0; i < parts; i++) {
+    partition *p = &part[i];
+    uint64_t want = i ? rootSize : bootSize, need;
+    p->path = argv[optind + i];
+    p->data = mapFile(p->path, &p->bytes);
+    need = i ? roundUp(p->bytes, BLOCK) / BLOCK : bootFooter(p);
+    if (!i && !p->addFooter && want && want != need * BLOCK) {
+      fprintf(stderr, "mksdimg: %s is already packed; pack it with pack-boot-image.py -size instead\n", p->path);
+      return 1;
+    }
+    if (want % BLOCK || (want && want / BLOCK < need)) {
+      fprintf(stderr, "mksdimg: %s needs %llu blocks, more than the partition size given\n",
+              p->path, (unsigned long long)need);
+      return 1;
+    }
+    p->first = next;
+    p->blocks = want ? want / BLOCK : need;
+    if (p->blocks == 0) p->blocks = 1;
+    next = roundUp(p->first + p->blocks, ALIGN);
+  }
+
+  // the backup entries and header follow the last partition
+  cardBlocks = roundUp(part[parts - 1].first + part[parts - 1].blocks + ENTRY_BLOCKS + 1, ALIGN);
+  if (cardSize) {
+    if (cardSize % BLOCK || cardSize / BLOCK < cardBlocks) {
+      fprintf(stderr, "mksdimg: the partitions need a card of %llu bytes\n", (unsigned long long)(cardBlocks * BLOCK));
+      return 1;
+    }
+    cardBlocks = cardSize / BLOCK;
+  }
+  lastUsable = cardBlocks - ENTRY_BLOCKS - 2;
+
+  fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, cardBlocks * BLOCK)) {
+    fprintf(stderr, "mksdimg: cannot create %s\n", out);
+    return 1;
+  }
+
+  // protective MBR: one partition of type 0xEE covering the disk from LBA 1
+  mbr[446 + 4] = 0xEE;
+  put32(mbr + 446 + 8, 1);
+  put32(mbr + 446 + 12, cardBlocks - 1 > 0xFFFFFFFF ? 0xFFFFFFFF : cardBlocks - 1);
+  mbr[510] = 0x55;
+  mbr[511] = 0xAA;
+  writeAt(fd, mbr, BLOCK, 0, out);
+
+  uniqueGuid(diskGuid, out, cardBlocks);
+  for (i = 0; i < parts; i++) {
+    partition *p = &part[i];
+    uint8_t *e = entries + i * ENTRY_BYTES;
+    putGuid(e, p->type);
+    uniqueGuid(e + 16, p->name, p->blocks);
+    put64(e + 32, p->first);
+    put64(e + 40, p->first + p->blocks - 1);
+    for (j = 0; p->name[j]; j++) put16(e + 56 + 2 * j, p->name[j]);
+    writeSparse(fd, p->data, p->bytes, p->first * BLOCK, out);
+    if (p->addFooter) writeAt(fd, p->footer, BLOCK, (p->first + p->blocks - 1) * BLOCK, out);
+  }
+  entriesCrc = crc32(entries, sizeof(entries));
+  writeAt(fd, entries, sizeof(entries), 2 * BLOCK, out);
+  writeAt(fd, entries, sizeof(entries), (lastUsable + 1) * BLOCK, out);
+  writeHeader(fd, 1, cardBlocks - 1, 2, lastUsable, diskGuid, entriesCrc, out);
+  writeHeader(fd, cardBlocks - 1, 1, lastUsable + 1, lastUsable, diskGuid, entriesCrc, out);
+  if (close(fd)) {
+    fprintf(stderr, "mksdimg: error writing %s\n", out);
+    return 1;
+  }
+
+  for (i = 0; i < parts; i++)
+    printf("%s: partition %d %s at LBA %llu, %llu blocks, from %s%s\n", out, i + 1, part[i].name,
+           (unsigned long long)part[i].first, (unsigned long long)part[i].blocks, part[i].path,
+           part[i].addFooter ? " with a raw image footer" : "");
+  printf("%s: %llu blocks (%llu MiB)\n", out, (unsigned long long)cardBlocks,
+         (unsigned long long)(cardBlocks * BLOCK >> 20));
+  return 0;
+}
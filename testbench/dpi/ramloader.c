@@ -0,0 +1,122 @@
+///////////////////////////////////////////
+// ramloader.c
+//
+// Written: Wally team 2023
+//
+// Purpose: DPI-C loader for sparse RAM checkpoints (rampages.h).  testbench-linux.sv
+//          passes the RAM model's memory array; pages are expanded and written into it
+//          by several threads at once, reading from disk only the stored pages and
+//          the base image pages the checkpoint refers to.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "svdpi.h"
+#include "rampages.h"
+
+#define MAX_THREADS 16
+#define WORDS_PER_PAGE (RP_PAGE_BYTES / 8)
+
+typedef struct {
+  const rp_image *img;
+  svLogicVecVal  *mem;        // contiguous 64-bit elements, two svLogicVecVal each
+  uint64_t        words;      // elements in mem
+  uint64_t        first, last; // pages
+  uint64_t        loaded;
+} loadJob;
+
+// a big-endian ram.bin word into the 4-state element of a logic [63:0] array
+static void putWord(svLogicVecVal *e, const uint8_t *p) {
+  uint64_t v = 0;
+  int i;
+  for (i = 0; i < 8; i++) v = v << 8 | p[i];
+  e[0].aval = (uint32_t)v;
+  e[0].bval = 0;
+  e[1].aval = v >> 32;
+  e[1].bval = 0;
+}
+
+static uint64_t fillPage(const rp_image *img, uint64_t n, uint64_t words, svLogicVecVal *(*elem)(void *, uint64_t), void *arg) {
+  uint8_t page[RP_PAGE_BYTES];
+  uint64_t w, base = n * WORDS_PER_PAGE;
+  uint32_t e = n < rp_num_pages(img) ? rp_page(img, n, page) : RP_ZERO;
+  if (e == RP_ZERO) memset(page, 0, sizeof(page));
+  for (w = 0; w < WORDS_PER_PAGE && base + w < words; w++) putWord(elem(arg, base + w), page + 8 * w);
+  return e != RP_ZERO;
+}
+
+static svLogicVecVal *contiguousElem(void *arg, uint64_t w) { return (svLogicVecVal *)arg + 2 * w; }
+
+static void *loadPages(void *arg) {
+  loadJob *j = arg;
+  uint64_t n;
+  for (n = j->first; n < j->last; n++) j->loaded += fillPage(j->img, n, j->words, contiguousElem, j->mem);
+  return NULL;
+}
+
+typedef struct {
+  const svOpenArrayHandle h;
+  int lo;
+} arrayRef;
+
+static svLogicVecVal *handleElem(void *arg, uint64_t w) {
+  arrayRef *a = arg;
+  return svGetArrElemPtr1(a->h, a->lo + (int)w);
+}
+
+// Load checkpoint path (made against base image basePath) into mem, a logic [63:0]
+// array indexed by word address.  Words past the checkpoint are zeroed.  Returns the
+// number of non-zero pages, or -1 if the checkpoint cannot be read.
+int ramcheckpoint_load(const char *path, const char *basePath, const svOpenArrayHandle mem) {
+  rp_image *img = rp_open(path, basePath);
+  int lo = svLow(mem, 1), hi = svHigh(mem, 1), t, threads;
+  uint64_t words = (uint64_t)(hi - lo) + 1, pages = (words + WORDS_PER_PAGE - 1) / WORDS_PER_PAGE, loaded = 0, n;
+  svLogicVecVal *first, *second, *end;
+  if (!img) return -1;
+  if (rp_mem_bytes(img) > words * 8)
+    fprintf(stderr, "ramloader: %s is larger than the RAM; truncating\n", path);
+  first = svGetArrElemPtr1(mem, lo);
+  second = words > 1 ? svGetArrElemPtr1(mem, lo + 1) : first + 2;
+  end = svGetArrElemPtr1(mem, hi);
+  if (first && second == first + 2 && end == first + 2 * (words - 1)) {
+    // the simulator lays the array out flat, so threads can write it directly
+    loadJob jobs[MAX_THREADS];
+    pthread_t tid[MAX_THREADS];
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads < 1 || (uint64_t)threads > pages) threads = 1;
+    for (t = 0; t < threads; t++) {
+      jobs[t] = (loadJob){img, first, words, pages * t / threads, pages * (t + 1) / threads, 0};
+      pthread_create(&tid[t], NULL, loadPages, &jobs[t]);
+    }
+    for (t = 0; t < threads; t++) {
+      pthread_join(tid[t], NULL);
+      loaded += jobs[t].loaded;
+    }
+  } else {
+    arrayRef a = {mem, lo};
+    for (n = 0; n < pages; n++) loaded += fillPage(img, n, words, handleElem, &a);
+  }
+  rp_close(img);
+  return loaded;
+}
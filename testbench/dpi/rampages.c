@@ -0,0 +1,260 @@
+///////////////////////////////////////////
+// rampages.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Reader and writer for the sparse RAM checkpoint described in rampages.h.
+//          Both the checkpoint and its base image are mapped, so only the pages a
+//          checkpoint actually refers to are ever read from disk.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "rampages.h"
+
+struct rp_image {
+  const uint8_t  *map, *base;
+  size_t          size, baseSize;
+  uint64_t        memBytes, numPages;
+  uint32_t        numStored;
+  const uint8_t  *entries, *pages;
+};
+
+static uint64_t get64(const uint8_t *p) {
+  uint64_t v = 0;
+  int i;
+  for (i = 7; i >= 0; i--) v = v << 8 | p[i];
+  return v;
+}
+
+static uint32_t get32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+static void put64(uint8_t *p, uint64_t v) { int i; for (i = 0; i < 8; i++, v >>= 8) p[i] = v; }
+static void put32(uint8_t *p, uint32_t v) { int i; for (i = 0; i < 4; i++, v >>= 8) p[i] = v; }
+
+static uint64_t mix(uint64_t h) {
+  h ^= h >> 31;
+  h *= 0x9e3779b97f4a7c15ull;
+  return h ^ h >> 29;
+}
+
+// page n of an image of the given size, zero padded past its end
+static const uint8_t *pageOf(const uint8_t *mem, size_t bytes, uint64_t n, uint8_t *pad) {
+  size_t off = n * RP_PAGE_BYTES;
+  if (off + RP_PAGE_BYTES <= bytes) return mem + off;
+  memset(pad, 0, RP_PAGE_BYTES);
+  if (off < bytes) memcpy(pad, mem + off, bytes - off);
+  return pad;
+}
+
+static uint64_t pageHash(const uint8_t *p) {
+  uint64_t h = 0, w;
+  size_t i;
+  for (i = 0; i < RP_PAGE_BYTES; i += 8) {
+    memcpy(&w, p + i, 8);
+    h = (h ^ w) * 0xff51afd7ed558ccdull + i;
+  }
+  return mix(h);
+}
+
+static int isZero(const uint8_t *p) {
+  uint64_t acc = 0, w;
+  size_t i;
+  for (i = 0; i < RP_PAGE_BYTES; i += 8) { memcpy(&w, p + i, 8); acc |= w; }
+  return acc == 0;
+}
+
+static uint64_t pagesIn(size_t bytes) { return (bytes + RP_PAGE_BYTES - 1) / RP_PAGE_BYTES; }
+
+uint64_t rp_image_hash(const uint8_t *mem, size_t bytes) {
+  uint8_t pad[RP_PAGE_BYTES];
+  uint64_t h = mix(bytes), n;
+  for (n = 0; n < pagesIn(bytes); n++) h = mix(h ^ pageHash(pageOf(mem, bytes, n, pad)));
+  return h ? h : 1;
+}
+
+/////////////////////////////////////////////
+// Reader
+/////////////////////////////////////////////
+
+static const uint8_t *mapFile(const char *path, size_t *size) {
+  struct stat st;
+  const uint8_t *map;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st)) { if (fd >= 0) close(fd); return NULL; }
+  *size = st.st_size;
+  map = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  return map == MAP_FAILED ? NULL : map;
+}
+
+rp_image *rp_open(const char *path, const char *basePath) {
+  rp_image *img = calloc(1, sizeof(*img));
+  uint64_t n, baseHash, mapEnd;
+  int needBase = 0;
+  if (!(img->map = mapFile(path, &img->size))) {
+    fprintf(stderr, "rampages: cannot open %s\n", path);
+    free(img);
+    return NULL;
+  }
+  if (img->size < RP_HEADER_BYTES || memcmp(img->map, RP_MAGIC, 4) || img->map[4] != RP_VERSION ||
+      get32(img->map + 8) != RP_PAGE_BYTES) {
+    fprintf(stderr, "rampages: %s is not a version %d RAM checkpoint\n", path, RP_VERSION);
+    rp_close(img);
+    return NULL;
+  }
+  img->numStored = get32(img->map + 12);
+  img->memBytes = get64(img->map + 16);
+  img->numPages = pagesIn(img->memBytes);
+  baseHash = get64(img->map + 24);
+  img->entries = img->map + RP_HEADER_BYTES;
+  mapEnd = RP_HEADER_BYTES + 4 * img->numPages;
+  img->pages = img->map + pagesIn(mapEnd) * RP_PAGE_BYTES;
+  if (pagesIn(mapEnd) * RP_PAGE_BYTES + (uint64_t)img->numStored * RP_PAGE_BYTES > img->size) {
+    fprintf(stderr, "rampages: %s is incomplete\n", path);
+    rp_close(img);
+    return NULL;
+  }
+  for (n = 0; n < img->numPages; n++) {
+    uint32_t e = get32(img->entries + 4 * n);
+    if (e & RP_BASE) needBase = 1;
+    else if (e > img->numStored) {
+      fprintf(stderr, "rampages: %s is corrupt at page %llu\n", path, (unsigned long long)n);
+      rp_close(img);
+      return NULL;
+    }
+  }
+  if (!needBase) return img;
+  if (!basePath || !(img->base = mapFile(basePath, &img->baseSize))) {
+    fprintf(stderr, "rampages: %s needs its base image %s\n", path, basePath ? basePath : "");
+    rp_close(img);
+    return NULL;
+  }
+  if (rp_image_hash(img->base, img->baseSize) != baseHash) {
+    fprintf(stderr, "rampages: %s has changed since %s was made from it\n", basePath, path);
+    rp_close(img);
+    return NULL;
+  }
+  return img;
+}
+
+uint64_t rp_mem_bytes(const rp_image *img) { return img->memBytes; }
+uint64_t rp_num_pages(const rp_image *img) { return img->numPages; }
+
+uint32_t rp_page(const rp_image *img, uint64_t n, uint8_t *buf) {
+  uint32_t e = get32(img->entries + 4 * n);
+  const uint8_t *src;
+  if (e == RP_ZERO) memset(buf, 0, RP_PAGE_BYTES);
+  else {
+    src = (e & RP_BASE) ? pageOf(img->base, img->baseSize, e & ~RP_BASE, buf)
+                        : img->pages + (uint64_t)(e - 1) * RP_PAGE_BYTES;
+    if (src != buf) memcpy(buf, src, RP_PAGE_BYTES);
+  }
+  return e;
+}
+
+void rp_close(rp_image *img) {
+  if (!img) return;
+  if (img->map) munmap((void *)img->map, img->size);
+  if (img->base) munmap((void *)img->base, img->baseSize);
+  free(img);
+}
+
+/////////////////////////////////////////////
+// Writer
+/////////////////////////////////////////////
+
+typedef struct {
+  uint64_t       hash;
+  uint32_t       entry;
+  const uint8_t *page;
+} slot;
+
+typedef struct {
+  slot    *slots;
+  uint64_t mask;
+} table;
+
+static uint32_t lookup(const table *t, uint64_t hash, const uint8_t *page) {
+  uint64_t i;
+  for (i = hash & t->mask; t->slots[i].page; i = (i + 1) & t->mask)
+    if (t->slots[i].hash == hash && !memcmp(t->slots[i].page, page, RP_PAGE_BYTES)) return t->slots[i].entry;
+  return RP_ZERO;
+}
+
+static void insert(table *t, uint64_t hash, const uint8_t *page, uint32_t entry) {
+  uint64_t i;
+  for (i = hash & t->mask; t->slots[i].page; i = (i + 1) & t->mask);
+  t->slots[i].hash = hash;
+  t->slots[i].page = page;
+  t->slots[i].entry = entry;
+}
+
+int rp_write(const char *path, const uint8_t *mem, size_t bytes, const uint8_t *base, size_t baseBytes) {
+  uint64_t numPages = pagesIn(bytes), baseNumPages = base ? pagesIn(baseBytes) : 0, n, h;
+  uint64_t mapBytes = pagesIn(RP_HEADER_BYTES + 4 * numPages) * RP_PAGE_BYTES;
+  uint8_t *head = calloc(1, mapBytes), *copies;
+  uint32_t numStored = 0, e;
+  int usesBase = 0, err = 0;
+  table t;
+  FILE *f;
+  if (numPages >= RP_BASE || baseNumPages >= RP_BASE) { free(head); return -1; }
+  // pages are remembered by pointer, so padded final pages are kept in copies
+  copies = calloc(2, RP_PAGE_BYTES);
+  for (t.mask = 1; t.mask < 2 * (numPages + baseNumPages); t.mask <<= 1);
+  t.slots = calloc(t.mask, sizeof(slot));
+  t.mask--;
+  for (n = 0; n < baseNumPages; n++) {
+    const uint8_t *p = pageOf(base, baseBytes, n, copies);
+    if (isZero(p) || lookup(&t, h = pageHash(p), p)) continue;
+    insert(&t, h, p, RP_BASE | n);
+  }
+  if (!(f = fopen(path, "wb"))) { free(head); free(copies); free(t.slots); return -1; }
+  fseek(f, mapBytes, SEEK_SET);
+  for (n = 0; n < numPages; n++) {
+    const uint8_t *p = pageOf(mem, bytes, n, copies + RP_PAGE_BYTES);
+    if (isZero(p)) e = RP_ZERO;
+    else if (!(e = lookup(&t, h = pageHash(p), p))) {
+      e = ++numStored;
+      insert(&t, h, p, e);
+      err |= fwrite(p, RP_PAGE_BYTES, 1, f) != 1;
+    }
+    if (e & RP_BASE) usesBase = 1;
+    put32(head + RP_HEADER_BYTES + 4 * n, e);
+  }
+  memcpy(head, RP_MAGIC, 4);
+  head[4] = RP_VERSION;
+  put32(head + 8, RP_PAGE_BYTES);
+  put32(head + 12, numStored);
+  put64(head + 16, bytes);
+  put64(head + 24, usesBase ? rp_image_hash(base, baseBytes) : 0);
+  rewind(f);
+  err |= fwrite(head, mapBytes, 1, f) != 1;
+  err |= fclose(f) != 0;
+  free(head);
+  free(copies);
+  free(t.slots);
+  return err ? -1 : 0;
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////
+// rampages.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Sparse, page-granular RAM checkpoint (linux-testvectors/checkpointN/ram.rpg).
+//          Only pages that are non-zero are stored, and a page whose contents match
+//          any page of the base image (linux-testvectors/ram.bin) is stored as a
+//          reference to it, found by content hash.  testbench-linux.sv loads it
+//          through ramloader.c instead of reading a full-size ram.bin.
+//
+// File layout (little endian):
+//   header   "WRPG" u8 version u8 reserved u16 reserved u32 pageBytes u32 numStored
+//            u64 memBytes u64 baseHash
+//   map      u32 per page of memBytes: RP_ZERO, RP_BASE | base page, or stored page + 1
+//   pages    numStored pages of pageBytes, starting at the next pageBytes boundary
+// Page contents use the ram.bin layout (big-endian 64-bit words, as $fread expects).
+// baseHash is rp_image_hash() of the base image; 0 if no page refers to it.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RAMPAGES_H
+#define RAMPAGES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RP_MAGIC        "WRPG"
+#define RP_VERSION      1
+#define RP_HEADER_BYTES 32
+#define RP_PAGE_BYTES   4096
+
+#define RP_ZERO 0x00000000u
+#define RP_BASE 0x80000000u
+
+typedef struct rp_image rp_image;
+
+// Map a checkpoint and, if any page refers to it, the base image it was made
+// against.  Returns NULL and prints a message if either is missing or the base
+// image has changed since.
+rp_image *rp_open(const char *path, const char *basePath);
+uint64_t  rp_mem_bytes(const rp_image *img);
+uint64_t  rp_num_pages(const rp_image *img);
+// Copy page n in the ram.bin layout into buf (RP_PAGE_BYTES); returns its map entry
+uint32_t  rp_page(const rp_image *img, uint64_t n, uint8_t *buf);
+void      rp_close(rp_image *img);
+
+// Content hash of a ram.bin-style image, page by page
+uint64_t  rp_image_hash(const uint8_t *mem, size_t bytes);
+
+// Pack the image mem (ram.bin layout) into path, deduplicating against base
+// (NULL for none).  Returns 0, or -1 on an I/O error.
+int       rp_write(const char *path, const uint8_t *mem, size_t bytes, const uint8_t *base, size_t baseBytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+///////////////////////////////////////////
+// rpg2bin.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Expand a sparse RAM checkpoint (rampages.h) back into a full ram.bin,
+//          for tools that still read the flat image.  Zero pages are left as holes.
+//          usage: rpg2bin [-b base ram.bin] <ram.rpg> <ram.bin>
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "rampages.h"
+
+int main(int argc, char *argv[]) {
+  const char *basePath = NULL;
+  uint8_t page[RP_PAGE_BYTES];
+  uint64_t n, bytes;
+  rp_image *img;
+  int opt, fd, err = 0;
+  while ((opt = getopt(argc, argv, "b:")) != -1) {
+    if (opt == 'b') basePath = optarg;
+    else return 1;
+  }
+  if (argc - optind != 2) {
+    fprintf(stderr, "Expected 2 arguments: <ram.rpg> <ram.bin>\n");
+    return 1;
+  }
+  if (!(img = rp_open(argv[optind], basePath))) return 1;
+  bytes = rp_mem_bytes(img);
+  if ((fd = open(argv[optind + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0 || ftruncate(fd, bytes)) {
+    fprintf(stderr, "rpg2bin: cannot write %s\n", argv[optind + 1]);
+    return 1;
+  }
+  for (n = 0; n < rp_num_pages(img); n++) {
+    uint64_t off = n * RP_PAGE_BYTES, len = bytes - off < RP_PAGE_BYTES ? bytes - off : RP_PAGE_BYTES;
+    if (rp_page(img, n, page) != RP_ZERO) err |= pwrite(fd, page, len, off) != (ssize_t)len;
+  }
+  err |= close(fd) != 0;
+  rp_close(img);
+  if (err) fprintf(stderr, "rpg2bin: error writing %s\n", argv[optind + 1]);
+  return err;
+}
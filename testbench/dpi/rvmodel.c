@@ -0,0 +1,879 @@
+///////////////////////////////////////////
+// rvmodel.c
+//
+// Written: Wally team 2023
+//
+// Purpose: RV64GC instruction set model for the lockstep comparator (see rvmodel.h).
+//          Written for clarity rather than speed: one instruction per call, no
+//          decode cache and no TLB, so every access walks the page table.  Floating
+//          point uses SoftFloat with RISC-V NaN and conversion rules applied on top.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#include "softfloat.h"
+#include "rvmodel.h"
+
+// exception causes
+#define INSTR_ACCESS 1
+#define ILLEGAL      2
+#define BREAKPOINT   3
+#define LOAD_ALIGN   4
+#define LOAD_ACCESS  5
+#define STORE_ALIGN  6
+#define STORE_ACCESS 7
+#define ECALL_U      8
+#define INSTR_PAGE   12
+#define LOAD_PAGE    13
+#define STORE_PAGE   15
+
+enum { FETCH, LOAD, STORE };
+
+// mstatus fields
+#define ST_SIE  (1ull << 1)
+#define ST_MIE  (1ull << 3)
+#define ST_SPIE (1ull << 5)
+#define ST_MPIE (1ull << 7)
+#define ST_SPP  (1ull << 8)
+#define ST_MPP  (3ull << 11)
+#define ST_FS   (3ull << 13)
+#define ST_MPRV (1ull << 17)
+#define ST_SUM  (1ull << 18)
+#define ST_MXR  (1ull << 19)
+#define ST_TVM  (1ull << 20)
+#define ST_TW   (1ull << 21)
+#define ST_TSR  (1ull << 22)
+#define ST_XL   0xA00000000ull          // SXL = UXL = 64 bits
+#define MSTATUS_WMASK 0x30007E79EAull   // also MBE, SBE, UBE as Wally implements them
+#define SSTATUS_RMASK 0x80000003000DE162ull
+#define SSTATUS_WMASK 0xC6162ull
+
+// page table entry bits
+#define PTE_V 0x01
+#define PTE_R 0x02
+#define PTE_W 0x04
+#define PTE_X 0x08
+#define PTE_U 0x10
+#define PTE_A 0x40
+#define PTE_D 0x80
+
+#define PPN_MASK ((1ull << 44) - 1)
+
+static void trapNow(rvm_hart *h, uint64_t cause, uint64_t tval) {
+  h->cause = cause;
+  h->tval = tval;
+  longjmp(h->env, 1);
+}
+
+static void illegal(rvm_hart *h) { trapNow(h, ILLEGAL, h->insn); }
+
+static int64_t sext32(uint64_t v) { return (int32_t)v; }
+
+/////////////////////////////////////////////
+// CSRs
+/////////////////////////////////////////////
+
+// note a CSR write, along with the views that change with it
+static void note(rvm_hart *h, int csr) {
+  int i;
+  for (i = 0; i < h->numWrites; i++) if (h->writes[i] == csr) break;
+  if (i == h->numWrites && i < RVM_MAX_WRITES) h->writes[h->numWrites++] = csr;
+  switch (csr) {
+    case RVM_MSTATUS: note(h, RVM_SSTATUS); break;
+    case RVM_MIE:     note(h, RVM_SIE);     break;
+    case RVM_FCSR:    note(h, RVM_FFLAGS);  note(h, RVM_FRM); break;
+  }
+}
+
+static void setMstatus(rvm_hart *h, uint64_t v) {
+  h->csr[RVM_MSTATUS] = (v & MSTATUS_WMASK) | ST_XL;
+  note(h, RVM_MSTATUS);
+}
+
+static void dirtyFP(rvm_hart *h) {
+  if ((h->csr[RVM_MSTATUS] & ST_FS) != ST_FS) setMstatus(h, h->csr[RVM_MSTATUS] | ST_FS);
+}
+
+static void setFcsr(rvm_hart *h, uint64_t v) {
+  h->csr[RVM_FCSR] = v & 0xff;
+  note(h, RVM_FCSR);
+  dirtyFP(h);
+}
+
+static int implemented(const rvm_hart *h, int csr) {
+  switch (csr) {
+    case RVM_FFLAGS: case RVM_FRM: case RVM_FCSR:
+    case RVM_SSTATUS: case RVM_SIE: case RVM_STVEC: case RVM_SCOUNTEREN:
+    case RVM_SSCRATCH: case RVM_SEPC: case RVM_SCAUSE: case RVM_STVAL: case RVM_SIP: case RVM_SATP:
+    case RVM_MSTATUS: case RVM_MISA: case RVM_MEDELEG: case RVM_MIDELEG: case RVM_MIE: case RVM_MTVEC:
+    case RVM_MCOUNTEREN: case RVM_MCOUNTINHIBIT:
+    case RVM_MSCRATCH: case RVM_MEPC: case RVM_MCAUSE: case RVM_MTVAL: case RVM_MIP: case RVM_MTINST:
+    case 0xF11: case 0xF12: case 0xF13: case 0xF14: case 0xF15:
+      return 1;
+  }
+  if (csr >= 0xC00 && csr <= 0xC1F) return 1;                 // cycle, time, instret, hpmcounter
+  if (csr >= 0xB00 && csr <= 0xB1F) return csr != 0xB01;      // mcycle, minstret, mhpmcounter
+  if (csr >= 0x3A0 && csr < 0x3A0 + (h->numPMP + 7) / 8 * 2) return !(csr & 1); // pmpcfg, even only on RV64
+  if (csr >= 0x3B0 && csr < 0x3B0 + h->numPMP) return 1;      // pmpaddr
+  return 0;
+}
+
+int rvm_csr_volatile(int csr) {
+  return (csr >= 0xC00 && csr <= 0xC1F) || (csr >= 0xB00 && csr <= 0xB1F) ||
+         (csr >= 0xF11 && csr <= 0xF15) || csr == RVM_MIP || csr == RVM_SIP;
+}
+
+uint64_t rvm_csr_peek(const rvm_hart *h, int csr, int *exists) {
+  uint64_t st = h->csr[RVM_MSTATUS] | ((h->csr[RVM_MSTATUS] & ST_FS) == ST_FS ? 1ull << 63 : 0);
+  uint64_t mip = h->csr[RVM_MIP] | h->irqLines;
+  if (exists) *exists = implemented(h, csr);
+  switch (csr) {
+    case RVM_FFLAGS:  return h->csr[RVM_FCSR] & 0x1f;
+    case RVM_FRM:     return h->csr[RVM_FCSR] >> 5 & 7;
+    case RVM_MSTATUS: return st;
+    case RVM_SSTATUS: return st & SSTATUS_RMASK;
+    case RVM_MIP:     return mip;
+    case RVM_SIP:     return mip & h->csr[RVM_MIDELEG];
+    case RVM_SIE:     return h->csr[RVM_MIE] & h->csr[RVM_MIDELEG];
+  }
+  return implemented(h, csr) ? h->csr[csr] : 0;
+}
+
+// write through the view and WARL masks of csr
+static void csrWrite(rvm_hart *h, int csr, uint64_t v) {
+  uint64_t *r = &h->csr[csr], deleg = h->csr[RVM_MIDELEG];
+  switch (csr) {
+    case RVM_FFLAGS: setFcsr(h, (h->csr[RVM_FCSR] & ~0x1full) | (v & 0x1f)); return;
+    case RVM_FRM:    setFcsr(h, (h->csr[RVM_FCSR] & 0x1f) | (v & 7) << 5); return;
+    case RVM_FCSR:   setFcsr(h, v); return;
+    case RVM_MSTATUS:
+      if ((v & ST_MPP) == 2ull << 11) v |= ST_MPP; // reserved MPP becomes M, as in csrsr.sv
+      setMstatus(h, v);
+      return;
+    case RVM_SSTATUS:
+      setMstatus(h, (h->csr[RVM_MSTATUS] & ~SSTATUS_WMASK) | (v & SSTATUS_WMASK));
+      return;
+    case RVM_MIE:     *r = v & 0xAAA; break;
+    case RVM_SIE:     h->csr[RVM_MIE] = (h->csr[RVM_MIE] & ~deleg) | (v & deleg & 0x222); csr = RVM_MIE; break;
+    case RVM_MIP:     *r = (*r & ~0x222ull) | (v & 0x222); break;
+    case RVM_SIP:     h->csr[RVM_MIP] = (h->csr[RVM_MIP] & ~(deleg & 2)) | (v & deleg & 2); csr = RVM_MIP; break;
+    case RVM_MIDELEG: *r = v & 0x222; break;
+    case RVM_MEDELEG: *r = v & 0xB3FF; break;
+    case RVM_MTVEC: case RVM_STVEC: *r = v & ~2ull; break;
+    case RVM_MEPC:  case RVM_SEPC:  *r = v & ~1ull; break;
+    case RVM_MCOUNTEREN: case RVM_SCOUNTEREN: *r = v & 0xffffffff; break;
+    case RVM_MCOUNTINHIBIT: *r = v & 0xfffffffd; break;
+    case RVM_SATP:
+      if (v >> 60 != 0 && v >> 60 != 8 && v >> 60 != 9) return; // unsupported modes are not written
+      *r = v;
+      break;
+    case RVM_MISA: case RVM_MTINST: case 0xF11: case 0xF12: case 0xF13: case 0xF14: case 0xF15:
+      return;
+    default:
+      if (csr >= 0x3B0 && csr <= 0x3EF) v &= (1ull << 54) - 1;
+      *r = v;
+  }
+  note(h, csr);
+}
+
+void rvm_csr_poke(rvm_hart *h, int csr, uint64_t value) {
+  if (csr == RVM_MISA || (csr >= 0xF11 && csr <= 0xF15)) h->csr[csr] = value;
+  else csrWrite(h, csr, value);
+}
+
+/////////////////////////////////////////////
+// Traps
+/////////////////////////////////////////////
+
+static void trap(rvm_hart *h, uint64_t cause, uint64_t tval, uint64_t epc) {
+  int interrupt = cause >> 63, code = cause & 63;
+  uint64_t deleg = interrupt ? h->csr[RVM_MIDELEG] : h->csr[RVM_MEDELEG];
+  uint64_t st = h->csr[RVM_MSTATUS], tvec;
+  if (h->priv <= 1 && (deleg >> code & 1)) {
+    csrWrite(h, RVM_SCAUSE, cause);
+    csrWrite(h, RVM_SEPC, epc);
+    csrWrite(h, RVM_STVAL, tval);
+    st = (st & ~(ST_SPP | ST_SPIE | ST_SIE)) | (h->priv ? ST_SPP : 0) | (st & ST_SIE ? ST_SPIE : 0);
+    h->priv = 1;
+    tvec = h->csr[RVM_STVEC];
+  } else {
+    csrWrite(h, RVM_MCAUSE, cause);
+    csrWrite(h, RVM_MEPC, epc);
+    csrWrite(h, RVM_MTVAL, tval);
+    st = (st & ~(ST_MPP | ST_MPIE | ST_MIE)) | (uint64_t)h->priv << 11 | (st & ST_MIE ? ST_MPIE : 0);
+    h->priv = 3;
+    tvec = h->csr[RVM_MTVEC];
+  }
+  setMstatus(h, st);
+  h->pc = (tvec & ~3ull) + ((tvec & 1) && interrupt ? 4 * code : 0);
+}
+
+int rvm_interrupt(rvm_hart *h) {
+  static const int priority[] = {11, 3, 7, 9, 1, 5};
+  uint64_t pending = (h->csr[RVM_MIP] | h->irqLines) & h->csr[RVM_MIE], st = h->csr[RVM_MSTATUS];
+  uint64_t deleg = h->csr[RVM_MIDELEG], enabled[2];
+  int i, level;
+  // interrupts for M-mode are taken before those delegated to S-mode
+  enabled[0] = (h->priv < 3 || (st & ST_MIE)) ? pending & ~deleg : 0;
+  enabled[1] = (h->priv < 1 || (h->priv == 1 && (st & ST_SIE))) ? pending & deleg : 0;
+  for (level = 0; level < 2; level++)
+    for (i = 0; i < 6; i++)
+      if (enabled[level] >> priority[i] & 1) {
+        trap(h, 1ull << 63 | priority[i], 0, h->pc);
+        return priority[i];
+      }
+  return -1;
+}
+
+/////////////////////////////////////////////
+// Memory
+/////////////////////////////////////////////
+
+int rvm_add_region(rvm_hart *h, uint64_t base, uint64_t size, int device) {
+  rvm_region *r;
+  if (h->numRegions == RVM_MAX_REGIONS) return -1;
+  r = &h->region[h->numRegions];
+  r->base = base;
+  r->size = size;
+  r->mem = NULL;
+  if (!device && !(r->mem = calloc(1, size))) return -1;
+  h->numRegions++;
+  return 0;
+}
+
+static rvm_region *regionOf(rvm_hart *h, uint64_t pa, uint64_t bytes) {
+  int i;
+  for (i = 0; i < h->numRegions; i++)
+    if (pa >= h->region[i].base && pa - h->region[i].base + bytes <= h->region[i].size) return &h->region[i];
+  return NULL;
+}
+
+uint8_t *rvm_mem(rvm_hart *h, uint64_t pa, uint64_t bytes) {
+  rvm_region *r = regionOf(h, pa, bytes);
+  return r && r->mem ? r->mem + (pa - r->base) : NULL;
+}
+
+static int isDevice(rvm_hart *h, uint64_t pa, uint64_t bytes) {
+  rvm_region *r = regionOf(h, pa, bytes);
+  return r && !r->mem;
+}
+
+static uint64_t translate(rvm_hart *h, uint64_t va, int access) {
+  static const int pageFault[] = {INSTR_PAGE, LOAD_PAGE, STORE_PAGE};
+  static const int accessFault[] = {INSTR_ACCESS, LOAD_ACCESS, STORE_ACCESS};
+  uint64_t st = h->csr[RVM_MSTATUS], satp = h->csr[RVM_SATP], a, pte = 0, ppn, offset;
+  int priv = h->priv, levels, vaBits, i, ok;
+  uint8_t *p = NULL;
+  if (access != FETCH && (st & ST_MPRV) && priv == 3) priv = st >> 11 & 3;
+  if (priv == 3 || satp >> 60 == 0) return va;
+  levels = satp >> 60 == 9 ? 4 : 3;
+  vaBits = 12 + 9 * levels;
+  if ((int64_t)(va << (64 - vaBits)) >> (64 - vaBits) != (int64_t)va) trapNow(h, pageFault[access], va);
+  a = (satp & PPN_MASK) << 12;
+  for (i = levels - 1; ; i--) {
+    if (!(p = rvm_mem(h, a + (va >> (12 + 9 * i) & 0x1ff) * 8, 8))) trapNow(h, accessFault[access], va);
+    memcpy(&pte, p, 8);
+    if (!(pte & PTE_V) || (!(pte & PTE_R) && (pte & PTE_W)) || pte >> 54) trapNow(h, pageFault[access], va);
+    if (pte & (PTE_R | PTE_X)) break;
+    if (i == 0) trapNow(h, pageFault[access], va);
+    a = (pte >> 10 & PPN_MASK) << 12;
+  }
+  ppn = pte >> 10 & PPN_MASK;
+  if (ppn & ((1ull << (9 * i)) - 1)) trapNow(h, pageFault[access], va); // misaligned superpage
+  if (priv == 0 && !(pte & PTE_U)) trapNow(h, pageFault[access], va);
+  if (priv == 1 && (pte & PTE_U) && (access == FETCH || !(st & ST_SUM))) trapNow(h, pageFault[access], va);
+  ok = access == FETCH ? pte & PTE_X : access == STORE ? pte & PTE_W : (pte & PTE_R) || ((st & ST_MXR) && (pte & PTE_X));
+  if (!ok) trapNow(h, pageFault[access], va);
+  if (!(pte & PTE_A) || (access == STORE && !(pte & PTE_D))) {
+    if (!h->svadu) trapNow(h, pageFault[access], va);
+    pte |= PTE_A | (access == STORE ? PTE_D : 0);
+    memcpy(p, &pte, 8);
+  }
+  offset = (1ull << (12 + 9 * i)) - 1;
+  return ((ppn << 12) & ~offset) | (va & offset);
+}
+
+// loads from a device return what the DUT wrote to the destination register
+static uint64_t load(rvm_hart *h, uint64_t va, int bytes, int fp) {
+  uint64_t pa, v = 0;
+  uint8_t *p;
+  if (va & (bytes - 1)) trapNow(h, LOAD_ALIGN, va);
+  pa = translate(h, va, LOAD);
+  if ((p = rvm_mem(h, pa, bytes))) {
+    memcpy(&v, p, bytes);
+    return v;
+  }
+  if (!isDevice(h, pa, bytes)) trapNow(h, LOAD_ACCESS, va);
+  h->usedDut = 1;
+  return fp ? h->dutF : h->dutX;
+}
+
+// physical address of a store or AMO; NULL *p for a device
+static uint64_t storeAdr(rvm_hart *h, uint64_t va, int bytes, uint8_t **p) {
+  uint64_t pa;
+  if (va & (bytes - 1)) trapNow(h, STORE_ALIGN, va);
+  pa = translate(h, va, STORE);
+  if (!(*p = rvm_mem(h, pa, bytes)) && !isDevice(h, pa, bytes)) trapNow(h, STORE_ACCESS, va);
+  return pa;
+}
+
+static void store(rvm_hart *h, uint64_t va, int bytes, uint64_t v) {
+  uint8_t *p;
+  storeAdr(h, va, bytes, &p);
+  if (p) memcpy(p, &v, bytes); // stores to devices are dropped
+}
+
+/////////////////////////////////////////////
+// Decode
+/////////////////////////////////////////////
+
+static uint32_t encI(int imm, int rs1, int f3, int rd, int op) {
+  return (uint32_t)(imm & 0xfff) << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op;
+}
+
+static uint32_t encS(int imm, int rs2, int rs1, int f3, int op) {
+  return (uint32_t)(imm >> 5 & 0x7f) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | (imm & 0x1f) << 7 | op;
+}
+
+static uint32_t encR(int f7, int rs2, int rs1, int f3, int rd, int op) {
+  return (uint32_t)f7 << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op;
+}
+
+static uint32_t encB(int imm, int rs1, int f3) {
+  return (uint32_t)(imm >> 12 & 1) << 31 | (imm >> 5 & 0x3f) << 25 | rs1 << 15 | f3 << 12 |
+         (imm >> 1 & 0xf) << 8 | (imm >> 11 & 1) << 7 | 0x63;
+}
+
+static uint32_t encJ(int imm, int rd) {
+  return (uint32_t)(imm >> 20 & 1) << 31 | (imm >> 1 & 0x3ff) << 21 | (imm >> 11 & 1) << 20 |
+         (imm >> 12 & 0xff) << 12 | rd << 7 | 0x6f;
+}
+
+static int sext(uint32_t v, int bits) { return (int32_t)(v << (32 - bits)) >> (32 - bits); }
+
+// the 32-bit equivalent of a compressed instruction, or 0 if it is illegal
+static uint32_t expand(uint32_t c) {
+  int rd = c >> 7 & 31, rs2 = c >> 2 & 31, rdp = 8 + (c >> 2 & 7), rs1p = 8 + (c >> 7 & 7);
+  int imm6 = sext((c >> 7 & 0x20) | (c >> 2 & 0x1f), 6), uimm6 = (c >> 7 & 0x20) | (c >> 2 & 0x1f);
+  int ldImm = (c >> 7 & 0x38) | (c << 1 & 0xc0), lwImm = (c >> 7 & 0x38) | (c >> 4 & 4) | (c << 1 & 0x40);
+  int ldspImm = (c >> 7 & 0x20) | (c >> 2 & 0x18) | (c << 4 & 0x1c0), sdspImm = (c >> 7 & 0x38) | (c >> 1 & 0x1c0);
+  int imm;
+  switch ((c & 3) << 3 | c >> 13) {
+    case 0: // c.addi4spn
+      imm = (c >> 7 & 0x30) | (c >> 1 & 0x3c0) | (c >> 4 & 4) | (c >> 2 & 8);
+      return imm ? encI(imm, 2, 0, rdp, 0x13) : 0;
+    case 1: return encI(ldImm, rs1p, 3, rdp, 0x07);         // c.fld
+    case 2: return encI(lwImm, rs1p, 2, rdp, 0x03);         // c.lw
+    case 3: return encI(ldImm, rs1p, 3, rdp, 0x03);         // c.ld
+    case 5: return encS(ldImm, rdp, rs1p, 3, 0x27);         // c.fsd
+    case 6: return encS(lwImm, rdp, rs1p, 2, 0x23);         // c.sw
+    case 7: return encS(ldImm, rdp, rs1p, 3, 0x23);         // c.sd
+    case 8: return encI(imm6, rd, 0, rd, 0x13);             // c.addi
+    case 9: return rd ? encI(imm6, rd, 0, rd, 0x1b) : 0;    // c.addiw
+    case 10: return encI(imm6, 0, 0, rd, 0x13);             // c.li
+    case 11:
+      if (rd == 2) { // c.addi16sp
+        imm = sext((c >> 3 & 0x200) | (c >> 2 & 0x10) | (c << 1 & 0x40) | (c << 4 & 0x180) | (c << 3 & 0x20), 10);
+        return imm ? encI(imm, 2, 0, 2, 0x13) : 0;
+      }
+      return imm6 ? ((uint32_t)imm6 << 12 & 0xfffff000) | rd << 7 | 0x37 : 0; // c.lui
+    case 12:
+      switch (c >> 10 & 3) {
+        case 0: return encI(uimm6, rs1p, 5, rs1p, 0x13);          // c.srli
+        case 1: return encI(0x400 | uimm6, rs1p, 5, rs1p, 0x13);  // c.srai
+        case 2: return encI(imm6, rs1p, 7, rs1p, 0x13);           // c.andi
+      }
+      switch ((c >> 10 & 4) | (c >> 5 & 3)) {
+        case 0: return encR(0x20, rdp, rs1p, 0, rs1p, 0x33);      // c.sub
+        case 1: return encR(0, rdp, rs1p, 4, rs1p, 0x33);         // c.xor
+        case 2: return encR(0, rdp, rs1p, 6, rs1p, 0x33);         // c.or
+        case 3: return encR(0, rdp, rs1p, 7, rs1p, 0x33);         // c.and
+        case 4: return encR(0x20, rdp, rs1p, 0, rs1p, 0x3b);      // c.subw
+        case 5: return encR(0, rdp, rs1p, 0, rs1p, 0x3b);         // c.addw
+      }
+      return 0;
+    case 13: // c.j
+      imm = (c >> 1 & 0x800) | (c >> 7 & 0x10) | (c >> 1 & 0x300) | (c << 2 & 0x400) |
+            (c >> 1 & 0x40) | (c << 1 & 0x80) | (c >> 2 & 0xe) | (c << 3 & 0x20);
+      return encJ(sext(imm, 12), 0);
+    case 14: case 15: // c.beqz, c.bnez
+      imm = (c >> 4 & 0x100) | (c >> 7 & 0x18) | (c << 1 & 0xc0) | (c >> 2 & 6) | (c << 3 & 0x20);
+      return encB(sext(imm, 9), rs1p, c >> 13 & 1);
+    case 16: return encI(uimm6, rd, 1, rd, 0x13);                          // c.slli
+    case 17: return encI(ldspImm, 2, 3, rd, 0x07);                         // c.fldsp
+    case 18:                                                               // c.lwsp
+      imm = (c >> 7 & 0x20) | (c >> 2 & 0x1c) | (c << 4 & 0xc0);
+      return rd ? encI(imm, 2, 2, rd, 0x03) : 0;
+    case 19: return rd ? encI(ldspImm, 2, 3, rd, 0x03) : 0;                // c.ldsp
+    case 20:
+      if (!(c >> 12 & 1)) {
+        if (rs2) return encR(0, rs2, 0, 0, rd, 0x33);                      // c.mv
+        return rd ? encI(0, rd, 0, 0, 0x67) : 0;                           // c.jr
+      }
+      if (rs2) return encR(0, rs2, rd, 0, rd, 0x33);                       // c.add
+      return rd ? encI(0, rd, 0, 1, 0x67) : 0x00100073;                    // c.jalr, c.ebreak
+    case 21: return encS(sdspImm, rs2, 2, 3, 0x27);                        // c.fsdsp
+    case 22: return encS((c >> 7 & 0x3c) | (c >> 1 & 0xc0), rs2, 2, 2, 0x23); // c.swsp
+    case 23: return encS(sdspImm, rs2, 2, 3, 0x23);                        // c.sdsp
+  }
+  return 0;
+}
+
+static void setX(rvm_hart *h, int rd, uint64_t v) {
+  if (!rd) return;
+  h->x[rd] = v;
+  h->xRd = rd;
+}
+
+/////////////////////////////////////////////
+// Floating point
+/////////////////////////////////////////////
+
+#define CANONICAL_S 0x7fc00000u
+#define CANONICAL_D 0x7ff8000000000000ull
+
+static int isNaNS(uint32_t v) { return (v & 0x7f800000) == 0x7f800000 && (v & 0x7fffff); }
+static int isNaND(uint64_t v) { return (v & 0x7ff0000000000000ull) == 0x7ff0000000000000ull && (v & 0xfffffffffffffull); }
+
+static uint64_t boxS(uint32_t v) { return 0xffffffff00000000ull | v; }
+static float32_t fS(uint64_t v) { float32_t r; r.v = v >> 32 == 0xffffffff ? (uint32_t)v : CANONICAL_S; return r; }
+static float64_t fD(uint64_t v) { float64_t r; r.v = v; return r; }
+// arithmetic results never carry a NaN payload
+static uint64_t resS(float32_t a) { return boxS(isNaNS(a.v) ? CANONICAL_S : a.v); }
+static uint64_t resD(float64_t a) { return isNaND(a.v) ? CANONICAL_D : a.v; }
+
+static void setF(rvm_hart *h, int rd, uint64_t v) {
+  h->f[rd] = v;
+  h->fRd = rd;
+  dirtyFP(h);
+}
+
+static void roundingMode(rvm_hart *h, int rm) {
+  if (rm == 7) rm = h->csr[RVM_FCSR] >> 5 & 7;
+  if (rm > 4) illegal(h);
+  softfloat_roundingMode = rm; // SoftFloat numbers its modes as RISC-V does
+  softfloat_exceptionFlags = 0;
+}
+
+static void accrue(rvm_hart *h) {
+  uint64_t fcsr = h->csr[RVM_FCSR] | softfloat_exceptionFlags; // and its flag bits too
+  if (fcsr != h->csr[RVM_FCSR]) setFcsr(h, fcsr);
+}
+
+static uint64_t fclass(int sign, uint64_t exp, uint64_t frac, uint64_t expMax, uint64_t quietBit) {
+  if (exp == expMax) return frac ? (frac & quietBit ? 1 << 9 : 1 << 8) : (sign ? 1 << 0 : 1 << 7);
+  if (exp == 0) return frac ? (sign ? 1 << 2 : 1 << 5) : (sign ? 1 << 3 : 1 << 4);
+  return sign ? 1 << 1 : 1 << 6;
+}
+
+// RISC-V results for out of range conversions: NaN and positive overflow saturate high
+static uint64_t toInt(int op, int nan, int neg, uint64_t r) {
+  static const uint64_t high[] = {0x7fffffff, ~0ull, 0x7fffffffffffffffull, ~0ull};
+  static const uint64_t low[]  = {~0ull << 31, 0, 1ull << 63, 0};
+  if (softfloat_exceptionFlags & softfloat_flag_invalid) r = nan || !neg ? high[op] : low[op];
+  return op < 2 ? (uint64_t)sext32(r) : r;
+}
+
+static uint64_t minMax(uint64_t a, uint64_t b, int max, int dbl) {
+  int aNaN = dbl ? isNaND(a) : isNaNS(a), bNaN = dbl ? isNaND(b) : isNaNS(b), less;
+  int sbit = dbl ? 63 : 31;
+  if (dbl ? f64_isSignalingNaN(fD(a)) || f64_isSignalingNaN(fD(b))
+          : f32_isSignalingNaN(fS(boxS(a))) || f32_isSignalingNaN(fS(boxS(b))))
+    softfloat_exceptionFlags |= softfloat_flag_invalid;
+  if (aNaN && bNaN) return dbl ? CANONICAL_D : CANONICAL_S;
+  if (aNaN) return b;
+  if (bNaN) return a;
+  if (((a | b) << 1) == 0 || (!dbl && (((a | b) << 33) == 0))) less = (a >> sbit & 1) && !(b >> sbit & 1); // -0 < +0
+  else less = dbl ? f64_lt_quiet(fD(a), fD(b)) : f32_lt_quiet(fS(boxS(a)), fS(boxS(b)));
+  return max ? (less ? b : a) : (less ? a : b);
+}
+
+static void fpArith(rvm_hart *h, uint32_t insn, int rd, int rs1, int rs2, int f3) {
+  int f7 = insn >> 25, dbl = f7 & 1, neg;
+  uint64_t a = h->f[rs1], b = h->f[rs2], r;
+  float32_t sa = fS(a), sb = fS(b);
+  float64_t da = fD(a), db = fD(b);
+  int aNaN = dbl ? isNaND(a) : isNaNS(sa.v);
+  if ((f7 & 3) > 1) illegal(h);
+  neg = dbl ? a >> 63 : sa.v >> 31;
+  switch (f7 >> 2) {
+    case 0x00: roundingMode(h, f3); setF(h, rd, dbl ? resD(f64_add(da, db)) : resS(f32_add(sa, sb))); break;
+    case 0x01: roundingMode(h, f3); setF(h, rd, dbl ? resD(f64_sub(da, db)) : resS(f32_sub(sa, sb))); break;
+    case 0x02: roundingMode(h, f3); setF(h, rd, dbl ? resD(f64_mul(da, db)) : resS(f32_mul(sa, sb))); break;
+    case 0x03: roundingMode(h, f3); setF(h, rd, dbl ? resD(f64_div(da, db)) : resS(f32_div(sa, sb))); break;
+    case 0x0B:
+      if (rs2) illegal(h);
+      roundingMode(h, f3);
+      setF(h, rd, dbl ? resD(f64_sqrt(da)) : resS(f32_sqrt(sa)));
+      break;
+    case 0x04: // fsgnj, fsgnjn, fsgnjx
+      if (f3 > 2) illegal(h);
+      softfloat_exceptionFlags = 0;
+      if (dbl) {
+        uint64_t s = f3 == 0 ? b : f3 == 1 ? ~b : a ^ b;
+        setF(h, rd, (a & ~(1ull << 63)) | (s & 1ull << 63));
+      } else {
+        uint32_t s = f3 == 0 ? sb.v : f3 == 1 ? ~sb.v : sa.v ^ sb.v;
+        setF(h, rd, boxS((sa.v & 0x7fffffff) | (s & 0x80000000)));
+      }
+      break;
+    case 0x05: // fmin, fmax
+      if (f3 > 1) illegal(h);
+      softfloat_exceptionFlags = 0;
+      setF(h, rd, dbl ? minMax(a, b, f3, 1) : boxS(minMax(sa.v, sb.v, f3, 0)));
+      break;
+    case 0x08: // fcvt.s.d, fcvt.d.s
+      if (rs2 != !dbl) illegal(h);
+      roundingMode(h, f3);
+      setF(h, rd, dbl ? resD(f32_to_f64(sa)) : resS(f64_to_f32(da)));
+      break;
+    case 0x14: // fle, flt, feq
+      if (f3 > 2) illegal(h);
+      softfloat_exceptionFlags = 0;
+      if (dbl) r = f3 == 0 ? f64_le(da, db) : f3 == 1 ? f64_lt(da, db) : f64_eq(da, db);
+      else     r = f3 == 0 ? f32_le(sa, sb) : f3 == 1 ? f32_lt(sa, sb) : f32_eq(sa, sb);
+      setX(h, rd, r);
+      break;
+    case 0x18: // fcvt.w, wu, l, lu
+      if (rs2 > 3) illegal(h);
+      roundingMode(h, f3);
+      if (dbl) r = rs2 == 0 ? (uint64_t)f64_to_i32(da, softfloat_roundingMode, 1) : rs2 == 1 ? f64_to_ui32(da, softfloat_roundingMode, 1) :
+                   rs2 == 2 ? (uint64_t)f64_to_i64(da, softfloat_roundingMode, 1) : f64_to_ui64(da, softfloat_roundingMode, 1);
+      else     r = rs2 == 0 ? (uint64_t)f32_to_i32(sa, softfloat_roundingMode, 1) : rs2 == 1 ? f32_to_ui32(sa, softfloat_roundingMode, 1) :
+                   rs2 == 2 ? (uint64_t)f32_to_i64(sa, softfloat_roundingMode, 1) : f32_to_ui64(sa, softfloat_roundingMode, 1);
+      setX(h, rd, toInt(rs2, aNaN, neg, r));
+      break;
+    case 0x1A: // fcvt from w, wu, l, lu
+      if (rs2 > 3) illegal(h);
+      roundingMode(h, f3);
+      a = h->x[rs1];
+      if (dbl) r = rs2 == 0 ? i32_to_f64(a).v : rs2 == 1 ? ui32_to_f64(a).v : rs2 == 2 ? i64_to_f64(a).v : ui64_to_f64(a).v;
+      else     r = boxS(rs2 == 0 ? i32_to_f32(a).v : rs2 == 1 ? ui32_to_f32(a).v : rs2 == 2 ? i64_to_f32(a).v : ui64_to_f32(a).v);
+      setF(h, rd, r);
+      break;
+    case 0x1C: // fmv.x, fclass
+      if (rs2 || f3 > 1) illegal(h);
+      softfloat_exceptionFlags = 0;
+      if (f3 == 0) setX(h, rd, dbl ? a : (uint64_t)sext32(a));
+      else if (dbl) setX(h, rd, fclass(a >> 63, a >> 52 & 0x7ff, a & 0xfffffffffffffull, 0x7ff, 1ull << 51));
+      else setX(h, rd, fclass(sa.v >> 31, sa.v >> 23 & 0xff, sa.v & 0x7fffff, 0xff, 1 << 22));
+      break;
+    case 0x1E: // fmv.w.x, fmv.d.x
+      if (rs2 || f3) illegal(h);
+      softfloat_exceptionFlags = 0;
+      setF(h, rd, dbl ? h->x[rs1] : boxS(h->x[rs1]));
+      break;
+    default:
+      illegal(h);
+  }
+  accrue(h);
+}
+
+// fmadd, fmsub, fnmsub, fnmadd
+static void fpFused(rvm_hart *h, uint32_t insn, int op, int rd, int rs1, int rs2, int f3) {
+  int fmt = insn >> 25 & 3, rs3 = insn >> 27;
+  int negProduct = op == 0x4B || op == 0x4F, negAddend = op == 0x47 || op == 0x4F;
+  if (fmt > 1) illegal(h);
+  roundingMode(h, f3);
+  if (fmt) {
+    float64_t a = fD(h->f[rs1]), b = fD(h->f[rs2]), c = fD(h->f[rs3]);
+    a.v ^= (uint64_t)negProduct << 63;
+    c.v ^= (uint64_t)negAddend << 63;
+    setF(h, rd, resD(f64_mulAdd(a, b, c)));
+  } else {
+    float32_t a = fS(h->f[rs1]), b = fS(h->f[rs2]), c = fS(h->f[rs3]);
+    a.v ^= (uint32_t)negProduct << 31;
+    c.v ^= (uint32_t)negAddend << 31;
+    setF(h, rd, resS(f32_mulAdd(a, b, c)));
+  }
+  accrue(h);
+}
+
+/////////////////////////////////////////////
+// Integer, memory and system instructions
+/////////////////////////////////////////////
+
+static uint64_t alu(int f3, int f7, uint64_t a, uint64_t b, int imm) {
+  int shamt = b & 63;
+  switch (f3) {
+    case 0: return f7 == 0x20 && !imm ? a - b : a + b;
+    case 1: return a << shamt;
+    case 2: return (int64_t)a < (int64_t)b;
+    case 3: return a < b;
+    case 4: return a ^ b;
+    case 5: return f7 & 0x20 ? (uint64_t)((int64_t)a >> shamt) : a >> shamt;
+    case 6: return a | b;
+    default: return a & b;
+  }
+}
+
+static uint64_t muldiv(int f3, uint64_t a, uint64_t b) {
+  int64_t sa = a, sb = b;
+  switch (f3) {
+    case 0: return a * b;
+    case 1: return (unsigned __int128)((__int128)sa * sb) >> 64;
+    case 2: return (unsigned __int128)((__int128)sa * (__int128)b) >> 64;
+    case 3: return ((unsigned __int128)a * b) >> 64;
+    case 4: return !b ? ~0ull : (sa == INT64_MIN && sb == -1) ? a : (uint64_t)(sa / sb);
+    case 5: return !b ? ~0ull : a / b;
+    case 6: return !b ? a : (sa == INT64_MIN && sb == -1) ? 0 : (uint64_t)(sa % sb);
+    default: return !b ? a : a % b;
+  }
+}
+
+static uint64_t muldivw(int f3, uint64_t a, uint64_t b) {
+  int32_t sa = a, sb = b;
+  uint32_t ua = a, ub = b;
+  switch (f3) {
+    case 0: return sext32(ua * ub);
+    case 4: return sext32(!sb ? -1 : (sa == INT32_MIN && sb == -1) ? sa : sa / sb);
+    case 5: return sext32(!ub ? ~0u : ua / ub);
+    case 6: return sext32(!sb ? sa : (sa == INT32_MIN && sb == -1) ? 0 : sa % sb);
+    default: return sext32(!ub ? ua : ua % ub);
+  }
+}
+
+static void amo(rvm_hart *h, uint32_t insn, int rd, int rs1, int rs2, int f3) {
+  int f5 = insn >> 27, bytes = f3 == 2 ? 4 : 8;
+  uint64_t adr = h->x[rs1], b = h->x[rs2], old = 0, v;
+  uint8_t *p;
+  if (f3 != 2 && f3 != 3) illegal(h);
+  if (f5 == 0x02) { // lr
+    if (rs2) illegal(h);
+    v = load(h, adr, bytes, 0);
+    setX(h, rd, bytes == 4 ? (uint64_t)sext32(v) : v);
+    return;
+  }
+  if (f5 == 0x03) {
+    // whether a reservation survives is up to the implementation, so sc follows the DUT
+    h->usedDut = 1;
+    if (!h->dutX) store(h, adr, bytes, b);
+    setX(h, rd, h->dutX != 0);
+    return;
+  }
+  storeAdr(h, adr, bytes, &p);
+  if (p) memcpy(&old, p, bytes);
+  else { h->usedDut = 1; old = h->dutX; }
+  if (bytes == 4) { old = sext32(old); b = sext32(b); }
+  switch (f5) {
+    case 0x00: v = old + b; break;
+    case 0x01: v = b; break;
+    case 0x04: v = old ^ b; break;
+    case 0x08: v = old | b; break;
+    case 0x0C: v = old & b; break;
+    case 0x10: v = (int64_t)old < (int64_t)b ? old : b; break;
+    case 0x14: v = (int64_t)old > (int64_t)b ? old : b; break;
+    case 0x18: v = (bytes == 4 ? (uint32_t)old < (uint32_t)b : old < b) ? old : b; break;
+    case 0x1C: v = (bytes == 4 ? (uint32_t)old > (uint32_t)b : old > b) ? old : b; break;
+    default: illegal(h); return;
+  }
+  if (p) memcpy(p, &v, bytes);
+  setX(h, rd, old);
+}
+
+static void csrInstr(rvm_hart *h, uint32_t insn, int rd, int rs1, int f3) {
+  int csr = insn >> 20, writes = (f3 & 3) == 1 || rs1 != 0, counter = csr & 31;
+  uint64_t src = f3 & 4 ? (uint64_t)rs1 : h->x[rs1], old, v;
+  if (!implemented(h, csr) || (csr >> 8 & 3) > h->priv || (writes && csr >> 10 == 3)) illegal(h);
+  if (csr == RVM_SATP && h->priv == 1 && (h->csr[RVM_MSTATUS] & ST_TVM)) illegal(h);
+  if (csr <= RVM_FCSR && !(h->csr[RVM_MSTATUS] & ST_FS)) illegal(h);
+  if (csr >= 0xC00 && csr <= 0xC1F && h->priv < 3 &&
+      (!(h->csr[RVM_MCOUNTEREN] >> counter & 1) || (h->priv == 0 && !(h->csr[RVM_SCOUNTEREN] >> counter & 1))))
+    illegal(h);
+  if (rvm_csr_volatile(csr) && rd) {
+    h->usedDut = 1;
+    old = h->dutX;
+  } else old = rvm_csr_peek(h, csr, NULL);
+  v = (f3 & 3) == 1 ? src : (f3 & 3) == 2 ? old | src : old & ~src;
+  if (writes) csrWrite(h, csr, v);
+  setX(h, rd, old);
+}
+
+// returns the next pc
+static uint64_t sysInstr(rvm_hart *h, uint32_t insn, uint64_t pc, uint64_t next, int rd, int rs1, int f3) {
+  uint64_t st = h->csr[RVM_MSTATUS];
+  int prev;
+  if (f3) {
+    if (f3 == 4) illegal(h);
+    csrInstr(h, insn, rd, rs1, f3);
+    return next;
+  }
+  if (insn == 0x00000073) trapNow(h, ECALL_U + h->priv, 0);
+  if (insn == 0x00100073) trapNow(h, BREAKPOINT, pc);
+  if (insn == 0x30200073) { // mret
+    if (h->priv != 3) illegal(h);
+    prev = st >> 11 & 3;
+    st = (st & ~(ST_MPP | ST_MIE)) | ST_MPIE | (st & ST_MPIE ? ST_MIE : 0);
+    if (prev != 3) st &= ~ST_MPRV;
+    setMstatus(h, st);
+    h->priv = prev;
+    return h->csr[RVM_MEPC];
+  }
+  if (insn == 0x10200073) { // sret
+    if (h->priv == 0 || (h->priv == 1 && (st & ST_TSR))) illegal(h);
+    prev = st >> 8 & 1;
+    st = (st & ~(ST_SPP | ST_SIE | ST_MPRV)) | ST_SPIE | (st & ST_SPIE ? ST_SIE : 0);
+    setMstatus(h, st);
+    h->priv = prev;
+    return h->csr[RVM_SEPC];
+  }
+  if (insn == 0x10500073) { // wfi completes at once
+    if (h->priv == 0 || (h->priv == 1 && (st & ST_TW))) illegal(h);
+    return next;
+  }
+  if (insn >> 25 == 0x09 && !rd) { // sfence.vma; there is no TLB to flush
+    if (h->priv == 0 || (h->priv == 1 && (st & ST_TVM))) illegal(h);
+    return next;
+  }
+  illegal(h);
+  return next;
+}
+
+static uint32_t fetch(rvm_hart *h) {
+  uint64_t pa = translate(h, h->pc, FETCH);
+  uint16_t lo, hi;
+  uint8_t *p = rvm_mem(h, pa, 2);
+  if (!p) trapNow(h, INSTR_ACCESS, h->pc);
+  memcpy(&lo, p, 2);
+  if ((lo & 3) != 3) return lo;
+  pa = translate(h, h->pc + 2, FETCH); // may be on the next page
+  if (!(p = rvm_mem(h, pa, 2))) trapNow(h, INSTR_ACCESS, h->pc);
+  memcpy(&hi, p, 2);
+  return (uint32_t)hi << 16 | lo;
+}
+
+static uint64_t execute(rvm_hart *h, uint32_t insn, uint64_t pc, int len) {
+  int op = insn & 0x7f, rd = insn >> 7 & 31, f3 = insn >> 12 & 7, rs1 = insn >> 15 & 31, rs2 = insn >> 20 & 31;
+  int f7 = insn >> 25, immI = (int32_t)insn >> 20, immS = ((int32_t)insn >> 25 << 5) | (insn >> 7 & 0x1f);
+  int immB = ((int32_t)insn >> 31 << 12) | (insn << 4 & 0x800) | (insn >> 20 & 0x7e0) | (insn >> 7 & 0x1e);
+  int immJ = ((int32_t)insn >> 31 << 20) | (insn & 0xff000) | (insn >> 9 & 0x800) | (insn >> 20 & 0x7fe);
+  uint64_t a = h->x[rs1], b = h->x[rs2], next = pc + len, v;
+  int taken;
+  switch (op) {
+    case 0x37: setX(h, rd, (int64_t)(int32_t)(insn & 0xfffff000)); break;       // lui
+    case 0x17: setX(h, rd, pc + (int64_t)(int32_t)(insn & 0xfffff000)); break;  // auipc
+    case 0x6f: setX(h, rd, next); return pc + immJ;                             // jal
+    case 0x67:                                                                  // jalr
+      if (f3) illegal(h);
+      setX(h, rd, next);
+      return (a + immI) & ~1ull;
+    case 0x63:                                                                  // branches
+      switch (f3) {
+        case 0: taken = a == b; break;
+        case 1: taken = a != b; break;
+        case 4: taken = (int64_t)a < (int64_t)b; break;
+        case 5: taken = (int64_t)a >= (int64_t)b; break;
+        case 6: taken = a < b; break;
+        case 7: taken = a >= b; break;
+        default: illegal(h); return 0;
+      }
+      return taken ? pc + immB : next;
+    case 0x03:                                                                  // loads
+      if (f3 == 7) illegal(h);
+      v = load(h, a + immI, 1 << (f3 & 3), 0);
+      switch (f3) {
+        case 0: v = (int8_t)v; break;
+        case 1: v = (int16_t)v; break;
+        case 2: v = (int32_t)v; break;
+      }
+      setX(h, rd, v);
+      break;
+    case 0x23:                                                                  // stores
+      if (f3 > 3) illegal(h);
+      store(h, a + immS, 1 << f3, b);
+      break;
+    case 0x13:                                                                  // op-imm
+      if ((f3 == 1 && insn >> 26) || (f3 == 5 && insn >> 26 & 0x2f)) illegal(h);
+      setX(h, rd, alu(f3, f7, a, (int64_t)immI, 1));
+      break;
+    case 0x1b:                                                                  // op-imm-32
+      if (f3 == 0) setX(h, rd, sext32(a + immI));
+      else if (f3 == 1 && !f7) setX(h, rd, sext32((uint32_t)a << rs2));
+      else if (f3 == 5 && !f7) setX(h, rd, sext32((uint32_t)a >> rs2));
+      else if (f3 == 5 && f7 == 0x20) setX(h, rd, sext32((int32_t)a >> rs2));
+      else illegal(h);
+      break;
+    case 0x33:                                                                  // op
+      if (f7 == 1) setX(h, rd, muldiv(f3, a, b));
+      else if (!f7 || (f7 == 0x20 && (f3 == 0 || f3 == 5))) setX(h, rd, alu(f3, f7, a, b, 0));
+      else illegal(h);
+      break;
+    case 0x3b:                                                                  // op-32
+      if (f7 == 1 && (f3 == 0 || f3 >= 4)) setX(h, rd, muldivw(f3, a, b));
+      else if (f3 == 0 && !f7) setX(h, rd, sext32(a + b));
+      else if (f3 == 0 && f7 == 0x20) setX(h, rd, sext32(a - b));
+      else if (f3 == 1 && !f7) setX(h, rd, sext32((uint32_t)a << (b & 31)));
+      else if (f3 == 5 && !f7) setX(h, rd, sext32((uint32_t)a >> (b & 31)));
+      else if (f3 == 5 && f7 == 0x20) setX(h, rd, sext32((int32_t)a >> (b & 31)));
+      else illegal(h);
+      break;
+    case 0x0f:                                                                  // fence, fence.i
+      if (f3 > 1) illegal(h);
+      break;
+    case 0x73:                                                                  // system
+      return sysInstr(h, insn, pc, next, rd, rs1, f3);
+    case 0x2f:                                                                  // atomics
+      amo(h, insn, rd, rs1, rs2, f3);
+      break;
+    case 0x07: case 0x27: case 0x43: case 0x47: case 0x4b: case 0x4f: case 0x53:
+      if (!(h->csr[RVM_MSTATUS] & ST_FS)) illegal(h);
+      if (op == 0x07) {                                                         // flw, fld
+        if (f3 != 2 && f3 != 3) illegal(h);
+        v = load(h, a + immI, f3 == 2 ? 4 : 8, 1);
+        setF(h, rd, f3 == 2 ? boxS(v) : v);
+      } else if (op == 0x27) {                                                  // fsw, fsd
+        if (f3 != 2 && f3 != 3) illegal(h);
+        store(h, a + immS, f3 == 2 ? 4 : 8, h->f[rs2]);
+      } else if (op == 0x53) fpArith(h, insn, rd, rs1, rs2, f3);
+      else fpFused(h, insn, op, rd, rs1, rs2, f3);
+      break;
+    default:
+      illegal(h);
+  }
+  return next;
+}
+
+void rvm_step(rvm_hart *h) {
+  uint64_t pc = h->pc;
+  uint32_t insn;
+  h->xRd = h->fRd = -1;
+  h->trapped = 0;
+  h->usedDut = 0;
+  h->insn = 0;
+  if (setjmp(h->env)) {
+    h->trapped = 1;
+    h->pc = pc;
+    trap(h, h->cause, h->tval, pc);
+    return;
+  }
+  insn = h->insn = fetch(h);
+  if ((insn & 3) != 3 && !(insn = expand(insn))) illegal(h);
+  h->pc = execute(h, insn, pc, (h->insn & 3) == 3 ? 4 : 2);
+}
+
+void rvm_init(rvm_hart *h, uint64_t misa, uint64_t resetVector) {
+  memset(h, 0, sizeof(*h));
+  h->pc = resetVector;
+  h->priv = 3;
+  h->numPMP = 16;
+  h->csr[RVM_MISA] = misa;
+  h->csr[RVM_MSTATUS] = ST_XL;
+  h->xRd = h->fRd = -1;
+}
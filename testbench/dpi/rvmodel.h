@@ -0,0 +1,122 @@
+///////////////////////////////////////////
+// rvmodel.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Lightweight RV64GC (IMAFDC, Zicsr, Zifencei, M/S/U, Sv39/Sv48) instruction
+//          set model for the lockstep comparator in cosim.c.  The model has no
+//          devices and never takes an interrupt on its own: the comparator tells it
+//          when the DUT did.  Loads from device regions and reads of volatile CSRs
+//          (counters, time, mip) return the value the DUT wrote to the destination
+//          register, which the comparator supplies before each step.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RVMODEL_H
+#define RVMODEL_H
+
+#include <setjmp.h>
+#include <stdint.h>
+
+#define RVM_MAX_REGIONS 8
+#define RVM_MAX_WRITES  16
+
+// CSR numbers the model gives meaning to
+#define RVM_FFLAGS   0x001
+#define RVM_FRM      0x002
+#define RVM_FCSR     0x003
+#define RVM_SSTATUS  0x100
+#define RVM_SIE      0x104
+#define RVM_STVEC    0x105
+#define RVM_SCOUNTEREN 0x106
+#define RVM_SSCRATCH 0x140
+#define RVM_SEPC     0x141
+#define RVM_SCAUSE   0x142
+#define RVM_STVAL    0x143
+#define RVM_SIP      0x144
+#define RVM_SATP     0x180
+#define RVM_MSTATUS  0x300
+#define RVM_MISA     0x301
+#define RVM_MEDELEG  0x302
+#define RVM_MIDELEG  0x303
+#define RVM_MIE      0x304
+#define RVM_MTVEC    0x305
+#define RVM_MCOUNTEREN 0x306
+#define RVM_MCOUNTINHIBIT 0x320
+#define RVM_MSCRATCH 0x340
+#define RVM_MEPC     0x341
+#define RVM_MCAUSE   0x342
+#define RVM_MTVAL    0x343
+#define RVM_MIP      0x344
+#define RVM_MTINST   0x34A
+
+// interrupt lines driven by the platform, in their mip bit positions
+#define RVM_MSIP (1ull << 3)
+#define RVM_STIP (1ull << 5)
+#define RVM_MTIP (1ull << 7)
+#define RVM_SEIP (1ull << 9)
+#define RVM_MEIP (1ull << 11)
+
+typedef struct {
+  uint64_t base, size;
+  uint8_t *mem;              // little-endian contents; NULL for a device region
+} rvm_region;
+
+typedef struct {
+  // architectural state
+  uint64_t pc, x[32], f[32];
+  int      priv;             // 0 U, 1 S, 3 M
+  uint64_t csr[4096];        // raw storage; rvm_csr_peek applies the restricted views
+  uint64_t irqLines;         // RVM_MEIP etc., ORed into mip
+  // configuration
+  rvm_region region[RVM_MAX_REGIONS];
+  int      numRegions;
+  int      svadu;            // the page table walker sets A and D instead of faulting
+  int      numPMP;
+  // value the DUT wrote to this instruction's destination register
+  uint64_t dutX, dutF;
+  // effects of the last rvm_step
+  uint32_t insn;             // as fetched, 16 bits if compressed
+  int      xRd, fRd;         // register written, or -1
+  int      trapped;          // took an exception instead of retiring
+  uint64_t cause, tval;
+  int      usedDut;          // took a device load or volatile CSR from dutX/dutF
+  // CSRs written since the caller last cleared numWrites
+  int      numWrites;
+  uint16_t writes[RVM_MAX_WRITES];
+  jmp_buf  env;
+} rvm_hart;
+
+void     rvm_init(rvm_hart *h, uint64_t misa, uint64_t resetVector);
+// memory at base; device regions have no backing store.  Returns 0 on success.
+int      rvm_add_region(rvm_hart *h, uint64_t base, uint64_t size, int device);
+// host pointer to bytes of physical memory, or NULL if they are not all in one memory region
+uint8_t *rvm_mem(rvm_hart *h, uint64_t pa, uint64_t bytes);
+// execute one instruction, or take the exception it raises
+void     rvm_step(rvm_hart *h);
+// take the highest priority pending and enabled interrupt; returns its cause or -1
+int      rvm_interrupt(rvm_hart *h);
+// CSR value as an instruction would read it; *exists is cleared for unimplemented CSRs
+uint64_t rvm_csr_peek(const rvm_hart *h, int csr, int *exists);
+// set a CSR through the same view and write mask as a CSR instruction in M-mode
+void     rvm_csr_poke(rvm_hart *h, int csr, uint64_t value);
+// CSRs whose value depends on time or on the pipeline rather than on the instruction stream
+int      rvm_csr_volatile(int csr);
+
+#endif
@@ -0,0 +1,98 @@
+///////////////////////////////////////////
+// sdimage.c
+//
+// Written: Wally team 2023
+//
+// Purpose: DPI-C storage backend for the SD card model (testbench/sdc/sdModel.sv).
+//          The card image, such as one built by mksdimg, is mapped rather than
+//          converted to hex and read into FLASHmem, so a simulation starts at once
+//          whatever the size of the image and only the blocks the software reads
+//          are ever paged in.  The mapping is private: blocks the software writes
+//          change the simulated card but never the image file.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+  uint8_t *mem;
+  uint64_t bytes;
+  uint64_t outside;               // accesses past the end of the image
+} sdImage;
+
+// Map path for sdimage_read and sdimage_write.  Returns NULL if it cannot be mapped.
+void *sdimage_open(const char *path) {
+  struct stat st;
+  sdImage *img;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) || st.st_size == 0) {
+    fprintf(stderr, "sdimage: cannot open %s\n", path);
+    if (fd >= 0) close(fd);
+    return NULL;
+  }
+  img = calloc(1, sizeof(*img));
+  img->bytes = st.st_size;
+  img->mem = mmap(NULL, img->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE, fd, 0);
+  close(fd);
+  if (img->mem == MAP_FAILED) {
+    fprintf(stderr, "sdimage: cannot map %s\n", path);
+    free(img);
+    return NULL;
+  }
+  // blocks are read in order, so let the kernel read ahead
+  madvise(img->mem, img->bytes, MADV_SEQUENTIAL);
+  return img;
+}
+
+long long sdimage_size(void *h) {
+  return ((sdImage *)h)->bytes;
+}
+
+// Bytes past the end of the image read as zero and are not written, like the
+// unloaded entries of FLASHmem.  Only the first such access is reported.
+static int inside(sdImage *img, uint64_t addr) {
+  if (addr < img->bytes) return 1;
+  if (img->outside++ == 0)
+    fprintf(stderr, "sdimage: access to byte 0x%llx beyond the %llu byte image\n",
+            (unsigned long long)addr, (unsigned long long)img->bytes);
+  return 0;
+}
+
+unsigned char sdimage_read(void *h, unsigned long long addr) {
+  sdImage *img = h;
+  return inside(img, addr) ? img->mem[addr] : 0;
+}
+
+void sdimage_write(void *h, unsigned long long addr, unsigned char data) {
+  sdImage *img = h;
+  if (inside(img, addr)) img->mem[addr] = data;
+}
+
+void sdimage_close(void *h) {
+  sdImage *img = h;
+  if (!img) return;
+  munmap(img->mem, img->bytes);
+  free(img);
+}
@@ -0,0 +1,173 @@
+///////////////////////////////////////////
+// tracereader.c
+//
+// Written: Wally team 2023
+//
+// Purpose: DPI-C reader of the Linux instruction trace for testbench-linux.sv.
+//          A background thread decodes the indexed all.ltr (linuxtrace.h), or parses
+//          a text all.txt, into a ring of records; the testbench takes one record
+//          per retired instruction with a single call instead of tokenizing the
+//          line in SystemVerilog.  The E and M stages each open their own reader.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "linuxtrace.h"
+
+#define RING  4096   // records
+#define BATCH 256    // records handed over per lock
+
+typedef struct {
+  lt_reader      *ltr;
+  FILE           *txt;
+  char            path[1024];
+  lt_record       ring[RING];
+  uint64_t        head, tail;    // records produced / released, under lock
+  uint64_t        next, avail;   // consumer position and records known to be ready
+  int             done;
+  pthread_t       thread;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  char            text[LT_TEXT_LEN];
+} tracereader;
+
+// fetch one record from the file; 1 on success, 0 at the end, -1 on an error
+static int readRecord(tracereader *t, lt_record *rec, unsigned long long lineNum) {
+  char line[4096];
+  int st;
+  if (t->ltr) {
+    if ((st = lt_next(t->ltr, rec)) < 0) fprintf(stderr, "tracereader: corrupt chunk in %s\n", t->path);
+    return st;
+  }
+  if (!fgets(line, sizeof(line), t->txt)) return 0;
+  if (lt_parse(line, rec)) {
+    fprintf(stderr, "tracereader: %s line %llu is malformed: %s", t->path, lineNum, line);
+    return -1;
+  }
+  return 1;
+}
+
+static void *producer(void *arg) {
+  tracereader *t = arg;
+  uint64_t head = 0, tail = 0;
+  int st = 1, n;
+  while (st > 0) {
+    pthread_mutex_lock(&t->lock);
+    while (head + BATCH > t->tail + RING) pthread_cond_wait(&t->cond, &t->lock);
+    tail = t->tail;
+    pthread_mutex_unlock(&t->lock);
+    // slots from head up to tail + RING belong to this thread until published
+    for (n = 0; n < BATCH && head < tail + RING && (st = readRecord(t, &t->ring[head % RING], head + 1)) > 0; n++)
+      head++;
+    pthread_mutex_lock(&t->lock);
+    t->head = head;
+    if (st <= 0) t->done = 1;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+  }
+  return NULL;
+}
+
+// Open a trace and start decoding at instruction start (0 based).  Text traces
+// are assumed to begin at the wanted instruction already.
+void *linuxtrace_open(const char *path, unsigned long long start) {
+  tracereader *t;
+  char magic[4] = {0};
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    fprintf(stderr, "tracereader: cannot open %s\n", path);
+    return NULL;
+  }
+  t = calloc(1, sizeof(*t));
+  snprintf(t->path, sizeof(t->path), "%s", path);
+  if (fread(magic, 1, 4, fp) == 4 && !memcmp(magic, LT_MAGIC, 4)) {
+    fclose(fp);
+    if (!(t->ltr = lt_open(path)) || lt_seek(t->ltr, start)) {
+      fprintf(stderr, "tracereader: cannot start %s at instruction %llu\n", path, start);
+      if (t->ltr) lt_close(t->ltr);
+      free(t);
+      return NULL;
+    }
+  } else {
+    rewind(fp);
+    t->txt = fp;
+  }
+  pthread_mutex_init(&t->lock, NULL);
+  pthread_cond_init(&t->cond, NULL);
+  pthread_create(&t->thread, NULL, producer, t);
+  return t;
+}
+
+// next record, or NULL at the end of the trace
+static const lt_record *take(tracereader *t) {
+  if (t->next == t->avail) {
+    pthread_mutex_lock(&t->lock);
+    t->tail = t->next;
+    pthread_cond_broadcast(&t->cond);
+    while (t->head == t->next && !t->done) pthread_cond_wait(&t->cond, &t->lock);
+    t->avail = t->head;
+    pthread_mutex_unlock(&t->lock);
+    if (t->next == t->avail) return NULL;
+  } else if (t->next % BATCH == 0) {
+    // release consumed slots so the producer keeps running ahead
+    pthread_mutex_lock(&t->lock);
+    t->tail = t->next;
+    t->avail = t->head;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+  }
+  return &t->ring[t->next++ % RING];
+}
+
+// Returns 1 with the next instruction's expected state, or 0 at the end of the trace.
+// gprAdr is -1 without a register write; memOp is 0 none, 1 MemR, 2 MemW.
+int linuxtrace_next(void *h, unsigned long long *pc, unsigned int *instr, const char **text,
+                    int *gprAdr, unsigned long long *gprVal, int *memOp, unsigned long long *memAdr,
+                    unsigned long long *memWriteData, unsigned long long *memReadData,
+                    int *numCSRs, int *csr, unsigned long long *csrVal) {
+  tracereader *t = h;
+  const lt_record *r;
+  int i;
+  if (!t || !(r = take(t))) return 0;
+  *pc = r->pc;
+  *instr = r->instr;
+  memcpy(t->text, r->text, LT_TEXT_LEN);
+  *text = t->text;
+  *gprAdr = (r->flags & LT_GPR) ? r->gprAdr : -1;
+  *gprVal = r->gprVal;
+  *memOp = (r->flags & LT_MEMR) ? 1 : (r->flags & LT_MEMW) ? 2 : 0;
+  // addresses the trace printed as negative or above 2^64 wrap as the hardware does
+  *memAdr = (r->flags & LT_NEGADR) ? -r->memAdr : r->memAdr;
+  *memWriteData = r->memWriteData;
+  *memReadData = r->memReadData;
+  *numCSRs = r->numCSRs;
+  for (i = 0; i < r->numCSRs; i++) {
+    csr[i] = r->csr[i];
+    csrVal[i] = r->csrVal[i];
+  }
+  return 1;
+}
+
+// discard one instruction (one the testbench knows will not commit)
+void linuxtrace_skip(void *h) {
+  if (h) take(h);
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////
+// txt2ltr.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Pack a Linux instruction trace (all.txt from genTrace.sh) into the
+//          indexed binary form described in linuxtrace.h.  Every line is checked
+//          to render back to exactly the same text.
+//          usage: txt2ltr [-l zstd level] <all.txt | -> <all.ltr>
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "linuxtrace.h"
+
+int main(int argc, char *argv[]) {
+  FILE *in;
+  lt_writer *w;
+  lt_record rec;
+  char line[4096], check[4096];
+  unsigned long long lineNum = 0;
+#ifdef WALLY_TRACE_ZSTD
+  int level = 3, opt;
+#else
+  int level = 0, opt;
+#endif
+  while ((opt = getopt(argc, argv, "l:")) != -1) {
+    if (opt == 'l') level = atoi(optarg);
+    else return 1;
+  }
+  if (argc - optind != 2) {
+    fprintf(stderr, "Expected 2 arguments: <all.txt | -> <all.ltr>\n");
+    return 1;
+  }
+  in = strcmp(argv[optind], "-") ? fopen(argv[optind], "r") : stdin;
+  if (!in) { fprintf(stderr, "txt2ltr: cannot open %s\n", argv[optind]); return 1; }
+  if (!(w = lt_create(argv[optind + 1], level))) return 1;
+  while (fgets(line, sizeof(line), in)) {
+    size_t n = strcspn(line, "\n");
+    line[n] = 0;
+    lineNum++;
+    if (lt_parse(line, &rec) || lt_format(&rec, check, sizeof(check)) != (int)n || strcmp(line, check)) {
+      fprintf(stderr, "txt2ltr: cannot represent line %llu: %s\n", lineNum, line);
+      return 1;
+    }
+    if (lt_write(w, &rec)) {
+      fprintf(stderr, "txt2ltr: error writing %s\n", argv[optind + 1]);
+      return 1;
+    }
+  }
+  if (lt_finish(w)) {
+    fprintf(stderr, "txt2ltr: error writing %s\n", argv[optind + 1]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,305 @@
+///////////////////////////////////////////
+// wallytrace.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Reader for the cache/branch event traces described in wallytrace.h.
+//          Binary traces are decoded from large buffered reads; legacy text logs
+//          (ICache.log, DCache.log, branch_*.log) are parsed into the same events.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wallytrace.h"
+#ifdef WALLY_TRACE_ZSTD
+#include <zstd.h>
+#endif
+
+#define RDBUF (1 << 20)
+
+struct wt_reader {
+  FILE     *fp;
+  int       kind;          // 0 for text logs
+  uint8_t  *buf;           // decoded bytes
+  size_t    pos, len;
+  int       eof;
+  uint64_t  lastAddr, lastPC;
+  char      name[4096];
+  wt_retire retire;
+  uint64_t  lastOrder, x[32], f[32], csrs[WT_NUM_CSRS];
+#ifdef WALLY_TRACE_ZSTD
+  ZSTD_DStream *zs;
+  uint8_t  *zbuf;
+  ZSTD_inBuffer zin;
+#endif
+};
+
+// refill the decoded buffer, keeping unconsumed bytes; returns bytes available
+static size_t fill(wt_reader *r) {
+  size_t keep = r->len - r->pos, got;
+  memmove(r->buf, r->buf + r->pos, keep);
+  r->pos = 0;
+  r->len = keep;
+  if (r->eof) return r->len;
+#ifdef WALLY_TRACE_ZSTD
+  if (r->zs) {
+    ZSTD_outBuffer out = {r->buf, RDBUF, r->len};
+    while (out.pos < out.size) {
+      if (r->zin.pos == r->zin.size) {
+        r->zin.size = fread(r->zbuf, 1, ZSTD_DStreamInSize(), r->fp);
+        r->zin.pos = 0;
+        if (r->zin.size == 0) { r->eof = 1; break; }
+      }
+      if (ZSTD_isError(ZSTD_decompressStream(r->zs, &out, &r->zin))) { r->eof = 1; break; }
+    }
+    r->len = out.pos;
+    return r->len;
+  }
+#endif
+  got = fread(r->buf + r->len, 1, RDBUF - r->len, r->fp);
+  if (got == 0) r->eof = 1;
+  r->len += got;
+  return r->len;
+}
+
+static int byte(wt_reader *r) {
+  if (r->pos == r->len && fill(r) == 0) return -1;
+  return r->buf[r->pos++];
+}
+
+static int varint(wt_reader *r, uint64_t *v) {
+  int b, shift = 0;
+  *v = 0;
+  do {
+    if ((b = byte(r)) < 0 || shift > 63) return -1;
+    *v |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  return 0;
+}
+
+static uint64_t unzigzag(uint64_t v) { return (v >> 1) ^ -(v & 1); }
+
+static int isblank_(int c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// hex digit values, -1 otherwise; a table avoids a mispredicted branch per digit
+static signed char hexdigit[256];
+
+static void inithex(void) {
+  int c;
+  memset(hexdigit, -1, sizeof(hexdigit));
+  for (c = 0; c < 10; c++) hexdigit['0' + c] = c;
+  for (c = 0; c < 6; c++) hexdigit['a' + c] = hexdigit['A' + c] = 10 + c;
+}
+
+wt_reader *wt_open(const char *path) {
+  wt_reader *r;
+  FILE *fp = fopen(path, "rb");
+  if (!fp) { fprintf(stderr, "wallytrace: cannot open %s\n", path); return NULL; }
+  r = calloc(1, sizeof(*r));
+  r->fp = fp;
+  r->buf = malloc(RDBUF);
+  fill(r);
+#ifdef WALLY_TRACE_ZSTD
+  if (r->len >= 4 && r->buf[0] == 0x28 && r->buf[1] == 0xb5 && r->buf[2] == 0x2f && r->buf[3] == 0xfd) {
+    // zstd frame: restart and decode the file through the stream decompressor
+    r->zs = ZSTD_createDStream();
+    ZSTD_initDStream(r->zs);
+    r->zbuf = malloc(ZSTD_DStreamInSize());
+    r->zin.src = r->zbuf;
+    r->zin.size = r->zin.pos = 0;
+    rewind(fp);
+    r->pos = r->len = 0;
+    r->eof = 0;
+    fill(r);
+  }
+#else
+  if (r->len >= 4 && r->buf[0] == 0x28 && r->buf[1] == 0xb5 && r->buf[2] == 0x2f && r->buf[3] == 0xfd) {
+    fprintf(stderr, "wallytrace: %s is zstd compressed; rebuild with ZSTD=1\n", path);
+    wt_close(r);
+    return NULL;
+  }
+#endif
+  if (r->len >= 8 && memcmp(r->buf, WT_MAGIC, 4) == 0) {
+    if (r->buf[4] != WT_VERSION) {
+      fprintf(stderr, "wallytrace: %s has unsupported version %d\n", path, r->buf[4]);
+      wt_close(r);
+      return NULL;
+    }
+    r->kind = r->buf[5];
+    r->pos = 8;
+  }
+  if (!r->kind) inithex();
+  return r;
+}
+
+int wt_kind(const wt_reader *r) { return r->kind; }
+
+// one line of a legacy text log; tokenized by hand since the logs run to
+// hundreds of millions of lines
+static int nextText(wt_reader *r, wt_event *e) {
+  const char *p, *end, *tok[3];
+  size_t toklen;
+  char *nl;
+  int fields, d;
+  for (;;) {
+    if (r->pos == r->len && fill(r) == 0) return 0;
+    nl = memchr(r->buf + r->pos, '\n', r->len - r->pos);
+    if (!nl && !r->eof && r->len - r->pos < RDBUF) { fill(r); continue; }
+    p = (char *)r->buf + r->pos;
+    end = nl ? nl : (char *)r->buf + r->len;
+    r->pos = end - (char *)r->buf + (nl != NULL);
+    while (p < end && isblank_(*p)) p++;
+    if (p == end) continue;
+    // fast path for "<hex> <field> [<field>]" lines; keywords fall through
+    e->addr = 0;
+    for (tok[0] = p; p < end && (d = hexdigit[(uint8_t)*p]) >= 0; p++) e->addr = e->addr << 4 | d;
+    if (p == end || isblank_(*p)) {
+      for (fields = 1; fields < 3; fields++) {
+        while (p < end && isblank_(*p)) p++;
+        if (p == end) break;
+        tok[fields] = p;
+        while (p < end && !isblank_(*p)) p++;
+      }
+      if (fields == 2) {
+        e->type = WT_BRANCH;
+        e->taken = tok[1][0] == 't';
+        return 1;
+      }
+      if (fields == 3) {
+        e->type = WT_ACCESS;
+        e->access = tok[1][0];
+        e->outcome = tok[2][0];
+        return 1;
+      }
+      return -1;
+    }
+    while (p < end && !isblank_(*p)) p++;
+    toklen = p - tok[0];
+    while (p < end && isblank_(*p)) p++;
+    if (toklen == 5 && !memcmp(tok[0], "TRAIN", 5)) { e->type = WT_TRAIN; return 1; }
+    if ((toklen == 5 && !memcmp(tok[0], "BEGIN", 5)) || (toklen == 3 && !memcmp(tok[0], "END", 3))) {
+      size_t n = end - p;
+      while (n && isblank_(p[n-1])) n--;
+      if (n >= sizeof(r->name)) n = sizeof(r->name) - 1;
+      memcpy(r->name, p, n);
+      r->name[n] = 0;
+      e->type = tok[0][0] == 'B' ? WT_BEGIN : WT_END;
+      e->name = r->name;
+      return 1;
+    }
+    return -1;
+  }
+}
+
+// the RVVI record following op; registers and CSRs accumulate in the reader
+static int nextRetire(wt_reader *r, wt_event *e, int op) {
+  wt_retire *t = &r->retire;
+  uint64_t v, pcDelta, nextDelta, order;
+  int b, i, reg;
+  if ((b = byte(r)) < 0 || varint(r, &pcDelta) || varint(r, &nextDelta) || varint(r, &t->insn) || varint(r, &order))
+    return -1;
+  t->flags = op & 0x3f;
+  t->mode = b & 3;
+  t->ixl = b >> 2 & 3;
+  t->pc = r->lastPC + unzigzag(pcDelta);
+  t->pcNext = r->lastPC = t->pc + unzigzag(nextDelta);
+  t->order = r->lastOrder += unzigzag(order) + 1;
+  t->xReg = t->fReg = -1;
+  if (op & WT_RETIRE_X) {
+    if ((reg = byte(r)) < 0 || reg > 31 || varint(r, &t->xVal)) return -1;
+    r->x[t->xReg = reg] = t->xVal;
+  }
+  if (op & WT_RETIRE_F) {
+    if ((reg = byte(r)) < 0 || reg > 31 || varint(r, &t->fVal)) return -1;
+    r->f[t->fReg = reg] = t->fVal;
+  }
+  t->numCSRs = 0;
+  if (op & WT_RETIRE_CSR) {
+    if (varint(r, &v) || v > WT_MAX_CSRS) return -1;
+    t->numCSRs = v;
+    for (i = 0; i < t->numCSRs; i++) {
+      if (varint(r, &v) || v >= WT_NUM_CSRS) return -1;
+      t->csr[i] = v;
+      if (varint(r, &v)) return -1;
+      t->csrVal[i] = r->csrs[t->csr[i]] ^= v;
+    }
+  }
+  t->x = r->x;
+  t->f = r->f;
+  t->csrs = r->csrs;
+  e->type = WT_RETIRE;
+  e->addr = t->pc;
+  e->retire = t;
+  return 1;
+}
+
+int wt_next(wt_reader *r, wt_event *e) {
+  int op;
+  uint64_t v;
+  if (!r->kind) return nextText(r, e);
+  if ((op = byte(r)) < 0) return 0;
+  if (op < WT_OP_BRANCH) {
+    e->type = WT_ACCESS;
+    if ((op & 7) > 4 || (op >> 3) > 4) return -1;
+    e->access = wt_access_chars[op & 7];
+    e->outcome = wt_outcome_chars[op >> 3];
+    if (e->access == 'F' || e->access == 'I') { e->addr = 0; return 1; }
+    if (varint(r, &v)) return -1;
+    e->addr = r->lastAddr += unzigzag(v);
+    return 1;
+  }
+  if (op < WT_OP_BEGIN) {
+    if (op > WT_OP_BRANCH + 1) return -1;
+    e->type = WT_BRANCH;
+    e->taken = op & 1;
+    if (varint(r, &v)) return -1;
+    e->addr = r->lastPC += unzigzag(v);
+    return 1;
+  }
+  if (op >= WT_OP_RETIRE) return nextRetire(r, e, op);
+  if (op == WT_OP_TRAIN) { e->type = WT_TRAIN; return 1; }
+  if (op == WT_OP_BEGIN || op == WT_OP_END) {
+    size_t i;
+    int c;
+    if (varint(r, &v) || v >= sizeof(r->name)) return -1;
+    for (i = 0; i < v; i++) {
+      if ((c = byte(r)) < 0) return -1;
+      r->name[i] = c;
+    }
+    r->name[v] = 0;
+    e->type = op == WT_OP_BEGIN ? WT_BEGIN : WT_END;
+    e->name = r->name;
+    return 1;
+  }
+  return -1;
+}
+
+void wt_close(wt_reader *r) {
+  if (!r) return;
+#ifdef WALLY_TRACE_ZSTD
+  if (r->zs) ZSTD_freeDStream(r->zs);
+  free(r->zbuf);
+#endif
+  fclose(r->fp);
+  free(r->buf);
+  free(r);
+}
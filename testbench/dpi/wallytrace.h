@@ -0,0 +1,125 @@
+///////////////////////////////////////////
+// wallytrace.h
+//
+// Written: Wally team 2023
+//
+// Purpose: Compact binary event trace written by the cache and branch predictor
+//          loggers in testbench.sv and the RVVI tracer (wallyTracer.sv), and a reader
+//          that returns the events of either the binary trace or the legacy text logs
+//          to analysis tools.
+//
+// File layout (little endian):
+//   header   "WTRC" u8 version u8 kind u16 reserved
+//   records  u8 op followed by an op-dependent payload
+//     0x00-0x3f  cache access: op[2:0] access (R W A F I), op[5:3] outcome (H M E D X)
+//                R/W/A are followed by varint(zigzag(addr - previous addr))
+//     0x40-0x41  branch: op[0] taken, followed by varint(zigzag(pc - previous pc))
+//     0x80 BEGIN / 0x81 END, followed by varint(name length) and the name
+//     0x82 TRAIN
+//     0xc0-0xff  retired instruction (RVVI): op[0] trap, op[1] halt, op[2] intr,
+//                op[3] X write, op[4] F write, op[5] CSR writes, followed by
+//                u8 mode | ixl << 2, varint(zigzag(pc - previous pc_wdata)),
+//                varint(zigzag(pc_wdata - pc)), varint(insn), varint(zigzag(order - previous order - 1)),
+//                [u8 reg, varint(value)] for X and F, and for CSRs varint(count) then
+//                varint(csr) varint(value ^ previous value of that CSR) each
+// The whole stream may additionally be zstd compressed (detected by its frame magic).
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef WALLYTRACE_H
+#define WALLYTRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WT_MAGIC   "WTRC"
+#define WT_VERSION 1
+
+// stream kinds
+#define WT_KIND_ICACHE 1
+#define WT_KIND_DCACHE 2
+#define WT_KIND_BRANCH 3
+#define WT_KIND_RVVI   4
+
+// record opcodes
+#define WT_OP_BRANCH 0x40
+#define WT_OP_BEGIN  0x80
+#define WT_OP_END    0x81
+#define WT_OP_TRAIN  0x82
+#define WT_OP_RETIRE 0xc0
+
+// WT_OP_RETIRE flags
+#define WT_RETIRE_TRAP 0x01
+#define WT_RETIRE_HALT 0x02
+#define WT_RETIRE_INTR 0x04
+#define WT_RETIRE_X    0x08
+#define WT_RETIRE_F    0x10
+#define WT_RETIRE_CSR  0x20
+
+#define WT_NUM_CSRS    4096
+#define WT_MAX_CSRS    256    // CSR writes in one retire record
+
+// event types returned by the reader
+enum { WT_ACCESS, WT_BRANCH, WT_BEGIN, WT_END, WT_TRAIN, WT_RETIRE };
+
+static const char wt_access_chars[]  = "RWAFI";
+static const char wt_outcome_chars[] = "HMEDX";
+
+// one retired instruction with the architectural state it changed
+typedef struct {
+  uint64_t        order, pc, pcNext, insn;
+  int             flags;                  // WT_RETIRE_*
+  int             mode, ixl;
+  int             xReg, fReg;             // registers written, if WT_RETIRE_X/F
+  uint64_t        xVal, fVal;
+  int             numCSRs;
+  uint16_t        csr[WT_MAX_CSRS];       // CSRs written, in the order logged
+  uint64_t        csrVal[WT_MAX_CSRS];
+  const uint64_t *x, *f, *csrs;           // register files and CSRs after this instruction
+} wt_retire;
+
+typedef struct {
+  int         type;     // WT_ACCESS, WT_BRANCH, WT_BEGIN, WT_END, WT_TRAIN, WT_RETIRE
+  char        access;   // R W A F I for WT_ACCESS
+  char        outcome;  // H M E D X for WT_ACCESS, as logged by Wally
+  int         taken;    // WT_BRANCH direction
+  uint64_t    addr;     // physical address or branch PC
+  const char *name;     // test name for WT_BEGIN/WT_END, valid until the next call
+  const wt_retire *retire; // WT_RETIRE, valid until the next call
+} wt_event;
+
+typedef struct wt_reader wt_reader;
+
+// Open a binary (optionally zstd compressed) trace or a legacy text log.
+// Returns NULL and prints a message if the file cannot be read.
+wt_reader *wt_open(const char *path);
+// Fetch the next event.  Returns 1 on success, 0 at end of file, -1 on a malformed record.
+int        wt_next(wt_reader *r, wt_event *e);
+// Stream kind from the binary header, or 0 for a text log
+int        wt_kind(const wt_reader *r);
+void       wt_close(wt_reader *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
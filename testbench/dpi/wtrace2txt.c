@@ -0,0 +1,105 @@
+///////////////////////////////////////////
+// wtrace2txt.c
+//
+// Written: Wally team 2023
+//
+// Purpose: Render a binary cache/branch event trace in the original text log
+//          format (ICache.log, DCache.log, branch_*.log) for scripts that have
+//          not moved to the wallytrace reader, or an RVVI trace (rvvi.wtr) in the
+//          formats wallyTracer.sv prints.
+//          usage: wtrace2txt [-m pc|most|all] [-c] <trace> [address hex digits] > file.log
+//            -m  RVVI detail, as PRINT_PC_INSTR, PRINT_MOST (default) or PRINT_ALL
+//            -c  also list the CSRs each instruction changed, as PRINT_CSRS
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "wallytrace.h"
+
+enum { RVVI_PC, RVVI_MOST, RVVI_ALL };
+
+// the CSR a Zicsr instruction accesses, as CSRAdrW in wallyTracer.sv
+static int csrOf(uint64_t insn, int prev) {
+  return ((insn & 0x7f) == 0x73 && (insn >> 12 & 3) != 0) ? (int)(insn >> 20 & 0xfff) : prev;
+}
+
+static void printRetire(const wt_retire *t, int detail, int csrs) {
+  static int xReg, fReg, csrAdr;
+  int i;
+  if (t->xReg >= 0) xReg = t->xReg;
+  if (t->fReg >= 0) fReg = t->fReg;
+  csrAdr = csrOf(t->insn, csrAdr);
+  if (detail == RVVI_PC)
+    printf("order = %08" PRIu64 ", PC = %08" PRIx64 ", insn = %08" PRIx64 "\n", t->order, t->pc, t->insn);
+  else if (detail == RVVI_MOST)
+    printf("order = %08" PRIu64 ", PC = %010" PRIx64 ", insn = %08" PRIx64 ", trap = %d, halt = %d, intr = %d, mode = %x, "
+           "ixl = %x, pc_wdata = %010" PRIx64 ", x%02d = %016" PRIx64 ", f%02d = %016" PRIx64 ", csr%03x = %016" PRIx64 "\n",
+           t->order, t->pc, t->insn, !!(t->flags & WT_RETIRE_TRAP), !!(t->flags & WT_RETIRE_HALT),
+           !!(t->flags & WT_RETIRE_INTR), t->mode, t->ixl, t->pcNext, xReg, t->x[xReg], fReg, t->f[fReg],
+           csrAdr, t->csrs[csrAdr]);
+  else {
+    printf("order = %08" PRIu64 ", PC = %08" PRIx64 ", insn = %08" PRIx64 ", trap = %d, halt = %d, intr = %d, mode = %x, "
+           "ixl = %x, pc_wdata = %08" PRIx64 "\n", t->order, t->pc, t->insn, !!(t->flags & WT_RETIRE_TRAP),
+           !!(t->flags & WT_RETIRE_HALT), !!(t->flags & WT_RETIRE_INTR), t->mode, t->ixl, t->pcNext);
+    for (i = 0; i < 32; i++) printf("x%02d = %08" PRIx64 "\n", i, t->x[i]);
+    for (i = 0; i < 32; i++) printf("f%02d = %08" PRIx64 "\n", i, t->f[i]);
+  }
+  // the simulation time is not recorded, so the order stands in for it
+  if (csrs)
+    for (i = 0; i < t->numCSRs; i++) printf("%" PRIu64 ": CSR %03x = %016" PRIx64 "\n", t->order, t->csr[i], t->csrVal[i]);
+}
+
+int main(int argc, char *argv[]) {
+  wt_reader *r;
+  wt_event e;
+  int status, digits, opt, detail = RVVI_MOST, csrs = 0;
+  while ((opt = getopt(argc, argv, "m:c")) != -1) {
+    if (opt == 'm') detail = !strcmp(optarg, "pc") ? RVVI_PC : !strcmp(optarg, "all") ? RVVI_ALL : RVVI_MOST;
+    else if (opt == 'c') csrs = 1;
+    else return 1;
+  }
+  if (argc - optind < 1) {
+    fprintf(stderr, "Expected 1 argument: <trace>\n");
+    return 1;
+  }
+  if (!(r = wt_open(argv[optind]))) return 1;
+  // the loggers print addresses with %h at the full signal width: PA_BITS = 56 for
+  // the caches and XLEN = 64 for the branch PC by default
+  if (argc - optind > 1) digits = atoi(argv[optind + 1]);
+  else digits = (wt_kind(r) == WT_KIND_BRANCH) ? 16 : 14;
+  while ((status = wt_next(r, &e)) > 0) {
+    switch (e.type) {
+      case WT_RETIRE: printRetire(e.retire, detail, csrs); break;
+      case WT_TRAIN:  printf("TRAIN\n"); break;
+      case WT_BEGIN:  printf("BEGIN %s\n", e.name); break;
+      case WT_END:    printf("END %s\n", e.name); break;
+      case WT_BRANCH: printf("%0*" PRIx64 " %c\n", digits, e.addr, e.taken ? 't' : 'n'); break;
+      default:
+        if (e.access == 'F' || e.access == 'I') printf("0 %c X\n", e.access);
+        else printf("%0*" PRIx64 " %c %c\n", digits, e.addr, e.access, e.outcome);
+    }
+  }
+  wt_close(r);
+  if (status < 0) fprintf(stderr, "wtrace2txt: malformed record in %s\n", argv[optind]);
+  return status < 0;
+}
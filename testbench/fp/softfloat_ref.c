@@ -0,0 +1,393 @@
+///////////////////////////////////////////
+// softfloat_ref.c
+//
+// Written: Wally team 2023
+//
+// Purpose: SoftFloat reference model for testbench-fp.sv, called through DPI-C.
+//          Generates constrained-random operands, computes the expected result and
+//          flags with SoftFloat and packs them in the same layout TestFloat writes
+//          to the .tv files, so readvectors consumes them unchanged.  Vectors are
+//          produced a batch at a time to amortize the DPI call overhead, and each
+//          answer is recomputed from the operands the DUT is actually given.
+//
+// A component of the Wally configurable RISC-V project.
+//
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+// either express or implied. See the License for the specific language governing permissions
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <string.h>
+#include "svdpi.h"
+#include "softfloat.h"
+
+// must match tests-fp.vh
+#define CVTINTUNIT 0
+#define DIVUNIT    1
+#define FMAUNIT    2
+#define CMPUNIT    3
+#define CVTFPUNIT  4
+
+#define FMA_OPCTRL 0
+#define MUL_OPCTRL 4
+#define ADD_OPCTRL 6
+#define SUB_OPCTRL 7
+#define LT_OPCTRL  1
+#define EQ_OPCTRL  2
+#define LE_OPCTRL  3
+
+// Fmt encoding used by the FPU: 00 single, 01 double, 10 half, 11 quad
+static const int fmtLen[4] = {32, 64, 16, 128};
+static const int fmtNE[4]  = {8, 11, 5, 15};
+
+typedef struct { uint64_t lo, hi; } fpval; // up to 128-bit operand/result
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ull;
+
+// xorshift64* - fast and good enough for stimulus
+static uint64_t rnd(void) {
+  rngState ^= rngState >> 12;
+  rngState ^= rngState << 25;
+  rngState ^= rngState >> 27;
+  return rngState * 0x2545F4914F6CDD1Dull;
+}
+
+static fpval mask(fpval v, int len) {
+  if (len < 64) { v.lo &= (1ull << len) - 1; v.hi = 0; }
+  else if (len == 64) v.hi = 0;
+  return v;
+}
+
+// field insertion into a little-endian array of 32-bit words
+static void setField(uint32_t *w, int *pos, fpval v, int len) {
+  for (int i = 0; i < len; i++, (*pos)++) {
+    uint64_t bit = (i < 64) ? (v.lo >> i) & 1 : (v.hi >> (i - 64)) & 1;
+    if (bit) w[*pos / 32] |= 1u << (*pos % 32);
+  }
+}
+
+static void getField(const svBitVecVal *w, int len, fpval *v) {
+  v->lo = v->hi = 0;
+  for (int i = 0; i < len; i++) {
+    uint64_t bit = (w[i / 32] >> (i % 32)) & 1;
+    if (i < 64) v->lo |= bit << i; else v->hi |= bit << (i - 64);
+  }
+}
+
+// Constrained-random floating-point operand: special values are weighted heavily
+// because they are where the hardware bugs live.
+static fpval randFp(int fmt) {
+  int len = fmtLen[fmt], ne = fmtNE[fmt], nf = len - ne - 1;
+  uint64_t emax = (1ull << ne) - 1, exp;
+  fpval m = {rnd(), rnd()}, v;
+  m = mask(m, nf);
+  switch (rnd() % 16) {
+    case 0:  exp = 0; m.lo = m.hi = 0; break;                      // zero
+    case 1:  exp = 0; if (!(m.lo | m.hi)) m.lo = 1; break;         // subnormal
+    case 2:  exp = emax; m.lo = m.hi = 0; break;                   // infinity
+    case 3:  exp = emax;                                           // quiet NaN
+             if (nf > 64) m.hi |= 1ull << (nf - 65); else m.lo |= 1ull << (nf - 1);
+             break;
+    case 4:  exp = emax;                                           // signaling NaN
+             if (nf > 64) m.hi &= ~(1ull << (nf - 65)); else m.lo &= ~(1ull << (nf - 1));
+             if (!(m.lo | m.hi)) m.lo = 1;
+             break;
+    case 5:  exp = emax - 1 - rnd() % 3; break;                    // near overflow
+    case 6:  exp = 1 + rnd() % 3; break;                           // near underflow
+    case 7:  exp = (emax >> 1) + rnd() % 5 - 2; break;             // near one
+    case 8:  exp = rnd() % (emax + 1); m.lo = m.hi = 0; break;     // power of two
+    default: exp = rnd() % (emax + 1); break;                      // anything
+  }
+  v = m;
+  if (nf >= 64) v.hi |= exp << (nf - 64);
+  else { v.lo |= exp << nf; v.hi = exp >> (64 - nf); }
+  if (rnd() & 1) { if (len > 64) v.hi |= 1ull << 63; else v.lo |= 1ull << (len - 1); }
+  return mask(v, len);
+}
+
+static uint64_t randInt(int len) {
+  uint64_t v;
+  switch (rnd() % 8) {
+    case 0:  v = 0; break;
+    case 1:  v = ~0ull; break;                          // -1 / max unsigned
+    case 2:  v = 1ull << (len - 1); break;              // most negative
+    case 3:  v = (1ull << (len - 1)) - 1; break;        // most positive
+    case 4:  v = rnd() >> (rnd() % 64); break;          // small magnitude
+    default: v = rnd(); break;
+  }
+  return len == 64 ? v : v & 0xFFFFFFFFull;
+}
+
+static uint_fast8_t riscvRm(int frm) {
+  switch (frm) {
+    case 1:  return softfloat_round_minMag;
+    case 2:  return softfloat_round_min;
+    case 3:  return softfloat_round_max;
+    case 4:  return softfloat_round_near_maxMag;
+    default: return softfloat_round_near_even;
+  }
+}
+
+static float16_t  toH(fpval v) { float16_t r;  r.v = v.lo; return r; }
+static float32_t  toS(fpval v) { float32_t r;  r.v = v.lo; return r; }
+static float64_t  toD(fpval v) { float64_t r;  r.v = v.lo; return r; }
+static float128_t toQ(fpval v) { float128_t r; r.v[0] = v.lo; r.v[1] = v.hi; return r; }
+static fpval fromH(float16_t a)  { fpval r = {a.v, 0}; return r; }
+static fpval fromS(float32_t a)  { fpval r = {a.v, 0}; return r; }
+static fpval fromD(float64_t a)  { fpval r = {a.v, 0}; return r; }
+static fpval fromQ(float128_t a) { fpval r = {a.v[0], a.v[1]}; return r; }
+
+#define FPOP2(name) \
+  static fpval name(int fmt, fpval a, fpval b) { \
+    switch (fmt) { \
+      case 0:  return fromS(f32_##name(toS(a), toS(b))); \
+      case 1:  return fromD(f64_##name(toD(a), toD(b))); \
+      case 2:  return fromH(f16_##name(toH(a), toH(b))); \
+      default: return fromQ(f128_##name(toQ(a), toQ(b))); \
+    } \
+  }
+FPOP2(add)
+FPOP2(sub)
+FPOP2(mul)
+FPOP2(div)
+
+#define FPCMP(name) \
+  static int name(int fmt, fpval a, fpval b) { \
+    switch (fmt) { \
+      case 0:  return f32_##name(toS(a), toS(b)); \
+      case 1:  return f64_##name(toD(a), toD(b)); \
+      case 2:  return f16_##name(toH(a), toH(b)); \
+      default: return f128_##name(toQ(a), toQ(b)); \
+    } \
+  }
+FPCMP(eq)
+FPCMP(le)
+FPCMP(lt)
+
+static fpval mulAdd(int fmt, fpval a, fpval b, fpval c) {
+  switch (fmt) {
+    case 0:  return fromS(f32_mulAdd(toS(a), toS(b), toS(c)));
+    case 1:  return fromD(f64_mulAdd(toD(a), toD(b), toD(c)));
+    case 2:  return fromH(f16_mulAdd(toH(a), toH(b), toH(c)));
+    default: return fromQ(f128_mulAdd(toQ(a), toQ(b), toQ(c)));
+  }
+}
+
+static fpval sqrtOp(int fmt, fpval a) {
+  switch (fmt) {
+    case 0:  return fromS(f32_sqrt(toS(a)));
+    case 1:  return fromD(f64_sqrt(toD(a)));
+    case 2:  return fromH(f16_sqrt(toH(a)));
+    default: return fromQ(f128_sqrt(toQ(a)));
+  }
+}
+
+static fpval cvtFp(int from, int to, fpval a) {
+  float128_t q;
+  if (from == to) return a;
+  switch (from) {
+    case 0:
+      if (to == 1) return fromD(f32_to_f64(toS(a)));
+      if (to == 2) return fromH(f32_to_f16(toS(a)));
+      return fromQ(f32_to_f128(toS(a)));
+    case 1:
+      if (to == 0) return fromS(f64_to_f32(toD(a)));
+      if (to == 2) return fromH(f64_to_f16(toD(a)));
+      return fromQ(f64_to_f128(toD(a)));
+    case 2:
+      if (to == 0) return fromS(f16_to_f32(toH(a)));
+      if (to == 1) return fromD(f16_to_f64(toH(a)));
+      return fromQ(f16_to_f128(toH(a)));
+    default:
+      q = toQ(a);
+      if (to == 0) return fromS(f128_to_f32(q));
+      if (to == 1) return fromD(f128_to_f64(q));
+      return fromH(f128_to_f16(q));
+  }
+}
+
+// integer -> float; isLong selects 64-bit source, isSigned selects signed interpretation
+static fpval intToFp(int fmt, uint64_t i, int isLong, int isSigned) {
+  if (isLong) {
+    if (isSigned) switch (fmt) {
+      case 0: return fromS(i64_to_f32(i)); case 1: return fromD(i64_to_f64(i));
+      case 2: return fromH(i64_to_f16(i)); default: return fromQ(i64_to_f128(i)); }
+    else switch (fmt) {
+      case 0: return fromS(ui64_to_f32(i)); case 1: return fromD(ui64_to_f64(i));
+      case 2: return fromH(ui64_to_f16(i)); default: return fromQ(ui64_to_f128(i)); }
+  } else {
+    if (isSigned) switch (fmt) {
+      case 0: return fromS(i32_to_f32(i)); case 1: return fromD(i32_to_f64(i));
+      case 2: return fromH(i32_to_f16(i)); default: return fromQ(i32_to_f128(i)); }
+    else switch (fmt) {
+      case 0: return fromS(ui32_to_f32(i)); case 1: return fromD(ui32_to_f64(i));
+      case 2: return fromH(ui32_to_f16(i)); default: return fromQ(ui32_to_f128(i)); }
+  }
+}
+
+// float -> integer, exact (raises inexact) to match create_vectors.sh
+static uint64_t fpToInt(int fmt, fpval a, int isLong, int isSigned, uint_fast8_t rm) {
+  if (isLong) {
+    if (isSigned) switch (fmt) {
+      case 0: return f32_to_i64(toS(a), rm, 1); case 1: return f64_to_i64(toD(a), rm, 1);
+      case 2: return f16_to_i64(toH(a), rm, 1); default: return f128_to_i64(toQ(a), rm, 1); }
+    else switch (fmt) {
+      case 0: return f32_to_ui64(toS(a), rm, 1); case 1: return f64_to_ui64(toD(a), rm, 1);
+      case 2: return f16_to_ui64(toH(a), rm, 1); default: return f128_to_ui64(toQ(a), rm, 1); }
+  } else {
+    if (isSigned) switch (fmt) {
+      case 0: return (uint32_t)f32_to_i32(toS(a), rm, 1); case 1: return (uint32_t)f64_to_i32(toD(a), rm, 1);
+      case 2: return (uint32_t)f16_to_i32(toH(a), rm, 1); default: return (uint32_t)f128_to_i32(toQ(a), rm, 1); }
+    else switch (fmt) {
+      case 0: return f32_to_ui32(toS(a), rm, 1); case 1: return f64_to_ui32(toD(a), rm, 1);
+      case 2: return f16_to_ui32(toH(a), rm, 1); default: return f128_to_ui32(toQ(a), rm, 1); }
+  }
+}
+
+// Compute one operation.  op[] holds the operands in the order TestFloat prints them;
+// the result and its width are returned through res/resLen, the flags as the return value.
+static int compute(int unit, int fmt, int opctrl, int frm, fpval *op, fpval *res, int *resLen) {
+  int len = fmtLen[fmt];
+  softfloat_roundingMode = riscvRm(frm);
+  softfloat_detectTininess = softfloat_tininess_afterRounding;
+  softfloat_exceptionFlags = 0;
+  switch (unit) {
+    case FMAUNIT:
+      *resLen = len;
+      switch (opctrl) {
+        case FMA_OPCTRL: *res = mulAdd(fmt, op[0], op[1], op[2]); break;
+        case MUL_OPCTRL: *res = mul(fmt, op[0], op[1]); break;
+        case SUB_OPCTRL: *res = sub(fmt, op[0], op[1]); break;
+        default:         *res = add(fmt, op[0], op[1]); break;
+      }
+      break;
+    case DIVUNIT:
+      *resLen = len;
+      *res = (opctrl & 1) ? sqrtOp(fmt, op[0]) : div(fmt, op[0], op[1]);
+      break;
+    case CMPUNIT:
+      *resLen = 4;
+      res->hi = 0;
+      res->lo = (opctrl == EQ_OPCTRL) ? eq(fmt, op[0], op[1]) :
+                (opctrl == LE_OPCTRL) ? le(fmt, op[0], op[1]) : lt(fmt, op[0], op[1]);
+      break;
+    case CVTFPUNIT:
+      *resLen = fmtLen[opctrl & 3];
+      *res = cvtFp(fmt, opctrl & 3, op[0]);
+      break;
+    default: // CVTINTUNIT: OpCtrl = {from int, long, signed}
+      if (opctrl & 4) {
+        *resLen = len;
+        *res = intToFp(fmt, op[0].lo, (opctrl >> 1) & 1, opctrl & 1);
+      } else {
+        *resLen = (opctrl & 2) ? 64 : 32;
+        res->hi = 0;
+        res->lo = fpToInt(fmt, op[0], (opctrl >> 1) & 1, opctrl & 1, softfloat_roundingMode);
+      }
+      break;
+  }
+  return softfloat_exceptionFlags & 0x1F;
+}
+
+// operand count and widths for a given operation, in TestFloat print order
+static int operands(int unit, int fmt, int opctrl, int *opLen) {
+  int len = fmtLen[fmt];
+  opLen[0] = opLen[1] = opLen[2] = len;
+  switch (unit) {
+    case FMAUNIT:    return (opctrl == FMA_OPCTRL) ? 3 : 2;
+    case DIVUNIT:    return (opctrl & 1) ? 1 : 2;
+    case CMPUNIT:    return 2;
+    case CVTFPUNIT:  return 1;
+    default:
+      if (opctrl & 4) opLen[0] = (opctrl & 2) ? 64 : 32;
+      return 1;
+  }
+}
+
+/////////////////////////////////////////////
+// DPI-C entry points
+/////////////////////////////////////////////
+
+void sfref_seed(int seed) {
+  rngState = 0x9E3779B97F4A7C15ull ^ ((uint64_t)(uint32_t)seed * 0xBF58476D1CE4E5B9ull);
+  if (!rngState) rngState = 1;
+}
+
+// Fill vectors[0..n-1] with random stimulus and SoftFloat answers for the selected
+// unit/fmt/opctrl/frm, and mark vectors[n] as all x so the testbench sees the end of
+// the batch exactly as it sees the end of a $readmemh'd file.  Returns n.
+int sfref_gen(int unit, int fmt, int opctrl, int frm, int vecLen, int n, const svOpenArrayHandle vectors) {
+  int words = (vecLen + 31) / 32, opLen[3], nops, resLen, pos, i, k, flags;
+  uint32_t buf[(128 * 4 + 8 + 31) / 32];
+  fpval op[3], res, f;
+  svLogicVecVal *v;
+
+  for (i = 0; i < n; i++) {
+    nops = operands(unit, fmt, opctrl, opLen);
+    for (k = 0; k < nops; k++) {
+      if (opLen[k] == fmtLen[fmt] && !(unit == CVTINTUNIT && (opctrl & 4))) op[k] = randFp(fmt);
+      else { op[k].lo = randInt(opLen[k]); op[k].hi = 0; }
+    }
+    flags = compute(unit, fmt, opctrl, frm, op, &res, &resLen);
+
+    // pack least significant field first: flags, result, then operands in reverse order
+    memset(buf, 0, sizeof(buf));
+    pos = 0;
+    f.lo = flags; f.hi = 0;
+    setField(buf, &pos, f, 8);
+    setField(buf, &pos, res, resLen);
+    for (k = nops - 1; k >= 0; k--) setField(buf, &pos, op[k], opLen[k]);
+
+    v = (svLogicVecVal *)svGetArrElemPtr1(vectors, i);
+    for (k = 0; k < words; k++) { v[k].aval = buf[k]; v[k].bval = 0; }
+  }
+  v = (svLogicVecVal *)svGetArrElemPtr1(vectors, n);
+  if (v) for (k = 0; k < words; k++) { v[k].aval = ~0u; v[k].bval = ~0u; }
+  return n;
+}
+
+// Single-operation reference: compute the expected answer and flags for the operands
+// readvectors drives into the DUT, so testbench-fp.sv checks each result against what
+// the DUT was given.  x/y/z are FLEN wide, srca is the integer source.  Operands are taken in the
+// DUT's orientation: for add/sub Z is the addend and Y is ignored.
+void sfref_compute(int unit, int fmt, int opctrl, int frm, int flen,
+                   const svBitVecVal *x, const svBitVecVal *y, const svBitVecVal *z,
+                   const svBitVecVal *srca, int xlen, svBitVecVal *ans, int *flags) {
+  fpval op[3], res;
+  int opLen[3], resLen, i;
+
+  operands(unit, fmt, opctrl, opLen);
+  getField(x, flen, &op[0]);
+  getField(y, flen, &op[1]);
+  getField(z, flen, &op[2]);
+  op[1] = mask(op[1], fmtLen[fmt]);
+  op[2] = mask(op[2], fmtLen[fmt]);
+  if (unit == CVTINTUNIT && (opctrl & 4)) getField(srca, xlen, &op[0]);
+  else op[0] = mask(op[0], fmtLen[fmt]);
+  if (unit == FMAUNIT && (opctrl == ADD_OPCTRL || opctrl == SUB_OPCTRL)) op[1] = op[2];
+  *flags = compute(unit, fmt, opctrl, frm, op, &res, &resLen);
+
+  // NaN-box floating-point results to FLEN and sign-extend 32-bit integer results
+  // like the readvectors module does
+  for (i = 0; i < (flen + 31) / 32; i++) ans[i] = 0;
+  for (i = 0; i < flen; i++) {
+    uint64_t bit;
+    if (i < resLen) bit = (i < 64) ? (res.lo >> i) & 1 : (res.hi >> (i - 64)) & 1;
+    else if (unit == CMPUNIT) bit = 0;
+    else if (unit == CVTINTUNIT && !(opctrl & 4)) bit = (i < xlen) && ((res.lo >> 31) & 1);
+    else bit = 1;
+    if (bit) ans[i / 32] |= 1u << (i % 32);
+  }
+}
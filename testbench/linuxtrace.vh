@@ -0,0 +1,47 @@
+///////////////////////////////////////////
+// linuxtrace.vh
+//
+// Written: Wally team 2023
+//
+// Purpose: DPI-C imports for the Linux instruction trace reader
+//          (testbench/dpi/tracereader.c, built into linuxtrace.so) used by
+//          testbench-linux.sv to fetch the expected state of each instruction,
+//          and for the sparse RAM checkpoint loader (testbench/dpi/ramloader.c).
+// 
+// A component of the Wally configurable RISC-V project.
+// 
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file 
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You 
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the 
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, 
+// either express or implied. See the License for the specific language governing permissions 
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// path is all.ltr (started at instruction start, 0 based) or a text all.txt
+import "DPI-C" function chandle linuxtrace_open(input string path, input longint unsigned start);
+// returns 0 at the end of the trace; gprAdr -1 for no register write; memOp 0 none, 1 MemR, 2 MemW;
+// csr holds indices into LinuxTraceCSRNames
+import "DPI-C" function int     linuxtrace_next(input chandle h, output longint unsigned pc, output int unsigned instr,
+                                                output string text, output int gprAdr, output longint unsigned gprVal,
+                                                output int memOp, output longint unsigned memAdr,
+                                                output longint unsigned memWriteData, output longint unsigned memReadData,
+                                                output int numCSRs, output int csr[0:16], output longint unsigned csrVal[0:16]);
+import "DPI-C" function void    linuxtrace_skip(input chandle h);
+
+// lt_csr_names in testbench/dpi/linuxtrace.h
+localparam string LinuxTraceCSRNames[0:16] = '{"mhartid", "mstatus", "mip", "mie", "mideleg", "medeleg", "mtvec",
+                                                "stvec", "mepc", "sepc", "mcause", "scause", "mtval", "stval",
+                                                "mscratch", "sscratch", "satp"};
+
+// loads checkpointN/ram.rpg, made against the base image ram.bin, into mem by word address;
+// returns the number of non-zero pages or -1 on an error
+import "DPI-C" function int     ramcheckpoint_load(input string path, input string basePath, output logic [63:0] mem[]);
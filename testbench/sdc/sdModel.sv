@@ -45,6 +45,46 @@ module    sdModel
    reg [32:0] ByteAddr;
    reg [7:0]  Inbuff [0:511];
    reg [7:0]  FLASHmem [logic[32:0]];
+
+   // With +SDIMAGE=card.img the testbench calls openImage, and the card's contents
+   // come from the image file mapped by testbench/dpi/sdimage.c instead of FLASHmem,
+   // so no hex file need be read before the simulation starts.  sim/wally.do defines
+   // SDIMAGE_DPI only when sdimage.so has been built.
+`ifdef SDIMAGE_DPI
+   import "DPI-C" function chandle      sdimage_open(input string filename);
+   import "DPI-C" function longint      sdimage_size(input chandle h);
+   import "DPI-C" function byte unsigned sdimage_read(input chandle h, input longint unsigned addr);
+   import "DPI-C" function void         sdimage_write(input chandle h, input longint unsigned addr, input byte unsigned data);
+`endif
+   chandle    SDImage = null;
+
+   task openImage(input string filename);
+`ifdef SDIMAGE_DPI
+      SDImage = sdimage_open(filename);
+      if (SDImage == null) $fatal(1, "sdModel: cannot map SD card image %s", filename);
+      $display("sdModel: SD card image %s, %0d blocks", filename, sdimage_size(SDImage) / `BLOCKSIZE);
+`else
+      $fatal(1, "sdModel: +SDIMAGE=%s needs testbench/dpi/sdimage.so; build it with make in testbench/dpi", filename);
+`endif
+   endtask
+
+   function automatic [3:0] flashNibble(input [32:0] addr, input bit upper);
+      reg [7:0] data;
+`ifdef SDIMAGE_DPI
+      if (SDImage != null) data = sdimage_read(SDImage, addr);
+      else
+`endif
+      data = FLASHmem[addr];
+      flashNibble = upper ? data[7:4] : data[3:0];
+   endfunction
+
+   task automatic flashWrite(input [32:0] addr, input [7:0] data);
+`ifdef SDIMAGE_DPI
+      if (SDImage != null) sdimage_write(SDImage, addr, data);
+      else
+`endif
+      FLASHmem[addr] = data;
+   endtask
    reg [7:0]  wide_data [0:63];
    
    
@@ -936,8 +976,8 @@ module    sdModel
 	   
 	   if (transf_cnt==1) begin  // first nibble
               if (BLOCK_WIDTH == 11'd1044) begin
-		 last_din <= FLASHmem[ByteAddr+(write_out_index)][7:4]; // LOAD register with upper nibble
-		 crcDat_in<= FLASHmem[ByteAddr+(write_out_index)][7:4];  // LOAD CRC16 with upper nibble
+		 last_din <= flashNibble(ByteAddr+(write_out_index), 1); // LOAD register with upper nibble
+		 crcDat_in<= flashNibble(ByteAddr+(write_out_index), 1);  // LOAD CRC16 with upper nibble
 	      end
 	      else begin
 		 // code for wide width data
@@ -952,8 +992,8 @@ module    sdModel
               data_send_index<=~data_send_index; //toggle
               if (!data_send_index) begin //upper nibble
 		 if (BLOCK_WIDTH == 11'd1044) begin
-		    last_din <= FLASHmem[ByteAddr+(write_out_index)][7:4]; // LOAD register with upper nibble
-		    crcDat_in<= FLASHmem[ByteAddr+(write_out_index)][7:4];  // LOAD CRC16 with upper nibble
+		    last_din <= flashNibble(ByteAddr+(write_out_index), 1); // LOAD register with upper nibble
+		    crcDat_in<= flashNibble(ByteAddr+(write_out_index), 1);  // LOAD CRC16 with upper nibble
 		 end
 		 else begin
 		    // code for wide width data
@@ -963,14 +1003,14 @@ module    sdModel
               end // if (!data_send_index)
               else begin //lower nibble
 		 if (BLOCK_WIDTH == 11'd1044) begin
-		    last_din<=FLASHmem[ByteAddr+(write_out_index)][3:0];
+		    last_din<=flashNibble(ByteAddr+(write_out_index), 0);
 		 end
 		 else begin
 		    last_din <= wide_data[write_out_index][3:0];
 		 end		 
 		 if (!add_wrong_data_crc)
 		   if (BLOCK_WIDTH == 11'd1044) begin
-		      crcDat_in<= FLASHmem[ByteAddr+(write_out_index)][3:0];
+		      crcDat_in<= flashNibble(ByteAddr+(write_out_index), 0);
 		   end
 		   else begin
 		      crcDat_in <= wide_data[write_out_index][3:0];
@@ -1037,8 +1077,8 @@ module    sdModel
 	      datOut[0]<=0;
 	      
 	      flash_blockwrite_cnt<=flash_blockwrite_cnt+2;
-	      FLASHmem[ByteAddr+(flash_blockwrite_cnt)]=Inbuff[flash_blockwrite_cnt];
-	      FLASHmem[ByteAddr+(flash_blockwrite_cnt+1)]=Inbuff[flash_blockwrite_cnt+1];
+	      flashWrite(ByteAddr+(flash_blockwrite_cnt), Inbuff[flash_blockwrite_cnt]);
+	      flashWrite(ByteAddr+(flash_blockwrite_cnt+1), Inbuff[flash_blockwrite_cnt+1]);
 	   end
 	   
 	   else begin
@@ -28,6 +28,8 @@
 
 module testbenchfp;
   parameter TEST="none";
+  parameter NUMVECTORS=100000;   // random vectors per test with FP_REFMODEL defined (0 = cycle through all the tests a batch at a time, forever)
+  parameter SEED=1;              // random seed for FP_REFMODEL stimulus
 
   string                       Tests[];                    // list of tests to be run
   logic [2:0]                  OpCtrl[];                   // list of op controls
@@ -43,6 +45,10 @@ module testbenchfp;
   logic [31:0]                 VectorNum=0;                // index for test vector
   logic [31:0]                 FrmNum=0;                   // index for rounding mode
   logic [`FLEN*4+7:0]          TestVectors[8388609:0];     // list of test vectors
+  logic [31:0]                 RefCount=0;                 // vectors produced by the reference model for this test
+  logic [31:0]                 RefPass=0;                  // passes through all the tests with NUMVECTORS=0
+  bit   [`FLEN-1:0]            RefAns;                     // reference model answer for the operands the DUT sees
+  int                          RefFlg;                     // and its flags
 
   logic [1:0]                  FmtVal;                     // value of the current Fmt
   logic [2:0]                  UnitVal, OpCtrlVal, FrmVal; // value of the currnet Unit/OpCtrl/FrmVal
@@ -624,10 +630,37 @@ module testbenchfp;
 
   ///////////////////////////////////////////////////////////////////////////////////////////////
 
+`ifdef FP_REFMODEL
+  // SoftFloat reference model (testbench/fp/softfloat_ref.c).  Instead of reading
+  // TestFloat vector files, random operands and their expected results are generated
+  // in C in the same layout, a batch at a time, and fed through readvectors.
+  localparam REFBATCH = 4096;
+  import "DPI-C" function void sfref_seed(input int seed);
+  import "DPI-C" function int  sfref_gen(input int unit, input int fmt, input int opctrl, input int frm, 
+                                         input int veclen, input int n, inout logic [`FLEN*4+7:0] vectors[]);
+  import "DPI-C" function void sfref_compute(input int unit, input int fmt, input int opctrl, input int frm, input int flen,
+                                             input bit [`FLEN-1:0] x, input bit [`FLEN-1:0] y, input bit [`FLEN-1:0] z,
+                                             input bit [`XLEN-1:0] srca, input int xlen, 
+                                             output bit [`FLEN-1:0] ans, output int flags);
+
+  task RefFill;
+    int n;
+    if (NUMVECTORS == 0 | NUMVECTORS - RefCount > REFBATCH) n = REFBATCH; // one batch per test with NUMVECTORS=0
+    else n = NUMVECTORS - RefCount;
+    void'(sfref_gen(Unit[TestNum], Fmt[TestNum], OpCtrl[OpCtrlNum], Frm[FrmNum], `FLEN*4+8, n, TestVectors));
+    RefCount += n;
+  endtask
+`endif
+
   // Read the first test
   initial begin
     $display("\n\nRunning %s vectors", Tests[TestNum]);
+`ifdef FP_REFMODEL
+    sfref_seed(SEED);
+    RefFill();
+`else
     $readmemh({`PATH, Tests[TestNum]}, TestVectors);
+`endif
     // set the test index to 0
     TestNum = 0;
   end
@@ -820,6 +853,19 @@ always @(posedge clk)
 // check results on falling edge of clk
 always @(negedge clk) begin
 
+`ifdef FP_REFMODEL
+    // Recompute the answer from the operands readvectors actually drove into the DUT, so
+    // every result is checked against them and not only against the stored vector
+    if (~reset & TestVectors[VectorNum][0] !== 1'bx) begin
+      sfref_compute(UnitVal, FmtVal, OpCtrlVal, FrmVal, `FLEN, X, Y, Z, SrcA, `XLEN, RefAns, RefFlg);
+      if (RefAns !== Ans | RefFlg[4:0] !== AnsFlg) begin
+        errors += 1;
+        $display("Reference model mismatch in %s", Tests[TestNum]);
+        $display("inputs: %h %h %h\nSrcA: %h\n Ref: %h %h\n Ans: %h %h", X, Y, Z, SrcA, RefAns, RefFlg[4:0], Ans, AnsFlg);
+        $stop;
+      end
+    end
+`endif
 
     // check if the NaN value is good. IEEE754-2019 sections 6.3 and 6.2.3 specify:
     //    - the sign of the NaN does not matter for the opperations being tested
@@ -926,15 +972,27 @@ always @(negedge clk) begin
 	 VectorNum += 1; // increment the vector
     end
    
+`ifdef FP_REFMODEL
+    // keep generating batches for the current test until NUMVECTORS have been checked;
+    // with NUMVECTORS=0 each test gets one batch and then the next test runs
+    if (TestVectors[VectorNum][0] === 1'bx & NUMVECTORS != 0 & RefCount < NUMVECTORS) begin
+      RefFill();
+      VectorNum = 0;
+    end
+`endif
     if (TestVectors[VectorNum][0] === 1'bx & Tests[TestNum] !== "") begin // if reached the eof
 
       // increment the test
       TestNum += 1;
 
+`ifdef FP_REFMODEL
+      RefCount = 0;
+`else
       // clear the vectors
       for(int i=0; i<6133248; i++) TestVectors[i] = {`FLEN*4+8{1'bx}};
       // read next files
       $readmemh({`PATH, Tests[TestNum]}, TestVectors);
+`endif
 
       // set the vector index back to 0
       VectorNum = 0;
@@ -944,12 +1002,25 @@ always @(negedge clk) begin
       if(FrmNum < 4) FrmNum += 1;
       else FrmNum = 0; 
 
+`ifdef FP_REFMODEL
+      // with NUMVECTORS=0 start again from the first test
+      if(Tests[TestNum] === "" & NUMVECTORS == 0) begin
+        RefPass += 1;
+        $display("\nPass %d of all Tests completed with %d errors\n", RefPass, errors);
+        TestNum = 0;
+        OpCtrlNum = 0;
+        FrmNum = 0;
+      end
+`endif
       // if no more Tests - finish
       if(Tests[TestNum] === "") begin
         $display("\nAll Tests completed with %d errors\n", errors);
         $stop;
       end 
 
+`ifdef FP_REFMODEL
+      RefFill();
+`endif
       $display("Running %s vectors", Tests[TestNum]);
     end
   end
@@ -28,6 +28,8 @@
 
 // This is set from the command line script
 // `define USE_IMPERAS_DV
+// or, to compare against the model in testbench/dpi/rvmodel.c instead of QEMU,
+// `define USE_WALLY_COSIM
 
 `ifdef USE_IMPERAS_DV
   `include "rvvi/imperasDV.svh"
@@ -59,6 +61,9 @@ module testbench;
     import rvviApiPkg::*;
     import idvApiPkg::*;
   `endif
+  `ifdef USE_WALLY_COSIM
+    `include "cosim.vh"
+  `endif
 
 
 
@@ -424,6 +429,110 @@ module testbench;
       end
 
   `endif
+
+  `ifdef USE_WALLY_COSIM
+
+      // Lockstep comparison of every retired instruction against the RV64GC model in
+      // testbench/dpi/rvmodel.c (cosim.so).  The DUT supplies interrupts and device reads,
+      // so neither the QEMU trace nor interrupts.txt is read.
+      logic         DCacheFlushDone, DCacheFlushStart;
+      chandle       cosim;
+      int           cosimErrors;
+      string        cosimDir;
+      integer       rpgFile;
+
+      rvviTrace #(.XLEN(`XLEN), .FLEN(`FLEN)) rvvi();
+      wallyTracer wallyTracer(rvvi);
+
+      initial begin
+        longint loaded;
+        cosim = cosim_open(`BOOTROM_BASE, `BOOTROM_RANGE, `UNCORE_RAM_BASE, `UNCORE_RAM_RANGE,
+                           64'h8000000000000000 | (`MISA & 32'h03ffffff), `RESET_VECTOR, `SVADU_SUPPORTED, `PMP_ENTRIES);
+        if (cosim == null) $fatal(1, "cosim: cannot open the model");
+        // only the boot ROM and RAM hold memory; everything else answers with the DUT's data
+        if (`CLINT_SUPPORTED) cosim_device(cosim, `CLINT_BASE, `CLINT_RANGE);
+        if (`GPIO_SUPPORTED)  cosim_device(cosim, `GPIO_BASE,  `GPIO_RANGE);
+        if (`UART_SUPPORTED)  cosim_device(cosim, `UART_BASE,  `UART_RANGE);
+        if (`PLIC_SUPPORTED)  cosim_device(cosim, `PLIC_BASE,  `PLIC_RANGE);
+        if (`SDC_SUPPORTED)   cosim_device(cosim, `SDC_BASE,   `SDC_RANGE);
+
+        $sformat(cosimDir, "%s/linux-testvectors/", RISCV_DIR);
+        loaded = cosim_load(cosim, {cosimDir, "bootmem.bin"}, `BOOTROM_BASE);
+        if (CHECKPOINT == 0) loaded = cosim_load(cosim, {cosimDir, "ram.bin"}, `UNCORE_RAM_BASE);
+        else begin
+          $sformat(cosimDir, "%s/linux-testvectors/checkpoint%0d/", RISCV_DIR, CHECKPOINT);
+          rpgFile = $fopen({cosimDir, "ram.rpg"}, "rb");
+          if (rpgFile != 0) begin
+            $fclose(rpgFile);
+            loaded = cosim_load_checkpoint(cosim, {cosimDir, "ram.rpg"}, {RISCV_DIR, "/linux-testvectors/ram.bin"}, `UNCORE_RAM_BASE);
+          end else loaded = cosim_load(cosim, {cosimDir, "ram.bin"}, `UNCORE_RAM_BASE);
+        end
+        if (loaded < 0) $fatal(1, "cosim: cannot load RAM image from %s", cosimDir);
+        AttemptedInstructionCount = CHECKPOINT;
+
+        // a checkpoint starts the model from the state forced into the DUT during reset
+        while (reset!==1) #1;
+        while (reset!==0) #1;
+        #2;
+        if (CHECKPOINT != 0) begin
+          for (int i = 1; i < 32; i++) cosim_set_xreg(cosim, i, dut.core.ieu.dp.regf.rf[i]);
+          cosim_set_pc(cosim, testbench.initPC[0]);
+          cosim_set_priv(cosim, testbench.initPRIV[0]);
+          cosim_set_csr(cosim, 12'h300, `CSR_BASE.csrm.MSTATUS_REGW);
+          cosim_set_csr(cosim, 12'h302, `CSR_BASE.csrm.MEDELEG_REGW);
+          cosim_set_csr(cosim, 12'h303, `CSR_BASE.csrm.MIDELEG_REGW);
+          cosim_set_csr(cosim, 12'h304, `CSR_BASE.csrm.MIE_REGW);
+          cosim_set_csr(cosim, 12'h344, `CSR_BASE.csrm.MIP_REGW);
+          cosim_set_csr(cosim, 12'h305, `CSR_BASE.csrm.MTVEC_REGW);
+          cosim_set_csr(cosim, 12'h306, `CSR_BASE.csrm.MCOUNTEREN_REGW);
+          cosim_set_csr(cosim, 12'h320, `CSR_BASE.csrm.MCOUNTINHIBIT_REGW);
+          cosim_set_csr(cosim, 12'h340, `CSR_BASE.csrm.MSCRATCH_REGW);
+          cosim_set_csr(cosim, 12'h341, `CSR_BASE.csrm.MEPC_REGW);
+          cosim_set_csr(cosim, 12'h342, `CSR_BASE.csrm.MCAUSE_REGW);
+          cosim_set_csr(cosim, 12'h343, `CSR_BASE.csrm.MTVAL_REGW);
+          cosim_set_csr(cosim, 12'h105, `CSR_BASE.csrs.csrs.STVEC_REGW);
+          cosim_set_csr(cosim, 12'h106, `CSR_BASE.csrs.csrs.SCOUNTEREN_REGW);
+          cosim_set_csr(cosim, 12'h140, `CSR_BASE.csrs.csrs.SSCRATCH_REGW);
+          cosim_set_csr(cosim, 12'h141, `CSR_BASE.csrs.csrs.SEPC_REGW);
+          cosim_set_csr(cosim, 12'h142, `CSR_BASE.csrs.csrs.SCAUSE_REGW);
+          cosim_set_csr(cosim, 12'h143, `CSR_BASE.csrs.csrs.STVAL_REGW);
+          cosim_set_csr(cosim, 12'h180, `CSR_BASE.csrs.csrs.SATP_REGW);
+          cosim_set_csr(cosim, 12'h003, {`CSR_BASE.csru.csru.FRM_REGW, `CSR_BASE.csru.csru.FFLAGS_REGW});
+        end
+      end
+
+      // the model only needs the interrupt lines when the DUT takes an interrupt
+      always @(posedge clk)
+        if (dut.core.priv.priv.trap.InterruptM)
+          cosim_irq(cosim, {52'b0, dut.core.MExtInt, 1'b0, dut.core.SExtInt, 1'b0, dut.core.MTimerInt, 1'b0,
+                            dut.core.priv.priv.csr.csrs.csrs.STimerInt, 1'b0, dut.core.MSwInt, 3'b0});
+
+      always @(posedge clk)
+        if (rvvi.valid[0][0]) begin
+          foreach (wallyTracer.CSRArray[csr])
+            if (rvvi.csr_wb[0][0][csr]) cosim_csr(cosim, csr, wallyTracer.CSRArray[csr]);
+          AttemptedInstructionCount += 1;
+          cosimErrors = cosim_retire(cosim, AttemptedInstructionCount, rvvi.pc_rdata[0][0], rvvi.insn[0][0],
+                                     rvvi.intr[0][0], rvvi.mode[0][0],
+                                     wallyTracer.rf_we3 ? wallyTracer.rf_a3 : -1, rvvi.x_wdata[0][0][wallyTracer.rf_a3],
+                                     wallyTracer.frf_we4 ? wallyTracer.frf_a4 : -1, rvvi.f_wdata[0][0][wallyTracer.frf_a4]);
+          if (AttemptedInstructionCount % 'd100000 == 0) $display("Reached %d instructions", AttemptedInstructionCount);
+          if (cosimErrors != 0) begin
+            warningCount += cosimErrors;
+            errorCount += 1;
+            $display("processed %0d instructions with %0d warnings", AttemptedInstructionCount, warningCount);
+            $stop; $stop;
+          end
+          if (AttemptedInstructionCount == INSTR_WAVEON) $stop;
+          if ((AttemptedInstructionCount == INSTR_LIMIT) & (INSTR_LIMIT!=0)) begin
+            $display("reached INSTR_LIMIT");
+            $stop; $stop;
+          end
+        end
+
+      final cosim_close(cosim);
+
+  `endif
   
 
   // Wally
@@ -592,15 +701,18 @@ module testbench;
   
     // ---------- Ground-Zero -----------
     if (CHECKPOINT==0) begin
+`ifndef USE_WALLY_COSIM
       traceFileM = $fopen({testvectorDir,"all.txt"}, "r");
       traceFileE = $fopen({testvectorDir,"all.txt"}, "r");
       interruptFile = $fopen({testvectorDir,"interrupts.txt"}, "r");
       `SCAN_NEW_INTERRUPT
-      InstrCountW = '0;
       AttemptedInstructionCount = 1; // offset needed here when running from ground zero
+`endif
+      InstrCountW = '0;
     // ---------- Checkpoint ----------
     end else begin
       //$readmemh({checkpointDir,"ram.txt"}, dut.uncore.uncore.ram.ram.memory.RAM);
+`ifndef USE_WALLY_COSIM
       traceFileE = $fopen({checkpointDir,"all.txt"}, "r");
       traceFileM = $fopen({checkpointDir,"all.txt"}, "r");
       interruptFile = $fopen({testvectorDir,"interrupts.txt"}, "r");
@@ -608,8 +720,9 @@ module testbench;
       while(interruptInstrCount < CHECKPOINT) begin
         `SCAN_NEW_INTERRUPT
       end
-      InstrCountW = CHECKPOINT;
       AttemptedInstructionCount = CHECKPOINT;
+`endif
+      InstrCountW = CHECKPOINT;
       // manual checkpoint initializations
       force {`STATUS_TSR,`STATUS_TW,`STATUS_TVM,`STATUS_MXR,`STATUS_SUM,`STATUS_MPRV} = initMSTATUS[0][22:17];
       force {`STATUS_FS,`STATUS_MPP} = initMSTATUS[0][14:11];
@@ -631,8 +744,10 @@ module testbench;
       release `PLIC_INT_ENABLE;
       release `INSTRET;
     end
+`ifndef USE_WALLY_COSIM
     // Get the E-stage trace reader ahead of the M-stage trace reader
     matchCountE = $fgets(lineE,traceFileE); // *** look at removing?
+`endif
   end
 
   ///////////////////////////////////////////////////////////////////////////////
@@ -749,10 +864,12 @@ module testbench;
 
   // =========== CORE ===========
   assign checkInstrM = dut.core.ieu.InstrValidM & ~dut.core.priv.priv.trap.InstrPageFaultM & ~dut.core.priv.priv.trap.InterruptM & ~dut.core.StallM;
+`ifndef USE_WALLY_COSIM
   always @(negedge clk) begin
     `SCAN_NEW_INSTR_FROM_TRACE(E)
     `SCAN_NEW_INSTR_FROM_TRACE(M)
   end
+`endif
 
   // step 1: register expected state into the write back stage.
   always @(posedge clk) begin
@@ -816,6 +933,7 @@ module testbench;
   
   // step2: make all checks in the write back stage.
   assign checkInstrW = InstrValidW & ~dut.core.StallW; // trapW will already be invalid in there was an InstrPageFault in the previous instruction.
+`ifndef USE_WALLY_COSIM
   always @(negedge clk) begin
     #1; // small delay allows interrupt spoofing to happen first
     // always check PC, instruction bits
@@ -893,6 +1011,7 @@ module testbench;
       end // if (`DEBUG_TRACE >= 1)
     end // if (checkInstrW)
   end // always @ (negedge clk)
+`endif
 
 
   // New IP spoofing
@@ -901,6 +1020,7 @@ module testbench;
   logic checkInterruptM;
   assign checkInterruptM = dut.core.ieu.InstrValidM & ~dut.core.priv.priv.trap.InstrPageFaultM & ~dut.core.priv.priv.trap.InterruptM;
   
+`ifndef USE_WALLY_COSIM
   always @(negedge clk) begin
     if(checkInterruptM) begin
       if((interruptInstrCount+1) == AttemptedInstructionCount) begin
@@ -935,6 +1055,7 @@ module testbench;
       end
     end
   end
+`endif
 
 
 
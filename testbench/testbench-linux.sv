@@ -72,18 +72,16 @@ module testbench;
   string checkpointDir;
   logic [1:0] initPriv;
   // ========== Trace parsing & checking ==========
-  integer garbageInt;
-  string  garbageString;
+  `include "linuxtrace.vh"
+  string  traceFileName;
+  longint unsigned traceStart;
   `define DECLARE_TRACE_SCANNER_SIGNALS(STAGE) \
-      integer traceFile``STAGE; \
+      chandle traceFile``STAGE; \
       integer matchCount``STAGE; \
-      string  line``STAGE; \
-      string  token``STAGE; \
-      string  ExpectedTokens``STAGE [31:0]; \
-      integer index``STAGE; \
-      integer StartIndex``STAGE, EndIndex``STAGE; \
-      integer TokenIndex``STAGE; \
-      integer MarkerIndex``STAGE; \
+      integer MemOpCode``STAGE; \
+      integer CSRIndex``STAGE; \
+      int     ExpectedCSRId``STAGE[0:16]; \
+      longint unsigned ExpectedCSRValue``STAGE[0:16]; \
       integer NumCSR``STAGE; \
       logic [`XLEN-1:0] ExpectedPC``STAGE; \
       logic [31:0]      ExpectedInstr``STAGE; \
@@ -93,8 +91,8 @@ module testbench;
       integer           ExpectedRegAdr``STAGE; \
       logic [`XLEN-1:0] ExpectedRegValue``STAGE; \
       logic [`XLEN-1:0] ExpectedIEUAdr``STAGE, ExpectedMemReadData``STAGE, ExpectedMemWriteData``STAGE; \
-      string            ExpectedCSRArray``STAGE[10:0]; \
-      logic [`XLEN-1:0] ExpectedCSRArrayValue``STAGE[10:0]; // *** might be redundant?
+      string            ExpectedCSRArray``STAGE[16:0]; \
+      logic [`XLEN-1:0] ExpectedCSRArrayValue``STAGE[16:0]; // *** might be redundant?
   `DECLARE_TRACE_SCANNER_SIGNALS(E)
   `DECLARE_TRACE_SCANNER_SIGNALS(M)
   //  M-stage expected values
@@ -113,8 +111,8 @@ module testbench;
   string            MemOpW;
   logic [`XLEN-1:0] ExpectedIEUAdrW, ExpectedMemReadDataW, ExpectedMemWriteDataW;
   integer           NumCSRW;
-  string            ExpectedCSRArrayW[10:0];
-  logic [`XLEN-1:0] ExpectedCSRArrayValueW[10:0];
+  string            ExpectedCSRArrayW[16:0];
+  logic [`XLEN-1:0] ExpectedCSRArrayValueW[16:0];
   logic [`XLEN-1:0] ExpectedIntType;
   integer           NumCSRWIndex;
   integer           NumCSRPostWIndex;
@@ -424,16 +422,41 @@ module testbench;
     readResult = $fread(dut.uncore.uncore.bootrom.bootrom.memory.ROM,memFile);
     $fclose(memFile);
     // initialize RAM and ROM
-    if (CHECKPOINT==0) 
-      memFile = $fopen({testvectorDir,"ram.bin"}, "rb");
-    else
-      memFile = $fopen({checkpointDir,"ram.bin"}, "rb");
-    readResult = $fread(dut.uncore.uncore.ram.ram.memory.RAM,memFile);
-    $fclose(memFile);
+    // a sparse checkpoint (ram.rpg) holds only the pages that are not zero or in ram.bin
+    if (CHECKPOINT!=0) memFile = $fopen({checkpointDir,"ram.rpg"}, "rb");
+    if (CHECKPOINT!=0 & memFile != 0) begin
+      $fclose(memFile);
+      if (ramcheckpoint_load({checkpointDir,"ram.rpg"}, {testvectorDir,"ram.bin"}, dut.uncore.uncore.ram.ram.memory.RAM) < 0) begin
+        $display("Error: cannot load %sram.rpg", checkpointDir);
+        $stop;
+      end
+    end else begin
+      if (CHECKPOINT==0) 
+        memFile = $fopen({testvectorDir,"ram.bin"}, "rb");
+      else
+        memFile = $fopen({checkpointDir,"ram.bin"}, "rb");
+      readResult = $fread(dut.uncore.uncore.ram.ram.memory.RAM,memFile);
+      $fclose(memFile);
+    end
+    // the indexed trace starts at the checkpoint directly; otherwise read the
+    // text trace, which genCheckpoint.sh truncates for each checkpoint
+    memFile = $fopen({testvectorDir,"all.ltr"}, "rb");
+    if (memFile != 0) begin
+      $fclose(memFile);
+      traceFileName = {testvectorDir,"all.ltr"};
+      traceStart = (CHECKPOINT==0) ? 0 : CHECKPOINT-1;
+    end else begin
+      traceFileName = (CHECKPOINT==0) ? {testvectorDir,"all.txt"} : {checkpointDir,"all.txt"};
+      traceStart = 0;
+    end
+    traceFileM = linuxtrace_open(traceFileName, traceStart);
+    traceFileE = linuxtrace_open(traceFileName, traceStart);
+    if (traceFileM == null || traceFileE == null) begin
+      $display("Error: cannot read trace %s", traceFileName);
+      $stop;
+    end
     // ---------- Ground-Zero -----------
     if (CHECKPOINT==0) begin
-      traceFileM = $fopen({testvectorDir,"all.txt"}, "r");
-      traceFileE = $fopen({testvectorDir,"all.txt"}, "r");
       interruptFile = $fopen({testvectorDir,"interrupts.txt"}, "r");
       `SCAN_NEW_INTERRUPT
       InstrCountW = '0;
@@ -441,8 +464,6 @@ module testbench;
     // ---------- Checkpoint ----------
     end else begin
       //$readmemh({checkpointDir,"ram.txt"}, dut.uncore.uncore.ram.ram.memory.RAM);
-      traceFileE = $fopen({checkpointDir,"all.txt"}, "r");
-      traceFileM = $fopen({checkpointDir,"all.txt"}, "r");
       interruptFile = $fopen({testvectorDir,"interrupts.txt"}, "r");
       `SCAN_NEW_INTERRUPT
       while(interruptInstrCount < CHECKPOINT) begin
@@ -472,7 +493,7 @@ module testbench;
       release `INSTRET;
     end
     // Get the E-stage trace reader ahead of the M-stage trace reader
-    matchCountE = $fgets(lineE,traceFileE); // *** look at removing?
+    linuxtrace_skip(traceFileE); // *** look at removing?
   end
 
   ///////////////////////////////////////////////////////////////////////////////
@@ -490,69 +511,27 @@ module testbench;
   `define SCAN_NEW_INSTR_FROM_TRACE(STAGE) \
     // always check PC, instruction bits \
     if (checkInstrM) begin \
-      // read 1 line of the trace file \
-      matchCount``STAGE = $fgets(line``STAGE, traceFile``STAGE); \
-      if(`DEBUG_TRACE >= 5) $display("Time %t, line %x", $time, line``STAGE); \
-      // extract PC, Instr \
-      matchCount``STAGE = $sscanf(line``STAGE, "%x %x %s", ExpectedPC``STAGE, ExpectedInstr``STAGE, text``STAGE); \
+      // fetch the next instruction, already tokenized by the DPI-C trace reader \
+      matchCount``STAGE = linuxtrace_next(traceFile``STAGE, ExpectedPC``STAGE, ExpectedInstr``STAGE, text``STAGE, \
+                                          ExpectedRegAdr``STAGE, ExpectedRegValue``STAGE, MemOpCode``STAGE, \
+                                          ExpectedIEUAdr``STAGE, ExpectedMemWriteData``STAGE, ExpectedMemReadData``STAGE, \
+                                          NumCSR``STAGE, ExpectedCSRId``STAGE, ExpectedCSRValue``STAGE); \
+      if (matchCount``STAGE == 0) begin \
+        $display("%tns, %d instrs: reached the end of trace %s", $time, AttemptedInstructionCount, traceFileName); \
+        $stop; \
+      end \
+      if(`DEBUG_TRACE >= 5) $display("Time %t, instr %x %x %s", $time, ExpectedPC``STAGE, ExpectedInstr``STAGE, text``STAGE); \
       if (`"STAGE`"=="M") begin \
         AttemptedInstructionCount += 1; \
       end \
- \
-      // for the life of me I cannot get any build in C or C++ string parsing functions/methods to work. \
-      // strtok was the best idea but it cannot be used correctly as system verilog does not have null \
-      // terminated strings. \
- \
-      // Just going to do this char by char. \
-      StartIndex``STAGE = 0; \
-      TokenIndex``STAGE = 0; \
-      //$display("len = %d", line``STAGE.len()); \
-      for(index``STAGE = 0; index``STAGE < line``STAGE.len(); index``STAGE++) begin \
-        //$display("char = %s", line``STAGE[index]); \
-        if (line``STAGE[index``STAGE] == " " | line``STAGE[index``STAGE] == "\n") begin \
-          EndIndex``STAGE = index``STAGE; \
-          ExpectedTokens``STAGE[TokenIndex``STAGE] = line``STAGE.substr(StartIndex``STAGE, EndIndex``STAGE-1); \
-          //$display("In Tokenizer %s", line``STAGE.substr(StartIndex, EndIndex-1)); \
-          StartIndex``STAGE = EndIndex``STAGE + 1; \
-          TokenIndex``STAGE++; \
-        end \
-      end \
- \
-      MarkerIndex``STAGE = 3; \
-      NumCSR``STAGE = 0; \
-      MemOp``STAGE = ""; \
-      RegWrite``STAGE = ""; \
  \
       #2; \
  \
-      while(TokenIndex``STAGE > MarkerIndex``STAGE) begin \
-        // parse the GPR \
-        if (ExpectedTokens``STAGE[MarkerIndex``STAGE] == "GPR") begin \
-          RegWrite``STAGE = ExpectedTokens``STAGE[MarkerIndex``STAGE]; \
-          matchCount``STAGE = $sscanf(ExpectedTokens``STAGE[MarkerIndex``STAGE+1], "%d", ExpectedRegAdr``STAGE); \
-          matchCount``STAGE = $sscanf(ExpectedTokens``STAGE[MarkerIndex``STAGE+2], "%x", ExpectedRegValue``STAGE); \
-          MarkerIndex``STAGE += 3; \
-        // parse memory address, read data, and/or write data \
-        end else if(ExpectedTokens``STAGE[MarkerIndex``STAGE].substr(0, 2) == "Mem") begin \
-          MemOp``STAGE = ExpectedTokens``STAGE[MarkerIndex``STAGE]; \
-          matchCount``STAGE = $sscanf(ExpectedTokens``STAGE[MarkerIndex``STAGE+1], "%x", ExpectedIEUAdr``STAGE); \
-          matchCount``STAGE = $sscanf(ExpectedTokens``STAGE[MarkerIndex``STAGE+2], "%x", ExpectedMemWriteData``STAGE); \
-          matchCount``STAGE = $sscanf(ExpectedTokens``STAGE[MarkerIndex``STAGE+3], "%x", ExpectedMemReadData``STAGE); \
-          MarkerIndex``STAGE += 4; \
-        // parse CSRs, because there are 1 or more CSRs after the CSR token \
-        // we check if the CSR token or the number of CSRs is greater than 0. \
-        // if so then we want to parse for a CSR. \
-        end else if(ExpectedTokens``STAGE[MarkerIndex``STAGE] == "CSR" | NumCSR``STAGE > 0) begin \
-          if(ExpectedTokens``STAGE[MarkerIndex``STAGE] == "CSR") begin \
-            // all additional CSR's won't have this token. \
-            MarkerIndex``STAGE++; \
-          end \
-          matchCount``STAGE = $sscanf(ExpectedTokens``STAGE[MarkerIndex``STAGE], "%s", ExpectedCSRArray``STAGE[NumCSR``STAGE]); \
-          matchCount``STAGE = $sscanf(ExpectedTokens``STAGE[MarkerIndex``STAGE+1], "%x", ExpectedCSRArrayValue``STAGE[NumCSR``STAGE]); \
-          MarkerIndex``STAGE += 2; \
-           \
-          NumCSR``STAGE++; \
-        end \
+      RegWrite``STAGE = (ExpectedRegAdr``STAGE >= 0) ? "GPR" : ""; \
+      MemOp``STAGE = (MemOpCode``STAGE == 1) ? "MemR" : (MemOpCode``STAGE == 2) ? "MemW" : ""; \
+      for(CSRIndex``STAGE = 0; CSRIndex``STAGE < NumCSR``STAGE; CSRIndex``STAGE++) begin \
+        ExpectedCSRArray``STAGE[CSRIndex``STAGE] = LinuxTraceCSRNames[ExpectedCSRId``STAGE[CSRIndex``STAGE]]; \
+        ExpectedCSRArrayValue``STAGE[CSRIndex``STAGE] = ExpectedCSRValue``STAGE[CSRIndex``STAGE]; \
       end \
       if(`"STAGE`"=="M") begin \
         // override on special conditions \
@@ -666,7 +645,10 @@ module testbench;
       // turn on waves
       if (AttemptedInstructionCount == INSTR_WAVEON) $stop;
       // end sim
-      if ((AttemptedInstructionCount == INSTR_LIMIT) & (INSTR_LIMIT!=0)) begin $stop; $stop; end
+      if ((AttemptedInstructionCount == INSTR_LIMIT) & (INSTR_LIMIT!=0)) begin
+        $display("%tns, %d instrs: reached INSTR_LIMIT", $time, AttemptedInstructionCount);
+        $stop; $stop;
+      end
       fault = 0;
       if (`DEBUG_TRACE >= 1) begin
         `checkEQ("PCW",PCW,ExpectedPCW)
@@ -768,8 +750,8 @@ module testbench;
             // Other instructions, however, will get interrupted and not
             // commit, so we don't want our W-stage checker to look for them
             // and get confused when it doesn't find them.
-            garbageInt = $fgets(garbageString,traceFileE);
-            garbageInt = $fgets(garbageString,traceFileM);
+            linuxtrace_skip(traceFileE);
+            linuxtrace_skip(traceFileM);
             AttemptedInstructionCount += 1;
         end
       end
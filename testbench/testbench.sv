@@ -28,10 +28,16 @@
 `include "wally-config.vh"
 `include "tests.vh"
 
+`ifndef PrintHPMCounters   // sim/benchmark-sweep.py defines it in the configuration
 `define PrintHPMCounters 0
+`endif
 `define BPRED_LOGGER 0
 `define I_CACHE_ADDR_LOGGER 0
 `define D_CACHE_ADDR_LOGGER 0
+// 1: the loggers above write compact binary traces (ICache.wtr, DCache.wtr, branch_*.wtr)
+// through the DPI-C writer instead of text logs.  Build it with make -C ../testbench/dpi;
+// +TRACEZSTD=<level> compresses the traces when the library is built with ZSTD=1.
+`define WALLY_TRACE_LOGGER 0
 
 module testbench;
   parameter DEBUG=0;
@@ -248,9 +254,14 @@ module testbench;
       if (`FPGA) begin
         string romfilename, sdcfilename;
         romfilename = {"../tests/custom/fpga-test-sdc/bin/fpga-test-sdc.memfile"};
-        sdcfilename = {"../testbench/sdc/ramdisk2.hex"};   
         $readmemh(romfilename, dut.uncore.uncore.bootrom.bootrom.memory.ROM);
-        $readmemh(sdcfilename, sdcard.sdcard.FLASHmem);
+        // +SDIMAGE=card.img maps a binary card image, as built by testbench/dpi/mksdimg,
+        // in place of reading the hex ramdisk into the card model
+        if ($value$plusargs("SDIMAGE=%s", sdcfilename)) sdcard.sdcard.openImage(sdcfilename);
+        else begin
+          sdcfilename = {"../testbench/sdc/ramdisk2.hex"};
+          $readmemh(sdcfilename, sdcard.sdcard.FLASHmem);
+        end
         // force sdc timers
         force dut.uncore.uncore.sdc.SDC.LimitTimers = 1;
       end else begin
@@ -298,6 +309,9 @@ module testbench;
       end else begin
         if (TEST == "coremark")
           if (dut.core.priv.priv.EcallFaultM) begin
+            // HPMCSample prints the counters on this edge if stop_time was not sampled;
+            // wait for it so they come before the end of the benchmark
+            #1;
             $display("Benchmark: coremark is done.");
             $stop;
           end
@@ -422,7 +436,7 @@ module testbench;
     logic             StartSampleFirst;
     logic             StartSampleDelayed, BeginDelayed;
     logic             EndSampleFirst, EndSampleDelayed;
-    logic [`XLEN-1:0] InitialHPMCOUNTERH[`COUNTERS-1:0];
+    logic [`XLEN-1:0] InitialHPMCOUNTERH[`COUNTERS-1:0] = '{default: 0}; // counted from reset until StartSample
 
     string  HPMCnames[] = '{"Mcycle",
                             "------",
@@ -448,7 +462,12 @@ module testbench;
                             "SFenceVMA",
                             "Interrupt",
                             "Exception",
-                            "Divide Cycles"
+                            "Divide Cycles",
+                            "FP Reg Write",
+                            "ITLB Miss",
+                            "DTLB Miss",
+                            "HPTW Cycles",
+                            "Bus Wait Cycles"
                           };
 
     if(TEST == "embench") begin
@@ -463,15 +482,18 @@ module testbench;
       assign EndSample = EndSampleFirst & ~ EndSampleDelayed;
 
     end else if(TEST == "coremark") begin
-      // embench runs warmup then runs start_trigger
-	    // embench end with stop_trigger.
+      // coremark times its run between start_time and stop_time.
+      // it ends with an ecall, where the testbench stops, so the counters are printed
+      // there too unless stop_time has already printed them.
+      logic Ended;
       assign StartSampleFirst = FunctionName.FunctionName.FunctionName == "start_time";
       flopr #(1) StartSampleReg(clk, reset, StartSampleFirst, StartSampleDelayed);
       assign StartSample = StartSampleFirst & ~ StartSampleDelayed;
 
       assign EndSampleFirst = FunctionName.FunctionName.FunctionName == "stop_time";
       flopr #(1) EndSampleReg(clk, reset, EndSampleFirst, EndSampleDelayed);
-      assign EndSample = EndSampleFirst & ~ EndSampleDelayed;
+      flopenr #(1) EndedReg(clk, reset, EndSample, 1'b1, Ended);
+      assign EndSample = EndSampleFirst & ~ EndSampleDelayed | dut.core.priv.priv.EcallFaultM & ~Ended;
 
     end else begin
       // default start condiction is reset
@@ -573,22 +595,41 @@ module testbench;
     flop #(1) InvalReg(clk, dut.core.ifu.InvalidateICacheM, InvalDelayed);
     assign InvalEdge = dut.core.ifu.InvalidateICacheM & ~InvalDelayed;
 
-    initial begin
-      LogFile = $psprintf("ICache.log");
-      file = $fopen(LogFile, "w");
-      $fwrite(file, "BEGIN %s\n", memfilename);
-    end
     string AccessTypeString, HitMissString;
     assign HitMissString = dut.core.ifu.bus.icache.icache.CacheHit ? "H" :
                            dut.core.ifu.bus.icache.icache.vict.cacheLRU.AllValid ? "E" : "M";
-    always @(posedge clk) begin
-    if(resetEdge) $fwrite(file, "TRAIN\n");
-    if(BeginSample) $fwrite(file, "BEGIN %s\n", memfilename);
-    if(Enable) begin  // only log i cache reads
-      $fwrite(file, "%h R %s\n", dut.core.ifu.PCPF, HitMissString);
-    end
-    if(InvalEdge) $fwrite(file, "0 I X\n");
-    if(EndSample) $fwrite(file, "END %s\n", memfilename);
+    if (`WALLY_TRACE_LOGGER) begin : Trace
+      `include "wallytrace.vh"
+      chandle trace;
+      int     zlevel;
+      initial begin
+        if (!$value$plusargs("TRACEZSTD=%d", zlevel)) zlevel = 0;
+        trace = wtrace_open("ICache.wtr", 1, zlevel);
+        wtrace_marker(trace, "B", memfilename);
+      end
+      always @(posedge clk) begin
+        if(resetEdge) wtrace_marker(trace, "T", "");
+        if(BeginSample) wtrace_marker(trace, "B", memfilename);
+        if(Enable) wtrace_cache(trace, dut.core.ifu.PCPF, "R", HitMissString[0]); // only log i cache reads
+        if(InvalEdge) wtrace_cache(trace, 0, "I", "X");
+        if(EndSample) wtrace_marker(trace, "E", memfilename);
+      end
+      final wtrace_close(trace);
+    end else begin
+      initial begin
+        LogFile = $psprintf("ICache.log");
+        file = $fopen(LogFile, "w");
+        $fwrite(file, "BEGIN %s\n", memfilename);
+      end
+      always @(posedge clk) begin
+      if(resetEdge) $fwrite(file, "TRAIN\n");
+      if(BeginSample) $fwrite(file, "BEGIN %s\n", memfilename);
+      if(Enable) begin  // only log i cache reads
+        $fwrite(file, "%h R %s\n", dut.core.ifu.PCPF, HitMissString);
+      end
+      if(InvalEdge) $fwrite(file, "0 I X\n");
+      if(EndSample) $fwrite(file, "END %s\n", memfilename);
+      end
     end
   end
 
@@ -616,19 +657,38 @@ module testbench;
                      dut.core.lsu.dmmu.dmmu.pmachecker.Cacheable &
                      (AccessTypeString != "NULL");
 
-    initial begin
-      LogFile = $psprintf("DCache.log");
-      file = $fopen(LogFile, "w");
-      $fwrite(file, "BEGIN %s\n", memfilename);
-    end
-    always @(posedge clk) begin
-      if(resetEdge) $fwrite(file, "TRAIN\n");
-      if(BeginSample) $fwrite(file, "BEGIN %s\n", memfilename);
-      if(Enabled) begin
-        $fwrite(file, "%h %s %s\n", dut.core.lsu.PAdrM, AccessTypeString, HitMissString);
+    if (`WALLY_TRACE_LOGGER) begin : Trace
+      `include "wallytrace.vh"
+      chandle trace;
+      int     zlevel;
+      initial begin
+        if (!$value$plusargs("TRACEZSTD=%d", zlevel)) zlevel = 0;
+        trace = wtrace_open("DCache.wtr", 2, zlevel);
+        wtrace_marker(trace, "B", memfilename);
+      end
+      always @(posedge clk) begin
+        if(resetEdge) wtrace_marker(trace, "T", "");
+        if(BeginSample) wtrace_marker(trace, "B", memfilename);
+        if(Enabled) wtrace_cache(trace, dut.core.lsu.PAdrM, AccessTypeString[0], HitMissString[0]);
+        if(dut.core.lsu.bus.dcache.dcache.cachefsm.FlushFlag) wtrace_cache(trace, 0, "F", "X");
+        if(EndSample) wtrace_marker(trace, "E", memfilename);
+      end
+      final wtrace_close(trace);
+    end else begin
+      initial begin
+        LogFile = $psprintf("DCache.log");
+        file = $fopen(LogFile, "w");
+        $fwrite(file, "BEGIN %s\n", memfilename);
+      end
+      always @(posedge clk) begin
+        if(resetEdge) $fwrite(file, "TRAIN\n");
+        if(BeginSample) $fwrite(file, "BEGIN %s\n", memfilename);
+        if(Enabled) begin
+          $fwrite(file, "%h %s %s\n", dut.core.lsu.PAdrM, AccessTypeString, HitMissString);
+        end
+        if(dut.core.lsu.bus.dcache.dcache.cachefsm.FlushFlag) $fwrite(file, "0 F X\n");
+        if(EndSample) $fwrite(file, "END %s\n", memfilename);
       end
-      if(dut.core.lsu.bus.dcache.dcache.cachefsm.FlushFlag) $fwrite(file, "0 F X\n");
-      if(EndSample) $fwrite(file, "END %s\n", memfilename);
     end
   end
 
@@ -642,18 +702,36 @@ module testbench;
       flopenrc #(1) PCSrcMReg(clk, reset, dut.core.FlushM, ~dut.core.StallM, dut.core.ifu.bpred.bpred.Predictor.DirPredictor.PCSrcE, PCSrcM);
       flop #(1) ResetDReg(clk, reset, resetD);
       assign resetEdge = ~reset & resetD;
-      initial begin
-        LogFile = $psprintf("branch_%s%0d.log", `BPRED_TYPE, `BPRED_SIZE);
-        file = $fopen(LogFile, "w");
-      end
-      always @(posedge clk) begin
-        if(resetEdge) $fwrite(file, "TRAIN\n");
-        if(StartSample) $fwrite(file, "BEGIN %s\n", memfilename);
-        if(dut.core.ifu.InstrClassM[0] & ~dut.core.StallW & ~dut.core.FlushW & dut.core.InstrValidM) begin
-          direction = PCSrcM ? "t" : "n";
-          $fwrite(file, "%h %s\n", dut.core.PCM, direction);
+      if (`WALLY_TRACE_LOGGER) begin : Trace
+        `include "wallytrace.vh"
+        chandle trace;
+        int     zlevel;
+        initial begin
+          if (!$value$plusargs("TRACEZSTD=%d", zlevel)) zlevel = 0;
+          trace = wtrace_open($psprintf("branch_%s%0d.wtr", `BPRED_TYPE, `BPRED_SIZE), 3, zlevel);
+        end
+        always @(posedge clk) begin
+          if(resetEdge) wtrace_marker(trace, "T", "");
+          if(StartSample) wtrace_marker(trace, "B", memfilename);
+          if(dut.core.ifu.InstrClassM[0] & ~dut.core.StallW & ~dut.core.FlushW & dut.core.InstrValidM)
+            wtrace_branch(trace, dut.core.PCM, PCSrcM);
+          if(EndSample) wtrace_marker(trace, "E", memfilename);
+        end
+        final wtrace_close(trace);
+      end else begin
+        initial begin
+          LogFile = $psprintf("branch_%s%0d.log", `BPRED_TYPE, `BPRED_SIZE);
+          file = $fopen(LogFile, "w");
+        end
+        always @(posedge clk) begin
+          if(resetEdge) $fwrite(file, "TRAIN\n");
+          if(StartSample) $fwrite(file, "BEGIN %s\n", memfilename);
+          if(dut.core.ifu.InstrClassM[0] & ~dut.core.StallW & ~dut.core.FlushW & dut.core.InstrValidM) begin
+            direction = PCSrcM ? "t" : "n";
+            $fwrite(file, "%h %s\n", dut.core.PCM, direction);
+          end
+          if(EndSample) $fwrite(file, "END %s\n", memfilename);
         end
-        if(EndSample) $fwrite(file, "END %s\n", memfilename);
       end
     end
   end
@@ -0,0 +1,44 @@
+///////////////////////////////////////////
+// wallytrace.vh
+//
+// Written: Wally team 2023
+//
+// Purpose: DPI-C imports for the binary cache/branch/RVVI event trace writer
+//          (testbench/dpi/eventlogger.c).  Included inside each logger's generate
+//          block so the library is only needed when WALLY_TRACE_LOGGER is set.
+//          wallyTracer.sv repeats the RVVI imports for its RVVI_TRACE block.
+// 
+// A component of the Wally configurable RISC-V project.
+// 
+// Copyright (C) 2021-23 Harvey Mudd College & Oklahoma State University
+//
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// Licensed under the Solderpad Hardware License v 2.1 (the “License”); you may not use this file 
+// except in compliance with the License, or, at your option, the Apache License version 2.0. You 
+// may obtain a copy of the License at
+//
+// https://solderpad.org/licenses/SHL-2.1/
+//
+// Unless required by applicable law or agreed to in writing, any work distributed under the 
+// License is distributed on an “AS IS” BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, 
+// either express or implied. See the License for the specific language governing permissions 
+// and limitations under the License.
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// kind: 1 ICache, 2 DCache, 3 Branch, 4 RVVI; zlevel > 0 zstd-compresses the trace
+import "DPI-C" function chandle wtrace_open(input string filename, input int kind, input int zlevel);
+// access R W A F I, outcome H M E D X
+import "DPI-C" function void    wtrace_cache(input chandle h, input longint unsigned addr, input byte access, input byte outcome);
+import "DPI-C" function void    wtrace_branch(input chandle h, input longint unsigned pc, input int taken);
+// marker B (BEGIN), E (END), T (TRAIN)
+import "DPI-C" function void    wtrace_marker(input chandle h, input byte marker, input string name);
+// RVVI: stage each CSR written by the next retired instruction, then log the instruction;
+// xReg/fReg -1 when no register is written
+import "DPI-C" function void    wtrace_rvvi_csr(input chandle h, input int csr, input longint unsigned value);
+import "DPI-C" function void    wtrace_rvvi(input chandle h, input longint unsigned order, input longint unsigned pc,
+                                            input longint unsigned pcNext, input longint unsigned insn,
+                                            input int trap, input int halt, input int intr, input int mode, input int ixl,
+                                            input int xReg, input longint unsigned xVal,
+                                            input int fReg, input longint unsigned fVal);
+import "DPI-C" function void    wtrace_close(input chandle h);
@@ -46,6 +46,13 @@ _start:
 	li x31, 0
 
 
+	# the UART driver is interrupt driven
+	la t0, trap_entry
+	csrw mtvec, t0
+
+	csrr a0, mhartid
+	bnez a0, secondary
+
 	# set the stack pointer to the top of memory - 8 bytes (pointer size)
 	li sp, 0x87FFFFF8
 
@@ -79,15 +86,79 @@ delay2:
 
 
 	# now that the card is copied and the led toggled we
-	# jump to the copied contents of the sd card.
+	# jump to the copied contents of the sd card, with the other harts.
+	jal ra, smp_release
 
 jumpToLinux:
 	csrr a0, mhartid
         li s0, 0x80000000
         la a1, _dtb
         jr s0
+
+	# Secondary harts run jobs from hart 0 while it boots; see smpBoot.h.  Hart h
+	# has its stack at SMP_STACK_TOP - (h-1)*SMP_STACK_SIZE.
+secondary:
+	li t0, 0x87F80000
+	addi t1, a0, -1
+	slli t1, t1, 15
+	sub sp, t0, t1
+	jal ra, smp_worker
+
+	# then wait for smp_release to send them to the boot image
+	csrr t0, mhartid
+	slli t0, t0, 2
+	li t1, 0x2000000
+	add t0, t0, t1
+park:
+	wfi
+	lw t1, 0(t0)
+	beqz t1, park
+	sw zero, 0(t0)
+	fence.i
+	j jumpToLinux
 end_of_bios:	
 
+	# Save the registers a C function may change, then let handle_trap in main.c
+	# claim the interrupt.  zsbl does not use floating point in handlers.
+	.align 2
+trap_entry:
+	addi sp, sp, -128
+	sd ra, 0(sp)
+	sd t0, 8(sp)
+	sd t1, 16(sp)
+	sd t2, 24(sp)
+	sd t3, 32(sp)
+	sd t4, 40(sp)
+	sd t5, 48(sp)
+	sd t6, 56(sp)
+	sd a0, 64(sp)
+	sd a1, 72(sp)
+	sd a2, 80(sp)
+	sd a3, 88(sp)
+	sd a4, 96(sp)
+	sd a5, 104(sp)
+	sd a6, 112(sp)
+	sd a7, 120(sp)
+	jal ra, handle_trap
+	ld ra, 0(sp)
+	ld t0, 8(sp)
+	ld t1, 16(sp)
+	ld t2, 24(sp)
+	ld t3, 32(sp)
+	ld t4, 40(sp)
+	ld t5, 48(sp)
+	ld t6, 56(sp)
+	ld a0, 64(sp)
+	ld a1, 72(sp)
+	ld a2, 80(sp)
+	ld a3, 88(sp)
+	ld a4, 96(sp)
+	ld a5, 104(sp)
+	ld a6, 112(sp)
+	ld a7, 120(sp)
+	addi sp, sp, 128
+	mret
+
 
 
 .section .rodata
@@ -24,17 +24,80 @@
 ///////////////////////////////////////////
 
 #include "sdcDriver.h"
+#include "uart.h"
+#include "smpBoot.h"
+#include "lz4.h"
 
-void copyFlash(long int blockAddr, long int * Dst, int numBlocks) {
+static inline unsigned long readCycles(void) {
+  unsigned long cycles;
+  asm volatile("csrr %0, mcycle" : "=r"(cycles));
+  return cycles;
+}
+
+typedef struct copyState {
+  const uint8_t * end;      // of the image in the copy
+  lz4_stream_t lz4;
+  int decode;               // nonzero for an LZ4 image
+} copyState;
+
+// Each block as it arrives: add the image part of it to the CRC, then
+// decompress as much as has arrived while the controller reads on
+static void copied(void * ctx, const void * buf, unsigned long len) {
+  copyState * s = ctx;
+  const uint8_t * end = (const uint8_t *) buf + len;
+
+  smp_crc(buf, len);
+  if (s->decode) lz4_decode(&s->lz4, end < s->end ? end : s->end);
+}
+
+// Copy numBlocks blocks to Dst and compute the CRC-32 of their first imageBytes bytes
+// as each block arrives, on another hart if there is one.  If Load is not 0 the image
+// is an LZ4 frame, decompressed to the loadBytes at Load as it arrives; Dst must then
+// be clear of them.  Returns 0, -1 if the controller reported a read error, or -2 if
+// the frame is bad or does not decompress to loadBytes.
+int copyFlash(long int blockAddr, long int * Dst, int numBlocks, unsigned long imageBytes,
+              long int * Load, unsigned long loadBytes, uint32_t * crc) {
+  unsigned long start, cycles, bytes, rate;
+  copyState s;
+  int res;
 
   setSDCCLK(4); // must be even, 1 gives no division.
   waitInitSDC();
 
-  int index;
+  start = readCycles();
+  s.end = (const uint8_t *) Dst + imageBytes;
+  s.decode = Load != 0;
+  if (s.decode) lz4_init(&s.lz4, Dst, Load, loadBytes);
+  smp_crc_begin(imageBytes);
+  res = copySDCBlocks(blockAddr, Dst, numBlocks, copied, &s);
+  *crc = smp_crc_result();
+  if (res == 0 && s.decode &&
+      (lz4_decode(&s.lz4, s.end) != LZ4_DONE || s.lz4.out != (uint8_t *) Load + loadBytes))
+    res = -2;
+  cycles = readCycles() - start;
+
+  if (ZSBL_VERBOSITY < VERBOSITY_INFO) return res;
 
-  for(index = 0; index < numBlocks; index++) {
-    copySDC512(blockAddr+(index*512), Dst+(index*512/8));
+  // throughput of the whole copy, including the CRC and decompression that overlap
+  // the card's reads, in hundredths of a MB/s
+  bytes = (unsigned long) numBlocks * 512;
+  rate = cycles ? bytes * (SYSTEMCLOCK / 10000) / cycles : 0;
+  print_uart("\r\ncopied ");
+  print_uart_dec(bytes);
+  print_uart(" bytes in ");
+  print_uart_dec(cycles);
+  print_uart(" cycles (");
+  print_uart_dec(numBlocks ? cycles / numBlocks : 0);
+  print_uart(" per block), ");
+  print_uart_dec(rate / 100);
+  print_uart(".");
+  print_uart_dec_pad(rate % 100, 2);
+  print_uart(" MB/s");
+  if (s.decode) {
+    print_uart(", decompressed to ");
+    print_uart_dec(s.lz4.out - (uint8_t *) Load);
+    print_uart(" bytes");
   }
-  
-    
+  print_uart("\r\n");
+  return res;
 }
@@ -0,0 +1,48 @@
+#include "crc32.h"
+
+void crc32_table(uint32_t table[8][256])
+{
+    uint32_t c;
+    int i, k;
+
+    for (i = 0; i < 256; i++)
+    {
+        c = i;
+        for (k = 0; k < 8; k++)
+            c = (c >> 1) ^ (c & 1 ? 0xEDB88320U : 0);
+        table[0][i] = c;
+    }
+    // table[k][i] is the CRC of byte i followed by k zero bytes
+    for (k = 1; k < 8; k++)
+        for (i = 0; i < 256; i++)
+            table[k][i] = (table[k-1][i] >> 8) ^ table[0][table[k-1][i] & 0xff];
+}
+
+void crc32_init(void)
+{
+    crc32_table((uint32_t (*)[256]) CRC32_TABLE_ADDR);
+}
+
+uint32_t crc32_update(const uint32_t table[8][256], uint32_t crc, const void *buf, unsigned long len)
+{
+    const uint8_t *p = buf;
+    uint64_t w;
+    uint32_t lo, hi;
+
+    for (; len > 0 && ((uintptr_t) p & 7); len--)
+        crc = table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    // little endian: the low word holds the first four bytes
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        w = *(const uint64_t *) p;
+        lo = (uint32_t) w ^ crc;
+        hi = (uint32_t) (w >> 32);
+        crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^
+              table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24] ^
+              table[3][hi & 0xff] ^ table[2][(hi >> 8) & 0xff] ^
+              table[1][(hi >> 16) & 0xff] ^ table[0][hi >> 24];
+    }
+    for (; len > 0; len--)
+        crc = table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// CRC-32 of IEEE 802.3 and zlib, as GPT uses for its header and partition entries.
+// The sum is carried between calls, so a buffer can be checked a piece at a time:
+//
+//   crc = CRC32_INIT;
+//   crc = crc32_update(table, crc, piece, len); ...
+//   crc ^= CRC32_FINAL;
+#define CRC32_INIT  0xFFFFFFFFU
+#define CRC32_FINAL 0xFFFFFFFFU
+
+// Slicing by 8: eight tables of 256 entries, 8 KiB, take a doubleword per step.
+// zsbl has no writable .data, so hart 0 keeps its tables in RAM at CRC32_TABLE_ADDR,
+// after the UART ring, and other harts build their own with crc32_table.
+#define CRC32_TABLE_ADDR 0x87F02000
+#define CRC32_TABLE ((const uint32_t (*)[256]) CRC32_TABLE_ADDR)
+
+void crc32_table(uint32_t table[8][256]);
+
+// Build hart 0's tables at CRC32_TABLE
+void crc32_init(void);
+
+uint32_t crc32_update(const uint32_t table[8][256], uint32_t crc, const void *buf, unsigned long len);
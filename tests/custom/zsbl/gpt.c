@@ -3,42 +3,11 @@
 #include "sdcDriver.h"
 
 #include "uart.h"
+#include "crc32.h"
 #include <stddef.h>
 
-int gpt_find_boot_partition(long int* dest, uint32_t size)
+static void print_gpt_header(gpt_pth_t *lba1)
 {
-  //int ret = init_sd();
-  int ret;
-  setSDCCLK(4); // must be even, 1 gives no division.
-  waitInitSDC();
-  ret = 0;
-    if (ret != 0) {
-        print_uart("could not initialize sd... exiting\r\n");
-        return -1;
-    }
-
-    print_uart("sd initialized!\r\n");
-
-    // load LBA1
-    size_t block_size = 512/8;
-    long int lba1_buf[block_size];
-
-    //int res = sd_copy(lba1_buf, 1, 1);
-    int res;
-    copySDC512(1, lba1_buf);
-    res = 0;
-
-    if (res != 0)
-    {
-        print_uart("SD card failed!\r\n");
-        print_uart("sd copy return value: ");
-        print_uart_addr(res);
-        print_uart("\r\n");
-        return -2;
-    }
-
-    gpt_pth_t *lba1 = (gpt_pth_t *)lba1_buf;
-
     print_uart("gpt partition table header:");
     print_uart("\r\n\tsignature:\t");
     print_uart_addr(lba1->signature);
@@ -61,25 +30,13 @@ int gpt_find_boot_partition(long int* dest, uint32_t size)
     print_uart("\r\n\tsize partition entries:  \t");
     print_uart_int(lba1->size_partition_entry);
     print_uart("\r\n");
+}
 
-    long int lba2_buf[block_size];
-
-    //res = sd_copy(lba2_buf, lba1->partition_entries_lba, 1);
-    copySDC512(lba1->partition_entries_lba, lba2_buf);
-    res = 0;
-
-    if (res != 0)
-    {
-        print_uart("SD card failed!\r\n");
-        print_uart("sd copy return value: ");
-        print_uart_addr(res);
-        print_uart("\r\n");
-        return -2;
-    }
-
+static void print_gpt_entries(uint8_t *entries, uint32_t entry_size)
+{
     for (int i = 0; i < 4; i++)
     {
-        partition_entries_t *part_entry = (partition_entries_t *)(lba2_buf + (i * 128));
+        partition_entries_t *part_entry = (partition_entries_t *)(entries + i * entry_size);
         print_uart("gpt partition entry ");
         print_uart_byte(i);
         print_uart("\r\n\tpartition type guid:\t");
@@ -99,21 +56,135 @@ int gpt_find_boot_partition(long int* dest, uint32_t size)
             print_uart_byte(part_entry->name[j]);
         print_uart("\r\n");
     }
+}
+
+static int gpt_fail(int err, const char *msg)
+{
+    print_uart("boot failed: ");
+    print_uart(msg);
+    print_uart("\r\n");
+    return err;
+}
+
+static int gpt_fail_crc(int err, const char *what, uint32_t crc, uint32_t expected)
+{
+    print_uart("boot failed: ");
+    print_uart(what);
+    print_uart(" crc ");
+    print_uart_int(crc);
+    print_uart(", expected ");
+    print_uart_int(expected);
+    print_uart("\r\n");
+    return err;
+}
+
+static uint32_t gpt_crc(const void *buf, unsigned long len)
+{
+    return crc32_update(CRC32_TABLE, CRC32_INIT, buf, len) ^ CRC32_FINAL;
+}
+
+int gpt_find_boot_partition(long int* dest, uint32_t size)
+{
+  //int ret = init_sd();
+  int ret;
+  setSDCCLK(4); // must be even, 1 gives no division.
+  waitInitSDC();
+  ret = 0;
+    if (ret != 0) {
+        print_uart("could not initialize sd... exiting\r\n");
+        return GPT_ERR_SD_INIT;
+    }
+
+    if (ZSBL_VERBOSITY >= VERBOSITY_INFO)
+        print_uart("sd initialized!\r\n");
+
+    // load LBA1
+    size_t block_size = 512/8;
+    long int lba1_buf[block_size];
+
+    copySDC512(1, lba1_buf);
 
-    partition_entries_t *boot = (partition_entries_t *)(lba2_buf);
-    print_uart("copying boot image ");
-    //res = sd_copy(dest, boot->first_lba, boot->last_lba - boot->first_lba + 1);
-    copyFlash(boot->first_lba, dest, boot->last_lba - boot->first_lba + 1);
+    gpt_pth_t *lba1 = (gpt_pth_t *)lba1_buf;
 
-    if (res != 0)
+    if (ZSBL_VERBOSITY >= VERBOSITY_DEBUG)
+        print_gpt_header(lba1);
+
+    // The header CRC is taken with its own field zero
+    if (lba1->signature != GPT_SIGNATURE)
+        return gpt_fail(GPT_ERR_HEADER, "no GPT signature");
+    if (lba1->header_size < GPT_HEADER_MIN || lba1->header_size > 512)
+        return gpt_fail(GPT_ERR_HEADER, "bad GPT header size");
+    uint32_t expected = lba1->crc_header;
+    lba1->crc_header = 0;
+    uint32_t crc = gpt_crc(lba1, lba1->header_size);
+    lba1->crc_header = expected;
+    if (crc != expected)
+        return gpt_fail_crc(GPT_ERR_HEADER, "GPT header", crc, expected);
+
+    // The entries' CRC covers the whole array, which usually spans 32 blocks
+    unsigned long entry_bytes = (unsigned long)lba1->nr_partition_entries * lba1->size_partition_entry;
+    if (lba1->size_partition_entry < sizeof(partition_entries_t) || lba1->nr_partition_entries == 0 ||
+        entry_bytes > GPT_MAX_ENTRY_BYTES)
+        return gpt_fail(GPT_ERR_ENTRIES, "bad GPT partition entry size or count");
+    long int entries_buf[GPT_MAX_ENTRY_BYTES/8];
+    if (copySDCBlocks(lba1->partition_entries_lba, entries_buf, (entry_bytes + 511) / 512, 0, 0) != 0)
+        return gpt_fail(GPT_ERR_SD_READ, "SD card read error");
+    crc = gpt_crc(entries_buf, entry_bytes);
+    if (crc != lba1->crc_partition_entry)
+        return gpt_fail_crc(GPT_ERR_ENTRIES, "GPT partition entries", crc, lba1->crc_partition_entry);
+
+    if (ZSBL_VERBOSITY >= VERBOSITY_DEBUG)
+        print_gpt_entries((uint8_t *)entries_buf, lba1->size_partition_entry);
+
+    partition_entries_t *boot = (partition_entries_t *)(entries_buf);
+    if (boot->last_lba < boot->first_lba || boot->first_lba < lba1->first_usable_lba ||
+        boot->last_lba > lba1->last_usable_lba)
+        return gpt_fail(GPT_ERR_ENTRIES, "boot partition out of bounds");
+
+    // Copy just the image if the partition has a footer, else all of it.  An LZ4
+    // image is copied above the RAM it decompresses to.
+    unsigned long blocks = boot->last_lba - boot->first_lba + 1;
+    unsigned long image_size = blocks * 512;
+    unsigned long stage = 0;
+    long int footer_buf[block_size];
+    boot_footer_t *footer = (boot_footer_t *)footer_buf;
+    copySDC512(boot->last_lba, footer_buf);
+    int checked = footer->magic == BOOT_FOOTER_MAGIC;
+    if (checked)
     {
-        print_uart("SD card failed!\r\n");
-        print_uart("sd copy return value: ");
-        print_uart_addr(res);
-        print_uart("\r\n");
-        return -2;
+        crc = gpt_crc(footer, offsetof(boot_footer_t, footer_crc));
+        if (crc != footer->footer_crc)
+            return gpt_fail_crc(GPT_ERR_IMAGE, "boot image footer", crc, footer->footer_crc);
+        if (footer->image_size > (blocks - 1) * 512)
+            return gpt_fail(GPT_ERR_IMAGE, "boot image larger than its partition");
+        if (footer->format == BOOT_FORMAT_LZ4)
+            stage = (footer->load_size + 4095) & ~4095UL;
+        else if (footer->format != BOOT_FORMAT_RAW)
+            return gpt_fail(GPT_ERR_IMAGE, "unknown boot image format");
+        image_size = footer->image_size;
+        blocks = (image_size + 511) / 512;
     }
-
-    print_uart(" done!\r\n");
-    return 0;
+    if (stage / 512 + blocks > size)
+        return gpt_fail(GPT_ERR_IMAGE, "boot image too large");
+
+    if (ZSBL_VERBOSITY >= VERBOSITY_INFO)
+        print_uart(stage ? "copying compressed boot image " : "copying boot image ");
+    ret = copyFlash(boot->first_lba, dest + stage/8, blocks, image_size,
+                    stage ? dest : 0, stage ? footer->load_size : 0, &crc);
+    if (ret == -1)
+        return gpt_fail(GPT_ERR_SD_READ, "SD card read error");
+
+    // a bad CRC explains a bad frame, so check it first
+    if (checked && crc != footer->image_crc)
+        return gpt_fail_crc(GPT_ERR_IMAGE, "boot image", crc, footer->image_crc);
+    if (ret != 0)
+        return gpt_fail(GPT_ERR_IMAGE, "bad LZ4 boot image");
+
+    if (ZSBL_VERBOSITY >= VERBOSITY_INFO)
+    {
+        print_uart(checked ? "boot image crc " : "boot image not checked, crc ");
+        print_uart_int(crc);
+        print_uart(" done!\r\n");
+    }
+    return GPT_OK;
 }
@@ -35,5 +35,39 @@ typedef struct partition_entries
     uint8_t name[72]; //! utf16 encoded
 } partition_entries_t;
 
-// Find boot partition and load it to the destination
+#define GPT_SIGNATURE 0x5452415020494645ULL // "EFI PART"
+#define GPT_HEADER_MIN 92
+#define GPT_MAX_ENTRY_BYTES (128 * 128)       // the usual 128 entries of 128 bytes
+
+// The boot partition may end with a footer in its last block giving the size and
+// CRC-32 of the image at the start of the partition.  zsbl then copies only the
+// image and checks it; without a footer the whole partition is copied unchecked.
+// bin/pack-boot-image.py writes the image and footer.
+#define BOOT_FOOTER_MAGIC 0x474D49594C4C4157ULL // "WALLYIMG"
+
+#define BOOT_FORMAT_RAW 0  // the image is copied to RAM as it is
+#define BOOT_FORMAT_LZ4 1  // the image is an LZ4 frame, decompressed as it is copied
+
+typedef struct boot_footer
+{
+    uint64_t magic;
+    uint64_t image_size;  // bytes at the start of the partition
+    uint32_t image_crc;   // of those bytes
+    uint32_t format;      // BOOT_FORMAT_*
+    uint64_t load_size;   // bytes in RAM once decompressed
+    uint32_t reserved;
+    uint32_t footer_crc;  // of the fields above
+} boot_footer_t;
+
+// Results of gpt_find_boot_partition
+#define GPT_OK           0
+#define GPT_ERR_SD_INIT -1
+#define GPT_ERR_SD_READ -2
+#define GPT_ERR_HEADER  -3  // bad signature, size or CRC
+#define GPT_ERR_ENTRIES -4  // bad entry size or count, CRC, or boot partition bounds
+#define GPT_ERR_IMAGE   -5  // bad footer, image CRC or LZ4 frame, or too large for size blocks
+
+// Find boot partition and load it to the destination, at most size blocks of RAM
+// including the staging area of a compressed image.  The GPT header and partition
+// entries are checked against their CRCs before anything is copied.
 int gpt_find_boot_partition(long int* dest, uint32_t size);
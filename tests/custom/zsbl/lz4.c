@@ -0,0 +1,201 @@
+#include "lz4.h"
+
+enum
+{
+    LZ4_HEADER,
+    LZ4_BLOCK_SIZE,
+    LZ4_RAW,
+    LZ4_SEQUENCE,
+    LZ4_LITERALS,
+    LZ4_MATCH,
+    LZ4_BLOCK_CHECKSUM,
+    LZ4_CONTENT_CHECKSUM,
+    LZ4_END,
+    LZ4_BAD
+};
+
+#define FLG_VERSION        0xC0
+#define FLG_BLOCK_CHECKSUM 0x10
+#define FLG_CONTENT_SIZE   0x08
+#define FLG_CONTENT_CHECKSUM 0x04
+#define FLG_RESERVED_DICT  0x03
+#define BLOCK_RAW          0x80000000U
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void lz4_init(lz4_stream_t *s, const void *in, void *out, unsigned long outSize)
+{
+    s->in = in;
+    s->blockEnd = in;
+    s->outStart = s->out = out;
+    s->outEnd = s->out + outSize;
+    s->litLeft = 0;
+    s->state = LZ4_HEADER;
+}
+
+// Copy up to n bytes of literals or a raw block that have arrived
+static int copy_in(lz4_stream_t *s, const uint8_t *avail, unsigned long n)
+{
+    const uint8_t *p = s->in;
+    uint8_t *q = s->out;
+    unsigned long have = avail > p ? avail - p : 0;
+
+    if (n > have)
+        n = have;
+    if (n > (unsigned long)(s->outEnd - q))
+        return -1;
+    s->in = p + n;
+    s->out = q + n;
+    while (n--)
+        *q++ = *p++;
+    return 0;
+}
+
+int lz4_decode(lz4_stream_t *s, const void *availp)
+{
+    const uint8_t *avail = availp, *p, *lim;
+    unsigned long len, off, n;
+    uint8_t *q, *m;
+    uint32_t size;
+    uint8_t b;
+
+    for (;;)
+    {
+        p = s->in;
+        lim = avail < s->blockEnd ? avail : s->blockEnd; // input of the current block
+        switch (s->state)
+        {
+        case LZ4_HEADER:
+            if (avail - p < 7)
+                return LZ4_MORE;
+            if (read32(p) != LZ4_MAGIC || (p[4] & FLG_VERSION) != 0x40 || (p[4] & FLG_RESERVED_DICT))
+                goto bad;
+            n = (p[4] & FLG_CONTENT_SIZE) ? 15 : 7;
+            if (avail - p < n)
+                return LZ4_MORE;
+            s->flags = p[4];
+            s->in = p + n;
+            s->state = LZ4_BLOCK_SIZE;
+            break;
+
+        case LZ4_BLOCK_SIZE:
+            if (avail - p < 4)
+                return LZ4_MORE;
+            size = read32(p);
+            s->in = p + 4;
+            s->blockEnd = s->in + (size & ~BLOCK_RAW);
+            if (size == 0)
+                s->state = (s->flags & FLG_CONTENT_CHECKSUM) ? LZ4_CONTENT_CHECKSUM : LZ4_END;
+            else
+                s->state = (size & BLOCK_RAW) ? LZ4_RAW : LZ4_SEQUENCE;
+            break;
+
+        case LZ4_RAW:
+            if (copy_in(s, lim, s->blockEnd - p))
+                goto bad;
+            if (s->in != s->blockEnd)
+                return LZ4_MORE;
+            goto block_end;
+
+        case LZ4_SEQUENCE:
+            // Parse the token and literal length without consuming them until all
+            // of it has arrived
+            if (p == s->blockEnd)
+                goto block_end;
+            if (p >= lim)
+                return LZ4_MORE;
+            b = *p++;
+            len = b >> 4;
+            if (len == 15)
+                do
+                {
+                    if (p >= lim)
+                    {
+                        if (lim == s->blockEnd)
+                            goto bad;
+                        return LZ4_MORE;
+                    }
+                    len += *p;
+                } while (*p++ == 255);
+            if (len > (unsigned long)(s->blockEnd - p))
+                goto bad;
+            s->token = b;
+            s->litLeft = len;
+            s->in = p;
+            s->state = LZ4_LITERALS;
+            break;
+
+        case LZ4_LITERALS:
+            n = s->litLeft;
+            if (copy_in(s, lim, n))
+                goto bad;
+            s->litLeft -= s->in - p;
+            if (s->litLeft)
+                return LZ4_MORE;
+            // the last sequence of a block has literals only
+            if (s->in == s->blockEnd)
+                goto block_end;
+            s->state = LZ4_MATCH;
+            break;
+
+        case LZ4_MATCH:
+            if (lim - p < 2)
+            {
+                if (lim == s->blockEnd)
+                    goto bad;
+                return LZ4_MORE;
+            }
+            off = p[0] | (p[1] << 8);
+            p += 2;
+            len = (s->token & 15) + 4;
+            if ((s->token & 15) == 15)
+                do
+                {
+                    if (p >= lim)
+                    {
+                        if (lim == s->blockEnd)
+                            goto bad;
+                        return LZ4_MORE;
+                    }
+                    len += *p;
+                } while (*p++ == 255);
+            q = s->out;
+            if (off == 0 || off > (unsigned long)(q - s->outStart) || len > (unsigned long)(s->outEnd - q))
+                goto bad;
+            // the match may overlap what it writes, so copy forwards a byte at a time
+            m = q - off;
+            s->out = q + len;
+            while (len--)
+                *q++ = *m++;
+            s->in = p;
+            s->state = LZ4_SEQUENCE;
+            break;
+
+        case LZ4_BLOCK_CHECKSUM:
+        case LZ4_CONTENT_CHECKSUM:
+            if (avail - p < 4)
+                return LZ4_MORE;
+            s->in = p + 4;
+            s->state = s->state == LZ4_BLOCK_CHECKSUM ? LZ4_BLOCK_SIZE : LZ4_END;
+            break;
+
+        case LZ4_END:
+            return LZ4_DONE;
+
+        default:
+            return LZ4_ERROR;
+        }
+        continue;
+
+    block_end:
+        s->state = (s->flags & FLG_BLOCK_CHECKSUM) ? LZ4_BLOCK_CHECKSUM : LZ4_BLOCK_SIZE;
+        continue;
+
+    bad:
+        s->state = LZ4_BAD;
+        return LZ4_ERROR;
+    }
+}
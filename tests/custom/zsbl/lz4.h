@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+// Streaming decoder for the LZ4 frame format, as written by lz4 and
+// bin/pack-boot-image.py.  The compressed frame is read from memory as it arrives;
+// each call decodes as far as the input so far allows and picks up there next time,
+// so a boot image can be decompressed while the rest of it is still being copied.
+// Linked and independent blocks are both accepted, since the output is contiguous.
+// Checksums in the frame are skipped; zsbl checks the whole frame with its CRC-32.
+// Dictionaries are not supported.
+
+#define LZ4_MAGIC 0x184D2204
+
+#define LZ4_MORE  0   // decoded all the input so far
+#define LZ4_DONE  1   // reached the end of the frame
+#define LZ4_ERROR -1  // bad frame, or output past its end
+
+typedef struct lz4_stream
+{
+    const uint8_t *in;        // next input byte
+    const uint8_t *blockEnd;  // end of the current block's data
+    uint8_t *out, *outStart, *outEnd;
+    unsigned long litLeft;    // literals of the current sequence not yet copied
+    uint8_t token;            // of the current sequence
+    uint8_t flags;            // FLG byte of the frame header
+    int state;
+} lz4_stream_t;
+
+void lz4_init(lz4_stream_t *s, const void *in, void *out, unsigned long outSize);
+
+// Decode input up to avail.  Returns LZ4_MORE, LZ4_DONE or LZ4_ERROR.
+int lz4_decode(lz4_stream_t *s, const void *avail);
@@ -1,13 +1,43 @@
 #include "uart.h"
 #include "sdcDriver.h"
 #include "gpt.h"
+#include "plic.h"
+#include "smpBoot.h"
+#include "crc32.h"
+
+// Build with -DZSBL_ZERO_START=<addr> -DZSBL_ZERO_END=<addr> to have the secondary
+// harts zero that range of RAM while the boot image is copied
+#ifndef ZSBL_ZERO_START
+#define ZSBL_ZERO_START 0
+#define ZSBL_ZERO_END 0
+#endif
 
 int main()
 {
-    init_uart(30000000, 115200);
-    print_uart("Hello World!\r\n");
+    unsigned long cycles;
+
+    init_uart(SYSTEMCLOCK, 115200);
+    if (ZSBL_VERBOSITY >= VERBOSITY_INFO)
+        print_uart("Hello World!\r\n");
+
+    crc32_init();
+    smp_init();
+    smp_zero((void *)ZSBL_ZERO_START, (void *)ZSBL_ZERO_END);
+
+    // the image may fill RAM up to what zsbl itself uses
+    int res = gpt_find_boot_partition((long int *)0x80000000UL, (SMP_JOB_BASE - 0x80000000UL) / 512);
+
+    smp_park();
+    if (ZSBL_VERBOSITY >= VERBOSITY_INFO)
+    {
+        asm volatile("csrr %0, mcycle" : "=r"(cycles));
+        print_uart("boot image ready after ");
+        print_uart_dec(cycles);
+        print_uart(" cycles\r\n");
+    }
 
-    int res = gpt_find_boot_partition((long int *)0x80000000UL, 2 * 16384);
+    // the ring must be empty before the next stage takes over the UART
+    flush_uart();
 
     if (res == 0)
     {
@@ -20,7 +50,24 @@ int main()
     }
 }
 
+// Called by trap_entry in bios.s
 void handle_trap(void)
 {
-    // print_uart("trap\r\n");
+    unsigned long cause;
+    int id;
+
+    asm volatile("csrr %0, mcause" : "=r"(cause));
+    if (cause != ((1UL << 63) | 11))
+    {
+        // print_uart("trap\r\n");
+        while (1) {};
+    }
+
+    // machine external interrupt: claim and complete each source the PLIC has pending
+    while ((id = *(volatile int *) PLIC_CLAIM) != 0)
+    {
+        if (id == PLIC_UART_ID)
+            handle_uart_interrupt();
+        *(volatile int *) PLIC_CLAIM = id;
+    }
 }
@@ -0,0 +1,42 @@
+#pragma once
+
+// PLIC registers of context 0, M-mode of hart 0
+#define PLIC_BASE         0x0C000000UL
+#define PLIC_PRIORITY(id) (PLIC_BASE + 4*(id))
+#define PLIC_ENABLE(id)   (PLIC_BASE + 0x2000 + 4*((id)/32))
+#define PLIC_THRESHOLD    (PLIC_BASE + 0x200000)
+#define PLIC_CLAIM        (PLIC_BASE + 0x200004)
+
+// Interrupt sources, PLIC_*_ID in config/fpga/wally-config.vh
+#define PLIC_UART_ID      10
+
+#define MIE_MEIE          (1 << 11)
+#define MSTATUS_MIE       (1 << 3)
+
+// bios.s points mtvec at trap_entry, which calls handle_trap in main.c to claim the
+// source and run its driver's handler.
+static inline void plic_enable(int id)
+{
+    *(volatile int *) PLIC_PRIORITY(id) = 1;
+    *(volatile int *) PLIC_ENABLE(id) |= 1 << (id % 32);
+    *(volatile int *) PLIC_THRESHOLD = 0;
+    asm volatile("csrs mie, %0" : : "r"(MIE_MEIE));
+}
+
+static inline void plic_disable(int id)
+{
+    *(volatile int *) PLIC_ENABLE(id) &= ~(1 << (id % 32));
+}
+
+// Mask interrupts and return whether they were enabled
+static inline unsigned long irq_save(void)
+{
+    unsigned long mstatus;
+    asm volatile("csrrc %0, mstatus, %1" : "=r"(mstatus) : "r"(MSTATUS_MIE));
+    return mstatus & MSTATUS_MIE;
+}
+
+static inline void irq_restore(unsigned long enabled)
+{
+    if (enabled) asm volatile("csrs mstatus, %0" : : "r"(MSTATUS_MIE));
+}
@@ -26,44 +26,69 @@
 
 #include "sdcDriver.h"
 
-#define SDC_MAIL_BOX 0x12100
+#define MAILBOX(reg) (SDC_MAIL_BOX + (reg))
 
-void copySDC512(long int blockAddr, long int * Dst) {
+// read the 64 doublewords of the block in the mailbox once it is ready
+static inline void drainSDC512(long int * Dst) {
+  volatile int * mailBoxStatus = (int *) MAILBOX(SDC_STATUS);
+  volatile long int * mailBoxReadData = (long int *) MAILBOX(SDC_READ_DATA);
+  int index;
 
-  waitInitSDC();
+  // wait until the mailbox has valid data
+  // this occurs when status[1] = 0
+  while((*mailBoxStatus & 0x2) == 0x2);
+
+  // eight loads in flight before the stores, rather than a load-store round trip per word
+  for(index = 0; index < 512/8; index += 8) {
+    long int d0 = *mailBoxReadData, d1 = *mailBoxReadData, d2 = *mailBoxReadData, d3 = *mailBoxReadData;
+    long int d4 = *mailBoxReadData, d5 = *mailBoxReadData, d6 = *mailBoxReadData, d7 = *mailBoxReadData;
+    Dst[index+0] = d0; Dst[index+1] = d1; Dst[index+2] = d2; Dst[index+3] = d3;
+    Dst[index+4] = d4; Dst[index+5] = d5; Dst[index+6] = d6; Dst[index+7] = d7;
+  }
+}
+
+// start reading a block into the mailbox; drainSDC512 waits for it
+static inline void requestSDC512(long int blockAddr) {
+  volatile long int * mailBoxAddr = (long int *) MAILBOX(SDC_ADDR);
+  volatile int * mailBoxCmd = (int *) MAILBOX(SDC_CMD);
 
-  volatile long int * mailBoxAddr;
-  volatile int * mailBoxCmd;
-  volatile int * mailBoxStatus;
-  volatile long int * mailBoxReadData;
-  mailBoxStatus = (int *) (SDC_MAIL_BOX + 0x4);  
-  mailBoxCmd = (int *) (SDC_MAIL_BOX + 0x8);
-  mailBoxAddr = (long int *) (SDC_MAIL_BOX + 0x10);
-  mailBoxReadData = (long int *) (SDC_MAIL_BOX + 0x18);  
-  
   // write the SDC address register with the blockAddr
   *mailBoxAddr = blockAddr;
-  *mailBoxCmd = 0x4;
+  *mailBoxCmd = SDC_CMD_READ_SINGLE;
+}
 
-  // wait until the mailbox has valid data
-  // this occurs when status[1] = 0
-  while((*mailBoxStatus & 0x2) == 0x2);
+// Callers wait for the card with waitInitSDC() once before their first copy.
+void copySDC512(long int blockAddr, long int * Dst) {
+  requestSDC512(blockAddr);
+  drainSDC512(Dst);
+}
 
+// Copy numBlocks consecutive blocks.  The mailbox holds one block, so block N is
+// drained first, then block N+1 is requested and the card reads it while block N is
+// passed to done with ctx.  done may be 0.  Returns 0; the mailbox has no way to
+// report a read error, but callers check for -1 in case it gains one.
+int copySDCBlocks(long int blockAddr, long int * Dst, int numBlocks, sdcBlocksDone done, void * ctx) {
   int index;
-  for(index = 0; index < 512/8; index++) {
-    Dst[index] = *mailBoxReadData;
+
+  if (numBlocks <= 0) return 0;
+  requestSDC512(blockAddr);
+  for(index = 0; index < numBlocks; index++) {
+    drainSDC512(Dst+(index*512/8));
+    if (index + 1 < numBlocks) requestSDC512(blockAddr+index+1);
+    if (done) done(ctx, Dst+(index*512/8), 512);
   }
+  return 0;
 }
 
 volatile void waitInitSDC(){
   volatile int * mailBoxStatus;
-  mailBoxStatus = (int *) (SDC_MAIL_BOX + 0x4);
+  mailBoxStatus = (int *) MAILBOX(SDC_STATUS);
   while((*mailBoxStatus & 0x1) != 0x1);
 }
 
 void setSDCCLK(int divider){
   divider = (1 - (divider >> 1));
   volatile int * mailBoxCLK;
-  mailBoxCLK = (int *) (SDC_MAIL_BOX + 0x0);
+  mailBoxCLK = (int *) MAILBOX(SDC_CLK_DIV);
   *mailBoxCLK = divider;
 }
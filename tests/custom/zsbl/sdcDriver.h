@@ -1,10 +1,27 @@
 #ifndef __SDCDRIVER_H
 #define __SDCDRIVER_H
 
+#include <stdint.h>
+
+#define SDC_MAIL_BOX 0x12100
+
+// mailbox registers, offsets from SDC_MAIL_BOX
+#define SDC_CLK_DIV   0x0
+#define SDC_STATUS    0x4   // bit 0: card initialized, bit 1: busy (no block ready)
+#define SDC_CMD       0x8
+#define SDC_ADDR      0x10
+#define SDC_READ_DATA 0x18
+
+#define SDC_CMD_READ_SINGLE   0x4 // CMD17
+
+// Called with each block once it is in memory, while the card reads the next.
+// copyFlash adds them to the image CRC and decompresses them
+typedef void (*sdcBlocksDone)(void *ctx, const void *buf, unsigned long len);
 
 void copySDC512(long int, long int *);
+int copySDCBlocks(long int, long int *, int, sdcBlocksDone, void *);
 volatile void waitInitSDC();
 void setSDCCLK(int);
-void copyFlash(long int, long int *, int);
+int copyFlash(long int, long int *, int, unsigned long, long int *, unsigned long, uint32_t *);
 
 #endif
@@ -0,0 +1,178 @@
+#include "smpBoot.h"
+#include "crc32.h"
+
+#define SMP_JOB_ZERO 1
+#define SMP_JOB_CRC  2
+#define SMP_JOB_EXIT 3
+
+#define MIE_MSIE (1 << 3)
+
+typedef struct smp_job
+{
+    unsigned long op;
+    unsigned long addr;
+    unsigned long len;
+} smp_job_t;
+
+typedef struct smp_state
+{
+    unsigned long seq[SMP_MAX_HARTS]; // next job line of each hart
+    unsigned long crcLeft;            // image bytes not yet passed to smp_crc
+    unsigned long crcJob;             // bytes per CRC job
+    unsigned long pendAddr, pendLen;  // bytes gathered for the next CRC job
+    uint32_t crc;                     // image CRC when hart 0 computes it alone
+} smp_state_t;
+
+// a job line followed by its result line, for each hart and job
+#define JOB(hart, seq) ((volatile smp_job_t *) (SMP_JOB_BASE + ((hart) * SMP_JOBS + (seq)) * 2 * SMP_LINE))
+#define RESULT(hart, seq) ((volatile uint32_t *) ((unsigned long) JOB(hart, seq) + SMP_LINE))
+#define STATE ((smp_state_t *) JOB(0, 0))
+
+#define MSIP(hart) (*(volatile int *) CLINT_MSIP(hart))
+
+#define CRC_HART 1
+
+// Write back this hart's dirty D$ lines with fence.i, encoded as a word because the
+// -march string has no Zifencei, and order that before the next store
+static inline void publish(void)
+{
+    asm volatile(".word 0x0000100f\n\tfence" : : : "memory");
+}
+
+static void run(int hart, unsigned long op, unsigned long addr, unsigned long len)
+{
+    volatile smp_job_t *job;
+
+    while (MSIP(hart)) {};
+    job = JOB(hart, STATE->seq[hart]++);
+    job->op = op;
+    job->addr = addr;
+    job->len = len;
+    publish();
+    MSIP(hart) = 1;
+}
+
+void smp_init(void)
+{
+    int hart;
+
+    for (hart = 0; hart < SMP_MAX_HARTS; hart++)
+        STATE->seq[hart] = 0;
+    smp_crc_begin(0);
+}
+
+void smp_zero(void *start, void *end)
+{
+    unsigned long first = (unsigned long) start, last = (unsigned long) end;
+    unsigned long slice;
+    int hart, harts;
+
+    if (SMP_HARTS == 1 || last <= first) return;
+    // the CRC hart only helps when it is the only one
+    harts = SMP_HARTS > 2 ? SMP_HARTS - 2 : 1;
+    slice = ((last - first) / harts + SMP_LINE - 1) & ~(unsigned long) (SMP_LINE - 1);
+    for (hart = SMP_HARTS - harts; hart < SMP_HARTS && first < last; hart++, first += slice)
+        run(hart, SMP_JOB_ZERO, first, last - first < slice ? last - first : slice);
+}
+
+void smp_crc_begin(unsigned long bytes)
+{
+    // at most SMP_JOBS - 3 jobs, leaving lines for zeroing, the last piece and exit
+    unsigned long job = (bytes + SMP_JOBS - 4) / (SMP_JOBS - 3);
+
+    STATE->crcLeft = bytes;
+    STATE->crcJob = job < SMP_CRC_MIN_BYTES ? SMP_CRC_MIN_BYTES : job;
+    STATE->pendLen = 0;
+    STATE->crc = CRC32_INIT;
+}
+
+void smp_crc(const void *buf, unsigned long len)
+{
+    unsigned long addr = (unsigned long) buf;
+
+    if (len > STATE->crcLeft)
+        len = STATE->crcLeft;
+    STATE->crcLeft -= len;
+    if (SMP_HARTS == 1)
+    {
+        STATE->crc = crc32_update(CRC32_TABLE, STATE->crc, buf, len);
+        return;
+    }
+    if (STATE->pendLen && addr != STATE->pendAddr + STATE->pendLen)
+    {
+        run(CRC_HART, SMP_JOB_CRC, STATE->pendAddr, STATE->pendLen);
+        STATE->pendLen = 0;
+    }
+    if (STATE->pendLen == 0)
+        STATE->pendAddr = addr;
+    STATE->pendLen += len;
+    if (STATE->pendLen >= STATE->crcJob)
+    {
+        run(CRC_HART, SMP_JOB_CRC, STATE->pendAddr, STATE->pendLen);
+        STATE->pendLen = 0;
+    }
+}
+
+uint32_t smp_crc_result(void)
+{
+    unsigned long seq;
+
+    if (SMP_HARTS == 1)
+        return STATE->crc ^ CRC32_FINAL;
+    if (STATE->pendLen)
+    {
+        run(CRC_HART, SMP_JOB_CRC, STATE->pendAddr, STATE->pendLen);
+        STATE->pendLen = 0;
+    }
+    seq = STATE->seq[CRC_HART];
+    while (MSIP(CRC_HART)) {};
+    // the CRC hart reports its sum after each job, zeroing included
+    return seq == 0 ? 0 : *RESULT(CRC_HART, seq - 1) ^ CRC32_FINAL;
+}
+
+void smp_park(void)
+{
+    int hart;
+
+    for (hart = 1; hart < SMP_HARTS; hart++)
+        run(hart, SMP_JOB_EXIT, 0, 0);
+    for (hart = 1; hart < SMP_HARTS; hart++)
+        while (MSIP(hart)) {};
+}
+
+void smp_release(void)
+{
+    int hart;
+
+    for (hart = 1; hart < SMP_HARTS; hart++)
+        MSIP(hart) = 1;
+}
+
+void smp_worker(int hart)
+{
+    uint32_t table[8][256];
+    uint32_t crc = CRC32_INIT;
+    volatile smp_job_t *job;
+    unsigned long seq, op, *p, *end;
+
+    if (hart == CRC_HART)
+        crc32_table(table);
+    asm volatile("csrs mie, %0" : : "r"(MIE_MSIE)); // wakes wfi; mstatus.MIE stays clear
+    for (seq = 0; seq < SMP_JOBS; seq++)
+    {
+        // the CLINT rather than mip, which may not yet show the clear below
+        while (MSIP(hart) == 0)
+            asm volatile("wfi");
+        job = JOB(hart, seq);
+        op = job->op;
+        if (op == SMP_JOB_ZERO)
+            for (p = (unsigned long *) job->addr, end = p + job->len / sizeof(*p); p < end; p++)
+                *p = 0;
+        else if (op == SMP_JOB_CRC)
+            crc = crc32_update(table, crc, (const void *) job->addr, job->len);
+        *RESULT(hart, seq) = crc;
+        publish();
+        MSIP(hart) = 0;
+        if (op == SMP_JOB_EXIT) return;
+    }
+}
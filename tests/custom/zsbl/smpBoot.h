@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Harts on the board.  Hart 0 boots.  The others wait in bios.s, run the jobs hart 0
+// hands them while it copies the boot image, and wait again until hart 0 jumps to
+// the image, which they then enter together with it.
+#ifndef SMP_HARTS
+#define SMP_HARTS 1
+#endif
+#define SMP_MAX_HARTS 16
+
+#define CLINT_MSIP(hart) (0x2000000UL + 4*(hart))
+
+// RAM used by zsbl, which has no writable .data or .bss (see uart.h).  bios.s starts
+// hart 0's stack at the top of RAM and secondary hart h at SMP_STACK_TOP -
+// (h-1)*SMP_STACK_SIZE; bios.s cannot include this header, so keep the two in step.
+#define SMP_STACK_TOP  0x87F80000
+#define SMP_STACK_SIZE 0x8000
+
+// Job and result lines, each used once.  Wally's caches are not coherent, so a hart
+// must never read a line again after another hart has written it; a fresh line per
+// job keeps stale copies out of every cache.  Hart 0's own state sits in the lines of
+// hart 0, which takes no jobs.
+#define SMP_JOB_BASE   0x87E00000
+#define SMP_JOBS       256           // per hart per boot
+#define SMP_LINE       64
+
+// Smallest CRC job; larger images use larger jobs to fit in SMP_JOBS
+#define SMP_CRC_MIN_BYTES 0x8000
+
+void smp_init(void);
+
+// Zero [start, end), both multiples of 8, on the secondary harts while hart 0 goes
+// on.  The range must not overlap the boot image or memory hart 0 has used.
+void smp_zero(void *start, void *end);
+
+// Start the CRC-32 of an image of bytes; anything passed to smp_crc past them is
+// ignored, so whole blocks can be passed
+void smp_crc_begin(unsigned long bytes);
+
+// Add len bytes just copied to buf to the image CRC-32.  Consecutive pieces are
+// gathered into jobs for hart 1, so that hart 0 goes on copying meanwhile; without
+// another hart they are added here.
+void smp_crc(const void *buf, unsigned long len);
+
+// Wait for the CRC-32 of everything passed to smp_crc
+uint32_t smp_crc_result(void);
+
+// Wait for every job, then send the secondary harts back to bios.s to wait for the jump
+void smp_park(void);
+
+// Called by bios.s: wake the parked harts to jump to the boot image with hart 0
+void smp_release(void);
+
+// Entry of secondary harts from bios.s; returns when hart 0 parks them
+void smp_worker(int hart);
@@ -1,4 +1,19 @@
 #include "uart.h"
+#include "plic.h"
+
+#if UART_BUFFERED
+typedef struct uart_tx_ring
+{
+    unsigned long head;  // next character written
+    unsigned long tail;  // next character sent
+    uint8_t ier;         // last value written to the interrupt enable register
+    uint8_t buffered;    // cleared by flush_uart
+    char buf[UART_TX_RING_SIZE];
+} uart_tx_ring_t;
+
+// Only touched with interrupts masked, or in the handler where they are
+#define TX_RING ((volatile uart_tx_ring_t *) UART_TX_RING)
+#endif
 
 void write_reg_u8(uintptr_t addr, uint8_t value)
 {
@@ -13,11 +28,61 @@ uint8_t read_reg_u8(uintptr_t addr)
 
 int is_transmit_empty()
 {
-    return read_reg_u8(UART_LINE_STATUS) & 0x20;
+    return read_reg_u8(UART_LINE_STATUS) & UART_LSR_THRE;
 }
 
+#if UART_BUFFERED
+// Refill the transmit FIFO once it is empty, and keep the THRE interrupt enabled
+// while characters are left in the ring
+static void fill_uart_fifo(void)
+{
+    volatile uart_tx_ring_t *ring = TX_RING;
+    uint8_t ier;
+    int n;
+
+    if (is_transmit_empty())
+        for (n = 0; n < UART_FIFO_DEPTH && ring->tail != ring->head; n++, ring->tail++)
+            write_reg_u8(UART_THR, ring->buf[ring->tail % UART_TX_RING_SIZE]);
+    ier = ring->tail != ring->head ? UART_IER_ETBEI : 0;
+    if (ier != ring->ier)
+    {
+        write_reg_u8(UART_INTERRUPT_ENABLE, ier);
+        ring->ier = ier;
+    }
+}
+
+void handle_uart_interrupt(void)
+{
+    read_reg_u8(UART_INTERRUPT_IDENT); // acknowledges THRE
+    fill_uart_fifo();
+}
+#endif
+
 void write_serial(char a)
 {
+#if UART_BUFFERED
+    volatile uart_tx_ring_t *ring = TX_RING;
+    unsigned long irq;
+
+    if (ring->buffered)
+    {
+        // Drain a full ring from here; the caller may have interrupts masked
+        while (ring->head - ring->tail == UART_TX_RING_SIZE)
+        {
+            irq = irq_save();
+            fill_uart_fifo();
+            irq_restore(irq);
+        }
+        irq = irq_save();
+        ring->buf[ring->head % UART_TX_RING_SIZE] = a;
+        ring->head++;
+        // start the ring if the interrupt is not already draining it
+        if (ring->ier == 0)
+            fill_uart_fifo();
+        irq_restore(irq);
+        return;
+    }
+#endif
     while (is_transmit_empty() == 0) {};
 
     write_reg_u8(UART_THR, a);
@@ -34,6 +99,35 @@ void init_uart(uint32_t freq, uint32_t baud)
     write_reg_u8(UART_LINE_CONTROL, 0x03);     // 8 bits, no parity, one stop bit
     write_reg_u8(UART_FIFO_CONTROL, 0xC7);     // Enable FIFO, clear them, with 14-byte threshold
     write_reg_u8(UART_MODEM_CONTROL, 0x20);    // Autoflow mode
+
+#if UART_BUFFERED
+    TX_RING->head = 0;
+    TX_RING->tail = 0;
+    TX_RING->ier = 0;
+    TX_RING->buffered = 1;
+    plic_enable(PLIC_UART_ID);
+    asm volatile("csrs mstatus, %0" : : "r"(MSTATUS_MIE));
+#endif
+}
+
+void flush_uart(void)
+{
+#if UART_BUFFERED
+    volatile uart_tx_ring_t *ring = TX_RING;
+    unsigned long irq;
+
+    while (ring->tail != ring->head)
+    {
+        irq = irq_save();
+        fill_uart_fifo();
+        irq_restore(irq);
+    }
+    irq_save();
+    ring->buffered = 0;
+    plic_disable(PLIC_UART_ID);
+    asm volatile("csrc mie, %0" : : "r"(MIE_MEIE));
+#endif
+    while ((read_reg_u8(UART_LINE_STATUS) & UART_LSR_TEMT) == 0) {};
 }
 
 void print_uart(const char *str)
@@ -89,3 +183,21 @@ void print_uart_byte(uint8_t byte)
     write_serial(hex[0]);
     write_serial(hex[1]);
 }
+
+void print_uart_dec_pad(uint64_t value, int digits)
+{
+    char buf[21];
+    int i = 0;
+    do
+    {
+        buf[i++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0 || i < digits);
+    while (i > 0)
+        write_serial(buf[--i]);
+}
+
+void print_uart_dec(uint64_t value)
+{
+    print_uart_dec_pad(value, 1);
+}
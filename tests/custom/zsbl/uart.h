@@ -4,6 +4,9 @@
 
 #define UART_BASE 0x10000000
 
+// clock of the FPGA boards, for baud rates and timing
+#define SYSTEMCLOCK 30000000
+
 #define UART_RBR UART_BASE + 0
 #define UART_THR UART_BASE + 0
 #define UART_INTERRUPT_ENABLE UART_BASE + 4
@@ -16,7 +19,45 @@
 #define UART_DLAB_LSB UART_BASE + 0
 #define UART_DLAB_MSB UART_BASE + 4
 
-void init_uart();
+#define UART_LSR_THRE 0x20 // transmit FIFO empty
+#define UART_LSR_TEMT 0x40 // transmitter idle
+#define UART_IER_ETBEI 0x02 // interrupt when the transmit FIFO empties
+#define UART_FIFO_DEPTH 16
+
+// Build with -DUART_BUFFERED=0 to write each character by polling the line status.
+// Otherwise write_serial queues characters in a ring that the THRE interrupt drains
+// a FIFO at a time, so printing overlaps with the SD card copy.
+#ifndef UART_BUFFERED
+#define UART_BUFFERED 1
+#endif
+
+// zsbl runs from ROM without writable .data or .bss, so the ring lives in RAM below
+// the 1 MiB at the top that bios.s gives the stack.  The size is a power of two; a
+// full ring makes write_serial wait for space.
+#define UART_TX_RING 0x87F00000
+#ifndef UART_TX_RING_SIZE
+#define UART_TX_RING_SIZE 4096
+#endif
+
+// Messages are printed at or below ZSBL_VERBOSITY.  The default prints progress;
+// -DZSBL_VERBOSITY=2 adds the GPT dump and 0 leaves only errors.
+#define VERBOSITY_ERROR 0
+#define VERBOSITY_INFO 1
+#define VERBOSITY_DEBUG 2
+#ifndef ZSBL_VERBOSITY
+#define ZSBL_VERBOSITY VERBOSITY_INFO
+#endif
+
+void init_uart(uint32_t freq, uint32_t baud);
+
+// Wait until every queued character has been sent, then return the UART to polled
+// output with its interrupt disabled, as the next stage expects to find it
+void flush_uart(void);
+
+// THRE interrupt handler, called by handle_trap
+void handle_uart_interrupt(void);
+
+void write_serial(char a);
 
 void print_uart(const char* str);
 
@@ -25,3 +66,7 @@ void print_uart_int(uint32_t addr);
 void print_uart_addr(uint64_t addr);
 
 void print_uart_byte(uint8_t byte);
+
+void print_uart_dec(uint64_t value);
+
+void print_uart_dec_pad(uint64_t value, int digits);